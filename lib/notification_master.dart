@@ -5,10 +5,16 @@ import 'package:flutter/services.dart';
 
 import 'notification_master_platform_interface.dart';
 import 'src/notification_polling.dart';
+import 'src/tools/fetched_notifications.dart';
+import 'src/tools/notification_history.dart';
+import 'src/tools/notification_event.dart';
 import 'src/tools/notification_importance.dart';
 
 export 'package:notification_master/src/notification_master_desktop.dart';
 
+export 'src/tools/fetched_notifications.dart';
+export 'src/tools/notification_history.dart';
+export 'src/tools/notification_event.dart';
 export 'src/tools/notification_importance.dart';
 export 'src/unified_notification_service.dart';
 
@@ -151,6 +157,15 @@ class NotificationMaster {
     );
   }
 
+  /// Creates (or replaces) a notification channel.
+  ///
+  /// On Linux channels are persisted and also used by the background
+  /// poller. Notifications and feed items (`channelId`) on a channel get its
+  /// urgency (from [importance]), [timeoutMs] (0 never expires), [sound]
+  /// (a sound-name such as `message-new-instant`; [enableSound] `false`
+  /// silences it) and [category]. [maxPerMinute] rate-limits the channel
+  /// with a token bucket holding [burst] notifications (default: ten
+  /// seconds' worth); notifications over the limit are dropped.
   Future<bool> createCustomChannel({
     required String channelId,
     required String channelName,
@@ -160,6 +175,11 @@ class NotificationMaster {
     int? lightColor,
     bool? enableVibration,
     bool? enableSound,
+    String? sound,
+    String? category,
+    int? timeoutMs,
+    int? maxPerMinute,
+    int? burst,
   }) {
     return NotificationMasterPlatform.instance.createCustomChannel(
       channelId: channelId,
@@ -170,6 +190,11 @@ class NotificationMaster {
       lightColor: lightColor,
       enableVibration: enableVibration,
       enableSound: enableSound,
+      sound: sound,
+      category: category,
+      timeoutMs: timeoutMs,
+      maxPerMinute: maxPerMinute,
+      burst: burst,
     );
   }
 
@@ -325,6 +350,49 @@ class NotificationMaster {
     return NotificationMasterPlatform.instance.getSubscribedTopics();
   }
 
+  /// Subscribe to many topics in one call.
+  ///
+  /// On Linux the whole batch is applied in a single native transaction; set
+  /// [showConfirmation] to show one summary notification instead of none.
+  /// Other platforms fall back to one [subscribeToTopic] call per topic.
+  Future<bool> subscribeToTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) {
+    return NotificationMasterPlatform.instance.subscribeToTopics(
+      topics,
+      showConfirmation: showConfirmation,
+    );
+  }
+
+  /// Unsubscribe from many topics in one call. See [subscribeToTopics].
+  Future<bool> unsubscribeFromTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) {
+    return NotificationMasterPlatform.instance.unsubscribeFromTopics(
+      topics,
+      showConfirmation: showConfirmation,
+    );
+  }
+
+  /// Replace the subscribed topic set with [topics] (set semantics).
+  ///
+  /// Useful for syncing the server-side topic list at login:
+  ///
+  /// ```dart
+  /// await notificationMaster.setTopics(serverTopics);
+  /// ```
+  Future<bool> setTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) {
+    return NotificationMasterPlatform.instance.setTopics(
+      topics,
+      showConfirmation: showConfirmation,
+    );
+  }
+
   /// Schedule a notification to be shown by the operating system at a fixed
   /// time, even when the app is fully closed (a real background service).
   ///
@@ -438,4 +506,171 @@ class NotificationMaster {
   Future<bool> isBackgroundPollingRunning() {
     return NotificationMasterPlatform.instance.isBackgroundPollingRunning();
   }
+
+  /// Poll, parse and display metrics in Prometheus text exposition format.
+  ///
+  /// Keys are the metric source: `plugin` (the in-app polling thread) and,
+  /// once the background daemon has run, `daemon`. Covers HTTP latency, bytes
+  /// and status codes, parse time, items per poll, dedupe hits, display
+  /// latency and notification-server errors.
+  ///
+  /// Currently collected on Linux; other platforms return an empty map.
+  Future<Map<String, String>> getPollingMetrics() {
+    return NotificationMasterPlatform.instance.getPollingMetrics();
+  }
+
+  /// Writes the spans recorded so far as Chrome trace JSON and returns the
+  /// file path, for viewing in https://ui.perfetto.dev or chrome://tracing.
+  ///
+  /// Tracing is opt-in: start the app with `NM_TRACE=1` (files go to
+  /// `$TMPDIR`) or `NM_TRACE=<directory>`. Returns `null` when tracing is
+  /// off. Currently Linux only; other platforms return `null`.
+  Future<String?> dumpTrace() {
+    return NotificationMasterPlatform.instance.dumpTrace();
+  }
+
+  /// Fetches [url] through the native HTTP client the polling thread uses, so
+  /// the app keeps one connection pool and one parser.
+  ///
+  /// Responses are decompressed natively. With [conditional] (the default),
+  /// the request carries the validators of the last response this method got
+  /// for [url], and a feed unchanged since then comes back as `notModified`
+  /// with no items. The polling thread keeps validators of its own, so its
+  /// requests never turn a fetch into `notModified`. With
+  /// [filterTopics], the request is scoped to the subscribed topics like
+  /// `startNotificationPolling`, and items for other topics are dropped.
+  /// With [show], the items are also displayed natively.
+  ///
+  /// Throws a [PlatformException] (`FETCH_FAILED`, `INVALID_RESPONSE`) when
+  /// the request or parsing fails. Returns `null` on platforms without a
+  /// native fetch (currently all but Linux).
+  Future<FetchedNotifications?> fetchNotifications(
+    String url, {
+    Map<String, String>? headers,
+    bool conditional = true,
+    bool filterTopics = true,
+    bool show = false,
+  }) {
+    return NotificationMasterPlatform.instance.fetchNotifications(
+      url,
+      headers: headers,
+      conditional: conditional,
+      filterTopics: filterTopics,
+      show: show,
+    );
+  }
+
+  /// Lifecycle events for notifications shown by this app: delivered,
+  /// clicked ([NotificationEventType.actionInvoked]), closed, and feed items
+  /// fetched by the native poller.
+  ///
+  /// Each list holds the events of one native frame (~16 ms). Repeated
+  /// events of one type for one notification within a frame are merged into
+  /// the latest one, so a badge or inbox can rebuild once per list. Items
+  /// from `startNotificationPolling`, and from the background poller while
+  /// the app is listening, arrive as [NotificationEventType.fetched], so a
+  /// second poller in Dart is not needed. Currently Linux only; other
+  /// platforms emit nothing.
+  Stream<List<NotificationEvent>> get notificationEvents =>
+      NotificationMasterPlatform.instance.notificationEvents;
+
+  /// Closes the notification shown by [showNotification] with [id].
+  ///
+  /// On Linux, calling [showNotification] again with an [id] that is still
+  /// on screen updates that notification instead of adding another; without
+  /// an id one is assigned and returned. Returns `false` when nothing with
+  /// [id] is showing. Currently Linux only; other platforms return `false`.
+  Future<bool> cancelNotification(int id) {
+    return NotificationMasterPlatform.instance.cancelNotification(id);
+  }
+
+  /// Closes every notification shown by [showNotification].
+  Future<bool> cancelAllNotifications() {
+    return NotificationMasterPlatform.instance.cancelAllNotifications();
+  }
+
+  /// Shows a notification with a progress bar at [progress] percent (0–100)
+  /// and starts its update stream; report changes with [updateProgress].
+  ///
+  /// The native side shows at most [maxUpdatesPerSecond] updates a second
+  /// (1–60) for [id], so progress can be reported as often as it changes.
+  /// Currently Linux only; other platforms return `false`.
+  Future<bool> showProgressNotification({
+    required int id,
+    required String title,
+    String? message,
+    int progress = 0,
+    int maxUpdatesPerSecond = 5,
+  }) {
+    return NotificationMasterPlatform.instance.showProgressNotification(
+      id: id,
+      title: title,
+      message: message,
+      progress: progress,
+      maxUpdatesPerSecond: maxUpdatesPerSecond,
+    );
+  }
+
+  /// Reports [progress] for the notification started by
+  /// [showProgressNotification] with [id]. Updates between two refreshes
+  /// replace each other, so only the latest is shown. [title] and [message]
+  /// keep their previous values when omitted.
+  ///
+  /// Pass [done] with the finished state: it is shown right away, exactly
+  /// once, and later updates for [id] return `false` until the notification
+  /// is started again.
+  Future<bool> updateProgress(
+    int id, {
+    required int progress,
+    String? title,
+    String? message,
+    bool done = false,
+  }) {
+    return NotificationMasterPlatform.instance.updateProgress(
+      id,
+      progress: progress,
+      title: title,
+      message: message,
+      done: done,
+    );
+  }
+
+  /// A page of the notifications already shown on this device, newest first,
+  /// read from local storage without a server round-trip.
+  ///
+  /// The history holds what this app showed (except progress updates) and
+  /// what the in-app and background pollers fetched. Pass the page's
+  /// `nextCursor` as [cursor] for the next, older page. [limit] is capped at
+  /// 500. Entries older than 30 days are dropped. Currently Linux only;
+  /// other platforms return `null`.
+  Future<NotificationHistoryPage?> getNotificationHistory({
+    int? cursor,
+    int limit = 50,
+    NotificationHistoryFilter? filter,
+  }) {
+    return NotificationMasterPlatform.instance.getNotificationHistory(
+      cursor: cursor,
+      limit: limit,
+      filter: filter,
+    );
+  }
+
+  /// Searches the titles, messages and expanded texts of the local
+  /// notification history and returns the newest [limit] matches, newest
+  /// first.
+  ///
+  /// An entry matches when it holds every word of [query], ignoring case and
+  /// accents. The last word also matches as a prefix, so results can follow
+  /// the user's typing; end any other word with `*` to do the same. Chinese
+  /// and Japanese characters match one by one. [limit] is capped at 500.
+  /// Currently Linux only; other platforms return `null`.
+  Future<List<NotificationHistoryEntry>?> searchNotifications(
+    String query, {
+    int limit = 20,
+  }) {
+    return NotificationMasterPlatform.instance.searchNotifications(
+      query,
+      limit: limit,
+    );
+  }
 }
@@ -2,6 +2,9 @@ import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 import 'notification_master_platform_interface.dart';
+import 'src/tools/fetched_notifications.dart';
+import 'src/tools/notification_history.dart';
+import 'src/tools/notification_event.dart';
 import 'src/tools/notification_importance.dart';
 
 /// An implementation of [NotificationMasterPlatform] that uses method channels.
@@ -9,6 +12,11 @@ class MethodChannelNotificationMaster extends NotificationMasterPlatform {
   @visibleForTesting
   final methodChannel = const MethodChannel('notification_master');
 
+  @visibleForTesting
+  final eventChannel = const EventChannel('notification_master/events');
+
+  Stream<List<NotificationEvent>>? _notificationEvents;
+
   @override
   Future<String?> getPlatformVersion() async {
     final version = await methodChannel.invokeMethod<String>(
@@ -152,6 +160,11 @@ class MethodChannelNotificationMaster extends NotificationMasterPlatform {
     int? lightColor,
     bool? enableVibration,
     bool? enableSound,
+    String? sound,
+    String? category,
+    int? timeoutMs,
+    int? maxPerMinute,
+    int? burst,
   }) async {
     final result = await methodChannel
         .invokeMethod<bool>('createCustomChannel', {
@@ -163,6 +176,11 @@ class MethodChannelNotificationMaster extends NotificationMasterPlatform {
           'lightColor': lightColor,
           'enableVibration': enableVibration,
           'enableSound': enableSound,
+          'sound': sound,
+          'category': category,
+          'timeoutMs': timeoutMs,
+          'maxPerMinute': maxPerMinute,
+          'burst': burst,
         });
     return result ?? false;
   }
@@ -310,6 +328,59 @@ class MethodChannelNotificationMaster extends NotificationMasterPlatform {
     return result ?? [];
   }
 
+  @override
+  Future<bool> subscribeToTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) => _invokeTopicBatch(
+    'subscribeToTopics',
+    topics,
+    showConfirmation,
+    () => super.subscribeToTopics(topics, showConfirmation: showConfirmation),
+  );
+
+  @override
+  Future<bool> unsubscribeFromTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) => _invokeTopicBatch(
+    'unsubscribeFromTopics',
+    topics,
+    showConfirmation,
+    () =>
+        super.unsubscribeFromTopics(topics, showConfirmation: showConfirmation),
+  );
+
+  @override
+  Future<bool> setTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) => _invokeTopicBatch(
+    'setTopics',
+    topics,
+    showConfirmation,
+    () => super.setTopics(topics, showConfirmation: showConfirmation),
+  );
+
+  /// Sends a whole topic diff in one platform call. Platforms that do not
+  /// implement the bulk method natively get the per-topic [fallback].
+  Future<bool> _invokeTopicBatch(
+    String method,
+    List<String> topics,
+    bool showConfirmation,
+    Future<bool> Function() fallback,
+  ) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>(method, {
+        'topics': topics,
+        'showConfirmation': showConfirmation,
+      });
+      return result ?? false;
+    } on MissingPluginException {
+      return fallback();
+    }
+  }
+
   @override
   Future<bool> scheduleNotification({
     required int id,
@@ -416,4 +487,182 @@ class MethodChannelNotificationMaster extends NotificationMasterPlatform {
     );
     return result ?? false;
   }
+
+  @override
+  Future<Map<String, String>> getPollingMetrics() async {
+    try {
+      final result = await methodChannel.invokeMapMethod<String, String>(
+        'getPollingMetrics',
+      );
+      return result ?? const {};
+    } on MissingPluginException {
+      return const {};
+    }
+  }
+
+  @override
+  Future<String?> dumpTrace() async {
+    try {
+      return await methodChannel.invokeMethod<String>('dumpTrace');
+    } on MissingPluginException {
+      return null;
+    }
+  }
+
+  @override
+  Future<FetchedNotifications?> fetchNotifications(
+    String url, {
+    Map<String, String>? headers,
+    bool conditional = true,
+    bool filterTopics = true,
+    bool show = false,
+  }) async {
+    try {
+      final result = await methodChannel.invokeMapMethod<String, dynamic>(
+        'fetchNotifications',
+        {
+          'url': url,
+          if (headers != null)
+            'headers': [
+              for (final header in headers.entries)
+                '${header.key}: ${header.value}',
+            ],
+          'conditional': conditional,
+          'filterTopics': filterTopics,
+          'show': show,
+        },
+      );
+      return result == null ? null : FetchedNotifications.fromMap(result);
+    } on MissingPluginException {
+      return null;
+    }
+  }
+
+  @override
+  Stream<List<NotificationEvent>> get notificationEvents {
+    return _notificationEvents ??= eventChannel
+        .receiveBroadcastStream()
+        .map(
+          (batch) => (batch as List)
+              .map((e) => NotificationEvent.fromMap(e as Map))
+              .whereType<NotificationEvent>()
+              .toList(growable: false),
+        )
+        .where((events) => events.isNotEmpty)
+        .asBroadcastStream();
+  }
+
+  @override
+  Future<bool> cancelNotification(int id) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>(
+        'cancelNotification',
+        {'id': id},
+      );
+      return result ?? false;
+    } on MissingPluginException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> showProgressNotification({
+    required int id,
+    required String title,
+    String? message,
+    int progress = 0,
+    int maxUpdatesPerSecond = 5,
+  }) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>(
+        'showProgressNotification',
+        {
+          'id': id,
+          'title': title,
+          'message': message,
+          'progress': progress,
+          'maxUpdatesPerSecond': maxUpdatesPerSecond,
+        },
+      );
+      return result ?? false;
+    } on MissingPluginException {
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> updateProgress(
+    int id, {
+    required int progress,
+    String? title,
+    String? message,
+    bool done = false,
+  }) async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>('updateProgress', {
+        'id': id,
+        'progress': progress,
+        'title': title,
+        'message': message,
+        'done': done,
+      });
+      return result ?? false;
+    } on MissingPluginException {
+      return false;
+    }
+  }
+
+  @override
+  Future<NotificationHistoryPage?> getNotificationHistory({
+    int? cursor,
+    int limit = 50,
+    NotificationHistoryFilter? filter,
+  }) async {
+    try {
+      final result = await methodChannel.invokeMapMethod<String, dynamic>(
+        'getNotificationHistory',
+        {
+          'cursor': cursor,
+          'limit': limit,
+          'channelId': filter?.channelId,
+          'topic': filter?.topic,
+          'since': filter?.since?.millisecondsSinceEpoch,
+          'until': filter?.until?.millisecondsSinceEpoch,
+        },
+      );
+      return result == null ? null : NotificationHistoryPage.fromMap(result);
+    } on MissingPluginException {
+      return null;
+    }
+  }
+
+  @override
+  Future<List<NotificationHistoryEntry>?> searchNotifications(
+    String query, {
+    int limit = 20,
+  }) async {
+    try {
+      final result = await methodChannel.invokeMapMethod<String, dynamic>(
+        'searchNotifications',
+        {'query': query, 'limit': limit},
+      );
+      return result == null
+          ? null
+          : NotificationHistoryPage.fromMap(result).entries;
+    } on MissingPluginException {
+      return null;
+    }
+  }
+
+  @override
+  Future<bool> cancelAllNotifications() async {
+    try {
+      final result = await methodChannel.invokeMethod<bool>(
+        'cancelAllNotifications',
+      );
+      return result ?? false;
+    } on MissingPluginException {
+      return false;
+    }
+  }
 }
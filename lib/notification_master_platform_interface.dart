@@ -1,6 +1,9 @@
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'notification_master_method_channel.dart';
+import 'src/tools/fetched_notifications.dart';
+import 'src/tools/notification_history.dart';
+import 'src/tools/notification_event.dart';
 import 'src/tools/notification_importance.dart';
 
 abstract class NotificationMasterPlatform extends PlatformInterface {
@@ -103,6 +106,11 @@ abstract class NotificationMasterPlatform extends PlatformInterface {
     int? lightColor,
     bool? enableVibration,
     bool? enableSound,
+    String? sound,
+    String? category,
+    int? timeoutMs,
+    int? maxPerMinute,
+    int? burst,
   }) {
     throw UnimplementedError('createCustomChannel() has not been implemented.');
   }
@@ -205,6 +213,56 @@ abstract class NotificationMasterPlatform extends PlatformInterface {
     throw UnimplementedError('getSubscribedTopics() has not been implemented.');
   }
 
+  /// Subscribes to every topic in [topics] in one call.
+  ///
+  /// Platforms without a native bulk implementation fall back to one
+  /// [subscribeToTopic] call per topic (and show that platform's per-topic
+  /// confirmation, if any). Returns `true` when every topic was applied.
+  Future<bool> subscribeToTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) async {
+    var ok = true;
+    for (final topic in topics.toSet()) {
+      ok = await subscribeToTopic(topic) && ok;
+    }
+    return ok;
+  }
+
+  /// Unsubscribes from every topic in [topics] in one call.
+  ///
+  /// Falls back to one [unsubscribeFromTopic] call per topic where there is no
+  /// native bulk implementation.
+  Future<bool> unsubscribeFromTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) async {
+    var ok = true;
+    for (final topic in topics.toSet()) {
+      ok = await unsubscribeFromTopic(topic) && ok;
+    }
+    return ok;
+  }
+
+  /// Replaces the subscribed topic set with [topics]: topics not in the list
+  /// are unsubscribed, new ones are subscribed, unchanged ones are untouched.
+  Future<bool> setTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) async {
+    final current = (await getSubscribedTopics()).toSet();
+    final wanted = topics.toSet();
+    final removed = await unsubscribeFromTopics(
+      current.difference(wanted).toList(),
+      showConfirmation: showConfirmation,
+    );
+    final added = await subscribeToTopics(
+      wanted.difference(current).toList(),
+      showConfirmation: showConfirmation,
+    );
+    return removed && added;
+  }
+
   /// Schedule a notification to be delivered by the operating system at a
   /// specific point in time, even when the app is fully closed.
   Future<bool> scheduleNotification({
@@ -269,6 +327,89 @@ abstract class NotificationMasterPlatform extends PlatformInterface {
     );
   }
 
+  /// Poll/parse/display metrics in Prometheus text format, keyed by source
+  /// (`plugin`, `daemon`). Empty on platforms that do not collect them.
+  Future<Map<String, String>> getPollingMetrics() {
+    return Future.value(const {});
+  }
+
+  /// Writes recorded pipeline spans as Chrome trace JSON and returns the
+  /// file path, or `null` when tracing is off or unsupported.
+  Future<String?> dumpTrace() {
+    return Future.value(null);
+  }
+
+  /// Fetches and parses a notification feed natively. Returns `null` where
+  /// there is no native fetch, so callers fall back to a Dart HTTP client.
+  Future<FetchedNotifications?> fetchNotifications(
+    String url, {
+    Map<String, String>? headers,
+    bool conditional = true,
+    bool filterTopics = true,
+    bool show = false,
+  }) {
+    return Future.value(null);
+  }
+
+  /// Lifecycle events of the notifications shown by this app, one list per
+  /// native frame. Empty on platforms that do not report them.
+  Stream<List<NotificationEvent>> get notificationEvents {
+    return const Stream.empty();
+  }
+
+  /// Closes the notification shown with [id]. Returns `false` when it is not
+  /// showing or the platform cannot close notifications.
+  Future<bool> cancelNotification(int id) {
+    return Future.value(false);
+  }
+
+  /// Closes every notification this app is showing.
+  Future<bool> cancelAllNotifications() {
+    return Future.value(false);
+  }
+
+  /// Shows a notification with a progress bar at [progress] percent and
+  /// starts its update stream. Returns `false` where unsupported.
+  Future<bool> showProgressNotification({
+    required int id,
+    required String title,
+    String? message,
+    int progress = 0,
+    int maxUpdatesPerSecond = 5,
+  }) {
+    return Future.value(false);
+  }
+
+  /// Reports new progress for the notification started with [id].
+  Future<bool> updateProgress(
+    int id, {
+    required int progress,
+    String? title,
+    String? message,
+    bool done = false,
+  }) {
+    return Future.value(false);
+  }
+
+  /// One page of the local history of displayed notifications, newest
+  /// first. Returns `null` where there is no local history.
+  Future<NotificationHistoryPage?> getNotificationHistory({
+    int? cursor,
+    int limit = 50,
+    NotificationHistoryFilter? filter,
+  }) {
+    return Future.value(null);
+  }
+
+  /// The newest history entries matching [query], newest first. Returns
+  /// `null` where there is no local history.
+  Future<List<NotificationHistoryEntry>?> searchNotifications(
+    String query, {
+    int limit = 20,
+  }) {
+    return Future.value(null);
+  }
+
   /// Android 12+: whether the app may schedule exact alarms.
   /// Other platforms return `true`.
   Future<bool> canScheduleExactAlarms() {
@@ -231,6 +231,11 @@ class NotificationMasterWeb extends NotificationMasterPlatform {
     int? lightColor,
     bool? enableVibration,
     bool? enableSound,
+    String? sound,
+    String? category,
+    int? timeoutMs,
+    int? maxPerMinute,
+    int? burst,
   }) async {
     // Web doesn't have notification channels like Android
     // We'll just return true to indicate success
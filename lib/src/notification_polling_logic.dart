@@ -6,6 +6,15 @@ import 'package:http/http.dart' as http;
 import '../notification_master.dart';
 
 Future<void> fetchAndShowNotifications(String url) async {
+  // Where the plugin has a native fetch, it requests, parses and shows the
+  // items in one call, on the connection pool its own poller uses.
+  final fetched = await NotificationMaster().fetchNotifications(
+    url,
+    filterTopics: false,
+    show: true,
+  );
+  if (fetched != null) return;
+
   final response = await http.get(Uri.parse(url));
   if (response.statusCode == 200) {
     final data = jsonDecode(response.body);
@@ -0,0 +1,44 @@
+/// The reply to `NotificationMaster().fetchNotifications()`.
+class FetchedNotifications {
+  const FetchedNotifications({
+    required this.status,
+    required this.notModified,
+    required this.items,
+  });
+
+  /// Decodes the native reply. The items arrive as one flat list holding the
+  /// values named by `fields` for each item in turn.
+  factory FetchedNotifications.fromMap(Map<dynamic, dynamic> map) {
+    final fields = List<String>.from(map['fields'] as List? ?? const []);
+    final flat = map['items'] as List? ?? const [];
+    final items = <Map<String, dynamic>>[];
+    if (fields.isNotEmpty) {
+      for (var i = 0; i + fields.length <= flat.length; i += fields.length) {
+        final item = <String, dynamic>{};
+        for (var f = 0; f < fields.length; f++) {
+          final value = flat[i + f];
+          // Absent values come through as "" / 0.
+          if (value == '' || value == 0) continue;
+          item[fields[f]] = value;
+        }
+        items.add(item);
+      }
+    }
+    return FetchedNotifications(
+      status: map['status'] as int? ?? 0,
+      notModified: map['notModified'] as bool? ?? false,
+      items: items,
+    );
+  }
+
+  /// HTTP status of the response.
+  final int status;
+
+  /// The feed has not changed since the previous fetch of the same URL
+  /// (HTTP 304); [items] is empty.
+  final bool notModified;
+
+  /// Parsed feed items with the keys `id`, `title`, `message`, `bigText`,
+  /// `imageUrl`, `topic` and `sentAt` (epoch milliseconds), when present.
+  final List<Map<String, dynamic>> items;
+}
@@ -0,0 +1,77 @@
+/// What happened to a notification (see [NotificationEvent]).
+enum NotificationEventType {
+  /// The notification server accepted the notification.
+  delivered,
+
+  /// The user clicked the notification (`action == 'default'`) or one of
+  /// its action buttons.
+  actionInvoked,
+
+  /// The notification was closed; see [NotificationEvent.reason].
+  closed,
+
+  /// The native or background poller received a feed item; see
+  /// [NotificationEvent.payload].
+  fetched,
+}
+
+/// One notification lifecycle event from the native side.
+///
+/// Events arrive in batches, at most one per frame, on
+/// `NotificationMaster().notificationEvents`.
+class NotificationEvent {
+  const NotificationEvent({
+    required this.type,
+    this.id,
+    this.itemId,
+    this.action,
+    this.reason,
+    this.payload,
+  });
+
+  /// Decodes one entry of a batch sent on the `notification_master/events`
+  /// channel. Unknown types decode as `null` so newer native code does not
+  /// break older Dart code.
+  static NotificationEvent? fromMap(Map<dynamic, dynamic> map) {
+    final type = map['type'];
+    if (type is! int ||
+        type < 0 ||
+        type >= NotificationEventType.values.length) {
+      return null;
+    }
+    final payload = map['payload'];
+    return NotificationEvent(
+      type: NotificationEventType.values[type],
+      id: map['id'] as int?,
+      itemId: map['itemId'] as String?,
+      action: map['action'] as String?,
+      reason: map['reason'] as int?,
+      payload: payload is Map ? Map<String, dynamic>.from(payload) : null,
+    );
+  }
+
+  final NotificationEventType type;
+
+  /// The id passed to `showNotification` or `scheduleNotification`. `null`
+  /// for methods without an id and for polled items.
+  final int? id;
+
+  /// The feed item id of a polled notification.
+  final String? itemId;
+
+  /// The action key for [NotificationEventType.actionInvoked].
+  final String? action;
+
+  /// Why the notification closed: 1 expired, 2 dismissed by the user,
+  /// 3 closed by the app, 4 undefined.
+  final int? reason;
+
+  /// The feed item for [NotificationEventType.fetched]: `id`, `title`,
+  /// `message`, `bigText`, `imageUrl`, `topic` and `sentAt` when present.
+  final Map<String, dynamic>? payload;
+
+  @override
+  String toString() =>
+      'NotificationEvent($type, id: $id, itemId: $itemId, action: $action, '
+      'reason: $reason)';
+}
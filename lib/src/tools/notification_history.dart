@@ -0,0 +1,111 @@
+/// Narrows `NotificationMaster().getNotificationHistory()` to one channel,
+/// one topic and/or a time range. Unset fields match everything.
+class NotificationHistoryFilter {
+  const NotificationHistoryFilter({
+    this.channelId,
+    this.topic,
+    this.since,
+    this.until,
+  });
+
+  final String? channelId;
+  final String? topic;
+
+  /// Shown at or after this time.
+  final DateTime? since;
+
+  /// Shown before this time.
+  final DateTime? until;
+}
+
+/// One displayed notification from the local history.
+class NotificationHistoryEntry {
+  const NotificationHistoryEntry({
+    required this.seq,
+    required this.shownAt,
+    required this.source,
+    required this.title,
+    this.message,
+    this.bigText,
+    this.id,
+    this.itemId,
+    this.channelId,
+    this.topic,
+  });
+
+  /// Position in the history; stable, and usable as a cursor.
+  final int seq;
+
+  final DateTime shownAt;
+
+  /// `app` (shown by this app), `feed` (fetched by the in-app polling) or
+  /// `daemon` (fetched by the background poller).
+  final String source;
+
+  final String title;
+  final String? message;
+
+  /// The expanded text of feed items that had one.
+  final String? bigText;
+
+  /// The id the app gave the notification, if any.
+  final int? id;
+
+  /// The feed item id of polled notifications.
+  final String? itemId;
+
+  final String? channelId;
+  final String? topic;
+}
+
+/// The reply to `NotificationMaster().getNotificationHistory()`.
+class NotificationHistoryPage {
+  const NotificationHistoryPage({required this.entries, this.nextCursor});
+
+  /// Decodes the native reply. The entries arrive as one flat list holding
+  /// the values named by `fields` for each entry in turn.
+  factory NotificationHistoryPage.fromMap(Map<dynamic, dynamic> map) {
+    final fields = List<String>.from(map['fields'] as List? ?? const []);
+    final flat = map['items'] as List? ?? const [];
+    final entries = <NotificationHistoryEntry>[];
+    if (fields.isNotEmpty) {
+      for (var i = 0; i + fields.length <= flat.length; i += fields.length) {
+        final v = <String, dynamic>{
+          for (var f = 0; f < fields.length; f++) fields[f]: flat[i + f],
+        };
+        String? text(String key) {
+          final value = v[key] as String?;
+          return value == null || value.isEmpty ? null : value;
+        }
+
+        final id = v['id'] as int? ?? 0;
+        entries.add(
+          NotificationHistoryEntry(
+            seq: v['seq'] as int? ?? 0,
+            shownAt: DateTime.fromMillisecondsSinceEpoch(
+              v['shownAt'] as int? ?? 0,
+            ),
+            source: v['source'] as String? ?? 'app',
+            title: v['title'] as String? ?? '',
+            message: text('message'),
+            bigText: text('bigText'),
+            id: id == 0 ? null : id,
+            itemId: text('itemId'),
+            channelId: text('channelId'),
+            topic: text('topic'),
+          ),
+        );
+      }
+    }
+    return NotificationHistoryPage(
+      entries: entries,
+      nextCursor: map['nextCursor'] as int?,
+    );
+  }
+
+  /// Newest first.
+  final List<NotificationHistoryEntry> entries;
+
+  /// Pass as `cursor` for the next (older) page; `null` on the last page.
+  final int? nextCursor;
+}
@@ -0,0 +1,630 @@
+#include <benchmark/benchmark.h>
+#include <flutter_linux/flutter_linux.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <sys/wait.h>
+
+#include <string>
+#include <vector>
+
+#include "include/notification_master/notification_master_plugin.h"
+#include "notification_master_plugin_private.h"
+#include "nm_clock.h"
+#include "nm_dedupe.h"
+#include "nm_events.h"
+#include "nm_feed.h"
+#include "nm_handoff.h"
+#include "nm_history.h"
+#include "nm_poller_config.h"
+#include "nm_prefs.h"
+#include "nm_search.h"
+#include "nm_simhash.h"
+
+// Micro-benchmarks for the plugin's native hot paths.
+//
+// Build the example with include_notification_master_benchmarks set (see
+// example/linux/CMakeLists.txt), then run for x64 release:
+// $ build/linux/x64/release/plugins/notification_master/notification_master_benchmarks --benchmark_format=json --benchmark_out=bench.json
+//
+// Every benchmark runs against throwaway XDG_CONFIG_HOME, XDG_DATA_HOME and
+// XDG_RUNTIME_DIR directories so it never touches the user's real
+// notification_master files, and notifications go to a counting stub sink
+// instead of the desktop notification server (and stay out of the history).
+
+namespace notification_master {
+namespace benchmarks {
+
+static std::string g_scratch_dir;
+
+static std::string scratch_path(const char* name) {
+  return g_scratch_dir + "/" + name;
+}
+
+static size_t g_shown = 0;
+
+static gboolean counting_sink(const gchar* title, const gchar* message,
+                              GObject* notification) {
+  ++g_shown;
+  return TRUE;
+}
+
+// {"notifications": [...]} with |count| items. Every other item is on the
+// "offers" topic when |mixed_topics| is set; the rest are on "news".
+static std::string notifications_body(int count, size_t big_text_bytes = 0,
+                                      bool mixed_topics = false) {
+  std::string sent_at = std::to_string(nm_feed::now_epoch_ms());
+  std::string big_text(big_text_bytes, 'x');
+  std::string body = "{\"notifications\": [";
+  for (int i = 0; i < count; ++i) {
+    if (i > 0) body += ",";
+    std::string n = std::to_string(i);
+    body += "{\"id\": \"" + n + "\", \"title\": \"Title " + n +
+            "\", \"message\": \"Message body " + n + "\", \"topic\": \"" +
+            (mixed_topics && i % 2 ? "offers" : "news") +
+            "\", \"sentAt\": " + sent_at;
+    if (!big_text.empty()) body += ", \"bigText\": \"" + big_text + "\"";
+    body += "}";
+  }
+  return body + "]}";
+}
+
+// ── Response parsing + display (process_poll_response) ────────────────────
+
+static void BM_ProcessNotificationsList(benchmark::State& state) {
+  std::string body = notifications_body((int)state.range(0));
+  std::vector<std::string> topics;
+  g_shown = 0;
+  for (auto _ : state) {
+    process_poll_response(body.data(), body.size(), topics);
+  }
+  state.counters["shown"] =
+      benchmark::Counter((double)g_shown, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * (int64_t)body.size());
+}
+BENCHMARK(BM_ProcessNotificationsList)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMicrosecond);
+
+static void BM_ProcessDataObject(benchmark::State& state) {
+  std::string body =
+      "{\"data\": {\"id\": \"42\", \"title\": \"Build finished\", "
+      "\"message\": \"main is green\", \"topic\": \"alerts.build\", "
+      "\"sentAt\": \"2024-01-01T00:00:00Z\"}}";
+  std::vector<std::string> topics;
+  for (auto _ : state) {
+    process_poll_response(body.data(), body.size(), topics);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessDataObject)->Unit(benchmark::kMicrosecond);
+
+// Ten items carrying a bigText of range(0) bytes each.
+static void BM_ProcessBigText(benchmark::State& state) {
+  std::string body = notifications_body(10, (size_t)state.range(0));
+  std::vector<std::string> topics;
+  for (auto _ : state) {
+    process_poll_response(body.data(), body.size(), topics);
+  }
+  state.SetBytesProcessed(state.iterations() * (int64_t)body.size());
+}
+BENCHMARK(BM_ProcessBigText)->Arg(1 << 10)->Arg(64 << 10)
+    ->Unit(benchmark::kMicrosecond);
+
+// Half of the items are dropped by the topic filter before display.
+static void BM_ProcessTopicFiltered(benchmark::State& state) {
+  std::string body = notifications_body(1000, 0, true);
+  std::vector<std::string> topics = {"news", "alerts.*"};
+  g_shown = 0;
+  for (auto _ : state) {
+    process_poll_response(body.data(), body.size(), topics);
+  }
+  state.counters["shown"] =
+      benchmark::Counter((double)g_shown, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_ProcessTopicFiltered)->Unit(benchmark::kMicrosecond);
+
+// Non-JSON bodies fall back to one generic notification.
+static void BM_ProcessInvalidBody(benchmark::State& state) {
+  std::string body = "<html><body>502 Bad Gateway</body></html>";
+  std::vector<std::string> topics;
+  for (auto _ : state) {
+    process_poll_response(body.data(), body.size(), topics);
+  }
+}
+BENCHMARK(BM_ProcessInvalidBody)->Unit(benchmark::kMicrosecond);
+
+// ── Dedupe (background daemon) ─────────────────────────────────────────────
+
+// Inserting range(0) distinct keys into an empty cache.
+static void BM_DedupeInsert(benchmark::State& state) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < state.range(0); ++i) {
+    keys.push_back("Title " + std::to_string(i) + '\0' + "Message body");
+  }
+  for (auto _ : state) {
+    nm_dedupe::DedupeCache cache(60 * 60 * 1000);
+    for (const auto& k : keys) benchmark::DoNotOptimize(cache.should_show(k));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DedupeInsert)->RangeMultiplier(10)->Range(100, 100000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Repeat lookups (suppressed) against a cache holding range(0) keys.
+static void BM_DedupeLookupHit(benchmark::State& state) {
+  nm_dedupe::DedupeCache cache(60 * 60 * 1000);
+  std::vector<std::string> keys;
+  for (int i = 0; i < state.range(0); ++i) {
+    keys.push_back("Title " + std::to_string(i) + '\0' + "Message body");
+    cache.should_show(keys.back());
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache.should_show(keys[i]));
+    if (++i == keys.size()) i = 0;
+  }
+}
+BENCHMARK(BM_DedupeLookupHit)->RangeMultiplier(10)->Range(100, 100000);
+
+// A week of 15 s polling cycles on a SimulatedClock, each showing range(0)
+// fresh items: steady-state insert + expiry churn at the daemon's one-hour
+// window, without waiting a week.
+static void BM_DedupeSimulatedWeek(benchmark::State& state) {
+  const int kCycles = 7 * 24 * 60 * 4;
+  for (auto _ : state) {
+    nm_clock::SimulatedClock clock;
+    nm_dedupe::DedupeCache cache(60 * 60 * 1000, nm_dedupe::kDefaultMaxEntries,
+                                 &clock);
+    int next_id = 0;
+    for (int cycle = 0; cycle < kCycles; ++cycle) {
+      for (int i = 0; i < state.range(0); ++i) {
+        benchmark::DoNotOptimize(
+            cache.should_show("Title " + std::to_string(next_id++)));
+      }
+      clock.advance(15 * 1000);
+    }
+    state.counters["held"] = (double)cache.size();
+  }
+  state.SetItemsProcessed(state.iterations() * kCycles * state.range(0));
+}
+BENCHMARK(BM_DedupeSimulatedWeek)->Arg(1)->Arg(10)
+    ->Unit(benchmark::kMillisecond);
+
+// A synthetic feed: a few dozen templates filled with changing hosts,
+// counters and times (the repeats near-duplicate suppression is for), mixed
+// with free-text messages drawn from a small vocabulary.
+static std::vector<std::string> near_duplicate_corpus(size_t n) {
+  static const char* const kTemplates[] = {
+      "Build %d failed\nPipeline main failed at %d:%d after %d tests",
+      "Disk usage %d%%\n/var on web-%d is almost full",
+      "CPU high on db-%d\nload average %d.%d over the last %d minutes",
+      "New order #%d\nA customer ordered %d items totalling $%d.%d",
+      "Deploy %d finished\nRelease %d.%d rolled out to %d hosts",
+      "Backup completed\nSnapshot %d took %d seconds, %d MB written (%d)",
+  };
+  static const char* const kWords[] = {
+      "alice", "bob", "meeting", "moved", "to", "tomorrow", "the", "report",
+      "is", "ready", "please", "review", "ticket", "closed", "opened", "by",
+      "your", "package", "arrives", "today", "lunch", "invoice", "overdue",
+      "new", "comment", "on", "pull", "request", "approved", "merged"};
+  const size_t kTemplateCount = sizeof(kTemplates) / sizeof(kTemplates[0]);
+  const size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+  std::vector<std::string> corpus;
+  corpus.reserve(n);
+  uint32_t seed = 42;
+  auto next = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+  };
+  char buf[256];
+  for (size_t i = 0; i < n; ++i) {
+    if (next() % 2) {
+      snprintf(buf, sizeof(buf), kTemplates[next() % kTemplateCount],
+               (int)(next() % 10000), (int)(next() % 100),
+               (int)(next() % 60), (int)(next() % 1000));
+      corpus.emplace_back(buf);
+    } else {
+      std::string text;
+      for (int w = 0, words = 4 + next() % 12; w < words; ++w) {
+        text += kWords[next() % kWordCount];
+        text += w == 2 ? '\n' : ' ';
+      }
+      corpus.push_back(text);
+    }
+  }
+  return corpus;
+}
+
+static void BM_SimHash(benchmark::State& state) {
+  std::vector<std::string> corpus = near_duplicate_corpus(1024);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(nm_dedupe::simhash(corpus[i]));
+    if (++i == corpus.size()) i = 0;
+  }
+}
+BENCHMARK(BM_SimHash);
+
+// Lookup + insert against a full index (range(0) fingerprints, the daemon's
+// default bound at 4096), on the synthetic corpus at distance 3. "shown" is
+// the fraction that got through.
+static void BM_NearDuplicateLookup(benchmark::State& state) {
+  std::vector<uint64_t> fingerprints;
+  for (const std::string& text : near_duplicate_corpus(65536)) {
+    fingerprints.push_back(nm_dedupe::simhash(text));
+  }
+  nm_clock::SimulatedClock clock;
+  nm_dedupe::NearDuplicateIndex index(60 * 60 * 1000, state.range(0), &clock);
+  size_t i = 0;
+  size_t shown = 0;
+  size_t calls = 0;
+  for (auto _ : state) {
+    shown += index.should_show(fingerprints[i], 3);
+    ++calls;
+    if (++i == fingerprints.size()) i = 0;
+  }
+  state.counters["shown"] = (double)shown / calls;
+  state.counters["held"] = (double)index.size();
+}
+BENCHMARK(BM_NearDuplicateLookup)->Arg(1024)->Arg(4096)->Arg(16384);
+
+// ── Display history ─────────────────────────────────────────────────────────
+
+// One page of 50 from a history of range(0) records, newest first, with
+// range(1) = 1 filtering on a channel that holds a tenth of them. The first
+// query maps and indexes the file; later ones only page.
+static void BM_HistoryQuery(benchmark::State& state) {
+  std::string path = scratch_path("history.log");
+  g_remove(path.c_str());
+  {
+    nm_history::Writer writer(path, (size_t)1 << 40, nm_history::kRetentionMs);
+    for (int i = 0; i < state.range(0); ++i) {
+      nm_history::Record record;
+      record.shown_at_ms = 1700000000000 + i;
+      record.title = "Build " + std::to_string(i) + " finished";
+      record.message = "Pipeline main passed in 4m 12s";
+      record.channel = i % 10 ? "chat" : "ci";
+      writer.append(record);
+    }
+  }
+  nm_history::Reader reader(path);
+  nm_history::Query query;
+  if (state.range(1)) query.channel = "ci";
+  reader.refresh();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(reader.query(query));
+  }
+}
+BENCHMARK(BM_HistoryQuery)->Args({10000, 0})->Args({10000, 1})
+    ->Args({100000, 0})->Args({100000, 1})->Unit(benchmark::kMicrosecond);
+
+// searchNotifications against an index of a million synthetic notifications
+// (built once, shared by all cases), newest 20 hits. Covers a common word,
+// a rare one, an AND of both and a one-letter prefix.
+static const nm_search::Index& search_corpus() {
+  static const nm_search::Index* index = [] {
+    static const char* const kWords[] = {
+        "deploy", "build", "failed", "passed", "backup", "disk", "cpu",
+        "alert", "lunch", "meeting", "invoice", "review", "merged", "release"};
+    const size_t n = sizeof(kWords) / sizeof(kWords[0]);
+    auto* built = new nm_search::Index();
+    uint64_t x = 42;
+    for (int64_t seq = 0; seq < 1000000; ++seq) {
+      std::string text;
+      for (int w = 0; w < 6; ++w) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        text += kWords[(x >> 33) % n];
+        text += ' ';
+      }
+      text += "host" + std::to_string(seq % 5000);
+      built->add(seq, text);
+    }
+    return built;
+  }();
+  return *index;
+}
+
+static void BM_SearchNotifications(benchmark::State& state,
+                                   const char* query) {
+  const nm_search::Index& index = search_corpus();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(index.search(query, 20));
+  }
+}
+BENCHMARK_CAPTURE(BM_SearchNotifications, common, "deploy")
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_SearchNotifications, rare, "host4242")
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_SearchNotifications, all_words, "host4242 deploy")
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_SearchNotifications, prefix, "d")
+    ->Unit(benchmark::kMicrosecond);
+
+// The first searchNotifications on a fresh Searcher over a history.log of
+// range(0) records: mapping the log, indexing every record (a tenth of them
+// with a big text) and answering one query. This is the wait that
+// update_in_background() takes off the first search after startup.
+static void BM_SearchColdStart(benchmark::State& state) {
+  std::string path = scratch_path("search_history.log");
+  g_remove(path.c_str());
+  {
+    nm_history::Writer writer(path, (size_t)1 << 40, nm_history::kRetentionMs);
+    for (int i = 0; i < state.range(0); ++i) {
+      nm_history::Record record;
+      record.shown_at_ms = 1700000000000 + i;
+      record.title = "Build " + std::to_string(i) + " finished";
+      record.message = "Pipeline main passed in 4m 12s";
+      if (i % 10 == 0) {
+        record.big_text = "Stages: checkout, compile, unit tests, deploy to "
+                          "staging host" + std::to_string(i % 5000);
+      }
+      writer.append(record);
+    }
+  }
+  for (auto _ : state) {
+    nm_history::Reader reader(path);
+    nm_search::Searcher searcher(&reader);
+    benchmark::DoNotOptimize(searcher.search("deploy staging", 20));
+  }
+  g_remove(path.c_str());
+}
+BENCHMARK(BM_SearchColdStart)->Arg(100000)->Arg(1000000)->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+
+// ── Daemon-to-app handoff ───────────────────────────────────────────────────
+
+// The daemon publishing a batch of range(0) items into the ring and the
+// plugin reading it back, on one thread (no futex sleep).
+static void BM_HandoffPublishRead(benchmark::State& state) {
+  std::string path = scratch_path("handoff.ring");
+  g_remove(path.c_str());
+  nm_handoff::Publisher publisher(path);
+  nm_handoff::Subscriber subscriber(path);
+  std::vector<nm_feed::Item> batch;
+  for (int i = 0; i < state.range(0); ++i) {
+    nm_feed::Item item;
+    item.id = "item-" + std::to_string(i);
+    item.title = "Build " + std::to_string(i) + " finished";
+    item.message = "Pipeline main passed in 4m 12s";
+    item.topic = "ci";
+    batch.push_back(item);
+  }
+  std::vector<nm_feed::Item> items;
+  for (auto _ : state) {
+    publisher.publish(batch);
+    items.clear();
+    subscriber.read(&items);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HandoffPublishRead)->Arg(1)->Arg(64);
+
+// ── poller.conf read/write ────────────────────────────────────────────────
+
+static void BM_PollerConfigLoad(benchmark::State& state) {
+  nm_config::PollerConfigStore conf;
+  conf.stage(nm_config::kUrl, "https://example.com/notifications");
+  conf.stage(nm_config::kInterval, "15");
+  conf.stage(nm_config::kEnabled, "true");
+  conf.commit();
+  for (auto _ : state) {
+    conf.load();
+    benchmark::DoNotOptimize(conf.current().interval_minutes);
+  }
+}
+BENCHMARK(BM_PollerConfigLoad)->Unit(benchmark::kMicrosecond);
+
+// One staged key written with an atomic replace, as the plugin does when the
+// daemon is (re)configured.
+static void BM_PollerConfigCommit(benchmark::State& state) {
+  nm_config::PollerConfigStore conf;
+  conf.load();
+  bool toggle = false;
+  for (auto _ : state) {
+    toggle = !toggle;
+    conf.stage(nm_config::kEnabled, toggle ? "true" : "false");
+    conf.commit();
+  }
+}
+BENCHMARK(BM_PollerConfigCommit)->Unit(benchmark::kMicrosecond);
+
+// 10k subscribe + 10k unsubscribe calls against the cached prefs store. The
+// write-behind timer is never dispatched here (no main loop), so this measures
+// exactly what a method-channel handler pays on the GTK thread.
+static void BM_PrefsSubscribeUnsubscribe10k(benchmark::State& state) {
+  nm_prefs::PrefsStore& prefs = nm_prefs::PrefsStore::get();
+  prefs.reset_for_testing(scratch_path("prefs_bench.ini"));
+  std::vector<std::string> topics;
+  for (int i = 0; i < 10000; ++i) topics.push_back("topic." + std::to_string(i));
+
+  for (auto _ : state) {
+    for (const auto& t : topics) prefs.add_topic(t);
+    for (const auto& t : topics) prefs.remove_topic(t);
+  }
+  state.SetItemsProcessed(state.iterations() * 20000);
+}
+BENCHMARK(BM_PrefsSubscribeUnsubscribe10k)->Unit(benchmark::kMillisecond);
+
+// Cost of the single write-behind flush that follows a burst of updates.
+static void BM_PrefsFlush(benchmark::State& state) {
+  nm_prefs::PrefsStore& prefs = nm_prefs::PrefsStore::get();
+  prefs.reset_for_testing(scratch_path("prefs_flush.ini"));
+  for (int i = 0; i < state.range(0); ++i) {
+    prefs.add_topic("topic." + std::to_string(i));
+  }
+  bool toggle = false;
+  for (auto _ : state) {
+    toggle = !toggle;
+    prefs.set_string("service", "active", toggle ? "polling" : "none");
+    prefs.flush();
+  }
+}
+BENCHMARK(BM_PrefsFlush)->Arg(10)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// ── Method-channel dispatch ───────────────────────────────────────────────
+
+// Dispatch cost of one method call, from name lookup to the response object.
+static void BM_MethodDispatch(benchmark::State& state, const char* method) {
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) args = fl_value_new_map();
+  for (auto _ : state) {
+    FlMethodResponse* response =
+        notification_master_plugin_dispatch(plugin, method, args);
+    g_object_unref(response);
+  }
+  g_object_unref(plugin);
+}
+// Lookup is a compile-time perfect hash, so a method near the top of the
+// table and one near the bottom should cost the same.
+BENCHMARK_CAPTURE(BM_MethodDispatch, early_branch,
+                  "checkNotificationPermission");
+BENCHMARK_CAPTURE(BM_MethodDispatch, late_branch, "isBackgroundPollingRunning");
+BENCHMARK_CAPTURE(BM_MethodDispatch, topics, "getSubscribedTopics");
+BENCHMARK_CAPTURE(BM_MethodDispatch, not_implemented, "noSuchMethod");
+
+// showNotification with the arguments the Dart side sends (decoded in one
+// pass over the map, see nm_args.h), shown through the stub sink. Odd
+// iterations send a wrongly typed id to time the INVALID_ARGUMENTS path.
+static void BM_ShowNotificationDispatch(benchmark::State& state) {
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) good = fl_value_new_map();
+  fl_value_set_string_take(good, "title", fl_value_new_string("Build failed"));
+  fl_value_set_string_take(good, "message",
+                           fl_value_new_string("main is red again"));
+  fl_value_set_string_take(good, "id", fl_value_new_int(42));
+  fl_value_set_string_take(good, "channelId", fl_value_new_string("builds"));
+  fl_value_set_string_take(good, "importance", fl_value_new_null());
+  g_autoptr(FlValue) bad = fl_value_new_map();
+  fl_value_set_string_take(bad, "title", fl_value_new_string("Build failed"));
+  fl_value_set_string_take(bad, "message", fl_value_new_string("x"));
+  fl_value_set_string_take(bad, "id", fl_value_new_string("42"));
+  bool toggle = false;
+  for (auto _ : state) {
+    toggle = !toggle;
+    FlMethodResponse* response = notification_master_plugin_dispatch(
+        plugin, "showNotification", toggle ? good : bad);
+    g_object_unref(response);
+  }
+  g_object_unref(plugin);
+}
+BENCHMARK(BM_ShowNotificationDispatch);
+
+static void count_response(FlMethodResponse* response, gpointer user_data) {
+  (*static_cast<int*>(user_data))++;
+}
+
+// Main-thread stall per method call: only the time spent inside
+// notification_master_plugin_call() — lookup, hand-off to a worker, or the
+// whole handler for inline methods — is measured. Waiting for the worker and
+// the idle-source response is excluded, as the UI keeps rendering then.
+static void BM_UiStall(benchmark::State& state, const char* method) {
+  set_notification_sink(counting_sink);
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "title", fl_value_new_string("Build failed"));
+  fl_value_set_string_take(args, "message", fl_value_new_string("main is red"));
+  fl_value_set_string_take(args, "topic", fl_value_new_string("builds"));
+  int responses = 0;
+  for (auto _ : state) {
+    int expected = responses + 1;
+    notification_master_plugin_call(plugin, method, args, count_response,
+                                    &responses);
+    state.PauseTiming();
+    while (responses < expected) g_main_context_iteration(nullptr, TRUE);
+    state.ResumeTiming();
+  }
+  g_object_unref(plugin);
+  set_notification_sink(nullptr);
+}
+// Blocking work (display over D-Bus, prefs I/O, joining the poller) should
+// cost the UI thread about as much as the inline getPlatformVersion.
+BENCHMARK_CAPTURE(BM_UiStall, platform_version, "getPlatformVersion");
+BENCHMARK_CAPTURE(BM_UiStall, show, "showNotification");
+BENCHMARK_CAPTURE(BM_UiStall, subscribe, "subscribeToTopic");
+BENCHMARK_CAPTURE(BM_UiStall, stop_polling, "stopNotificationPolling");
+
+// ── Event channel ─────────────────────────────────────────────────────────
+
+// One frame's worth of events: state.range(0) pushes spread over 16
+// notifications (so most coalesce), then the flush and the encoding into
+// the channel message.
+static void BM_EventBatch(benchmark::State& state) {
+  size_t sent = 0;
+  nm_events::Batcher batcher(
+      nullptr, [&sent](const std::vector<nm_events::Event>& batch) {
+        FlValue* message = encode_event_batch(batch);
+        sent += fl_value_get_length(message);
+        fl_value_unref(message);
+      });
+  batcher.set_enabled(true);
+  nm_events::Event event;
+  event.type = nm_events::kActionInvoked;
+  event.action = "default";
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); i++) {
+      event.id = i % 16;
+      batcher.push(event);
+    }
+    batcher.flush();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["sent_per_frame"] =
+      benchmark::Counter((double)sent / (double)state.iterations());
+}
+BENCHMARK(BM_EventBatch)->Arg(1)->Arg(64)->Arg(1024);
+
+// ── Scheduler ─────────────────────────────────────────────────────────────
+
+// scheduleNotification one hour out (spawns the detached sleeper) followed
+// by cancelScheduledNotification (kills it).
+static void BM_ScheduleCancel(benchmark::State& state) {
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) schedule = fl_value_new_map();
+  fl_value_set_string_take(schedule, "id", fl_value_new_int(7));
+  fl_value_set_string_take(schedule, "title", fl_value_new_string("Reminder"));
+  fl_value_set_string_take(schedule, "message",
+                           fl_value_new_string("Stand-up in 5 minutes"));
+  fl_value_set_string_take(
+      schedule, "scheduledEpochMillis",
+      fl_value_new_int(nm_feed::now_epoch_ms() + 60 * 60 * 1000));
+  g_autoptr(FlValue) cancel = fl_value_new_map();
+  fl_value_set_string_take(cancel, "id", fl_value_new_int(7));
+
+  for (auto _ : state) {
+    g_object_unref(notification_master_plugin_dispatch(
+        plugin, "scheduleNotification", schedule));
+    g_object_unref(notification_master_plugin_dispatch(
+        plugin, "cancelScheduledNotification", cancel));
+    state.PauseTiming();
+    // The plugin leaves killed sleepers to be reaped by the OS at exit.
+    while (waitpid(-1, nullptr, 0) > 0) {
+    }
+    state.ResumeTiming();
+  }
+  g_object_unref(plugin);
+}
+BENCHMARK(BM_ScheduleCancel)->Unit(benchmark::kMicrosecond);
+
+}  // namespace benchmarks
+}  // namespace notification_master
+
+int main(int argc, char** argv) {
+  gchar* dir = g_dir_make_tmp("nm_bench_XXXXXX", nullptr);
+  notification_master::benchmarks::g_scratch_dir = dir ? dir : g_get_tmp_dir();
+  for (const char* var : {"XDG_CONFIG_HOME", "XDG_DATA_HOME", "XDG_RUNTIME_DIR"}) {
+    g_setenv(var, notification_master::benchmarks::g_scratch_dir.c_str(), TRUE);
+  }
+  g_free(dir);
+  set_notification_sink(notification_master::benchmarks::counting_sink);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
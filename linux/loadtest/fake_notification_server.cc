@@ -0,0 +1,166 @@
+// Fake org.freedesktop.Notifications service for the load harness.
+//
+// Owns org.freedesktop.Notifications on the session bus it is started on
+// (run_load.py starts a private dbus-daemon, so the real desktop is never
+// involved) and appends one JSON line per Notify call to the log file:
+//
+//   {"t_ms": 1700000000123, "id": 7, "summary": "Load #42"}
+//
+// t_ms is the wall-clock receive time, comparable with the mock server's
+// sentAt. Notify can be made slow with --delay-ms to model a busy
+// notification daemon. Prints "ready" on stdout once the name is owned.
+//
+// Usage: notification_master_fake_notifyd <log-file> [--delay-ms N]
+
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <glib.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char kIntrospection[] =
+    "<node>"
+    "  <interface name='org.freedesktop.Notifications'>"
+    "    <method name='Notify'>"
+    "      <arg type='s' name='app_name' direction='in'/>"
+    "      <arg type='u' name='replaces_id' direction='in'/>"
+    "      <arg type='s' name='app_icon' direction='in'/>"
+    "      <arg type='s' name='summary' direction='in'/>"
+    "      <arg type='s' name='body' direction='in'/>"
+    "      <arg type='as' name='actions' direction='in'/>"
+    "      <arg type='a{sv}' name='hints' direction='in'/>"
+    "      <arg type='i' name='expire_timeout' direction='in'/>"
+    "      <arg type='u' name='id' direction='out'/>"
+    "    </method>"
+    "    <method name='CloseNotification'>"
+    "      <arg type='u' name='id' direction='in'/>"
+    "    </method>"
+    "    <method name='GetCapabilities'>"
+    "      <arg type='as' name='capabilities' direction='out'/>"
+    "    </method>"
+    "    <method name='GetServerInformation'>"
+    "      <arg type='s' name='name' direction='out'/>"
+    "      <arg type='s' name='vendor' direction='out'/>"
+    "      <arg type='s' name='version' direction='out'/>"
+    "      <arg type='s' name='spec_version' direction='out'/>"
+    "    </method>"
+    "    <signal name='NotificationClosed'>"
+    "      <arg type='u' name='id'/>"
+    "      <arg type='u' name='reason'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+FILE* g_log = nullptr;
+guint g_delay_ms = 0;
+guint32 g_next_id = 1;
+
+void handle_method_call(GDBusConnection* connection, const gchar* sender,
+                        const gchar* object_path, const gchar* interface_name,
+                        const gchar* method_name, GVariant* parameters,
+                        GDBusMethodInvocation* invocation, gpointer user_data) {
+  if (strcmp(method_name, "Notify") == 0) {
+    gint64 t_ms = g_get_real_time() / 1000;
+    const gchar* summary = nullptr;
+    guint32 replaces_id = 0;
+    g_variant_get_child(parameters, 1, "u", &replaces_id);
+    g_variant_get_child(parameters, 3, "&s", &summary);
+    guint32 id = replaces_id ? replaces_id : g_next_id++;
+    gchar* escaped = g_strescape(summary ? summary : "", nullptr);
+    fprintf(g_log, "{\"t_ms\": %lld, \"id\": %u, \"summary\": \"%s\"}\n",
+            (long long)t_ms, id, escaped);
+    fflush(g_log);
+    g_free(escaped);
+    if (g_delay_ms) g_usleep((gulong)g_delay_ms * 1000);
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(u)", id));
+  } else if (strcmp(method_name, "CloseNotification") == 0) {
+    guint32 id = 0;
+    g_variant_get(parameters, "(u)", &id);
+    // Reason 3: closed by a call to CloseNotification.
+    g_dbus_connection_emit_signal(connection, nullptr, object_path,
+                                  interface_name, "NotificationClosed",
+                                  g_variant_new("(uu)", id, 3u), nullptr);
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+  } else if (strcmp(method_name, "GetCapabilities") == 0) {
+    const gchar* caps[] = {"body", "actions", "persistence", nullptr};
+    g_dbus_method_invocation_return_value(
+        invocation, g_variant_new("(^as)", caps));
+  } else if (strcmp(method_name, "GetServerInformation") == 0) {
+    g_dbus_method_invocation_return_value(
+        invocation, g_variant_new("(ssss)", "nm-fake-notifyd",
+                                  "notification_master", "1.0", "1.2"));
+  } else {
+    g_dbus_method_invocation_return_dbus_error(
+        invocation, "org.freedesktop.DBus.Error.UnknownMethod", method_name);
+  }
+}
+
+const GDBusInterfaceVTable kVTable = {handle_method_call, nullptr, nullptr, {}};
+
+void on_bus_acquired(GDBusConnection* connection, const gchar* name,
+                     gpointer user_data) {
+  GDBusNodeInfo* info = static_cast<GDBusNodeInfo*>(user_data);
+  GError* error = nullptr;
+  g_dbus_connection_register_object(connection, "/org/freedesktop/Notifications",
+                                    info->interfaces[0], &kVTable, nullptr,
+                                    nullptr, &error);
+  if (error) {
+    fprintf(stderr, "register_object: %s\n", error->message);
+    exit(1);
+  }
+}
+
+void on_name_acquired(GDBusConnection* connection, const gchar* name,
+                      gpointer user_data) {
+  printf("ready\n");
+  fflush(stdout);
+}
+
+void on_name_lost(GDBusConnection* connection, const gchar* name,
+                  gpointer user_data) {
+  fprintf(stderr, "could not own %s (is another notification server on "
+                  "this bus?)\n", name);
+  exit(1);
+}
+
+gboolean on_sigterm(gpointer user_data) {
+  g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+  return G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <log-file> [--delay-ms N]\n", argv[0]);
+    return 2;
+  }
+  for (int i = 2; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--delay-ms") == 0) g_delay_ms = (guint)atoi(argv[++i]);
+  }
+  g_log = fopen(argv[1], "a");
+  if (!g_log) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  GDBusNodeInfo* info = g_dbus_node_info_new_for_xml(kIntrospection, nullptr);
+  guint owner = g_bus_own_name(G_BUS_TYPE_SESSION,
+                               "org.freedesktop.Notifications",
+                               G_BUS_NAME_OWNER_FLAGS_NONE, on_bus_acquired,
+                               on_name_acquired, on_name_lost, info, nullptr);
+  GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+  g_unix_signal_add(SIGTERM, on_sigterm, loop);
+  g_main_loop_run(loop);
+
+  g_bus_unown_name(owner);
+  g_dbus_node_info_unref(info);
+  g_main_loop_unref(loop);
+  fclose(g_log);
+  return 0;
+}
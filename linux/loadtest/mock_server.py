@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""Mock notification feed for the Linux load harness (see run_load.py).
+
+Serves {"notifications": [...]} from GET /feed over HTTP or HTTPS using only
+the standard library. Every response carries fresh items with unique ids
+(in the title as "Load #<id>") and a millisecond "sentAt", so the harness can
+match what the fake notification server received to when it was emitted.
+
+Query parameters select the response shape:
+  items=N      items per response (default 1)
+  etag=K       content changes every K requests; ETag / If-None-Match -> 304
+  chunked=1    Transfer-Encoding: chunked
+  gzip=1       gzip the body (only when the client sends Accept-Encoding: gzip)
+  drip_ms=M    send the body in 64-byte pieces, M ms apart (slow server)
+  bigtext=B    add a bigText of B bytes to each item
+  status=C     reply with HTTP status C and no body
+
+POST /receipts is accepted and counted. GET /stats returns the counters.
+
+Standalone use:
+  python3 mock_server.py --port 8080 [--tls]
+"""
+
+import argparse
+import gzip
+import http.server
+import json
+import os
+import shutil
+import socketserver
+import ssl
+import subprocess
+import tempfile
+import threading
+import time
+import urllib.parse
+
+
+class FeedState:
+    """Counters and the id -> sentAt map shared by all handler threads."""
+
+    def __init__(self, track_latency=True):
+        self.lock = threading.Lock()
+        self.track_latency = track_latency
+        self.next_id = 1
+        self.sent_at_ms = {}
+        self.requests = 0
+        self.not_modified = 0
+        self.bytes_sent = 0
+        self.receipts = 0
+        self.etag_body = None
+        self.etag_version = 0
+
+    def new_items(self, count, bigtext):
+        now_ms = int(time.time() * 1000)
+        items = []
+        with self.lock:
+            for _ in range(count):
+                item_id = self.next_id
+                self.next_id += 1
+                if self.track_latency:
+                    self.sent_at_ms[item_id] = now_ms
+                item = {
+                    "id": str(item_id),
+                    "title": "Load #%d" % item_id,
+                    "message": "load test item %d" % item_id,
+                    "sentAt": now_ms,
+                }
+                if bigtext:
+                    item["bigText"] = "x" * bigtext
+                items.append(item)
+        return items
+
+    def stats(self):
+        with self.lock:
+            return {
+                "requests": self.requests,
+                "not_modified": self.not_modified,
+                "bytes_sent": self.bytes_sent,
+                "items_emitted": self.next_id - 1,
+                "receipts": self.receipts,
+            }
+
+
+class FeedHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    state = None  # FeedState, set by make_server()
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def _param(self, query, name, default=0):
+        try:
+            return int(query.get(name, [default])[0])
+        except ValueError:
+            return default
+
+    def do_GET(self):
+        url = urllib.parse.urlparse(self.path)
+        query = urllib.parse.parse_qs(url.query)
+        if url.path == "/stats":
+            self._send(200, json.dumps(self.state.stats()).encode(), {})
+            return
+        if url.path != "/feed":
+            self._send(404, b"", {})
+            return
+
+        with self.state.lock:
+            self.state.requests += 1
+            request_no = self.state.requests
+        status = self._param(query, "status")
+        if status:
+            self._send(status, b"", {})
+            return
+
+        items = self._param(query, "items", 1)
+        bigtext = self._param(query, "bigtext")
+        etag_every = self._param(query, "etag")
+        headers = {"Content-Type": "application/json"}
+        if etag_every:
+            with self.state.lock:
+                version = (request_no - 1) // etag_every
+                stale = self.state.etag_body is None or \
+                    version != self.state.etag_version
+            if stale:
+                body = json.dumps(
+                    {"notifications": self.state.new_items(items, bigtext)})
+                with self.state.lock:
+                    self.state.etag_body = body.encode()
+                    self.state.etag_version = version
+            etag = '"v%d"' % version
+            headers["ETag"] = etag
+            if self.headers.get("If-None-Match") == etag:
+                with self.state.lock:
+                    self.state.not_modified += 1
+                self._send(304, b"", headers)
+                return
+            body = self.state.etag_body
+        else:
+            body = json.dumps(
+                {"notifications": self.state.new_items(items, bigtext)}).encode()
+
+        accepts_gzip = "gzip" in self.headers.get("Accept-Encoding", "")
+        if self._param(query, "gzip") and accepts_gzip:
+            body = gzip.compress(body)
+            headers["Content-Encoding"] = "gzip"
+        self._send(200, body, headers,
+                   chunked=bool(self._param(query, "chunked")),
+                   drip_ms=self._param(query, "drip_ms"))
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        payload = self.rfile.read(length)
+        if urllib.parse.urlparse(self.path).path == "/receipts":
+            try:
+                count = len(json.loads(payload).get("receipts", []))
+            except ValueError:
+                count = 0
+            with self.state.lock:
+                self.state.receipts += count
+            self._send(204, b"", {})
+        else:
+            self._send(404, b"", {})
+
+    def _send(self, status, body, headers, chunked=False, drip_ms=0):
+        self.send_response(status)
+        for name, value in headers.items():
+            self.send_header(name, value)
+        if chunked:
+            self.send_header("Transfer-Encoding", "chunked")
+        else:
+            self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if status in (204, 304):
+            return
+        piece = 64 if drip_ms else max(len(body), 1)
+        for start in range(0, len(body), piece):
+            data = body[start:start + piece]
+            if chunked:
+                data = b"%x\r\n%s\r\n" % (len(data), data)
+            self.wfile.write(data)
+            if drip_ms:
+                self.wfile.flush()
+                time.sleep(drip_ms / 1000.0)
+        if chunked:
+            self.wfile.write(b"0\r\n\r\n")
+        with self.state.lock:
+            self.state.bytes_sent += len(body)
+
+
+class ThreadingServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+def make_self_signed_cert(directory):
+    """Writes cert.pem/key.pem for localhost into |directory| via openssl."""
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes",
+         "-keyout", key, "-out", cert, "-days", "1", "-subj", "/CN=localhost",
+         "-addext", "subjectAltName=DNS:localhost,IP:127.0.0.1"],
+        check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return cert, key
+
+
+def make_server(port=0, tls=False, cert_dir=None, track_latency=True):
+    """Returns (server, state, base_url, cert_path) without serving yet.
+
+    With |track_latency| off the id -> sentAt map is not kept (soak runs emit
+    millions of items).
+    """
+    state = FeedState(track_latency)
+    handler = type("Handler", (FeedHandler,), {"state": state})
+    server = ThreadingServer(("127.0.0.1", port), handler)
+    cert = None
+    scheme = "http"
+    if tls:
+        cert, key = make_self_signed_cert(cert_dir or tempfile.mkdtemp())
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(cert, key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        scheme = "https"
+    base_url = "%s://127.0.0.1:%d" % (scheme, server.server_address[1])
+    return server, state, base_url, cert
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--tls", action="store_true")
+    args = parser.parse_args()
+    if args.tls and not shutil.which("openssl"):
+        parser.error("--tls needs the openssl command")
+    server, _, base_url, cert = make_server(args.port, args.tls)
+    print("serving %s/feed%s" % (base_url, " (cert %s)" % cert if cert else ""),
+          flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+// Runs the plugin's in-app polling thread without a Flutter engine, for the
+// load harness (run_load.py --target plugin).
+//
+// Creates the plugin object, dispatches startNotificationPolling for <url>,
+// spins the GLib main loop for <seconds>, then stops polling and prints the
+// plugin's metrics (Prometheus text) to stdout. The poll period comes from
+// $NM_LOADTEST_INTERVAL_SECONDS.
+//
+// Usage: notification_master_load_driver <url> <seconds>
+
+#include <flutter_linux/flutter_linux.h>
+#include <glib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "include/notification_master/notification_master_plugin.h"
+#include "notification_master_plugin_private.h"
+#include "nm_metrics.h"
+
+static gboolean quit_cb(gpointer user_data) {
+  g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+  return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <url> <seconds>\n", argv[0]);
+    return 2;
+  }
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "pollingUrl", fl_value_new_string(argv[1]));
+  fl_value_set_string_take(args, "intervalMinutes", fl_value_new_int(1));
+  FlMethodResponse* started = notification_master_plugin_dispatch(
+      plugin, "startNotificationPolling", args);
+  gboolean ok = FL_IS_METHOD_SUCCESS_RESPONSE(started);
+  g_object_unref(started);
+  if (!ok) {
+    fprintf(stderr, "startNotificationPolling failed\n");
+    return 1;
+  }
+
+  GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+  g_timeout_add_seconds((guint)atoi(argv[2]), quit_cb, loop);
+  g_main_loop_run(loop);
+  g_main_loop_unref(loop);
+
+  g_object_unref(notification_master_plugin_dispatch(
+      plugin, "stopNotificationPolling", nullptr));
+  std::string metrics = nm_metrics::global().render_prometheus("plugin");
+  fwrite(metrics.data(), 1, metrics.size(), stdout);
+  g_object_unref(plugin);
+  return 0;
+}
@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+"""End-to-end load harness for the Linux poller daemon and plugin thread.
+
+Runs one scripted scenario against either notification_master_poller
+(--target daemon) or the plugin's polling thread via
+notification_master_load_driver (--target plugin), with:
+  * mock_server.py serving the feed (HTTP or HTTPS) in-process,
+  * notification_master_fake_notifyd owning org.freedesktop.Notifications on
+    a private dbus-daemon, so nothing reaches the real desktop,
+  * a throwaway XDG_CONFIG_HOME with a poller.conf for the feed, and
+    NM_LOADTEST_INTERVAL_SECONDS for a sub-minute poll period.
+
+Reports JSON with throughput (notifications/s), delivery latency
+(sentAt -> Notify received, p50/p90/p99/max), CPU time and RSS of the target
+process and of its polling thread, and the mock server's counters.
+
+The native helpers are built with the benchmarks (set
+include_notification_master_benchmarks in the example's CMakeLists.txt):
+
+  python3 linux/loadtest/run_load.py --build-dir example/build/linux \\
+      --target daemon --scenario burst --duration 30
+
+Needs dbus-daemon on PATH (and openssl for --scenario tls).
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import mock_server  # noqa: E402
+
+# name -> (feed query, fake notifyd --delay-ms, https)
+SCENARIOS = {
+    "steady": ("items=1", 0, False),
+    "burst": ("items=200", 0, False),
+    "etag": ("items=20&etag=5", 0, False),
+    "chunked": ("items=20&chunked=1", 0, False),
+    "gzip": ("items=50&gzip=1", 0, False),
+    "drip": ("items=20&drip_ms=50", 0, False),
+    "bigtext": ("items=10&bigtext=65536", 0, False),
+    "tls": ("items=20", 0, True),
+    "slow_notifyd": ("items=20", 20, False),
+}
+
+BINARIES = {
+    "daemon": "notification_master_poller",
+    "plugin": "notification_master_load_driver",
+    "notifyd": "notification_master_fake_notifyd",
+}
+
+POLLING_THREAD = "nm-polling"
+CLK_TCK = os.sysconf("SC_CLK_TCK")
+PAGE_KB = os.sysconf("SC_PAGE_SIZE") // 1024
+
+
+def find_binary(build_dir, name):
+    for root, _, files in os.walk(build_dir):
+        if name in files:
+            return os.path.join(root, name)
+    sys.exit("%s not found under %s (build with benchmarks enabled)" %
+             (name, build_dir))
+
+
+def cpu_ticks(stat_path):
+    """utime + stime from a /proc/.../stat file, or None if it is gone."""
+    try:
+        with open(stat_path) as f:
+            fields = f.read().rsplit(")", 1)[1].split()
+        return int(fields[11]) + int(fields[12])
+    except (OSError, IndexError):
+        return None
+
+
+def rss_kb(pid):
+    try:
+        with open("/proc/%d/statm" % pid) as f:
+            return int(f.read().split()[1]) * PAGE_KB
+    except OSError:
+        return None
+
+
+def polling_thread_stat(pid):
+    """/proc path of the thread named POLLING_THREAD, if it exists."""
+    task_dir = "/proc/%d/task" % pid
+    try:
+        for tid in os.listdir(task_dir):
+            with open(os.path.join(task_dir, tid, "comm")) as f:
+                if f.read().strip() == POLLING_THREAD:
+                    return os.path.join(task_dir, tid, "stat")
+    except OSError:
+        pass
+    return None
+
+
+class Sampler(threading.Thread):
+    """Samples CPU and RSS of |pid| every |period| seconds until stopped."""
+
+    def __init__(self, pid, period=0.25):
+        super().__init__(daemon=True)
+        self.pid = pid
+        self.period = period
+        self.stop_event = threading.Event()
+        self.rss = []
+        self.cpu_ticks = 0
+        self.thread_ticks = None
+
+    def run(self):
+        stat = "/proc/%d/stat" % self.pid
+        while not self.stop_event.is_set():
+            ticks = cpu_ticks(stat)
+            rss = rss_kb(self.pid)
+            if ticks is None or rss is None:
+                break
+            self.cpu_ticks = ticks
+            self.rss.append(rss)
+            thread_stat = polling_thread_stat(self.pid)
+            thread_ticks = cpu_ticks(thread_stat) if thread_stat else None
+            if thread_ticks is not None:
+                self.thread_ticks = max(self.thread_ticks or 0, thread_ticks)
+            self.stop_event.wait(self.period)
+
+    def stop(self):
+        self.stop_event.set()
+        self.join()
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return None
+    index = min(len(sorted_values) - 1, int(round(p * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def start_private_bus():
+    bus = subprocess.Popen(
+        ["dbus-daemon", "--session", "--nofork", "--print-address=1"],
+        stdout=subprocess.PIPE, text=True)
+    address = bus.stdout.readline().strip()
+    if not address:
+        bus.kill()
+        sys.exit("dbus-daemon did not report an address")
+    return bus, address
+
+
+def wait_for_line(proc, expected, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        line = proc.stdout.readline()
+        if not line:
+            break
+        if line.strip() == expected:
+            return True
+    return False
+
+
+def write_poller_conf(config_home, url, receipts_url):
+    conf_dir = os.path.join(config_home, "notification_master")
+    os.makedirs(conf_dir, exist_ok=True)
+    with open(os.path.join(conf_dir, "poller.conf"), "w") as f:
+        f.write("[poller]\n")
+        f.write("url=%s\n" % url)
+        f.write("interval=1\n")
+        f.write("enabled=1\n")
+        f.write("log_level=warn\n")
+        f.write("receipts_url=%s\n" % receipts_url)
+
+
+def read_deliveries(log_path, sent_at_ms):
+    latencies = []
+    delivered = 0
+    with open(log_path) as f:
+        for line in f:
+            try:
+                entry = json.loads(line)
+            except ValueError:
+                continue
+            delivered += 1
+            match = re.match(r"Load #(\d+)$", entry.get("summary", ""))
+            if match and int(match.group(1)) in sent_at_ms:
+                latencies.append(entry["t_ms"] - sent_at_ms[int(match.group(1))])
+    return delivered, sorted(latencies)
+
+
+class LoadEnvironment:
+    """Mock feed server, private bus, fake notifyd and a scratch config home.
+
+    Use as a context manager; |env| is the environment to start targets with.
+    """
+
+    def __init__(self, build_dir, query, notify_delay_ms=0, tls=False,
+                 interval_seconds=1, keep=False, track_latency=True):
+        self.notifyd_path = find_binary(build_dir, BINARIES["notifyd"])
+        self.query = query
+        self.notify_delay_ms = notify_delay_ms
+        self.tls = tls
+        self.interval_seconds = interval_seconds
+        self.keep = keep
+        self.track_latency = track_latency
+        self.work = None
+        self.server = None
+        self.bus = None
+        self.notifyd = None
+
+    def __enter__(self):
+        self.work = tempfile.mkdtemp(prefix="nm_load_")
+        try:
+            self._start()
+        except BaseException:
+            self.__exit__(None, None, None)
+            raise
+        return self
+
+    def _start(self):
+        self.server, self.state, base_url, cert = mock_server.make_server(
+            tls=self.tls, cert_dir=self.work, track_latency=self.track_latency)
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+        self.feed_url = "%s/feed?%s" % (base_url, self.query)
+        write_poller_conf(os.path.join(self.work, "config"), self.feed_url,
+                          base_url + "/receipts")
+
+        self.bus, address = start_private_bus()
+        self.env = dict(os.environ)
+        self.env["DBUS_SESSION_BUS_ADDRESS"] = address
+        self.env["XDG_CONFIG_HOME"] = os.path.join(self.work, "config")
+        self.env["NM_LOADTEST_INTERVAL_SECONDS"] = str(self.interval_seconds)
+        if cert:
+            # Trusted by libsoup's OpenSSL TLS backend; the daemon does not
+            # verify peers.
+            self.env["SSL_CERT_FILE"] = cert
+
+        self.notify_log = os.path.join(self.work, "notify.jsonl")
+        self.notifyd = subprocess.Popen(
+            [self.notifyd_path, self.notify_log, "--delay-ms",
+             str(self.notify_delay_ms)],
+            env=self.env, stdout=subprocess.PIPE, text=True)
+        if not wait_for_line(self.notifyd, "ready", 10):
+            raise RuntimeError("fake notification server did not start")
+
+    def __exit__(self, *exc):
+        if self.notifyd and self.notifyd.poll() is None:
+            self.notifyd.terminate()
+            self.notifyd.wait(timeout=10)
+        if self.bus:
+            self.bus.kill()
+            self.bus.wait()
+        if self.server:
+            self.server.shutdown()
+        if not self.keep:
+            shutil.rmtree(self.work, ignore_errors=True)
+        else:
+            print("kept %s" % self.work, file=sys.stderr)
+        return False
+
+
+def stop_process(proc):
+    if proc and proc.poll() is None:
+        proc.terminate()
+        proc.wait(timeout=10)
+
+
+def run(args):
+    query, notify_delay_ms, tls = SCENARIOS[args.scenario]
+    target_path = find_binary(args.build_dir, BINARIES[args.target])
+    target = None
+    with LoadEnvironment(args.build_dir, query, notify_delay_ms, tls,
+                         args.interval_seconds, args.keep) as load:
+        try:
+            if args.target == "daemon":
+                command = [target_path]
+            else:
+                command = [target_path, load.feed_url, str(args.duration)]
+            started = time.time()
+            # Only the plugin driver prints anything we need (its metrics).
+            target = subprocess.Popen(
+                command, env=load.env, text=True,
+                stdout=subprocess.PIPE if args.target == "plugin"
+                else subprocess.DEVNULL)
+            sampler = Sampler(target.pid)
+            sampler.start()
+
+            if args.target == "daemon":
+                time.sleep(args.duration)
+                target.send_signal(signal.SIGTERM)
+            plugin_metrics, _ = target.communicate(timeout=args.duration + 30)
+            wall = time.time() - started
+            sampler.stop()
+        finally:
+            stop_process(target)
+
+        state = load.state
+        with state.lock:
+            sent_at_ms = dict(state.sent_at_ms)
+        delivered, latencies = read_deliveries(load.notify_log, sent_at_ms)
+        rss = sampler.rss or [0]
+        report = {
+            "target": args.target,
+            "scenario": args.scenario,
+            "duration_s": round(wall, 3),
+            "interval_s": args.interval_seconds,
+            "delivered": delivered,
+            "throughput_per_s": round(delivered / wall, 3) if wall else 0,
+            "latency_ms": {
+                "p50": percentile(latencies, 0.50),
+                "p90": percentile(latencies, 0.90),
+                "p99": percentile(latencies, 0.99),
+                "max": latencies[-1] if latencies else None,
+            },
+            "cpu_s": round(sampler.cpu_ticks / CLK_TCK, 3),
+            "cpu_percent": round(100.0 * sampler.cpu_ticks / CLK_TCK / wall, 2),
+            # Plugin only: the daemon polls on its main thread.
+            "polling_thread_cpu_s": (
+                round(sampler.thread_ticks / CLK_TCK, 3)
+                if sampler.thread_ticks is not None else None),
+            "rss_kb": {"avg": sum(rss) // len(rss), "peak": max(rss)},
+            "server": state.stats(),
+        }
+        if args.target == "plugin":
+            report["plugin_metrics"] = plugin_metrics
+        return report
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--build-dir", required=True,
+                        help="directory containing the built binaries")
+    parser.add_argument("--target", choices=("daemon", "plugin"),
+                        default="daemon")
+    parser.add_argument("--scenario", choices=sorted(SCENARIOS),
+                        default="steady")
+    parser.add_argument("--duration", type=int, default=30,
+                        help="seconds to run the target")
+    parser.add_argument("--interval-seconds", type=int, default=1,
+                        help="poll period (NM_LOADTEST_INTERVAL_SECONDS)")
+    parser.add_argument("--out", help="write the JSON report here too")
+    parser.add_argument("--keep", action="store_true",
+                        help="keep the scratch directory (logs, config)")
+    args = parser.parse_args()
+    if not shutil.which("dbus-daemon"):
+        parser.error("dbus-daemon is required")
+
+    report = run(args)
+    text = json.dumps(report, indent=2)
+    print(text)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""Soak test: runs notification_master_poller for a long time and fails if
+its memory, file descriptors or threads trend upward.
+
+The daemon polls the mock feed (see mock_server.py) every --interval-seconds
+and every response carries --items-per-poll fresh notifications, which the
+fake notification server acknowledges on a private bus (see run_load.py). At
+the defaults (500 items/s) a million notifications take about 35 minutes
+instead of the months a real feed would need, which is what exposes per-item
+and per-cycle leaks.
+
+With --simulated-clock the daemon runs on a simulated clock (NM_CLOCK=
+simulated, see nm_clock.h): its waits between cycles advance simulated time
+instead of blocking, so it polls back to back while days of intervals,
+dedupe windows and backoff timers elapse in its own view of time. The report
+then includes "simulated_hours", read from the daemon's last_run stamp.
+
+Every --sample-seconds the daemon's VmRSS and Threads (/proc/<pid>/status)
+and its open fds (/proc/<pid>/fd) are recorded. After --warmup-seconds:
+  * RSS fails when the least-squares slope over the remaining samples exceeds
+    --max-rss-growth-kb-per-hour and RSS also grew by more than
+    --min-rss-growth-kb (so allocator noise on short runs does not fail);
+  * fds and threads fail when they rise above the highest value seen during
+    warm-up.
+
+  python3 linux/loadtest/soak.py --build-dir example/build/linux \\
+      --notifications 1000000 --out soak.json
+
+Exits 1 when a check fails, 0 otherwise. The JSON report includes the
+samples so the trend can be plotted.
+"""
+
+import argparse
+import json
+import os
+import signal
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import run_load  # noqa: E402
+
+
+def sample(pid):
+    """(rss_kb, threads, open_fds) of |pid|, or None once it has exited."""
+    rss = threads = None
+    try:
+        with open("/proc/%d/status" % pid) as f:
+            for line in f:
+                if line.startswith("VmRSS:"):
+                    rss = int(line.split()[1])
+                elif line.startswith("Threads:"):
+                    threads = int(line.split()[1])
+        fds = len(os.listdir("/proc/%d/fd" % pid))
+    except OSError:
+        return None
+    if rss is None or threads is None:
+        return None
+    return rss, threads, fds
+
+
+def slope_per_hour(points):
+    """Least-squares slope of (t_seconds, value) points, in value/hour."""
+    n = len(points)
+    if n < 2:
+        return 0.0
+    mean_t = sum(t for t, _ in points) / n
+    mean_v = sum(v for _, v in points) / n
+    var_t = sum((t - mean_t) ** 2 for t, _ in points)
+    if var_t == 0:
+        return 0.0
+    cov = sum((t - mean_t) * (v - mean_v) for t, v in points)
+    return cov / var_t * 3600.0
+
+
+def count_lines(path, state):
+    """Lines appended to |path| since the last call (|state| keeps offset)."""
+    try:
+        with open(path, "rb") as f:
+            f.seek(state.get("offset", 0))
+            data = f.read()
+    except OSError:
+        return state.get("lines", 0)
+    # Only count complete lines; a partial last line is read next time.
+    complete = data.rfind(b"\n") + 1
+    state["offset"] = state.get("offset", 0) + complete
+    state["lines"] = state.get("lines", 0) + data.count(b"\n", 0, complete)
+    return state["lines"]
+
+
+def evaluate(samples, warmup_s, max_rss_kb_per_hour, min_rss_growth_kb):
+    warm = [s for s in samples if s["t"] < warmup_s]
+    steady = [s for s in samples if s["t"] >= warmup_s]
+    checks = {}
+    if len(steady) < 3:
+        checks["samples"] = {
+            "ok": False,
+            "detail": "too few samples after warm-up; run longer",
+        }
+        return checks
+    rss_slope = slope_per_hour([(s["t"], s["rss_kb"]) for s in steady])
+    rss_growth = steady[-1]["rss_kb"] - steady[0]["rss_kb"]
+    checks["rss"] = {
+        "ok": rss_slope <= max_rss_kb_per_hour or
+              rss_growth <= min_rss_growth_kb,
+        "slope_kb_per_hour": round(rss_slope, 1),
+        "limit_kb_per_hour": max_rss_kb_per_hour,
+        "first_kb": steady[0]["rss_kb"],
+        "last_kb": steady[-1]["rss_kb"],
+    }
+    for key in ("fds", "threads"):
+        baseline = max(s[key] for s in warm) if warm else steady[0][key]
+        peak = max(s[key] for s in steady)
+        checks[key] = {"ok": peak <= baseline, "warmup_max": baseline,
+                       "max": peak}
+    return checks
+
+
+def run(args):
+    query = "items=%d" % args.items_per_poll
+    poller = run_load.find_binary(args.build_dir,
+                                  run_load.BINARIES["daemon"])
+    samples = []
+    log_state = {}
+    delivered = 0
+    daemon = None
+    with run_load.LoadEnvironment(args.build_dir, query,
+                                  interval_seconds=args.interval_seconds,
+                                  keep=args.keep,
+                                  track_latency=False) as load:
+        try:
+            started = time.time()
+            env = dict(load.env)
+            if args.simulated_clock:
+                env["NM_CLOCK"] = "simulated"
+            daemon = subprocess.Popen([poller], env=env,
+                                      stdout=subprocess.DEVNULL)
+            exited = False
+            while True:
+                elapsed = time.time() - started
+                stats = sample(daemon.pid)
+                if stats is None or daemon.poll() is not None:
+                    exited = True
+                    break
+                delivered = count_lines(load.notify_log, log_state)
+                samples.append({"t": round(elapsed, 1), "rss_kb": stats[0],
+                                "threads": stats[1], "fds": stats[2],
+                                "delivered": delivered})
+                if elapsed >= args.duration or (
+                        args.notifications and delivered >= args.notifications):
+                    break
+                time.sleep(args.sample_seconds)
+            wall = time.time() - started
+            if not exited:
+                daemon.send_signal(signal.SIGTERM)
+                daemon.wait(timeout=30)
+        finally:
+            run_load.stop_process(daemon)
+
+        checks = evaluate(samples, args.warmup_seconds,
+                          args.max_rss_growth_kb_per_hour,
+                          args.min_rss_growth_kb)
+        if exited:
+            checks["alive"] = {"ok": False,
+                               "detail": "daemon exited with %s" %
+                                         daemon.returncode}
+        report = {
+            "duration_s": round(wall, 1),
+            "delivered": delivered,
+            "notifications_per_s": round(delivered / wall, 1) if wall else 0,
+            "server": load.state.stats(),
+            "checks": checks,
+            "ok": all(c["ok"] for c in checks.values()),
+            "samples": samples,
+        }
+        if args.simulated_clock:
+            report["simulated_hours"] = simulated_hours(load, started)
+        return report
+
+
+def simulated_hours(load, started):
+    """Hours the daemon's clock advanced, from last_run in poller.state."""
+    path = os.path.join(load.env["XDG_CONFIG_HOME"], "notification_master",
+                        "poller.state")
+    try:
+        with open(path) as f:
+            for line in f:
+                key, _, value = line.partition("=")
+                if key.strip() == "last_run" and value.strip():
+                    return round((int(value) - started) / 3600.0, 1)
+    except (OSError, ValueError):
+        pass
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--build-dir", required=True,
+                        help="directory containing the built binaries")
+    parser.add_argument("--duration", type=int, default=4 * 3600,
+                        help="maximum seconds to run")
+    parser.add_argument("--notifications", type=int, default=0,
+                        help="stop once this many were delivered (0 = no "
+                             "limit)")
+    parser.add_argument("--items-per-poll", type=int, default=500)
+    parser.add_argument("--interval-seconds", type=int, default=1)
+    parser.add_argument("--sample-seconds", type=float, default=5)
+    parser.add_argument("--warmup-seconds", type=int, default=120)
+    parser.add_argument("--max-rss-growth-kb-per-hour", type=float,
+                        default=512)
+    parser.add_argument("--min-rss-growth-kb", type=float, default=1024)
+    parser.add_argument("--simulated-clock", action="store_true",
+                        help="run the daemon with NM_CLOCK=simulated")
+    parser.add_argument("--out", help="write the JSON report here too")
+    parser.add_argument("--keep", action="store_true",
+                        help="keep the scratch directory (logs, config)")
+    args = parser.parse_args()
+
+    report = run(args)
+    summary = dict(report)
+    summary.pop("samples")
+    print(json.dumps(summary, indent=2))
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(report, f, indent=2)
+            f.write("\n")
+    sys.exit(0 if report["ok"] else 1)
+
+
+if __name__ == "__main__":
+    main()
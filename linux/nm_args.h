@@ -0,0 +1,173 @@
+#ifndef NM_ARGS_H_
+#define NM_ARGS_H_
+
+// Typed decoding of method-channel argument maps for the plugin's handlers.
+//
+// Each handler declares a plain struct whose member initializers are the
+// defaults, plus a schema naming the map key, member and presence of every
+// argument:
+//
+//   struct ShowArgs {
+//     const gchar* title = nullptr;
+//     gint64 id = 1;
+//   };
+//   static const nm_args::Field<ShowArgs> kShowArgs[] = {
+//       nm_args::field("title", &ShowArgs::title, nm_args::kRequired),
+//       nm_args::field("id", &ShowArgs::id),
+//   };
+//
+// decode() walks the map once, matching each key against the schema, checks
+// the value's type and stores it; null values count as absent. Unknown keys
+// are ignored. The first problem found is reported as text ("id must be an
+// int", "title is required") for invalid_arguments(), so every handler
+// answers malformed calls with the same INVALID_ARGUMENTS error.
+//
+// Strings and FlValue members borrow from |args|, which outlives the
+// handler call.
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace nm_args {
+
+enum Presence { kOptional, kRequired };
+
+enum Kind { kString, kInt, kBool, kStringList };
+
+template <typename T>
+struct Field {
+  const char* key;
+  Kind kind;
+  Presence presence;
+  const gchar* T::*string_member;
+  gint64 T::*int_member;
+  bool T::*bool_member;
+  std::vector<std::string> T::*list_member;
+};
+
+template <typename T>
+Field<T> field(const char* key, const gchar* T::*member,
+               Presence presence = kOptional) {
+  return {key, kString, presence, member, nullptr, nullptr, nullptr};
+}
+
+template <typename T>
+Field<T> field(const char* key, gint64 T::*member,
+               Presence presence = kOptional) {
+  return {key, kInt, presence, nullptr, member, nullptr, nullptr};
+}
+
+template <typename T>
+Field<T> field(const char* key, bool T::*member,
+               Presence presence = kOptional) {
+  return {key, kBool, presence, nullptr, nullptr, member, nullptr};
+}
+
+template <typename T>
+Field<T> field(const char* key, std::vector<std::string> T::*member,
+               Presence presence = kOptional) {
+  return {key, kStringList, presence, nullptr, nullptr, nullptr, member};
+}
+
+inline const char* kind_name(Kind kind) {
+  switch (kind) {
+    case kString:     return "a string";
+    case kInt:        return "an int";
+    case kBool:       return "a bool";
+    case kStringList: return "a list of strings";
+  }
+  return "?";
+}
+
+// Stores |value| into |field|'s member of |out|. False when the value has
+// the wrong type (|out| may then hold part of a list).
+template <typename T>
+bool assign(const Field<T>& field, FlValue* value, T* out) {
+  FlValueType type = fl_value_get_type(value);
+  switch (field.kind) {
+    case kString:
+      if (type != FL_VALUE_TYPE_STRING) return false;
+      out->*field.string_member = fl_value_get_string(value);
+      return true;
+    case kInt:
+      if (type != FL_VALUE_TYPE_INT) return false;
+      out->*field.int_member = fl_value_get_int(value);
+      return true;
+    case kBool:
+      if (type != FL_VALUE_TYPE_BOOL) return false;
+      out->*field.bool_member = fl_value_get_bool(value);
+      return true;
+    case kStringList: {
+      if (type != FL_VALUE_TYPE_LIST) return false;
+      std::vector<std::string>& list = out->*field.list_member;
+      size_t n = fl_value_get_length(value);
+      list.clear();
+      list.reserve(n);
+      for (size_t i = 0; i < n; i++) {
+        FlValue* item = fl_value_get_list_value(value, i);
+        if (fl_value_get_type(item) != FL_VALUE_TYPE_STRING) return false;
+        list.emplace_back(fl_value_get_string(item));
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decodes |args| into |out| (which keeps its defaults for absent keys).
+// Returns false with |error| set on a non-map, a wrongly typed value or a
+// missing required key. A null |args| is an empty map.
+template <typename T, size_t N>
+bool decode(FlValue* args, const Field<T> (&fields)[N], T* out,
+            std::string* error) {
+  static_assert(N <= 32, "schema too large for the seen-field mask");
+  uint32_t seen = 0;
+  FlValueType args_type =
+      args ? fl_value_get_type(args) : FL_VALUE_TYPE_NULL;
+  if (args_type == FL_VALUE_TYPE_MAP) {
+    size_t length = fl_value_get_length(args);
+    for (size_t i = 0; i < length; i++) {
+      FlValue* key = fl_value_get_map_key(args, i);
+      if (fl_value_get_type(key) != FL_VALUE_TYPE_STRING) continue;
+      const gchar* name = fl_value_get_string(key);
+      for (size_t f = 0; f < N; f++) {
+        if (strcmp(fields[f].key, name) != 0) continue;
+        FlValue* value = fl_value_get_map_value(args, i);
+        if (fl_value_get_type(value) == FL_VALUE_TYPE_NULL) break;
+        if (!assign(fields[f], value, out)) {
+          *error = std::string(name) + " must be " + kind_name(fields[f].kind);
+          return false;
+        }
+        seen |= 1u << f;
+        break;
+      }
+    }
+  } else if (args_type != FL_VALUE_TYPE_NULL) {
+    *error = "arguments must be a map";
+    return false;
+  }
+  for (size_t f = 0; f < N; f++) {
+    if (fields[f].presence == kRequired && !(seen & (1u << f))) {
+      *error = std::string(fields[f].key) + " is required";
+      return false;
+    }
+  }
+  return true;
+}
+
+// The one error response for malformed arguments (transfer full).
+inline FlMethodResponse* invalid_arguments(const gchar* method,
+                                           const std::string& error) {
+  std::string message = std::string(method) + ": " + error;
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(
+      "INVALID_ARGUMENTS", message.c_str(), nullptr));
+}
+
+}  // namespace nm_args
+
+#endif  // NM_ARGS_H_
@@ -11,10 +11,37 @@
 //   interval = 1          (minutes, default 15)
 //   enabled  = 1
 //
-// Log is written next to this executable: notification_master_poller.log
+// Subscribed topics are read from prefs.ini (written by the plugin). Each
+// request carries them as `topics=` plus an X-NM-Topics-Hash header, and items
+// for other topics are dropped client-side (see nm_topics.h).
+//
+// Channels created by the plugin live in prefs.ini too. Each item is shown
+// with its channel's urgency, timeout, sound and category, and dropped once
+// the channel is over its rate limit (see nm_channels.h).
+//
+// With transport = mqtt (and a build that found libmosquitto) the daemon
+// instead holds one persistent MQTT connection and subscribes to the same
+// topics on the broker; see nm_mqtt.h and the [mqtt] group in
+// nm_poller_config.h. Pushed messages go through the same display path.
+//
+// The file is parsed once at startup and then only when inotify reports a
+// change (see nm_poller_config.h). Status (last_run / last_error) goes to
+// poller.state so the daemon never rewrites the user's config while polling.
+//
+// Log is written next to this executable: notification_master_poller.log,
+// asynchronously and rotated at 1 MiB keeping 3 old files (see nm_log.h).
+// The runtime level is log_level in [poller] (debug|info|warn|error).
+//
+// With NM_TRACE set, pipeline spans are dumped as Chrome trace JSON on exit
+// and on SIGUSR1 (see nm_trace.h).
+//
+// With NM_CLOCK=simulated the loops run on a SimulatedClock: waits advance
+// simulated time instead of blocking, so soak runs cover days of polling
+// cycles and dedupe windows in minutes (see nm_clock.h).
 //
 // Build: added as add_executable(notification_master_poller ...) in
-// linux/CMakeLists.txt, links libnotify + libcurl + glib-2.0 + json-glib-1.0.
+// linux/CMakeLists.txt, links libnotify + libcurl + glib-2.0 + json-glib-1.0
+// (+ libmosquitto when available, which defines NM_HAVE_MQTT).
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -22,88 +49,85 @@
 #include <curl/curl.h>
 #include <json-glib/json-glib.h>
 
+#include <algorithm>
 #include <atomic>
-#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <fstream>
-#include <map>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 #include <unistd.h>
 #include <signal.h>
 #include <sys/stat.h>
 
+#include "nm_channels.h"
+#include "nm_clock.h"
+#include "nm_dedupe.h"
+#include "nm_feed.h"
+#include "nm_handoff.h"
+#include "nm_history.h"
+#include "nm_log.h"
+#include "nm_metrics.h"
+#include "nm_poller_config.h"
+#include "nm_receipts.h"
+#include "nm_simhash.h"
+#include "nm_topics.h"
+#include "nm_trace.h"
+#ifdef NM_HAVE_MQTT
+#include "nm_mqtt.h"
+#endif
+
 // ---------------------------------------------------------------------------
 // Constants
 // ---------------------------------------------------------------------------
 static constexpr long long kDedupeWindowMs = 60LL * 60 * 1000; // 1 hour
 static const char* kAppName  = "NotificationMaster";
-static const char* kConfDir  = "notification_master";
-static const char* kConfFile = "poller.conf";
-static const char* kGroup    = "poller";
 
 // ---------------------------------------------------------------------------
-// Logging
+// Logging  (asynchronous, see nm_log.h)
 // ---------------------------------------------------------------------------
-static std::mutex  g_log_mtx;
-static std::string g_log_path;
-
-static std::string timestamp_str() {
-  struct timespec ts;
-  clock_gettime(CLOCK_REALTIME, &ts);
-  struct tm t;
-  localtime_r(&ts.tv_sec, &t);
-  char buf[32];
-  snprintf(buf, sizeof(buf), "[%02d:%02d:%02d.%03ld]",
-           t.tm_hour, t.tm_min, t.tm_sec, ts.tv_nsec / 1000000L);
-  return buf;
+#define LOG(msg)       NM_LOG_INFO(msg)
+#define LOG_DEBUG(msg) NM_LOG_DEBUG(msg)
+#define LOG_WARN(msg)  NM_LOG_WARN(msg)
+#define LOG_ERROR(msg) NM_LOG_ERROR(msg)
+
+// Applies log_level from poller.conf (default info).
+// Sets the log level from |conf| and logs the values its loader ignored.
+static void apply_logging(const nm_config::PollerConfig& conf) {
+  nm_log::Level level = nm_log::kInfo;
+  if (!conf.log_level.empty() && !nm_log::parse_level(conf.log_level, &level))
+    LOG_WARN("unknown log_level '" + conf.log_level + "' — using info");
+  nm_log::Logger::get().set_level(level);
+  for (const auto& warning : conf.warnings) LOG_WARN(warning);
 }
 
-static void nm_log(const std::string& msg) {
-  std::lock_guard<std::mutex> lk(g_log_mtx);
-  std::string line = "[NM-POLLER] " + timestamp_str() + " " + msg + "\n";
-  if (!g_log_path.empty()) {
-    FILE* f = fopen(g_log_path.c_str(), "a");
-    if (f) { fputs(line.c_str(), f); fclose(f); }
-  }
-  fputs(line.c_str(), stderr);
-}
-
-#define LOG(msg) nm_log(msg)
-
 // ---------------------------------------------------------------------------
-// Config helpers  (~/.config/notification_master/poller.conf)
+// Config  (~/.config/notification_master/poller.conf, held in memory)
 // ---------------------------------------------------------------------------
-static std::string config_path() {
-  const char* base = g_get_user_config_dir();
-  return std::string(base) + "/" + kConfDir + "/" + kConfFile;
-}
-
-static std::string read_conf(const char* key, const char* fallback = "") {
-  GKeyFile* kf = g_key_file_new();
-  std::string path = config_path();
-  g_key_file_load_from_file(kf, path.c_str(), G_KEY_FILE_NONE, nullptr);
-  gchar* val = g_key_file_get_string(kf, kGroup, key, nullptr);
-  std::string result = val ? val : fallback;
-  g_free(val);
-  g_key_file_free(kf);
-  return result;
+static nm_config::PollerConfigStore g_conf;
+
+// Records the outcome of a poll cycle in poller.state with a single write.
+static void write_status(const std::string& last_run,
+                         const std::string& last_error) {
+  NM_TRACE_SCOPE("write_status", "io");
+  nm_config::KeyValues values;
+  if (!last_run.empty()) values.emplace_back(nm_config::kLastRun, last_run);
+  values.emplace_back(nm_config::kLastError, last_error);
+  nm_config::write_key_file(nm_config::state_path(), nm_config::kStatusGroup,
+                            values);
 }
 
-static void write_conf(const char* key, const std::string& value) {
-  std::string path = config_path();
-  // Ensure directory exists
-  std::string dir = std::string(g_get_user_config_dir()) + "/" + kConfDir;
-  g_mkdir_with_parents(dir.c_str(), 0700);
-
-  GKeyFile* kf = g_key_file_new();
-  g_key_file_load_from_file(kf, path.c_str(), G_KEY_FILE_NONE, nullptr);
-  g_key_file_set_string(kf, kGroup, key, value.c_str());
-  g_key_file_save_to_file(kf, path.c_str(), nullptr);
-  g_key_file_free(kf);
+// Publishes the metrics snapshot to poller.prom (atomic replace, so a
+// textfile collector never reads a partial file).
+static void write_metrics() {
+  NM_TRACE_SCOPE("write_metrics", "io");
+  std::string text = nm_metrics::global().render_prometheus("daemon");
+  g_file_set_contents(nm_config::metrics_path().c_str(), text.data(),
+                      (gssize)text.size(), nullptr);
 }
 
 // ---------------------------------------------------------------------------
@@ -118,12 +142,62 @@ struct CurlBuf {
   }
 };
 
-static std::string http_get(const std::string& url) {
-  CURL* curl = curl_easy_init();
+// Splits a finished transfer into dns / connect / tls / wait / transfer trace
+// spans from curl's cumulative timings (seconds since |start_ns|).
+static void trace_curl_phases(CURL* curl, uint64_t start_ns) {
+  if (!nm_trace::enabled()) return;
+  double dns = 0, connect = 0, tls = 0, first_byte = 0, total = 0;
+  curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &dns);
+  curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &connect);
+  curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &tls);
+  curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &first_byte);
+  curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total);
+  auto span = [start_ns](const char* name, double from, double to) {
+    if (to > from) {
+      nm_trace::record(name, "http", start_ns + (uint64_t)(from * 1e9),
+                       (uint64_t)((to - from) * 1e9));
+    }
+  };
+  span("dns", 0, dns);
+  span("connect", dns, connect);
+  span("tls", connect, tls);
+  double sent = tls > connect ? tls : connect;
+  span("wait", sent, first_byte);
+  span("transfer", first_byte, total);
+}
+
+// One easy handle for the daemon's lifetime (every request runs on the main
+// thread). curl_easy_reset() clears the options but keeps the connection,
+// DNS and TLS session caches, so steady-state polls reuse the connection
+// instead of allocating and handshaking every cycle.
+static CURL* g_curl = nullptr;
+
+static CURL* acquire_curl() {
+  if (!g_curl) {
+    g_curl = curl_easy_init();
+  } else {
+    curl_easy_reset(g_curl);
+  }
+  return g_curl;
+}
+
+static std::string http_get(const std::string& url,
+                            const std::vector<std::string>& topics) {
+  NM_TRACE_SCOPE("http_get", "http");
+  CURL* curl = acquire_curl();
   if (!curl) return "";
 
+  std::string scoped = nm_topics::scoped_url(url, topics);
+  struct curl_slist* headers = nullptr;
+  if (!topics.empty()) {
+    std::string h = std::string(nm_topics::kTopicsHashHeader) + ": " +
+                    nm_topics::topic_set_hash(topics);
+    headers = curl_slist_append(headers, h.c_str());
+  }
+
   CurlBuf buf;
-  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_URL, scoped.c_str());
+  if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CurlBuf::write_cb);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
@@ -132,143 +206,224 @@ static std::string http_get(const std::string& url) {
   // Accept self-signed certs in dev; remove for production hardening
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
 
+  nm_metrics::PollMetrics& metrics = nm_metrics::global();
+  nm_metrics::Stopwatch timer;
+  uint64_t trace_start = nm_trace::enabled() ? nm_trace::now_ns() : 0;
   CURLcode res = curl_easy_perform(curl);
-  curl_easy_cleanup(curl);
+  metrics.http_duration.observe(timer.seconds());
+  long status = 0;
+  if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  metrics.http_responses.inc((int)status);
+  if (trace_start) trace_curl_phases(curl, trace_start);
+  curl_slist_free_all(headers);
 
   if (res != CURLE_OK) {
-    LOG("http_get: CURL error: " + std::string(curl_easy_strerror(res)));
+    LOG_WARN("http_get: CURL error: " + std::string(curl_easy_strerror(res)));
     return "";
   }
+  metrics.http_bytes.observe((double)buf.data.size());
   return buf.data;
 }
 
 // ---------------------------------------------------------------------------
-// JSON parsing  (minimal — mirrors Windows poller)
+// Delivery receipts  (batched POST, see nm_receipts.h)
 // ---------------------------------------------------------------------------
-static std::map<std::string, std::string> parse_notification_obj(
-    JsonObject* obj) {
-  std::map<std::string, std::string> d;
-  auto get = [&](const char* k) -> std::string {
-    JsonNode* n = json_object_get_member(obj, k);
-    if (!n || JSON_NODE_TYPE(n) != JSON_NODE_VALUE) return "";
-    const char* v = json_node_get_string(n);
-    return v ? v : "";
-  };
-  d["title"]    = get("title");
-  d["message"]  = get("message");
-  d["bigText"]  = get("bigText");
-  d["imageUrl"] = get("imageUrl");
-  return d;
+static nm_receipts::ReceiptQueue g_receipts;
+
+static void post_receipts(const std::string& receipts_url) {
+  if (receipts_url.empty() || g_receipts.empty()) return;
+  NM_TRACE_SCOPE("post_receipts", "http");
+  CURL* curl = acquire_curl();
+  if (!curl) return;
+
+  std::string body;
+  size_t count = g_receipts.take_json(&body);
+  struct curl_slist* headers =
+      curl_slist_append(nullptr, "Content-Type: application/json");
+  CurlBuf reply;
+  curl_easy_setopt(curl, CURLOPT_URL, receipts_url.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body.size());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CurlBuf::write_cb);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &reply);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "NotificationMasterPoller/1.0");
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+
+  CURLcode res = curl_easy_perform(curl);
+  long status = 0;
+  if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  curl_slist_free_all(headers);
+
+  if (status >= 200 && status < 300) {
+    g_receipts.commit();
+    nm_metrics::global().receipts_sent.inc(count);
+    LOG_DEBUG("post_receipts: sent " + std::to_string(count));
+  } else {
+    g_receipts.restore();
+    nm_metrics::global().receipts_failed.inc(count);
+    LOG_WARN("post_receipts: failed (status " + std::to_string(status) +
+             ") — " + std::to_string(count) + " receipt(s) kept for retry");
+  }
 }
 
 // ---------------------------------------------------------------------------
 // Deduplication cache
 // ---------------------------------------------------------------------------
-struct DedupeCache {
-  std::mutex mtx;
-  std::map<std::string, long long> seen;
-
-  static long long now_ms() {
-    using namespace std::chrono;
-    return duration_cast<milliseconds>(
-               system_clock::now().time_since_epoch())
-        .count();
-  }
-
-  bool should_show(const std::string& key) {
-    long long now = now_ms();
-    std::lock_guard<std::mutex> lk(mtx);
-    auto it = seen.find(key);
-    if (it != seen.end() && (now - it->second) < kDedupeWindowMs)
-      return false;
-    seen[key] = now;
-    return true;
-  }
-};
+static nm_dedupe::DedupeCache g_dedupe(kDedupeWindowMs);
+// Near-duplicates, when poller.conf sets near_duplicates (same window).
+static nm_dedupe::NearDuplicateIndex g_near_duplicates(kDedupeWindowMs);
+static_assert(nm_config::kMaxNearDuplicates ==
+                  nm_dedupe::NearDuplicateIndex::kMaxDistance,
+              "poller.conf accepts near_duplicates the index cannot honour");
+
+// Channel policies and rate limits, synced from prefs.ini in show_items().
+static nm_channels::Registry g_channels;
+
+// Display history, shared with the plugin (nm_history.h). Opened on first
+// use, after main() has settled the environment.
+static nm_history::Writer& history() {
+  static nm_history::Writer writer(nm_config::history_path());
+  return writer;
+}
 
-static DedupeCache g_dedupe;
+// Live feed of fetched items for a running app (nm_handoff.h).
+static nm_handoff::Publisher& handoff() {
+  static nm_handoff::Publisher publisher(nm_config::handoff_path());
+  return publisher;
+}
 
 // ---------------------------------------------------------------------------
 // Show a single notification via libnotify
 // ---------------------------------------------------------------------------
-static void show_notification(const std::string& title,
-                               const std::string& body) {
+// Returns true if the notification reached the notification server. Only
+// then is it remembered for dedupe: an item dropped by a rate limit or a
+// D-Bus failure is shown when it comes round again.
+static bool show_notification(const std::string& title,
+                              const std::string& body,
+                              const std::string& channel_id) {
   if (!notify_is_initted()) notify_init(kAppName);
 
   std::string key = title + '\0' + body;
-  if (!g_dedupe.should_show(key)) {
-    LOG("show_notification: SKIPPED (already shown recently): title='" +
+  if (g_dedupe.seen(key)) {
+    nm_metrics::global().dedupe_hits.inc();
+    LOG_DEBUG("show_notification: SKIPPED (already shown recently): title='" +
         title + "'");
-    return;
+    return false;
+  }
+  const int max_distance = g_conf.current().near_duplicates;
+  const uint64_t fingerprint =
+      max_distance > 0 ? nm_dedupe::simhash(title + '\n' + body) : 0;
+  if (max_distance > 0 && g_near_duplicates.seen(fingerprint, max_distance)) {
+    nm_metrics::global().near_duplicate_hits.inc();
+    LOG_DEBUG("show_notification: SKIPPED (near-duplicate of a recent one): "
+        "title='" + title + "'");
+    return false;
+  }
+  nm_channels::Channel channel;
+  if (!g_channels.admit(channel_id, nm_clock::get().monotonic_ms(),
+                        &channel)) {
+    nm_metrics::global().rate_limited.inc();
+    LOG_DEBUG("show_notification: SKIPPED (channel '" + channel_id +
+        "' over its rate limit): title='" + title + "'");
+    return false;
   }
 
-  LOG("show_notification: title='" + title + "' body='" + body + "'");
+  LOG_DEBUG("show_notification: title='" + title + "' body='" + body + "'");
+  NM_TRACE_SCOPE("notify_show", "display");
   NotifyNotification* n = notify_notification_new(
       title.c_str(), body.empty() ? nullptr : body.c_str(), nullptr);
   notify_notification_set_timeout(n, NOTIFY_EXPIRES_DEFAULT);
+  nm_channels::apply(channel, n);
   GError* err = nullptr;
-  if (!notify_notification_show(n, &err)) {
-    LOG("show_notification: ERROR " +
+  nm_metrics::Stopwatch timer;
+  gboolean shown = notify_notification_show(n, &err);
+  nm_metrics::global().display_duration.observe(timer.seconds());
+  if (shown) {
+    g_dedupe.remember(key);
+    if (max_distance > 0) g_near_duplicates.remember(fingerprint);
+  } else {
+    nm_metrics::global().display_errors.inc();
+    LOG_ERROR("show_notification: ERROR " +
         std::string(err ? err->message : "unknown"));
     if (err) g_error_free(err);
   }
   g_object_unref(G_OBJECT(n));
+  return shown;
 }
 
 // ---------------------------------------------------------------------------
 // Parse server response and show notifications
 // ---------------------------------------------------------------------------
-static void parse_and_show(const std::string& json_str) {
-  GError* err = nullptr;
-  JsonParser* parser = json_parser_new();
-  if (!json_parser_load_from_data(parser, json_str.c_str(),
-                                   (gssize)json_str.size(), &err)) {
-    LOG("parse_and_show: JSON parse error: " +
-        std::string(err ? err->message : "?"));
-    if (err) g_error_free(err);
-    g_object_unref(parser);
-    return;
+static void show_items(const std::vector<nm_feed::Item>& items,
+                       const std::vector<std::string>& topics) {
+  NM_TRACE_SCOPE("show_items", "display");
+  // Unchanged channels keep their buckets across reloads.
+  g_channels.set(g_conf.current().channels);
+  nm_topics::TopicMatcher matcher(topics);
+  std::vector<nm_feed::Item> matched;
+  for (const auto& item : items) {
+    if (matcher.matches(item.topic)) matched.push_back(item);
   }
-
-  JsonNode* root = json_parser_get_root(parser);
-  if (!root || JSON_NODE_TYPE(root) != JSON_NODE_OBJECT) {
-    g_object_unref(parser);
-    return;
+  const size_t filtered = items.size() - matched.size();
+  // The app, if it is running, hears about the items that were shown, in
+  // one batch after the last of them.
+  auto show = [](const nm_feed::Item& item) {
+    const std::string& title = item.title.empty() ? item.message : item.title;
+    const std::string& body =
+        item.big_text.empty() ? item.message : item.big_text;
+    if ((title.empty() && body.empty()) ||
+        !show_notification(title, body, item.channel))
+      return false;
+    nm_receipts::Receipt receipt;
+    receipt.id = item.id;
+    receipt.topic = item.topic;
+    receipt.sent_at_ms = item.sent_at_ms;
+    receipt.displayed_at_ms = nm_feed::now_epoch_ms();
+    nm_metrics::global().record_delivery(receipt.sent_at_ms,
+                                         receipt.displayed_at_ms);
+    g_receipts.add(receipt);
+    nm_history::Record record;
+    record.source = nm_history::kDaemon;
+    record.shown_at_ms = receipt.displayed_at_ms;
+    record.item_id = item.id;
+    record.title = title;
+    record.message = item.message;
+    record.big_text = item.big_text;
+    record.channel = item.channel;
+    record.topic = item.topic;
+    history().append(record);
+    return true;
+  };
+  if (!handoff().publish_shown(matched, show)) {
+    LOG_WARN("show_items: cannot open " + nm_config::handoff_path());
   }
-  JsonObject* root_obj = json_node_get_object(root);
-
-  // Format: {"notifications": [...]}
-  if (json_object_has_member(root_obj, "notifications")) {
-    JsonArray* arr = json_object_get_array_member(root_obj, "notifications");
-    if (arr) {
-      guint len = json_array_get_length(arr);
-      LOG("parse_and_show: found " + std::to_string(len) + " notification(s)");
-      for (guint i = 0; i < len; ++i) {
-        JsonNode* node = json_array_get_element(arr, i);
-        if (JSON_NODE_TYPE(node) == JSON_NODE_OBJECT) {
-          auto d = parse_notification_obj(json_node_get_object(node));
-          std::string title = d["title"].empty() ? d["message"] : d["title"];
-          std::string body  = d["bigText"].empty() ? d["message"] : d["bigText"];
-          if (!title.empty() || !body.empty())
-            show_notification(title, body);
-        }
-      }
-    }
+  nm_metrics::global().topic_filtered.inc(filtered);
+  if (filtered > 0)
+    LOG_DEBUG("show_items: dropped " + std::to_string(filtered) +
+        " item(s) for unsubscribed topics");
+}
+
+static void parse_and_show(const std::string& json_str,
+                           const std::vector<std::string>& topics) {
+  std::vector<nm_feed::Item> items;
+  std::string error;
+  nm_metrics::Stopwatch timer;
+  bool ok;
+  {
+    NM_TRACE_SCOPE("parse", "parse");
+    ok = nm_feed::parse(json_str.data(), json_str.size(), &items, &error);
   }
-  // Format: {"data": {...}}
-  else if (json_object_has_member(root_obj, "data")) {
-    JsonObject* data_obj =
-        json_object_get_object_member(root_obj, "data");
-    if (data_obj) {
-      auto d = parse_notification_obj(data_obj);
-      std::string title = d["title"].empty() ? d["message"] : d["title"];
-      std::string body  = d["bigText"].empty() ? d["message"] : d["bigText"];
-      if (!title.empty() || !body.empty())
-        show_notification(title, body);
-    }
+  nm_metrics::global().parse_duration.observe(timer.seconds());
+  if (!ok) {
+    LOG_WARN("parse_and_show: " + error);
+    return;
   }
-
-  g_object_unref(parser);
+  nm_metrics::global().poll_items.observe((double)items.size());
+  LOG_DEBUG("parse_and_show: found " + std::to_string(items.size()) +
+      " notification(s)");
+  show_items(items, topics);
 }
 
 // ---------------------------------------------------------------------------
@@ -278,50 +433,210 @@ static std::atomic<bool> g_running{true};
 
 static void handle_signal(int) { g_running.store(false); }
 
+// SIGUSR1 asks for a trace dump; the loops service it between cycles.
+static std::atomic<bool> g_trace_dump_requested{false};
+
+static void handle_trace_signal(int) { g_trace_dump_requested.store(true); }
+
+static void maybe_dump_trace() {
+  if (!g_trace_dump_requested.exchange(false)) return;
+  std::string path = nm_trace::dump();
+  if (path.empty()) LOG_WARN("trace dump requested but tracing is off (NM_TRACE)");
+  else LOG("trace written to " + path);
+}
+
+static std::string now_epoch_str() {
+  return std::to_string(nm_clock::get().wall_ms() / 1000);
+}
+
+// True when |conf| asks for MQTT and this build can provide it.
+static bool use_mqtt(const nm_config::PollerConfig& conf) {
+#ifdef NM_HAVE_MQTT
+  return conf.transport == nm_config::kTransportMqtt;
+#else
+  (void)conf;
+  return false;
+#endif
+}
+
 static void polling_loop() {
   LOG("polling_loop: started");
 
+  // poller.conf is held in memory; inotify tells us when the plugin changes
+  // it. Without inotify fall back to re-reading it once per cycle.
+  bool watching = g_conf.watch();
+  if (!watching) LOG_WARN("polling_loop: inotify unavailable — reloading per cycle");
+
   while (g_running.load()) {
-    // Re-read config each cycle so the plugin can update URL/interval live.
-    std::string url      = read_conf("url");
-    std::string en       = read_conf("enabled", "1");
-    std::string iv_str   = read_conf("interval", "15");
-    int interval         = std::atoi(iv_str.c_str());
-    if (interval <= 0) interval = 15;
-
-    if (en != "1") {
+    if (!watching) g_conf.load();
+    const nm_config::PollerConfig conf = g_conf.current();
+
+    if (!conf.enabled) {
       LOG("polling_loop: enabled=0 — exiting");
       break;
     }
-    if (url.empty()) {
+    if (use_mqtt(conf)) {
+      LOG("polling_loop: transport=mqtt — switching");
+      break;
+    }
+    if (conf.url.empty()) {
       LOG("polling_loop: no url configured — waiting");
     } else {
-      LOG("polling_loop: requesting " + url);
-      std::string resp = http_get(url);
+      NM_TRACE_SCOPE("poll_cycle", "poll");
+      LOG_DEBUG("polling_loop: requesting " + conf.url);
+      nm_metrics::global().polls.inc();
+      std::string resp = http_get(conf.url, conf.topics);
       if (resp.empty()) {
-        LOG("polling_loop: empty/failed response");
-        write_conf("last_error", "empty response");
+        LOG_WARN("polling_loop: empty/failed response");
+        write_status("", "empty response");
       } else {
-        LOG("polling_loop: got " + std::to_string(resp.size()) + " bytes");
-        parse_and_show(resp);
+        LOG_DEBUG("polling_loop: got " + std::to_string(resp.size()) + " bytes");
+        parse_and_show(resp, conf.topics);
         // Record last-run timestamp (epoch seconds as string)
-        write_conf("last_run",
-                   std::to_string(
-                       std::chrono::duration_cast<std::chrono::seconds>(
-                           std::chrono::system_clock::now().time_since_epoch())
-                           .count()));
-        write_conf("last_error", "");
+        write_status(now_epoch_str(), "");
       }
+      post_receipts(conf.receipts_url);
+      write_metrics();
     }
 
-    // Sleep interval*60 seconds in 1s slices so SIGTERM is handled quickly.
-    for (int i = 0; i < interval * 60 && g_running.load(); ++i) {
-      std::this_thread::sleep_for(std::chrono::seconds(1));
+    // Sleep until the next cycle in 1s slices so SIGTERM is handled quickly.
+    // A config change ends the wait early: disabling stops the daemon, a new
+    // URL or topic set is polled right away and a new interval re-arms the
+    // deadline.
+    nm_clock::Clock& clock = nm_clock::get();
+    const int64_t cycle_start = clock.monotonic_ms();
+    while (g_running.load()) {
+      const nm_config::PollerConfig& now_conf = g_conf.current();
+      int64_t remaining = cycle_start +
+                          (int64_t)now_conf.poll_period_seconds() * 1000 -
+                          clock.monotonic_ms();
+      if (remaining <= 0) break;
+      maybe_dump_trace();
+      if (g_conf.wait_for_change(
+              (int)clock.begin_wait(std::min<int64_t>(remaining, 1000)))) {
+        LOG("polling_loop: config changed — reloaded");
+        apply_logging(g_conf.current());
+        if (!g_conf.current().enabled || g_conf.current().url != conf.url ||
+            g_conf.current().topics != conf.topics ||
+            use_mqtt(g_conf.current()))
+          break;
+      }
     }
   }
   LOG("polling_loop: exited");
 }
 
+#ifdef NM_HAVE_MQTT
+// ---------------------------------------------------------------------------
+// MQTT loop — one persistent connection instead of interval polling
+// ---------------------------------------------------------------------------
+static void mqtt_loop() {
+  LOG("mqtt_loop: started");
+  bool watching = g_conf.watch();
+  nm_config::PollerConfig conf = g_conf.current();
+
+  nm_mqtt::Subscriber sub(
+      conf.mqtt, [&conf](const std::string& broker_topic, const char* payload,
+                         size_t len) {
+        NM_TRACE_SCOPE("mqtt_message", "mqtt");
+        std::vector<nm_feed::Item> items;
+        std::string error;
+        if (!nm_feed::parse_message(payload, len, &items, &error)) {
+          LOG_WARN("mqtt_loop: bad payload on " + broker_topic + ": " + error);
+          return;
+        }
+        nm_metrics::global().poll_items.observe((double)items.size());
+        std::string topic =
+            nm_topics::topic_from_broker(conf.mqtt.topic_prefix, broker_topic);
+        for (auto& item : items) {
+          if (item.topic.empty()) item.topic = topic;
+        }
+        show_items(items, conf.topics);
+      });
+  sub.set_topics(conf.topics);
+
+  // Reconnect with exponential backoff (1 s .. 60 s). Every reconnect resumes
+  // the broker session, so QoS 1 messages published meanwhile still arrive.
+  nm_clock::Clock& clock = nm_clock::get();
+  int backoff_s = 1;
+  int64_t next_attempt = clock.monotonic_ms();
+  int64_t next_reload = next_attempt;
+  int64_t next_metrics = next_attempt;
+  bool was_connected = false;
+
+  while (g_running.load()) {
+    const int64_t now = clock.monotonic_ms();
+    std::string error;
+    if (!sub.connected() && !was_connected && now >= next_attempt) {
+      LOG("mqtt_loop: connecting to " + conf.mqtt.host + ":" +
+          std::to_string(conf.mqtt.port));
+      if (sub.connect(&error)) {
+        was_connected = true;
+      } else {
+        LOG_WARN("mqtt_loop: connect failed: " + error);
+        write_status("", "mqtt: " + error);
+        next_attempt = now + backoff_s * 1000;
+        backoff_s = std::min(backoff_s * 2, 60);
+      }
+    }
+
+    if (was_connected) {
+      bool had_session = sub.connected();
+      if (!sub.loop(250, &error)) {
+        LOG_WARN("mqtt_loop: connection lost: " + error);
+        write_status("", "mqtt: " + error);
+        was_connected = false;
+        next_attempt = now + backoff_s * 1000;
+        backoff_s = std::min(backoff_s * 2, 60);
+      } else if (!had_session && sub.connected()) {
+        LOG("mqtt_loop: connected");
+        write_status(now_epoch_str(), "");
+        backoff_s = 1;
+      }
+    }
+
+    maybe_dump_trace();
+
+    // Messages arrive at any time; post receipts and publish the metrics
+    // snapshot every 15 s.
+    if (now >= next_metrics) {
+      post_receipts(g_conf.current().receipts_url);
+      write_metrics();
+      next_metrics = now + 15 * 1000;
+    }
+
+    bool changed;
+    if (watching) {
+      changed = g_conf.wait_for_change(
+          (int)clock.begin_wait(was_connected ? 0 : 250));
+    } else {
+      changed = now >= next_reload;
+      if (changed) {
+        g_conf.load();
+        next_reload = now + 30 * 1000;
+      }
+      if (!was_connected) clock.sleep_ms(250);
+    }
+    if (changed) {
+      const nm_config::PollerConfig& next = g_conf.current();
+      apply_logging(next);
+      if (!next.enabled || !use_mqtt(next) || next.mqtt != conf.mqtt) {
+        LOG("mqtt_loop: config changed — restarting transport");
+        break;
+      }
+      if (next.topics != conf.topics) {
+        LOG("mqtt_loop: topics changed — updating subscriptions");
+        conf.topics = next.topics;
+        sub.set_topics(conf.topics);
+      }
+    }
+  }
+  sub.disconnect();
+  write_metrics();
+  LOG("mqtt_loop: exited");
+}
+#endif  // NM_HAVE_MQTT
+
 // ---------------------------------------------------------------------------
 // Resolve the log path next to this executable
 // ---------------------------------------------------------------------------
@@ -339,38 +654,77 @@ static std::string resolve_log_path() {
 // main
 // ---------------------------------------------------------------------------
 int main(int argc, char* argv[]) {
-  // Set log path next to executable.
-  g_log_path = resolve_log_path();
+  // Log next to the executable; echo to stderr only when run from a terminal.
+  nm_log::Options log_options;
+  log_options.path = resolve_log_path();
+  log_options.echo_stderr = isatty(STDERR_FILENO);
+  nm_log::Logger::get().start(log_options);
 
   // Handle termination signals so the daemon exits cleanly.
   signal(SIGTERM, handle_signal);
   signal(SIGINT,  handle_signal);
+  signal(SIGUSR1, handle_trace_signal);
+
+  // Opt-in span tracing (NM_TRACE, inherited from the app); see nm_trace.h.
+  if (nm_trace::init_from_env("poller")) nm_trace::set_thread_name("polling_loop");
+
+  // Accelerated time for soak tests only; see nm_clock.h.
+  static nm_clock::SimulatedClock simulated_clock;
+  const char* clock_env = getenv("NM_CLOCK");
+  if (clock_env && strcmp(clock_env, "simulated") == 0) {
+    nm_clock::set_default(&simulated_clock);
+    LOG("using simulated clock (NM_CLOCK=simulated)");
+  }
 
   // Optionally accept --url and --interval on the command line so the plugin
   // can pass config directly without waiting for the conf file to be written.
+  // They are persisted together with enabled=1 in ONE write, and only when
+  // they differ from what the plugin already wrote before launching us.
+  g_conf.load();
+  const nm_config::PollerConfig& initial = g_conf.current();
   for (int i = 1; i < argc - 1; ++i) {
-    if (strcmp(argv[i], "--url") == 0)
-      write_conf("url", argv[i + 1]);
-    else if (strcmp(argv[i], "--interval") == 0)
-      write_conf("interval", argv[i + 1]);
+    if (strcmp(argv[i], "--url") == 0 && initial.url != argv[i + 1])
+      g_conf.stage(nm_config::kUrl, argv[i + 1]);
+    else if (strcmp(argv[i], "--interval") == 0 &&
+             initial.interval_minutes != std::atoi(argv[i + 1]))
+      g_conf.stage(nm_config::kInterval, argv[i + 1]);
   }
-  write_conf("enabled", "1");
+  if (!initial.enabled) g_conf.stage(nm_config::kEnabled, "1");
+  g_conf.commit();
+  apply_logging(g_conf.current());
 
   LOG("daemon started — pid=" + std::to_string(getpid()));
 
   // Initialise libnotify.
   if (!notify_init(kAppName)) {
-    LOG("WARNING: notify_init failed — notifications may not appear");
+    LOG_WARN("notify_init failed — notifications may not appear");
   }
 
   // Initialise libcurl globally (once per process).
   curl_global_init(CURL_GLOBAL_DEFAULT);
 
-  polling_loop();
+  // Run whichever transport the config asks for until disabled or signalled;
+  // each loop returns when the transport (or its connection settings) change.
+  while (g_running.load() && g_conf.current().enabled) {
+#ifdef NM_HAVE_MQTT
+    if (use_mqtt(g_conf.current())) {
+      mqtt_loop();
+      continue;
+    }
+#else
+    if (g_conf.current().transport == nm_config::kTransportMqtt)
+      LOG_WARN("transport=mqtt requested but built without libmosquitto — polling");
+#endif
+    polling_loop();
+  }
 
+  if (g_curl) curl_easy_cleanup(g_curl);
   curl_global_cleanup();
   if (notify_is_initted()) notify_uninit();
 
+  std::string trace_path = nm_trace::dump();
+  if (!trace_path.empty()) LOG("trace written to " + trace_path);
   LOG("daemon exiting");
+  nm_log::Logger::get().stop();
   return 0;
 }
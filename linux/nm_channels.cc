@@ -0,0 +1,216 @@
+#include "nm_channels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace nm_channels {
+
+static const char* const kName = "name";
+static const char* const kDescription = "description";
+static const char* const kUrgency = "urgency";
+static const char* const kTimeoutMs = "timeout_ms";
+static const char* const kSound = "sound";
+static const char* const kSilent = "silent";
+static const char* const kCategory = "category";
+static const char* const kRatePerMinute = "rate_per_minute";
+static const char* const kBurst = "burst";
+
+bool Channel::operator==(const Channel& o) const {
+  return id == o.id && name == o.name && description == o.description &&
+         urgency == o.urgency && timeout_ms == o.timeout_ms &&
+         sound == o.sound && silent == o.silent && category == o.category &&
+         rate_per_minute == o.rate_per_minute && burst == o.burst;
+}
+
+int urgency_for_importance(int importance) {
+  if (importance <= 1) return NOTIFY_URGENCY_LOW;
+  if (importance >= 4) return NOTIFY_URGENCY_CRITICAL;
+  return NOTIFY_URGENCY_NORMAL;
+}
+
+static std::string read_string(GKeyFile* kf, const char* group,
+                               const char* key) {
+  gchar* value = g_key_file_get_string(kf, group, key, nullptr);
+  std::string result = value ? value : "";
+  g_free(value);
+  return result;
+}
+
+static int read_int(GKeyFile* kf, const char* group, const char* key,
+                    int fallback) {
+  std::string value = read_string(kf, group, key);
+  return value.empty() ? fallback : std::atoi(value.c_str());
+}
+
+std::vector<Channel> load_all(GKeyFile* kf) {
+  std::vector<Channel> channels;
+  const size_t prefix_len = strlen(kGroupPrefix);
+  gchar** groups = g_key_file_get_groups(kf, nullptr);
+  for (gchar** g = groups; g && *g; ++g) {
+    if (strncmp(*g, kGroupPrefix, prefix_len) != 0 ||
+        (*g)[prefix_len] == '\0') {
+      continue;
+    }
+    Channel c;
+    c.id = *g + prefix_len;
+    c.name = read_string(kf, *g, kName);
+    c.description = read_string(kf, *g, kDescription);
+    c.urgency = std::min(
+        std::max(read_int(kf, *g, kUrgency, c.urgency), 0),
+        (int)NOTIFY_URGENCY_CRITICAL);
+    c.timeout_ms = std::max(read_int(kf, *g, kTimeoutMs, c.timeout_ms),
+                            kCallerTimeout);
+    c.sound = read_string(kf, *g, kSound);
+    c.silent = read_int(kf, *g, kSilent, 0) != 0;
+    c.category = read_string(kf, *g, kCategory);
+    c.rate_per_minute = std::max(read_int(kf, *g, kRatePerMinute, 0), 0);
+    c.burst = std::max(read_int(kf, *g, kBurst, 0), 0);
+    channels.push_back(c);
+  }
+  g_strfreev(groups);
+  return channels;
+}
+
+void save(GKeyFile* kf, const Channel& c) {
+  std::string group = kGroupPrefix + c.id;
+  g_key_file_remove_group(kf, group.c_str(), nullptr);
+  const char* g = group.c_str();
+  g_key_file_set_string(kf, g, kName, c.name.c_str());
+  if (!c.description.empty()) {
+    g_key_file_set_string(kf, g, kDescription, c.description.c_str());
+  }
+  g_key_file_set_integer(kf, g, kUrgency, c.urgency);
+  g_key_file_set_integer(kf, g, kTimeoutMs, c.timeout_ms);
+  if (!c.sound.empty()) g_key_file_set_string(kf, g, kSound, c.sound.c_str());
+  g_key_file_set_integer(kf, g, kSilent, c.silent ? 1 : 0);
+  if (!c.category.empty()) {
+    g_key_file_set_string(kf, g, kCategory, c.category.c_str());
+  }
+  g_key_file_set_integer(kf, g, kRatePerMinute, c.rate_per_minute);
+  g_key_file_set_integer(kf, g, kBurst, c.burst);
+}
+
+void apply(const Channel& c, NotifyNotification* notification) {
+  notify_notification_set_urgency(notification, (NotifyUrgency)c.urgency);
+  if (c.timeout_ms != kCallerTimeout) {
+    notify_notification_set_timeout(notification, c.timeout_ms);
+  }
+  if (c.silent) {
+    notify_notification_set_hint(notification, "suppress-sound",
+                                 g_variant_new_boolean(TRUE));
+  } else if (!c.sound.empty()) {
+    notify_notification_set_hint_string(notification, "sound-name",
+                                        c.sound.c_str());
+  }
+  if (!c.category.empty()) {
+    notify_notification_set_category(notification, c.category.c_str());
+  }
+}
+
+TokenBucket::TokenBucket(int per_minute, int burst)
+    : per_ms_(per_minute / 60000.0) {
+  if (burst <= 0) burst = std::max(1, per_minute / 6);
+  capacity_ = burst;
+  tokens_ = capacity_;
+}
+
+bool TokenBucket::take(int64_t now_ms) {
+  if (per_ms_ <= 0) return true;  // unlimited
+  if (last_ms_ >= 0 && now_ms > last_ms_) {
+    tokens_ = std::min(capacity_, tokens_ + (now_ms - last_ms_) * per_ms_);
+  }
+  if (last_ms_ < 0 || now_ms > last_ms_) last_ms_ = now_ms;
+  if (tokens_ < 1.0) return false;
+  tokens_ -= 1.0;
+  return true;
+}
+
+void Registry::set(const std::vector<Channel>& channels) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::unordered_map<std::string, Entry> previous;
+  previous.swap(entries_);
+  for (const Channel& channel : channels) {
+    auto it = previous.find(channel.id);
+    if (it != previous.end() && it->second.channel == channel) {
+      entries_.emplace(channel.id, it->second);
+    } else {
+      put_locked(channel);
+    }
+  }
+  // A removed default channel leaves unregistered ids unlimited.
+  if (!entries_.count(kDefaultChannel)) unlisted_.clear();
+}
+
+void Registry::put(const Channel& channel) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  put_locked(channel);
+}
+
+void Registry::put_locked(const Channel& channel) {
+  // A new default policy applies to unregistered ids from a full bucket.
+  if (channel.id == kDefaultChannel) unlisted_.clear();
+  unlisted_.erase(channel.id);
+  entries_.erase(channel.id);
+  entries_.emplace(channel.id,
+                   Entry{channel, TokenBucket(channel.rate_per_minute,
+                                              channel.burst)});
+}
+
+Registry::Entry* Registry::find_locked(const std::string& channel_id) {
+  auto it = entries_.find(channel_id);
+  if (it == entries_.end()) it = entries_.find(kDefaultChannel);
+  return it == entries_.end() ? nullptr : &it->second;
+}
+
+Registry::Entry* Registry::find_bucket_locked(const std::string& channel_id) {
+  auto it = entries_.find(channel_id);
+  if (it != entries_.end()) return &it->second;
+  auto fallback = entries_.find(kDefaultChannel);
+  if (fallback == entries_.end()) return nullptr;
+  auto own = unlisted_.find(channel_id);
+  if (own == unlisted_.end()) {
+    if (unlisted_.size() >= kMaxUnlisted) unlisted_.erase(unlisted_.begin());
+    const Channel& policy = fallback->second.channel;
+    own = unlisted_
+              .emplace(channel_id,
+                       Entry{policy, TokenBucket(policy.rate_per_minute,
+                                                 policy.burst)})
+              .first;
+  }
+  return &own->second;
+}
+
+bool Registry::admit(const std::string& channel_id, int64_t now_ms,
+                     Channel* policy) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Entry* entry = find_bucket_locked(channel_id);
+  if (!entry) {
+    *policy = Channel();
+    policy->id = channel_id;
+    return true;
+  }
+  *policy = entry->channel;
+  return entry->bucket.take(now_ms);
+}
+
+void Registry::policy(const std::string& channel_id, Channel* policy) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  const Entry* entry = find_locked(channel_id);
+  if (entry) {
+    *policy = entry->channel;
+  } else {
+    *policy = Channel();
+    policy->id = channel_id;
+  }
+}
+
+std::vector<Channel> Registry::channels() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<Channel> channels;
+  channels.reserve(entries_.size());
+  for (const auto& entry : entries_) channels.push_back(entry.second.channel);
+  return channels;
+}
+
+}  // namespace nm_channels
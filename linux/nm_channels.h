@@ -0,0 +1,132 @@
+#ifndef NM_CHANNELS_H_
+#define NM_CHANNELS_H_
+
+// Notification channels shared by the plugin and the background poller
+// daemon.
+//
+// createCustomChannel stores each channel as a [channel:<id>] group in
+// prefs.ini (see nm_prefs.h). The daemon picks the groups up through
+// PollerConfigStore, which already reloads prefs.ini on change:
+//
+//   [channel:alerts]
+//   name           = Alerts
+//   description    = ...
+//   urgency        = 2          (0 low, 1 normal, 2 critical)
+//   timeout_ms     = 10000      (-1: the caller's default, 0: never expires)
+//   sound          = message-new-instant  (sound-name hint)
+//   silent         = 0          (1 sends suppress-sound)
+//   category       = im.received
+//   rate_per_minute = 30        (0: unlimited)
+//   burst          = 5
+//
+// Both display paths ask a Registry to admit() a notification before it
+// reaches the notification server. Each channel has its own token bucket, so
+// a feed flooding one channel is throttled there and the others keep their
+// budget. Ids without a channel of their own use the policy of the
+// "default" channel when one exists, each with a bucket of its own, so one
+// noisy unregistered feed does not throttle the others. Without a "default"
+// channel they are unlimited.
+//
+// Thread-safe. Needs GLib and libnotify.
+
+#include <glib.h>
+#include <libnotify/notify.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nm_channels {
+
+static const char* const kGroupPrefix = "channel:";
+static const char* const kDefaultChannel = "default";
+
+// Channel::timeout_ms meaning "whatever the display path uses by default".
+static constexpr int kCallerTimeout = -1;
+
+struct Channel {
+  std::string id;
+  std::string name;
+  std::string description;
+  int urgency = NOTIFY_URGENCY_NORMAL;
+  int timeout_ms = kCallerTimeout;
+  std::string sound;
+  bool silent = false;
+  std::string category;
+  int rate_per_minute = 0;  // 0: unlimited
+  int burst = 0;            // 0: ten seconds' worth, at least one
+
+  bool operator==(const Channel& o) const;
+};
+
+// Maps createCustomChannel's importance (the Dart NotificationImportance
+// index, 0 min .. 4 max) to an urgency.
+int urgency_for_importance(int importance);
+
+// Reads every [channel:<id>] group of |kf|.
+std::vector<Channel> load_all(GKeyFile* kf);
+// Writes |channel| as its group in |kf|, replacing the previous one.
+void save(GKeyFile* kf, const Channel& channel);
+
+// Sets urgency, timeout (when the channel has one), sound and category on
+// |notification|.
+void apply(const Channel& channel, NotifyNotification* notification);
+
+// Classic token bucket: |burst| tokens, refilled at |per_minute|.
+class TokenBucket {
+ public:
+  TokenBucket(int per_minute, int burst);
+
+  // Takes one token at |now_ms| (monotonic); false when none is left.
+  bool take(int64_t now_ms);
+
+ private:
+  double per_ms_;
+  double capacity_;
+  double tokens_;
+  int64_t last_ms_ = -1;
+};
+
+class Registry {
+ public:
+  // Replaces the channel set. Unchanged channels keep their buckets, so a
+  // reload does not hand out a fresh burst.
+  void set(const std::vector<Channel>& channels);
+  // Adds or replaces one channel.
+  void put(const Channel& channel);
+
+  // Fills |policy| for |channel_id| and takes a token from its bucket.
+  // Returns false when the channel is over its rate limit.
+  bool admit(const std::string& channel_id, int64_t now_ms, Channel* policy);
+  // Fills |policy| without touching the rate limit.
+  void policy(const std::string& channel_id, Channel* policy);
+
+  std::vector<Channel> channels() const;
+
+ private:
+  struct Entry {
+    Channel channel;
+    TokenBucket bucket;
+  };
+
+  // Buckets kept for ids without a channel; past this an arbitrary one is
+  // dropped and starts full when its id comes back.
+  static constexpr size_t kMaxUnlisted = 256;
+
+  void put_locked(const Channel& channel);
+  // The channel of |channel_id|, else the default channel, else nullptr.
+  Entry* find_locked(const std::string& channel_id);
+  // Like find_locked(), but an id without a channel gets its own entry with
+  // the default channel's policy and a fresh bucket.
+  Entry* find_bucket_locked(const std::string& channel_id);
+
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::unordered_map<std::string, Entry> unlisted_;
+};
+
+}  // namespace nm_channels
+
+#endif  // NM_CHANNELS_H_
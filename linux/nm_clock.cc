@@ -0,0 +1,60 @@
+#include "nm_clock.h"
+
+#include <chrono>
+#include <thread>
+
+namespace nm_clock {
+
+int64_t SystemClock::wall_ms() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t SystemClock::monotonic_ms() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void SystemClock::sleep_ms(int64_t ms) {
+  if (ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+SimulatedClock::SimulatedClock(int64_t wall_ms)
+    : wall_(wall_ms >= 0 ? wall_ms : system_clock().wall_ms()),
+      monotonic_(1000000000) {}
+
+void SimulatedClock::advance(int64_t ms) {
+  if (ms <= 0) return;
+  monotonic_.fetch_add(ms, std::memory_order_acq_rel);
+  wall_.fetch_add(ms, std::memory_order_acq_rel);
+}
+
+void SimulatedClock::jump_wall(int64_t delta_ms) {
+  wall_.fetch_add(delta_ms, std::memory_order_acq_rel);
+}
+
+Clock& system_clock() {
+  static SystemClock* instance = new SystemClock();
+  return *instance;
+}
+
+static std::atomic<Clock*> g_default{nullptr};
+
+Clock& get() {
+  Clock* clock = g_default.load(std::memory_order_acquire);
+  return clock ? *clock : system_clock();
+}
+
+void set_default(Clock* clock) {
+  g_default.store(clock, std::memory_order_release);
+}
+
+int64_t seconds_until(int64_t target_epoch_ms, const Clock& clock) {
+  int64_t remaining_ms = target_epoch_ms - clock.wall_ms();
+  if (remaining_ms <= 0) return 0;
+  return (remaining_ms + 999) / 1000;
+}
+
+}  // namespace nm_clock
@@ -0,0 +1,93 @@
+#ifndef NM_CLOCK_H_
+#define NM_CLOCK_H_
+
+// Time source shared by the plugin and the background poller daemon. The
+// polling loops, the dedupe cache and the scheduler read time and wait
+// through a Clock instead of calling std::chrono / time() / sleep directly,
+// so tests, benchmarks and soak runs can substitute a SimulatedClock that
+// advances days in milliseconds and can jump its wall clock independently of
+// its monotonic clock (NTP steps, suspend, manual changes).
+//
+// Two timelines are kept apart on purpose:
+//   wall_ms()      — epoch milliseconds; for absolute targets such as
+//                    scheduledEpochMillis and last_run stamps;
+//   monotonic_ms() — never jumps; for intervals, deadlines and windows.
+//
+// The daemon switches to a SimulatedClock when started with
+// NM_CLOCK=simulated (soak tests only; see linux/loadtest/soak.py).
+
+#include <atomic>
+#include <cstdint>
+
+namespace nm_clock {
+
+class Clock {
+ public:
+  virtual ~Clock() = default;
+
+  virtual int64_t wall_ms() const = 0;
+  virtual int64_t monotonic_ms() const = 0;
+
+  // Lets |ms| of clock time pass.
+  virtual void sleep_ms(int64_t ms) = 0;
+
+  // For callers about to block on a descriptor (inotify, a socket) for up to
+  // |ms| of clock time: returns the real timeout to block with. A simulated
+  // clock advances by |ms| and returns 0, so the caller only polls.
+  virtual int64_t begin_wait(int64_t ms) = 0;
+};
+
+class SystemClock : public Clock {
+ public:
+  int64_t wall_ms() const override;
+  int64_t monotonic_ms() const override;
+  void sleep_ms(int64_t ms) override;
+  int64_t begin_wait(int64_t ms) override { return ms < 0 ? 0 : ms; }
+};
+
+// Moves only when told to: by advance(), by jump_wall(), or by the code under
+// test sleeping or waiting on it. Thread-safe.
+class SimulatedClock : public Clock {
+ public:
+  // Starts at |wall_ms| (default: the real current time) with the monotonic
+  // clock at an arbitrary 1e9 ms, so code cannot mistake one for the other.
+  explicit SimulatedClock(int64_t wall_ms = -1);
+
+  int64_t wall_ms() const override {
+    return wall_.load(std::memory_order_acquire);
+  }
+  int64_t monotonic_ms() const override {
+    return monotonic_.load(std::memory_order_acquire);
+  }
+  void sleep_ms(int64_t ms) override { advance(ms); }
+  int64_t begin_wait(int64_t ms) override {
+    advance(ms);
+    return 0;
+  }
+
+  // Both timelines move forward by |ms| (negative values are ignored).
+  void advance(int64_t ms);
+  // Steps only the wall clock by |delta_ms| (either direction).
+  void jump_wall(int64_t delta_ms);
+
+ private:
+  std::atomic<int64_t> wall_;
+  std::atomic<int64_t> monotonic_;
+};
+
+// The real clock (process lifetime).
+Clock& system_clock();
+
+// The clock used by code that is not handed one explicitly. Defaults to
+// system_clock(); set_default() swaps it (nullptr restores the default) and
+// must happen before the polling thread starts.
+Clock& get();
+void set_default(Clock* clock);
+
+// Whole seconds from |clock|'s wall time until |target_epoch_ms|, rounded up
+// so a notification never fires early; 0 when the target has passed.
+int64_t seconds_until(int64_t target_epoch_ms, const Clock& clock);
+
+}  // namespace nm_clock
+
+#endif  // NM_CLOCK_H_
@@ -0,0 +1,114 @@
+#ifndef NM_DEDUPE_H_
+#define NM_DEDUPE_H_
+
+// Suppresses repeats of the same notification within a time window. Used by
+// the background poller daemon, which may re-poll a feed that still lists
+// items it already showed. Keys are opaque strings (the daemon uses
+// title + '\0' + body).
+//
+// Memory is bounded for a daemon that runs for weeks: only a 64-bit hash of
+// each key is kept, entries older than the window are dropped as new ones
+// arrive, and at most max_entries are held (the oldest go first). Lookups and
+// inserts are O(1) amortised.
+//
+// The window is measured on the monotonic timeline of a Clock (nm_clock.h),
+// so wall-clock steps neither expire entries early nor pin them.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "nm_clock.h"
+
+namespace nm_dedupe {
+
+static constexpr size_t kDefaultMaxEntries = 4096;
+
+class DedupeCache {
+ public:
+  // |clock| (not owned) defaults to nm_clock::get() at each call.
+  explicit DedupeCache(long long window_ms,
+                       size_t max_entries = kDefaultMaxEntries,
+                       nm_clock::Clock* clock = nullptr)
+      : window_ms_(window_ms),
+        max_entries_(max_entries ? max_entries : 1),
+        clock_(clock) {}
+
+  // True (and |key| is remembered as shown now) unless |key| was shown less
+  // than window_ms ago.
+  bool should_show(const std::string& key) {
+    long long now = (clock_ ? *clock_ : nm_clock::get()).monotonic_ms();
+    size_t h = std::hash<std::string>()(key);
+    std::lock_guard<std::mutex> lk(mtx_);
+    prune_locked(now);
+    if (index_.count(h)) return false;
+    remember_locked(h, now);
+    return true;
+  }
+
+  // Whether |key| was shown less than window_ms ago. Nothing is remembered;
+  // a caller that may still drop the notification calls remember() once it
+  // is on screen.
+  bool seen(const std::string& key) {
+    long long now = (clock_ ? *clock_ : nm_clock::get()).monotonic_ms();
+    size_t h = std::hash<std::string>()(key);
+    std::lock_guard<std::mutex> lk(mtx_);
+    prune_locked(now);
+    return index_.count(h) != 0;
+  }
+
+  // Remembers |key| as shown now.
+  void remember(const std::string& key) {
+    long long now = (clock_ ? *clock_ : nm_clock::get()).monotonic_ms();
+    size_t h = std::hash<std::string>()(key);
+    std::lock_guard<std::mutex> lk(mtx_);
+    prune_locked(now);
+    remember_locked(h, now);
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return order_.size();
+  }
+
+ private:
+  // |order_| is sorted by show time, so expired entries are at the front.
+  void prune_locked(long long now) {
+    while (!order_.empty() && now - order_.front().second >= window_ms_) {
+      index_.erase(order_.front().first);
+      order_.pop_front();
+    }
+  }
+
+  void remember_locked(size_t h, long long now) {
+    auto it = index_.find(h);
+    if (it != index_.end()) {
+      order_.erase(it->second);
+      index_.erase(it);
+    }
+    order_.emplace_back(h, now);
+    index_[h] = std::prev(order_.end());
+    if (order_.size() > max_entries_) {
+      index_.erase(order_.front().first);
+      order_.pop_front();
+    }
+  }
+
+  typedef std::list<std::pair<size_t, long long>> Order;
+
+  const long long window_ms_;
+  const size_t max_entries_;
+  nm_clock::Clock* const clock_;
+  std::mutex mtx_;
+  Order order_;  // (key hash, shown at), oldest first
+  std::unordered_map<size_t, Order::iterator> index_;
+};
+
+}  // namespace nm_dedupe
+
+#endif  // NM_DEDUPE_H_
@@ -0,0 +1,80 @@
+#ifndef NM_DISPATCH_H_
+#define NM_DISPATCH_H_
+
+// Compile-time perfect hash from method-channel method names to table
+// entries, used by the plugin's dispatch (notification_master_plugin.cc).
+//
+// build_index() runs at compile time over a constexpr array of entries that
+// have a `name` member. It looks for a seed under which 32-bit FNV-1a puts
+// every name in its own slot of a power-of-two table at least four times
+// larger than the entry count, which takes a handful of seeds. A lookup is
+// then one hash of the incoming name plus one strcmp against the only
+// candidate, whatever the method's position in the table.
+//
+// A duplicate name can never be separated, so the search fails and the
+// static_assert next to the table stops the build.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace nm_dispatch {
+
+static constexpr uint8_t kEmptySlot = 0xff;
+static constexpr uint32_t kMaxSeeds = 10000;
+
+constexpr uint32_t hash(const char* s, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (; *s; ++s) {
+    h ^= (uint8_t)*s;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+constexpr size_t slots_for(size_t entries) {
+  size_t slots = 1;
+  while (slots < entries * 4) slots *= 2;
+  return slots;
+}
+
+template <size_t Slots>
+struct Index {
+  bool ok;
+  uint32_t seed;
+  uint8_t slot[Slots];  // entry position, or kEmptySlot
+
+  // Position of |name| in |entries|, or -1 when it is not there.
+  template <typename Entry, size_t N>
+  int find(const Entry (&entries)[N], const char* name) const {
+    uint8_t i = slot[hash(name, seed) & (Slots - 1)];
+    if (i == kEmptySlot || strcmp(entries[i].name, name) != 0) return -1;
+    return i;
+  }
+};
+
+template <size_t Slots, typename Entry, size_t N>
+constexpr Index<Slots> build_index(const Entry (&entries)[N]) {
+  static_assert(N < kEmptySlot, "too many entries for uint8_t slots");
+  static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+  Index<Slots> index{false, 0, {}};
+  for (uint32_t seed = 0; seed < kMaxSeeds; ++seed) {
+    for (size_t s = 0; s < Slots; ++s) index.slot[s] = kEmptySlot;
+    bool collided = false;
+    for (size_t i = 0; i < N && !collided; ++i) {
+      size_t s = hash(entries[i].name, seed) & (Slots - 1);
+      if (index.slot[s] != kEmptySlot) collided = true;
+      else index.slot[s] = (uint8_t)i;
+    }
+    if (!collided) {
+      index.ok = true;
+      index.seed = seed;
+      return index;
+    }
+  }
+  return index;
+}
+
+}  // namespace nm_dispatch
+
+#endif  // NM_DISPATCH_H_
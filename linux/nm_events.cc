@@ -0,0 +1,123 @@
+#include "nm_events.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace nm_events {
+
+// Events of one type for one notification share a key; fetched items
+// without an id never coalesce.
+static bool coalescing_key(const Event& event, std::string* key) {
+  if (event.type == kFetched && event.item_id.empty()) return false;
+  *key = std::to_string((int)event.type) + ':' + std::to_string(event.id) +
+         ':' + event.item_id;
+  return true;
+}
+
+Batcher::Batcher(GMainContext* context, Sink sink, unsigned frame_ms)
+    : context_(context), sink_(std::move(sink)), frame_ms_(frame_ms) {}
+
+Batcher::~Batcher() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (timer_) {
+    g_source_destroy(timer_);
+    g_source_unref(timer_);
+    timer_ = nullptr;
+  }
+}
+
+void Batcher::set_enabled(bool enabled) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  enabled_ = enabled;
+  if (!enabled) {
+    pending_.clear();
+    slots_.clear();
+  }
+}
+
+bool Batcher::enabled() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return enabled_;
+}
+
+void Batcher::push(Event event) {
+  std::string key;
+  bool coalesce = coalescing_key(event, &key);
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!enabled_) return;
+  if (coalesce) {
+    auto it = slots_.find(key);
+    if (it != slots_.end()) {
+      pending_[it->second] = std::move(event);
+      return;
+    }
+  }
+  if (pending_.size() >= kMaxPending) {
+    dropped_++;
+    return;
+  }
+  if (coalesce) slots_.emplace(std::move(key), pending_.size());
+  pending_.push_back(std::move(event));
+  if (!timer_) {
+    timer_ = g_timeout_source_new(frame_ms_);
+    g_source_set_callback(timer_, flush_cb, this, nullptr);
+    g_source_attach(timer_, context_);
+  }
+}
+
+gboolean Batcher::flush_cb(gpointer user_data) {
+  static_cast<Batcher*>(user_data)->flush();
+  return G_SOURCE_REMOVE;
+}
+
+void Batcher::flush() {
+  std::vector<Event> batch;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (timer_) {
+      // Called from the timer itself or ahead of it; either way the next
+      // push arms a new one.
+      g_source_destroy(timer_);
+      g_source_unref(timer_);
+      timer_ = nullptr;
+    }
+    batch.swap(pending_);
+    slots_.clear();
+  }
+  if (!batch.empty()) sink_(batch);
+}
+
+size_t Batcher::dropped() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return dropped_;
+}
+
+void ServerIds::remember(uint32_t server_id, int64_t id,
+                         const std::string& item_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (entries_.find(server_id) == entries_.end()) {
+    order_.push_back(server_id);
+  }
+  entries_[server_id] = Entry{id, item_id};
+  while (order_.size() > kMaxTracked) {
+    entries_.erase(order_.front());
+    order_.pop_front();
+  }
+}
+
+bool ServerIds::lookup(uint32_t server_id, Event* event) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = entries_.find(server_id);
+  if (it == entries_.end()) return false;
+  event->id = it->second.id;
+  event->item_id = it->second.item_id;
+  return true;
+}
+
+void ServerIds::forget(uint32_t server_id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (entries_.erase(server_id) == 0) return;
+  order_.erase(std::find(order_.begin(), order_.end(), server_id));
+}
+
+}  // namespace nm_events
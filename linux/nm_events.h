@@ -0,0 +1,129 @@
+#ifndef NM_EVENTS_H_
+#define NM_EVENTS_H_
+
+// Notification lifecycle events streamed to Dart over the
+// "notification_master/events" EventChannel.
+//
+//   kDelivered     — the notification server accepted a notification;
+//   kActionInvoked — the user clicked it or one of its actions
+//                    (org.freedesktop.Notifications.ActionInvoked);
+//   kClosed        — it went away (NotificationClosed, with the reason);
+//   kFetched       — the polling thread or the background daemon (through
+//                    nm_handoff.h) received a feed item (see nm_feed.h), so
+//                    Dart gets the payload without polling a second time.
+//
+// Events are pushed from any thread (workers, the polling thread, D-Bus
+// signal handlers) into a Batcher. The first event of a batch arms a
+// frame-length timer on the plugin's main context, and the whole batch goes
+// out as one channel message when it fires. Inside a batch, repeated events
+// for the same notification and type collapse into the latest one, so a
+// burst of clicks or polls costs one message per frame.
+//
+// Plugin-only (uses GLib main contexts).
+
+#include <glib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nm_feed.h"
+
+namespace nm_events {
+
+enum Type {
+  kDelivered = 0,
+  kActionInvoked = 1,
+  kClosed = 2,
+  kFetched = 3,
+};
+
+// NotificationClosed reasons from the Desktop Notifications spec.
+enum CloseReason {
+  kExpired = 1,
+  kDismissed = 2,
+  kClosedByCall = 3,
+  kUndefined = 4,
+};
+
+struct Event {
+  Type type = kDelivered;
+  int64_t id = 0;        // id given to show*(), 0 for polled items
+  std::string item_id;   // feed item id, for polled items
+  std::string action;    // kActionInvoked: action key ("default" on click)
+  int32_t reason = 0;    // kClosed: CloseReason
+  nm_feed::Item item;    // kFetched
+};
+
+// One frame at 60 Hz.
+static constexpr unsigned kFrameMs = 16;
+// Events held per batch; more are dropped (and counted) until the flush.
+static constexpr size_t kMaxPending = 1024;
+
+class Batcher {
+ public:
+  // Receives each batch on |context|'s thread, in arrival order.
+  typedef std::function<void(const std::vector<Event>& batch)> Sink;
+
+  Batcher(GMainContext* context, Sink sink, unsigned frame_ms = kFrameMs);
+  ~Batcher();
+
+  Batcher(const Batcher&) = delete;
+  Batcher& operator=(const Batcher&) = delete;
+
+  // Events are only queued while a Dart listener is attached.
+  void set_enabled(bool enabled);
+  bool enabled() const;
+
+  // Thread-safe.
+  void push(Event event);
+
+  // Delivers the pending batch now. Call on |context|'s thread.
+  void flush();
+
+  size_t dropped() const;
+
+ private:
+  static gboolean flush_cb(gpointer user_data);
+
+  GMainContext* context_;
+  Sink sink_;
+  const unsigned frame_ms_;
+  mutable std::mutex mtx_;
+  bool enabled_ = false;
+  std::vector<Event> pending_;
+  std::unordered_map<std::string, size_t> slots_;  // coalescing key -> index
+  GSource* timer_ = nullptr;
+  size_t dropped_ = 0;
+};
+
+// Maps the notification server's ids to what the plugin showed, so signals
+// for other applications' notifications are ignored. Keeps the most recent
+// kMaxTracked notifications.
+class ServerIds {
+ public:
+  static constexpr size_t kMaxTracked = 512;
+
+  void remember(uint32_t server_id, int64_t id, const std::string& item_id);
+  // Fills |event|'s id and item_id; false for unknown server ids.
+  bool lookup(uint32_t server_id, Event* event) const;
+  void forget(uint32_t server_id);
+
+ private:
+  struct Entry {
+    int64_t id;
+    std::string item_id;
+  };
+  mutable std::mutex mtx_;
+  std::unordered_map<uint32_t, Entry> entries_;
+  std::deque<uint32_t> order_;
+};
+
+}  // namespace nm_events
+
+#endif  // NM_EVENTS_H_
@@ -0,0 +1,143 @@
+#include "nm_feed.h"
+
+#include <json-glib/json-glib.h>
+
+#include "nm_clock.h"
+
+namespace nm_feed {
+
+static std::string member_string(JsonObject* obj, const char* key) {
+  JsonNode* n = json_object_get_member(obj, key);
+  if (!n || JSON_NODE_TYPE(n) != JSON_NODE_VALUE) return "";
+  switch (json_node_get_value_type(n)) {
+    case G_TYPE_STRING: {
+      const char* v = json_node_get_string(n);
+      return v ? v : "";
+    }
+    case G_TYPE_INT64:
+      return std::to_string((long long)json_node_get_int(n));
+    case G_TYPE_DOUBLE:
+      return std::to_string(json_node_get_double(n));
+    case G_TYPE_BOOLEAN:
+      return json_node_get_boolean(n) ? "true" : "false";
+    default:
+      return "";
+  }
+}
+
+// Numbers below 1e11 are taken as seconds (that is the year 5138 in seconds
+// but only 1973 in milliseconds), larger ones as milliseconds.
+static int64_t epoch_to_ms(double v) {
+  if (v <= 0) return 0;
+  return v < 1e11 ? (int64_t)(v * 1000.0) : (int64_t)v;
+}
+
+static int64_t iso8601_to_ms(const char* text) {
+  GTimeZone* utc = g_time_zone_new_utc();
+  GDateTime* dt = g_date_time_new_from_iso8601(text, utc);
+  g_time_zone_unref(utc);
+  if (!dt) return 0;
+  int64_t ms = (int64_t)g_date_time_to_unix(dt) * 1000 +
+               g_date_time_get_microsecond(dt) / 1000;
+  g_date_time_unref(dt);
+  return ms;
+}
+
+static int64_t member_timestamp_ms(JsonObject* obj, const char* key) {
+  JsonNode* n = json_object_get_member(obj, key);
+  if (!n || JSON_NODE_TYPE(n) != JSON_NODE_VALUE) return 0;
+  switch (json_node_get_value_type(n)) {
+    case G_TYPE_INT64:
+      return epoch_to_ms((double)json_node_get_int(n));
+    case G_TYPE_DOUBLE:
+      return epoch_to_ms(json_node_get_double(n));
+    case G_TYPE_STRING: {
+      const char* v = json_node_get_string(n);
+      if (!v || !*v) return 0;
+      char* end = nullptr;
+      double num = g_ascii_strtod(v, &end);
+      if (end && *end == '\0') return epoch_to_ms(num);
+      return iso8601_to_ms(v);
+    }
+    default:
+      return 0;
+  }
+}
+
+int64_t now_epoch_ms() { return nm_clock::get().wall_ms(); }
+
+static Item parse_item(JsonObject* obj) {
+  Item item;
+  item.id        = member_string(obj, "id");
+  item.title     = member_string(obj, "title");
+  item.message   = member_string(obj, "message");
+  item.big_text  = member_string(obj, "bigText");
+  item.image_url = member_string(obj, "imageUrl");
+  item.topic     = member_string(obj, "topic");
+  item.channel   = member_string(obj, "channelId");
+  item.sent_at_ms = member_timestamp_ms(obj, "sentAt");
+  if (item.sent_at_ms == 0) {
+    item.sent_at_ms = member_timestamp_ms(obj, "createdAt");
+  }
+  return item;
+}
+
+static bool parse_impl(const char* data, size_t len, bool allow_bare,
+                       std::vector<Item>* items, std::string* error) {
+  if (!data || len == 0) {
+    if (error) *error = "empty body";
+    return false;
+  }
+
+  GError* err = nullptr;
+  JsonParser* parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, data, (gssize)len, &err)) {
+    if (error) *error = err ? err->message : "JSON parse error";
+    if (err) g_error_free(err);
+    g_object_unref(parser);
+    return false;
+  }
+
+  bool ok = true;
+  JsonNode* root = json_parser_get_root(parser);
+  JsonObject* root_obj =
+      root && JSON_NODE_HOLDS_OBJECT(root) ? json_node_get_object(root) : nullptr;
+  JsonNode* list = root_obj
+      ? json_object_get_member(root_obj, "notifications") : nullptr;
+  JsonNode* single = root_obj
+      ? json_object_get_member(root_obj, "data") : nullptr;
+
+  if (list && JSON_NODE_HOLDS_ARRAY(list)) {
+    JsonArray* arr = json_node_get_array(list);
+    guint count = json_array_get_length(arr);
+    items->reserve(items->size() + count);
+    for (guint i = 0; i < count; i++) {
+      JsonNode* node = json_array_get_element(arr, i);
+      if (JSON_NODE_HOLDS_OBJECT(node)) {
+        items->push_back(parse_item(json_node_get_object(node)));
+      }
+    }
+  } else if (single && JSON_NODE_HOLDS_OBJECT(single)) {
+    items->push_back(parse_item(json_node_get_object(single)));
+  } else if (allow_bare && root_obj) {
+    items->push_back(parse_item(root_obj));
+  } else {
+    if (error) *error = "unrecognised response shape";
+    ok = false;
+  }
+
+  g_object_unref(parser);
+  return ok;
+}
+
+bool parse(const char* data, size_t len, std::vector<Item>* items,
+           std::string* error) {
+  return parse_impl(data, len, false, items, error);
+}
+
+bool parse_message(const char* data, size_t len, std::vector<Item>* items,
+                   std::string* error) {
+  return parse_impl(data, len, true, items, error);
+}
+
+}  // namespace nm_feed
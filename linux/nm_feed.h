@@ -0,0 +1,54 @@
+#ifndef NM_FEED_H_
+#define NM_FEED_H_
+
+// Poll response parsing shared by the plugin's polling thread and the
+// background poller daemon, so new per-item fields are added in one place.
+//
+// Accepted shapes:
+//   {"notifications": [ {item}, ... ]}
+//   {"data": {item}}
+// where an item is
+//   {"id": "...", "title": "...", "message": "...", "bigText": "...",
+//    "imageUrl": "...", "topic": "...", "channelId": "...", "sentAt": ...}
+// Every field is optional. "channelId" picks the display policy and rate
+// limit (see nm_channels.h); without one the "default" channel applies. Non-string scalars (e.g. numeric ids) are
+// converted to strings. "sentAt" (or "createdAt") is the server emit time:
+// epoch seconds or milliseconds (number or digit string) or an ISO-8601
+// string; it drives the end-to-end delivery latency metric.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nm_feed {
+
+struct Item {
+  std::string id;
+  std::string title;
+  std::string message;
+  std::string big_text;
+  std::string image_url;
+  std::string topic;
+  std::string channel;     // "" for the default channel
+  int64_t sent_at_ms = 0;  // 0 when the server did not say
+};
+
+// Current wall-clock time in epoch milliseconds (same clock as sent_at_ms),
+// read from nm_clock::get().
+int64_t now_epoch_ms();
+
+// Parses |len| bytes of |data| and appends the items to |items|. Returns false
+// (with a reason in |error|, if given) when the body is not JSON or is not one
+// of the shapes above; an empty "notifications" array is a success.
+bool parse(const char* data, size_t len, std::vector<Item>* items,
+           std::string* error = nullptr);
+
+// Like parse(), but also accepts a bare item object. Used for pushed
+// messages (MQTT), where one payload usually carries one notification.
+bool parse_message(const char* data, size_t len, std::vector<Item>* items,
+                   std::string* error = nullptr);
+
+}  // namespace nm_feed
+
+#endif  // NM_FEED_H_
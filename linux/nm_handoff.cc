@@ -0,0 +1,338 @@
+#include "nm_handoff.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstring>
+
+namespace nm_handoff {
+
+// The header lives in memory shared between processes, so its atomics must
+// not fall back to a lock.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared-memory atomics need lock-free 32 and 64-bit types");
+
+struct Header {
+  char magic[8];
+  uint64_t capacity;                 // bytes of records after the header
+  std::atomic<uint64_t> reserved;    // end of the bytes being written
+  std::atomic<uint64_t> committed;   // end of the bytes readers may take
+  std::atomic<uint64_t> next_item;   // number of the next item published
+  std::atomic<uint64_t> last_batch;  // start of the newest batch
+  std::atomic<uint32_t> wake;        // futex word, bumped after each batch
+  char unused[12];
+};
+
+namespace {
+
+const char kMagic[8] = {'N', 'M', 'R', 'I', 'N', 'G', '1', '\0'};
+
+enum Kind : uint32_t {
+  kItem = 1,
+  kWrap = 2,  // filler up to the end of the ring
+};
+
+struct RecordHeader {
+  uint32_t size;  // whole record, padding included
+  uint32_t kind;
+  uint64_t item;  // kItem: number of the item
+};
+
+static_assert(sizeof(Header) == 64, "Header layout");
+static_assert(sizeof(RecordHeader) == 16, "RecordHeader layout");
+
+// Record sizes and the capacity are multiples of this, so the space left
+// before the end of the ring always holds at least a RecordHeader.
+const size_t kAlign = sizeof(RecordHeader);
+
+const int kFields = 7;  // id, title, message, big_text, image_url, topic,
+                        // channel
+
+void put_field(std::string* out, const std::string& value) {
+  // Cut long fields on a UTF-8 character boundary.
+  size_t len = value.size();
+  if (len > kMaxFieldBytes) {
+    len = kMaxFieldBytes;
+    while (len > 0 && ((unsigned char)value[len] & 0xc0) == 0x80) --len;
+  }
+  uint32_t n = (uint32_t)len;
+  out->append((const char*)&n, sizeof(n));
+  out->append(value.data(), len);
+}
+
+// The record for |item| numbered |number|, header included.
+std::string encode(const nm_feed::Item& item, uint64_t number) {
+  std::string out(sizeof(RecordHeader), '\0');
+  out.append((const char*)&item.sent_at_ms, sizeof(item.sent_at_ms));
+  put_field(&out, item.id);
+  put_field(&out, item.title);
+  put_field(&out, item.message);
+  put_field(&out, item.big_text);
+  put_field(&out, item.image_url);
+  put_field(&out, item.topic);
+  put_field(&out, item.channel);
+  out.resize((out.size() + kAlign - 1) & ~(kAlign - 1), '\0');
+  RecordHeader header = {(uint32_t)out.size(), kItem, number};
+  memcpy(&out[0], &header, sizeof(header));
+  return out;
+}
+
+bool decode(const std::string& body, nm_feed::Item* item) {
+  const char* p = body.data();
+  const char* end = p + body.size();
+  if (end - p < (ptrdiff_t)sizeof(item->sent_at_ms)) return false;
+  memcpy(&item->sent_at_ms, p, sizeof(item->sent_at_ms));
+  p += sizeof(item->sent_at_ms);
+  std::string* fields[kFields] = {&item->id,        &item->title,
+                                  &item->message,   &item->big_text,
+                                  &item->image_url, &item->topic,
+                                  &item->channel};
+  for (std::string* field : fields) {
+    uint32_t n = 0;
+    if (end - p < (ptrdiff_t)sizeof(n)) return false;
+    memcpy(&n, p, sizeof(n));
+    p += sizeof(n);
+    if ((size_t)(end - p) < n) return false;
+    field->assign(p, n);
+    p += n;
+  }
+  return true;
+}
+
+uint32_t* futex_word(Header* header) {
+  return reinterpret_cast<uint32_t*>(&header->wake);
+}
+
+// Not FUTEX_PRIVATE: the word is shared with other processes.
+void futex_wait(Header* header, uint32_t seen, int timeout_ms) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+  syscall(SYS_futex, futex_word(header), FUTEX_WAIT, seen, &timeout, nullptr,
+          0);
+}
+
+void futex_wake(Header* header) {
+  syscall(SYS_futex, futex_word(header), FUTEX_WAKE, INT_MAX, nullptr,
+          nullptr, 0);
+}
+
+}  // namespace
+
+// ── Ring ────────────────────────────────────────────────────────────────────
+
+Ring::~Ring() {
+  if (map_) munmap(map_, mapped_);
+  if (fd_ >= 0) close(fd_);
+}
+
+bool Ring::open(const std::string& path, size_t capacity) {
+  if (is_open()) return true;
+  capacity &= ~(kAlign - 1);
+  if (capacity < 4096) capacity = 4096;
+  gchar* dir = g_path_get_dirname(path.c_str());
+  g_mkdir_with_parents(dir, 0700);
+  g_free(dir);
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return false;
+
+  // Under the lock, a file without a valid header is (re)initialised; a
+  // valid one keeps the capacity it was created with.
+  Header existing = {};
+  struct stat st;
+  bool ok = flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0;
+  if (ok && (size_t)st.st_size >= sizeof(Header) &&
+      pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+      memcmp(existing.magic, kMagic, sizeof(kMagic)) == 0 &&
+      existing.capacity % kAlign == 0 && existing.capacity >= 4096 &&
+      (uint64_t)st.st_size == sizeof(Header) + existing.capacity) {
+    capacity = (size_t)existing.capacity;
+  } else if (ok) {
+    Header header = {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.capacity = capacity;
+    ok = ftruncate(fd, 0) == 0 &&
+         ftruncate(fd, (off_t)(sizeof(Header) + capacity)) == 0 &&
+         pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+  }
+  void* map = MAP_FAILED;
+  const size_t len = sizeof(Header) + capacity;
+  if (ok) map = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  flock(fd, LOCK_UN);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  map_ = map;
+  mapped_ = len;
+  header_ = static_cast<Header*>(map);
+  data_ = static_cast<char*>(map) + sizeof(Header);
+  capacity_ = capacity;
+  return true;
+}
+
+// ── Publisher ───────────────────────────────────────────────────────────────
+
+Publisher::Publisher(std::string path, size_t capacity)
+    : path_(std::move(path)), capacity_(capacity) {}
+
+bool Publisher::publish(const std::vector<nm_feed::Item>& items) {
+  if (items.empty()) return true;
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!ring_.open(path_, capacity_)) return false;
+  // Another daemon may briefly run alongside this one (a restart).
+  if (flock(ring_.fd(), LOCK_EX) != 0) return false;
+  Header* header = ring_.header();
+  const uint64_t capacity = ring_.capacity();
+  uint64_t pos = header->committed.load(std::memory_order_relaxed);
+  const uint64_t start = pos;
+
+  // Raises |reserved| to |end| before the bytes below it are overwritten.
+  auto reserve = [header](uint64_t end) {
+    if (header->reserved.load(std::memory_order_relaxed) < end) {
+      header->reserved.store(end, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+  };
+  for (const nm_feed::Item& item : items) {
+    const uint64_t number = header->next_item.load(std::memory_order_relaxed);
+    std::string record = encode(item, number);
+    // An item over half the ring would evict everything unread; drop it.
+    if (record.size() > capacity / 2) continue;
+    header->next_item.store(number + 1, std::memory_order_relaxed);
+    uint64_t offset = pos % capacity;
+    if (capacity - offset < record.size()) {
+      RecordHeader wrap = {(uint32_t)(capacity - offset), kWrap, 0};
+      reserve(pos + sizeof(wrap));
+      memcpy(ring_.data() + offset, &wrap, sizeof(wrap));
+      pos += capacity - offset;
+      offset = 0;
+    }
+    reserve(pos + record.size());
+    memcpy(ring_.data() + offset, record.data(), record.size());
+    pos += record.size();
+  }
+  header->last_batch.store(start, std::memory_order_relaxed);
+  header->committed.store(pos, std::memory_order_release);
+  header->wake.fetch_add(1, std::memory_order_release);
+  flock(ring_.fd(), LOCK_UN);
+  futex_wake(header);
+  return true;
+}
+
+bool Publisher::publish_shown(
+    const std::vector<nm_feed::Item>& items,
+    const std::function<bool(const nm_feed::Item&)>& show) {
+  std::vector<nm_feed::Item> shown;
+  for (const auto& item : items) {
+    if (show(item)) shown.push_back(item);
+  }
+  return publish(shown);
+}
+
+// ── Subscriber ──────────────────────────────────────────────────────────────
+
+Subscriber::Subscriber(std::string path, size_t capacity) {
+  if (ring_.open(path, capacity)) {
+    Header* header = ring_.header();
+    tail_ = header->committed.load(std::memory_order_acquire);
+    next_item_ = (int64_t)header->next_item.load(std::memory_order_relaxed);
+  }
+}
+
+bool Subscriber::wait(int timeout_ms) {
+  if (!is_open()) return false;
+  Header* header = ring_.header();
+  const uint32_t seen = header->wake.load(std::memory_order_acquire);
+  // interrupt() sets the flag before it bumps |wake|: either the flag shows
+  // here or the futex no longer holds |seen|.
+  if (interrupted_.load()) return false;
+  if (header->committed.load(std::memory_order_acquire) != tail_) return true;
+  futex_wait(header, seen, timeout_ms);
+  return header->committed.load(std::memory_order_acquire) != tail_;
+}
+
+size_t Subscriber::read(std::vector<nm_feed::Item>* items) {
+  if (!is_open()) return 0;
+  Header* header = ring_.header();
+  const uint64_t capacity = ring_.capacity();
+  const uint64_t end = header->committed.load(std::memory_order_acquire);
+  if (end < tail_) tail_ = end;  // the file was recreated
+  size_t lost = 0;
+  std::string body;
+  while (tail_ < end) {
+    // More than a ring behind: the oldest unread records are gone. Resume
+    // at the newest batch if it is still whole (a later one may have
+    // landed since |end| was read); item numbers tell how many were missed.
+    if (end - tail_ > capacity) {
+      const uint64_t last = header->last_batch.load(std::memory_order_relaxed);
+      tail_ = last <= end && end - last <= capacity ? last : end;
+      continue;
+    }
+    const uint64_t offset = tail_ % capacity;
+    RecordHeader record;
+    memcpy(&record, ring_.data() + offset, sizeof(record));
+    const bool sane = record.size >= sizeof(record) && record.size % kAlign == 0 &&
+                      record.size <= capacity - offset;
+    if (sane && record.kind == kItem) {
+      body.assign(ring_.data() + offset + sizeof(record),
+                  record.size - sizeof(record));
+    }
+    // The copy is good only if the publisher had not started overwriting it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->reserved.load(std::memory_order_relaxed) - tail_ > capacity ||
+        !sane) {
+      tail_ = end;
+      break;
+    }
+    tail_ += record.size;
+    if (record.kind != kItem) continue;
+    if ((int64_t)record.item > next_item_) {
+      lost += (size_t)((int64_t)record.item - next_item_);
+    }
+    next_item_ = (int64_t)record.item + 1;
+    nm_feed::Item item;
+    if (decode(body, &item)) items->push_back(std::move(item));
+  }
+  return lost;
+}
+
+void Subscriber::interrupt() {
+  interrupted_.store(true);
+  if (!is_open()) return;
+  ring_.header()->wake.fetch_add(1, std::memory_order_release);
+  futex_wake(ring_.header());
+}
+
+// ── Listener ────────────────────────────────────────────────────────────────
+
+Listener::Listener(std::string path, Sink sink, size_t capacity)
+    : subscriber_(std::move(path), capacity), sink_(std::move(sink)) {
+  if (subscriber_.is_open()) thread_ = std::thread(&Listener::run, this);
+}
+
+Listener::~Listener() {
+  subscriber_.interrupt();
+  if (thread_.joinable()) thread_.join();
+}
+
+void Listener::run() {
+  while (!subscriber_.interrupted()) {
+    if (!subscriber_.wait(kWaitTimeoutMs)) continue;
+    std::vector<nm_feed::Item> items;
+    size_t lost = subscriber_.read(&items);
+    if (!items.empty() || lost > 0) sink_(std::move(items), lost);
+  }
+}
+
+}  // namespace nm_handoff
@@ -0,0 +1,169 @@
+#ifndef NM_HANDOFF_H_
+#define NM_HANDOFF_H_
+
+// Hands feed items fetched by the background poller daemon to the running
+// app, so in-app views update without the app polling a second time.
+//
+// $XDG_RUNTIME_DIR/notification_master/handoff.ring is a shared-memory ring
+// that both processes mmap(). The daemon publishes each decoded batch into
+// it through a Publisher and bumps a futex word in the header. A Listener
+// thread in the plugin sleeps on that futex (FUTEX_WAIT on a shared
+// mapping wakes across processes), reads what is new and hands it on as one
+// batch.
+//
+//   file    = Header (64 bytes), then |capacity| bytes of records
+//   record  = RecordHeader (16 bytes), then sent_at_ms and id, title,
+//             message, big_text, image_url, topic and channel as u32
+//             length + bytes, zero-padded to 16 bytes
+//
+// Records never straddle the end of the ring: a kWrap record fills the tail
+// and the next one starts at offset 0. Positions are byte counts that only
+// grow, so a reader that falls a whole ring behind notices, skips to the
+// newest batch and learns how many items it missed from their numbers. The
+// publisher raises |reserved| before it overwrites old bytes and |committed|
+// once the batch is complete; a reader checks |reserved| after copying a
+// record to know the copy was not overwritten (a seqlock, per record).
+//
+// The ring is a live feed, not storage: a Listener starts at the newest
+// record, and anything published while no app listens is only in the
+// history (nm_history.h). Publishing never blocks on readers.
+//
+// Shared by the plugin and the daemon. Thread-safe. Needs GLib.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nm_feed.h"
+
+namespace nm_handoff {
+
+// Bytes of records in a ring created with the default size.
+static constexpr size_t kDefaultCapacity = 1024 * 1024;
+// Longer fields are cut to this many bytes.
+static constexpr size_t kMaxFieldBytes = 16 * 1024;
+// Upper bound on one wait; it also bounds a missed wakeup.
+static constexpr int kWaitTimeoutMs = 1000;
+
+struct Header;
+
+// An mmap()ed ring file. The first process to open it sizes it with
+// |capacity|; later ones use the size it was created with.
+class Ring {
+ public:
+  Ring() = default;
+  ~Ring();
+
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+
+  bool open(const std::string& path, size_t capacity);
+  bool is_open() const { return header_ != nullptr; }
+
+  int fd() const { return fd_; }
+  Header* header() const { return header_; }
+  char* data() const { return data_; }
+  uint64_t capacity() const { return capacity_; }
+
+ private:
+  int fd_ = -1;
+  void* map_ = nullptr;
+  size_t mapped_ = 0;
+  Header* header_ = nullptr;
+  char* data_ = nullptr;
+  uint64_t capacity_ = 0;
+};
+
+class Publisher {
+ public:
+  explicit Publisher(std::string path, size_t capacity = kDefaultCapacity);
+
+  Publisher(const Publisher&) = delete;
+  Publisher& operator=(const Publisher&) = delete;
+
+  // Appends |items| and wakes every Subscriber. The ring is opened on first
+  // use. False when it cannot be opened.
+  bool publish(const std::vector<nm_feed::Item>& items);
+
+  // Passes each of |items| to |show|, then publishes the ones it accepted
+  // as one batch. The app thus hears only about what reached the screen,
+  // not what dedupe or a rate limit dropped. False when the ring cannot be
+  // opened.
+  bool publish_shown(const std::vector<nm_feed::Item>& items,
+                     const std::function<bool(const nm_feed::Item&)>& show);
+
+ private:
+  const std::string path_;
+  const size_t capacity_;
+  std::mutex mtx_;
+  Ring ring_;
+};
+
+class Subscriber {
+ public:
+  // Opens the ring (creating it if the daemon has not) and starts at its
+  // newest record.
+  explicit Subscriber(std::string path, size_t capacity = kDefaultCapacity);
+
+  Subscriber(const Subscriber&) = delete;
+  Subscriber& operator=(const Subscriber&) = delete;
+
+  bool is_open() const { return ring_.is_open(); }
+
+  // Blocks until something is published, interrupt() is called or
+  // |timeout_ms| passes. True when there may be records to read.
+  bool wait(int timeout_ms);
+
+  // Appends the items published since the last call to |items|, oldest
+  // first. Returns how many were overwritten before they could be read;
+  // after falling a ring behind, the count comes with the next item read.
+  size_t read(std::vector<nm_feed::Item>* items);
+
+  // Makes wait() return false at once, now and from then on; for stopping
+  // a thread blocked in it. Other processes' subscribers see a spurious
+  // wakeup.
+  void interrupt();
+  bool interrupted() const { return interrupted_.load(); }
+
+ private:
+  Ring ring_;
+  uint64_t tail_ = 0;       // position of the next record to read
+  int64_t next_item_ = 0;   // number of the next item
+  std::atomic<bool> interrupted_{false};
+};
+
+// A thread that forwards each batch read from a Subscriber to a sink.
+class Listener {
+ public:
+  // Called on the listener thread with the items of one wakeup and the
+  // number lost to overruns since the previous call.
+  typedef std::function<void(std::vector<nm_feed::Item> items, size_t lost)>
+      Sink;
+
+  // Opens the ring on the calling thread, then starts listening. Does
+  // nothing when the ring cannot be opened.
+  Listener(std::string path, Sink sink, size_t capacity = kDefaultCapacity);
+  // Stops and joins the thread; the sink is not called afterwards.
+  ~Listener();
+
+  Listener(const Listener&) = delete;
+  Listener& operator=(const Listener&) = delete;
+
+  bool is_listening() const { return thread_.joinable(); }
+
+ private:
+  void run();
+
+  Subscriber subscriber_;
+  Sink sink_;
+  std::thread thread_;
+};
+
+}  // namespace nm_handoff
+
+#endif  // NM_HANDOFF_H_
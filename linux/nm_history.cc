@@ -0,0 +1,543 @@
+#include "nm_history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "nm_clock.h"
+
+namespace nm_history {
+
+namespace {
+
+const char kFileMagic[8] = {'N', 'M', 'H', 'I', 'S', 'T', '1', '\0'};
+
+struct FileHeader {
+  char magic[8];
+  int64_t first_seq;
+};
+
+const uint32_t kRecordMagic = 0x52484d4e;  // "NMHR"
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t size;      // whole record, padding included
+  uint32_t checksum;  // of the bytes after this field
+  uint8_t source;
+  uint8_t reserved[3];
+  int64_t shown_at_ms;
+  int64_t notification_id;
+};
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader layout");
+static_assert(sizeof(RecordHeader) == 32, "RecordHeader layout");
+
+// item_id, title, message, channel, topic, big_text
+const int kFields = 6;
+const size_t kMaxRecordBytes =
+    sizeof(RecordHeader) + kFields * (4 + kMaxFieldBytes) + 8;
+const size_t kBlock = 256;
+
+uint32_t checksum(const char* data, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= (unsigned char)data[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void put_field(std::string* out, const std::string& value) {
+  // Cut long fields on a UTF-8 character boundary.
+  size_t len = value.size();
+  if (len > kMaxFieldBytes) {
+    len = kMaxFieldBytes;
+    while (len > 0 && ((unsigned char)value[len] & 0xc0) == 0x80) --len;
+  }
+  uint32_t n = (uint32_t)len;
+  out->append((const char*)&n, sizeof(n));
+  out->append(value.data(), len);
+}
+
+std::string encode(const Record& record) {
+  std::string out(sizeof(RecordHeader), '\0');
+  put_field(&out, record.item_id);
+  put_field(&out, record.title);
+  put_field(&out, record.message);
+  put_field(&out, record.channel);
+  put_field(&out, record.topic);
+  put_field(&out, record.big_text);
+  out.resize((out.size() + 7) & ~(size_t)7, '\0');
+
+  RecordHeader header = {};
+  header.magic = kRecordMagic;
+  header.size = (uint32_t)out.size();
+  header.source = record.source;
+  header.shown_at_ms = record.shown_at_ms ? record.shown_at_ms
+                                          : nm_clock::get().wall_ms();
+  header.notification_id = record.notification_id;
+  memcpy(&out[0], &header, sizeof(header));
+  const size_t skip = offsetof(RecordHeader, source);
+  header.checksum = checksum(out.data() + skip, out.size() - skip);
+  memcpy(&out[offsetof(RecordHeader, checksum)], &header.checksum,
+         sizeof(header.checksum));
+  return out;
+}
+
+enum Check { kValid, kIncomplete, kInvalid };
+
+// Checks the record at |offset| of the |len| bytes at |data|.
+Check check_record(const char* data, size_t len, size_t offset,
+                   RecordHeader* header) {
+  if (len - offset < sizeof(RecordHeader)) return kIncomplete;
+  memcpy(header, data + offset, sizeof(*header));
+  if (header->magic != kRecordMagic || header->size < sizeof(RecordHeader) ||
+      header->size > kMaxRecordBytes || header->size % 8 != 0) {
+    return kInvalid;
+  }
+  if (len - offset < header->size) return kIncomplete;
+  const size_t skip = offsetof(RecordHeader, source);
+  if (checksum(data + offset + skip, header->size - skip) !=
+      header->checksum) {
+    return kInvalid;
+  }
+  return kValid;
+}
+
+// Reads the fields of the valid record at |data| into |fields|.
+void read_fields(const char* data, const RecordHeader& header,
+                 std::string* fields[kFields]) {
+  const char* p = data + sizeof(RecordHeader);
+  const char* end = data + header.size;
+  for (int i = 0; i < kFields; ++i) {
+    uint32_t n = 0;
+    if (end - p < (ptrdiff_t)sizeof(n)) return;
+    memcpy(&n, p, sizeof(n));
+    p += sizeof(n);
+    if ((size_t)(end - p) < n) return;
+    if (fields[i]) fields[i]->assign(p, n);
+    p += n;
+  }
+}
+
+bool read_file_header(const char* data, size_t len, int64_t* first_seq) {
+  FileHeader header;
+  if (len < sizeof(header)) return false;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0) return false;
+  *first_seq = header.first_seq;
+  return true;
+}
+
+bool write_all(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+bool same_file(int fd, const std::string& path, struct stat* st) {
+  struct stat on_disk;
+  return fstat(fd, st) == 0 && stat(path.c_str(), &on_disk) == 0 &&
+         st->st_ino == on_disk.st_ino && st->st_dev == on_disk.st_dev;
+}
+
+}  // namespace
+
+const char* source_name(Source source) {
+  switch (source) {
+    case kFeed:   return "feed";
+    case kDaemon: return "daemon";
+    default:      return "app";
+  }
+}
+
+// ── Writer ──────────────────────────────────────────────────────────────────
+
+Writer::Writer(std::string path, size_t compact_bytes, int64_t retention_ms)
+    : path_(std::move(path)),
+      compact_bytes_(compact_bytes),
+      retention_ms_(retention_ms) {}
+
+Writer::~Writer() {
+  if (fd_ >= 0) close(fd_);
+}
+
+// Opens the current file (creating it with its header) and returns holding
+// LOCK_SH on it. A file replaced by another process's compaction is reopened.
+bool Writer::open_locked() {
+  for (int attempt = 0; attempt < 8; ++attempt) {
+    if (fd_ < 0) {
+      gchar* dir = g_path_get_dirname(path_.c_str());
+      g_mkdir_with_parents(dir, 0700);
+      g_free(dir);
+      fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+      if (fd_ < 0) return false;
+    }
+    struct stat st;
+    if (flock(fd_, LOCK_SH) == 0 && same_file(fd_, path_, &st)) {
+      if (st.st_size > 0) return true;
+      // New file: write the header under the exclusive lock, then look again.
+      if (flock(fd_, LOCK_EX) == 0 && fstat(fd_, &st) == 0 &&
+          st.st_size == 0) {
+        FileHeader header = {};
+        memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+        write_all(fd_, (const char*)&header, sizeof(header));
+      }
+    }
+    flock(fd_, LOCK_UN);
+    close(fd_);
+    fd_ = -1;
+  }
+  return false;
+}
+
+bool Writer::append(const Record& record) {
+  std::string data = encode(record);
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!open_locked()) return false;
+  bool ok = write_all(fd_, data.data(), data.size());
+  struct stat st;
+  bool over =
+      ok && fstat(fd_, &st) == 0 && (size_t)st.st_size > compact_bytes_;
+  flock(fd_, LOCK_UN);
+  if (over) compact_locked();
+  return ok;
+}
+
+bool Writer::compact() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return compact_locked();
+}
+
+bool Writer::compact_locked() {
+  if (!open_locked()) return false;
+  struct stat st;
+  // Another process may have compacted while this one waited for the lock.
+  if (flock(fd_, LOCK_EX) != 0 || !same_file(fd_, path_, &st)) {
+    flock(fd_, LOCK_UN);
+    return true;
+  }
+  size_t len = (size_t)st.st_size;
+  void* map = len ? mmap(nullptr, len, PROT_READ, MAP_SHARED, fd_, 0)
+                  : MAP_FAILED;
+  if (map == MAP_FAILED) {
+    flock(fd_, LOCK_UN);
+    return false;
+  }
+  const char* data = static_cast<const char*>(map);
+
+  int64_t first_seq = 0;
+  read_file_header(data, len, &first_seq);
+  struct Span {
+    size_t offset;
+    size_t size;
+    int64_t shown_at_ms;
+  };
+  std::vector<Span> records;
+  size_t offset = sizeof(FileHeader);
+  while (offset < len) {
+    RecordHeader header;
+    Check c = check_record(data, len, offset, &header);
+    if (c == kIncomplete) break;
+    if (c == kInvalid) {
+      ++offset;  // resync past garbage
+      continue;
+    }
+    records.push_back(Span{offset, header.size, header.shown_at_ms});
+    offset += header.size;
+  }
+
+  // Seqs are positions, so only a prefix can go: every expired record up to
+  // the first live one, and then the oldest until half the budget is left.
+  const int64_t cutoff = nm_clock::get().wall_ms() - retention_ms_;
+  size_t keep_from = 0;
+  while (keep_from < records.size() &&
+         records[keep_from].shown_at_ms < cutoff) {
+    ++keep_from;
+  }
+  size_t kept_bytes = 0;
+  for (size_t i = keep_from; i < records.size(); ++i) {
+    kept_bytes += records[i].size;
+  }
+  while (keep_from < records.size() && kept_bytes > compact_bytes_ / 2) {
+    kept_bytes -= records[keep_from++].size;
+  }
+
+  std::string tmp = path_ + ".tmp";
+  int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  bool ok = out >= 0;
+  if (ok) {
+    FileHeader header = {};
+    memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    header.first_seq = first_seq + (int64_t)keep_from;
+    std::string buffer((const char*)&header, sizeof(header));
+    buffer.reserve(sizeof(header) + kept_bytes);
+    for (size_t i = keep_from; i < records.size(); ++i) {
+      buffer.append(data + records[i].offset, records[i].size);
+    }
+    ok = write_all(out, buffer.data(), buffer.size());
+    ok = close(out) == 0 && ok;
+    ok = ok && rename(tmp.c_str(), path_.c_str()) == 0;
+    if (!ok) unlink(tmp.c_str());
+  }
+  munmap(map, len);
+  // Writers waiting on the old file find it replaced once this lock drops.
+  flock(fd_, LOCK_UN);
+  close(fd_);
+  fd_ = -1;
+  return ok;
+}
+
+// ── Reader ──────────────────────────────────────────────────────────────────
+
+uint32_t Reader::Postings::intern(const std::string& name) {
+  auto it = ids.find(name);
+  if (it != ids.end()) return it->second;
+  uint32_t id = (uint32_t)positions.size();
+  ids.emplace(name, id);
+  positions.emplace_back();
+  return id;
+}
+
+const std::vector<uint32_t>* Reader::Postings::find(
+    const std::string& name) const {
+  auto it = ids.find(name);
+  return it == ids.end() ? nullptr : &positions[it->second];
+}
+
+Reader::Reader(std::string path) : path_(std::move(path)) {}
+
+Reader::~Reader() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  reset_locked();
+}
+
+void Reader::reset_locked() {
+  if (map_) munmap(const_cast<char*>(map_), mapped_);
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  inode_ = 0;
+  map_ = nullptr;
+  mapped_ = 0;
+  parsed_ = 0;
+  first_seq_ = 0;
+  entries_.clear();
+  blocks_.clear();
+  channels_ = Postings();
+  topics_ = Postings();
+}
+
+bool Reader::remap_locked(size_t size) {
+  if (map_) munmap(const_cast<char*>(map_), mapped_);
+  map_ = nullptr;
+  mapped_ = 0;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) return false;
+  map_ = static_cast<const char*>(map);
+  mapped_ = size;
+  return true;
+}
+
+void Reader::refresh() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  struct stat st;
+  if (stat(path_.c_str(), &st) != 0) {
+    reset_locked();
+    return;
+  }
+  if (fd_ < 0 || (uint64_t)st.st_ino != inode_) {
+    // First look, or a compaction renamed a new file into place.
+    reset_locked();
+    fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) return;
+  }
+  if (fstat(fd_, &st) != 0) return;
+  inode_ = (uint64_t)st.st_ino;
+  size_t size = (size_t)st.st_size;
+  if (size < mapped_) {
+    reset_locked();  // truncated by hand; start over next time
+    return;
+  }
+  if (size > mapped_ && !remap_locked(size)) return;
+  index_locked();
+}
+
+void Reader::index_locked() {
+  if (parsed_ == 0) {
+    if (!read_file_header(map_, mapped_, &first_seq_)) return;
+    parsed_ = sizeof(FileHeader);
+  }
+  std::string channel;
+  std::string topic;
+  std::string* fields[kFields] = {nullptr,  nullptr, nullptr,
+                                  &channel, &topic,  nullptr};
+  while (parsed_ < mapped_) {
+    RecordHeader header;
+    Check c = check_record(map_, mapped_, parsed_, &header);
+    if (c == kIncomplete) break;  // still being written
+    if (c == kInvalid) {
+      ++parsed_;  // left by a writer that died mid-record
+      continue;
+    }
+    channel.clear();
+    topic.clear();
+    read_fields(map_ + parsed_, header, fields);
+    uint32_t position = (uint32_t)entries_.size();
+    Entry entry{parsed_, header.shown_at_ms, channels_.intern(channel),
+                topics_.intern(topic)};
+    entries_.push_back(entry);
+    channels_.positions[entry.channel].push_back(position);
+    topics_.positions[entry.topic].push_back(position);
+    if (position % kBlock == 0) {
+      blocks_.emplace_back(entry.shown_at_ms, entry.shown_at_ms);
+    } else {
+      auto& block = blocks_.back();
+      block.first = std::min(block.first, entry.shown_at_ms);
+      block.second = std::max(block.second, entry.shown_at_ms);
+    }
+    parsed_ += header.size;
+  }
+}
+
+Record Reader::decode_locked(size_t position) const {
+  const Entry& entry = entries_[position];
+  RecordHeader header;
+  memcpy(&header, map_ + entry.offset, sizeof(header));
+  Record record;
+  record.seq = first_seq_ + (int64_t)position;
+  record.shown_at_ms = header.shown_at_ms;
+  record.notification_id = header.notification_id;
+  record.source = header.source <= kDaemon ? (Source)header.source : kApp;
+  std::string* fields[kFields] = {&record.item_id, &record.title,
+                                  &record.message, &record.channel,
+                                  &record.topic,   &record.big_text};
+  read_fields(map_ + entry.offset, header, fields);
+  return record;
+}
+
+Page Reader::query(const Query& query) {
+  refresh();
+  std::lock_guard<std::mutex> lk(mtx_);
+  Page page;
+  size_t limit = std::max<size_t>(1, std::min(query.limit, kMaxPageSize));
+  size_t end = entries_.size();
+  if (query.cursor >= 0) {
+    // Cursors older than the file's first record were compacted away.
+    int64_t relative = query.cursor - first_seq_;
+    end = relative <= 0 ? 0 : std::min(end, (size_t)relative);
+  }
+  const int64_t since = query.since_ms;
+  const int64_t until = query.until_ms;
+  auto in_time = [since, until](int64_t shown_at_ms) {
+    return (since == 0 || shown_at_ms >= since) &&
+           (until == 0 || shown_at_ms < until);
+  };
+
+  // Walk the shorter posting list when filtering by channel or topic.
+  const std::vector<uint32_t>* list = nullptr;
+  uint32_t channel = 0;
+  uint32_t topic = 0;
+  if (!query.channel.empty()) {
+    list = channels_.find(query.channel);
+    if (!list) return page;
+    channel = channels_.ids.at(query.channel);
+  }
+  if (!query.topic.empty()) {
+    const std::vector<uint32_t>* topics = topics_.find(query.topic);
+    if (!topics) return page;
+    topic = topics_.ids.at(query.topic);
+    if (!list || topics->size() < list->size()) list = topics;
+  }
+  auto matches = [&](size_t position) {
+    const Entry& entry = entries_[position];
+    return (query.channel.empty() || entry.channel == channel) &&
+           (query.topic.empty() || entry.topic == topic) &&
+           in_time(entry.shown_at_ms);
+  };
+
+  bool more = false;
+  if (list) {
+    auto it = std::lower_bound(list->begin(), list->end(), (uint32_t)end);
+    while (it != list->begin()) {
+      size_t position = *--it;
+      if (!matches(position)) continue;
+      if (page.records.size() == limit) {
+        more = true;
+        break;
+      }
+      page.records.push_back(decode_locked(position));
+    }
+  } else {
+    size_t position = end;
+    while (position > 0) {
+      const auto& block = blocks_[(position - 1) / kBlock];
+      if ((since != 0 && block.second < since) ||
+          (until != 0 && block.first >= until)) {
+        position = (position - 1) / kBlock * kBlock;  // none of it matches
+        continue;
+      }
+      --position;
+      if (!matches(position)) continue;
+      if (page.records.size() == limit) {
+        more = true;
+        break;
+      }
+      page.records.push_back(decode_locked(position));
+    }
+  }
+  if (more) page.next_cursor = page.records.back().seq;
+  return page;
+}
+
+size_t Reader::size() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return entries_.size();
+}
+
+int64_t Reader::first_seq() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return first_seq_;
+}
+
+int64_t Reader::end_seq() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return first_seq_ + (int64_t)entries_.size();
+}
+
+int64_t Reader::scan(int64_t from_seq, size_t max_records,
+                     const std::function<void(const Record&)>& visit) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  size_t position =
+      from_seq > first_seq_ ? (size_t)(from_seq - first_seq_) : 0;
+  position = std::min(position, entries_.size());
+  const size_t end = entries_.size() - position > max_records
+                         ? position + max_records
+                         : entries_.size();
+  for (; position < end; ++position) {
+    visit(decode_locked(position));
+  }
+  return first_seq_ + (int64_t)end;
+}
+
+bool Reader::get(int64_t seq, Record* record) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (seq < first_seq_ || seq >= first_seq_ + (int64_t)entries_.size()) {
+    return false;
+  }
+  *record = decode_locked((size_t)(seq - first_seq_));
+  return true;
+}
+
+}  // namespace nm_history
@@ -0,0 +1,189 @@
+#ifndef NM_HISTORY_H_
+#define NM_HISTORY_H_
+
+// Local history of displayed notifications, shared by the plugin and the
+// background poller daemon.
+//
+// ~/.local/share/notification_master/history.log is an append-only log. Both
+// processes append through a Writer: each record is one O_APPEND write()
+// under a shared flock(), so appends never interleave. The plugin reads the
+// file through a Reader, which mmap()s it and indexes only the bytes added
+// since its last look.
+//
+//   file    = FileHeader record*
+//   record  = RecordHeader (32 bytes), then item_id, title, message, channel,
+//             topic and big_text as u32 length + bytes, zero-padded to 8
+//             bytes. Records written before big_text existed end after
+//             topic and read back with an empty one.
+//
+// Every record carries a checksum. A reader stops at a record that is still
+// being written and picks it up next time. Garbage left behind by a writer
+// that died mid-record is skipped once later records have landed after it.
+//
+// Records are numbered by their position in the log. FileHeader::first_seq
+// counts the records compaction has dropped, so a record's seq (and the
+// paging cursor built on it) stays the same when the file is rewritten.
+// Compaction runs from append() once the file passes compact_bytes. It takes
+// the exclusive lock, keeps the newest records younger than the retention
+// (about half of compact_bytes), and renames the new file over the old one.
+// Writers and readers notice the new inode and reopen it.
+//
+// Thread-safe. Needs GLib.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nm_history {
+
+static constexpr size_t kCompactBytes = 8 * 1024 * 1024;
+static constexpr int64_t kRetentionMs = 30LL * 24 * 60 * 60 * 1000;
+static constexpr size_t kDefaultPageSize = 50;
+static constexpr size_t kMaxPageSize = 500;
+// Longer titles and messages are cut to this many bytes.
+static constexpr size_t kMaxFieldBytes = 16 * 1024;
+
+enum Source : uint8_t {
+  kApp = 0,     // shown by the app through the plugin
+  kFeed = 1,    // fetched by the plugin's polling thread
+  kDaemon = 2,  // fetched by the background poller daemon
+};
+
+// "app", "feed" or "daemon".
+const char* source_name(Source source);
+
+struct Record {
+  int64_t seq = -1;  // set by the Reader
+  int64_t shown_at_ms = 0;      // epoch ms
+  int64_t notification_id = 0;  // the app's id; 0 for feed items
+  Source source = kApp;
+  std::string item_id;  // feed item id, "" for app notifications
+  std::string title;
+  std::string message;
+  std::string channel;
+  std::string topic;
+  std::string big_text;  // expanded text of feed items, "" when none
+};
+
+class Writer {
+ public:
+  explicit Writer(std::string path, size_t compact_bytes = kCompactBytes,
+                  int64_t retention_ms = kRetentionMs);
+  ~Writer();
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  // Appends |record| (seq is ignored; shown_at_ms 0 means now). False when
+  // the file cannot be opened or written.
+  bool append(const Record& record);
+
+  // Rewrites the file without expired records and, if it is still over
+  // half of compact_bytes, without the oldest ones. append() calls this.
+  bool compact();
+
+ private:
+  bool open_locked();
+  bool compact_locked();
+
+  const std::string path_;
+  const size_t compact_bytes_;
+  const int64_t retention_ms_;
+  std::mutex mtx_;
+  int fd_ = -1;
+};
+
+struct Query {
+  int64_t cursor = -1;  // only records with seq < cursor; -1: from the newest
+  size_t limit = kDefaultPageSize;  // clamped to 1..kMaxPageSize
+  std::string channel;  // "" matches every channel
+  std::string topic;    // "" matches every topic
+  int64_t since_ms = 0;  // shown at or after (epoch ms), 0: no bound
+  int64_t until_ms = 0;  // shown before, 0: no bound
+};
+
+struct Page {
+  std::vector<Record> records;  // newest first
+  int64_t next_cursor = -1;     // -1 when there is nothing older
+};
+
+class Reader {
+ public:
+  explicit Reader(std::string path);
+  ~Reader();
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  // Maps and indexes what was appended since the last call, or the whole
+  // file after a compaction replaced it. query() calls this first.
+  void refresh();
+
+  // One page of matching records, newest first. Decodes only the records
+  // it returns.
+  Page query(const Query& query);
+
+  // Records indexed so far.
+  size_t size() const;
+
+  // Seq of the oldest record still in the file, and one past the newest.
+  int64_t first_seq() const;
+  int64_t end_seq() const;
+
+  // Calls |visit| with at most |max_records| indexed records from
+  // |from_seq| on, oldest first, and returns the seq after the last one.
+  // For secondary indexes (nm_search.h), which scan in batches so that
+  // query() is never held up for long; |visit| runs under the lock and must
+  // not call back.
+  int64_t scan(int64_t from_seq, size_t max_records,
+               const std::function<void(const Record&)>& visit);
+
+  // The record with |seq|; false when it was compacted away or not indexed.
+  bool get(int64_t seq, Record* record) const;
+
+ private:
+  struct Entry {
+    uint64_t offset;
+    int64_t shown_at_ms;
+    uint32_t channel;
+    uint32_t topic;
+  };
+
+  // Interned channel or topic names with the positions using each.
+  struct Postings {
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::vector<uint32_t>> positions;
+
+    uint32_t intern(const std::string& name);
+    const std::vector<uint32_t>* find(const std::string& name) const;
+  };
+
+  void reset_locked();
+  bool remap_locked(size_t size);
+  void index_locked();
+  Record decode_locked(size_t position) const;
+
+  const std::string path_;
+  mutable std::mutex mtx_;
+  int fd_ = -1;
+  uint64_t inode_ = 0;
+  const char* map_ = nullptr;
+  size_t mapped_ = 0;
+  size_t parsed_ = 0;  // bytes indexed so far
+  int64_t first_seq_ = 0;
+  std::vector<Entry> entries_;
+  // Time range of each block of kBlock entries, so time-filtered queries
+  // skip whole blocks.
+  std::vector<std::pair<int64_t, int64_t>> blocks_;
+  Postings channels_;
+  Postings topics_;
+};
+
+}  // namespace nm_history
+
+#endif  // NM_HISTORY_H_
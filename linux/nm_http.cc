@@ -0,0 +1,219 @@
+#include "nm_http.h"
+
+#include <algorithm>
+
+namespace nm_http {
+
+static SoupMessageHeaders* request_headers(SoupMessage* msg) {
+#if SOUP_VERSION == 3
+  return soup_message_get_request_headers(msg);
+#else
+  return msg->request_headers;
+#endif
+}
+
+static SoupMessageHeaders* response_headers(SoupMessage* msg) {
+#if SOUP_VERSION == 3
+  return soup_message_get_response_headers(msg);
+#else
+  return msg->response_headers;
+#endif
+}
+
+#if SOUP_VERSION != 3
+// libsoup 2's synchronous send takes no GCancellable; aborting the session
+// makes it return SOUP_STATUS_CANCELLED. Each thread has its own session on
+// libsoup 2, so only the calling thread's request is aborted.
+static void abort_session_cb(GCancellable* cancellable, gpointer session) {
+  soup_session_abort(SOUP_SESSION(session));
+}
+#endif
+
+Client& Client::get() {
+  // Never destroyed: the polling thread may still be using it at exit.
+  static Client* client = new Client();
+  return *client;
+}
+
+static SoupSession* new_session() {
+  SoupSession* session = soup_session_new();
+  // libsoup 3 and plain libsoup 2.42+ sessions already carry a decoder.
+  if (!soup_session_has_feature(session, SOUP_TYPE_CONTENT_DECODER)) {
+    soup_session_add_feature_by_type(session, SOUP_TYPE_CONTENT_DECODER);
+  }
+  return session;
+}
+
+// A thread's own session, released when the thread exits.
+struct ThreadSession {
+  SoupSession* session = nullptr;
+  ~ThreadSession() {
+    if (session) g_object_unref(session);
+  }
+};
+
+// Sessions are safe to share between threads from libsoup 3.2 on.
+static bool needs_per_thread_sessions() {
+#if SOUP_VERSION == 3
+  return soup_get_minor_version() < 2;
+#else
+  return true;
+#endif
+}
+
+Client::Client()
+    : per_thread_(needs_per_thread_sessions()),
+      session_(per_thread_ ? nullptr : new_session()) {}
+
+SoupSession* Client::session() {
+  if (!per_thread_) return session_;
+  static thread_local ThreadSession local;
+  if (!local.session) local.session = new_session();
+  return local.session;
+}
+
+guint Client::send(SoupMessage* msg, GCancellable* cancellable,
+                   std::string* body, std::string* error) {
+  SoupSession* session = this->session();
+#if SOUP_VERSION == 3
+  GError* err = nullptr;
+  GBytes* bytes = soup_session_send_and_read(session, msg, cancellable, &err);
+  guint status = err ? 0 : soup_message_get_status(msg);
+  if (err) {
+    if (error) *error = err->message;
+    g_error_free(err);
+  }
+  if (bytes) {
+    gsize len = 0;
+    const char* data = (const char*)g_bytes_get_data(bytes, &len);
+    if (body && data) body->assign(data, len);
+    g_bytes_unref(bytes);
+  }
+  return status;
+#else
+  gulong abort_id =
+      cancellable ? g_cancellable_connect(cancellable,
+                                          G_CALLBACK(abort_session_cb),
+                                          session, nullptr)
+                  : 0;
+  guint status = g_cancellable_is_cancelled(cancellable)
+                     ? SOUP_STATUS_CANCELLED
+                     : soup_session_send_message(session, msg);
+  if (abort_id) g_cancellable_disconnect(cancellable, abort_id);
+  // libsoup 2 reports transport failures as status codes below 100.
+  if (status < 100) {
+    if (error) *error = soup_status_get_phrase(status);
+    return 0;
+  }
+  SoupMessageBody* response = msg->response_body;
+  if (body && response && response->data) {
+    body->assign(response->data, (size_t)response->length);
+  }
+  return status;
+#endif
+}
+
+void ValidatorCache::apply(const std::string& url, SoupMessage* msg) {
+  SoupMessageHeaders* request = request_headers(msg);
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = validators_.find(url);
+  if (it == validators_.end()) return;
+  if (!it->second.etag.empty()) {
+    soup_message_headers_replace(request, "If-None-Match",
+                                 it->second.etag.c_str());
+  }
+  if (!it->second.last_modified.empty()) {
+    soup_message_headers_replace(request, "If-Modified-Since",
+                                 it->second.last_modified.c_str());
+  }
+}
+
+void ValidatorCache::store(const std::string& url, SoupMessage* msg) {
+  SoupMessageHeaders* headers = response_headers(msg);
+  const char* etag = soup_message_headers_get_one(headers, "ETag");
+  const char* last_modified =
+      soup_message_headers_get_one(headers, "Last-Modified");
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!etag && !last_modified) {
+    if (validators_.erase(url)) {
+      order_.erase(std::find(order_.begin(), order_.end(), url));
+    }
+    return;
+  }
+  auto it = validators_.find(url);
+  if (it == validators_.end()) {
+    if (order_.size() >= kMaxUrls) {
+      validators_.erase(order_.front());
+      order_.erase(order_.begin());
+    }
+    order_.push_back(url);
+    it = validators_.emplace(url, Validators()).first;
+  }
+  it->second.etag = etag ? etag : "";
+  it->second.last_modified = last_modified ? last_modified : "";
+}
+
+bool Client::get(const std::string& url, const Headers& headers,
+                 ValidatorCache* validators, GCancellable* cancellable,
+                 Response* response, const Inspector& inspect) {
+  *response = Response();
+  SoupMessage* msg = soup_message_new(SOUP_METHOD_GET, url.c_str());
+  if (!msg) {
+    response->error = "invalid URL";
+    return false;
+  }
+  SoupMessageHeaders* request = request_headers(msg);
+  for (const auto& header : headers) {
+    soup_message_headers_replace(request, header.first.c_str(),
+                                 header.second.c_str());
+  }
+  if (validators) validators->apply(url, msg);
+#if SOUP_VERSION == 3
+  if (inspect) soup_message_add_flags(msg, SOUP_MESSAGE_COLLECT_METRICS);
+#endif
+
+  if (g_cancellable_is_cancelled(cancellable)) {
+    response->cancelled = true;
+  } else {
+    response->status =
+        send(msg, cancellable, &response->body, &response->error);
+    response->cancelled = g_cancellable_is_cancelled(cancellable);
+  }
+  if (response->cancelled) {
+    response->status = 0;
+    response->body.clear();
+    g_object_unref(msg);
+    return false;
+  }
+  if (inspect) inspect(msg);
+  if (response->status == SOUP_STATUS_NOT_MODIFIED) {
+    response->not_modified = true;
+    response->body.clear();
+  } else if (validators && SOUP_STATUS_IS_SUCCESSFUL(response->status)) {
+    validators->store(url, msg);
+  }
+  g_object_unref(msg);
+  return response->status != 0;
+}
+
+bool Client::post_json(const std::string& url, const std::string& body,
+                       GCancellable* cancellable, guint* status) {
+  *status = 0;
+  SoupMessage* msg = soup_message_new(SOUP_METHOD_POST, url.c_str());
+  if (!msg) return false;
+#if SOUP_VERSION == 3
+  GBytes* request = g_bytes_new(body.data(), body.size());
+  soup_message_set_request_body_from_bytes(msg, "application/json", request);
+  g_bytes_unref(request);
+#else
+  soup_message_set_request(msg, "application/json", SOUP_MEMORY_COPY,
+                           body.data(), body.size());
+#endif
+  if (!g_cancellable_is_cancelled(cancellable)) {
+    *status = send(msg, cancellable, nullptr, nullptr);
+  }
+  g_object_unref(msg);
+  return true;
+}
+
+}  // namespace nm_http
@@ -0,0 +1,113 @@
+#ifndef NM_HTTP_H_
+#define NM_HTTP_H_
+
+// The plugin's one HTTP client, used by the polling thread, delivery
+// receipts and fetchNotifications. With libsoup 3.2 and later it is one
+// process-wide SoupSession, so they share one connection pool (keep-alive,
+// TLS sessions).
+//
+//   - Responses are decompressed by the session's SoupContentDecoder
+//     (Accept-Encoding is sent for gzip/deflate, and br where libsoup has it).
+//   - Conditional GET: the ETag / Last-Modified of the last 200 for each URL
+//     are sent back as If-None-Match / If-Modified-Since; a 304 comes back
+//     as Response::not_modified with an empty body. Validators belong to the
+//     caller (a ValidatorCache per consumer of a feed), so a 304 only ever
+//     means "unchanged since this caller's last 200".
+//   - The callers are the polling thread, the receipts poster and
+//     fetchNotifications on the fetch workers, and their requests run
+//     concurrently. Older libsoup does not allow a session to be used from
+//     several threads at once, so there every thread gets a session of its
+//     own (freed when the thread exits) and a slow server only ever holds up
+//     the thread that asked it.
+//
+// Plugin-only; works with libsoup 2.4 and 3 (SOUP_VERSION).
+
+#include <libsoup/soup.h>
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nm_http {
+
+typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+struct Response {
+  guint status = 0;           // 0 on transport failure
+  bool cancelled = false;
+  bool not_modified = false;  // 304 to a conditional request
+  std::string error;          // transport failure, if any
+  std::string body;           // decoded
+};
+
+// Called with the finished message (e.g. to read SoupMessageMetrics).
+typedef std::function<void(SoupMessage* msg)> Inspector;
+
+// The validators of the last 200 per URL, for one caller's conditional GETs.
+// Thread-safe.
+class ValidatorCache {
+ public:
+  ValidatorCache() = default;
+
+  ValidatorCache(const ValidatorCache&) = delete;
+  ValidatorCache& operator=(const ValidatorCache&) = delete;
+
+ private:
+  friend class Client;
+
+  struct Validators {
+    std::string etag;
+    std::string last_modified;
+  };
+
+  // Validators are kept for this many URLs; the oldest are dropped.
+  static constexpr size_t kMaxUrls = 64;
+
+  // Adds If-None-Match / If-Modified-Since for |url| to |msg|.
+  void apply(const std::string& url, SoupMessage* msg);
+  // Keeps the validators of |msg|, a 200 for |url|.
+  void store(const std::string& url, SoupMessage* msg);
+
+  std::mutex mtx_;
+  std::unordered_map<std::string, Validators> validators_;
+  std::vector<std::string> order_;
+};
+
+class Client {
+ public:
+  static Client& get();
+
+  // GETs |url| with extra |headers|. With |validators|, the request is
+  // conditional on the previous 200 for |url| stored there, and a new 200
+  // updates them; nullptr sends a plain GET. Returns false when the request
+  // could not be made (bad URL, transport error, cancelled); |response| says
+  // why.
+  bool get(const std::string& url, const Headers& headers,
+           ValidatorCache* validators, GCancellable* cancellable,
+           Response* response, const Inspector& inspect = Inspector());
+
+  // POSTs |body| as application/json and stores the HTTP status (0 on
+  // failure) in |status|. Returns false only for an unusable URL.
+  bool post_json(const std::string& url, const std::string& body,
+                 GCancellable* cancellable, guint* status);
+
+ private:
+  Client();
+
+  // The shared session, or the calling thread's own one when sessions
+  // cannot be shared between threads.
+  SoupSession* session();
+  guint send(SoupMessage* msg, GCancellable* cancellable, std::string* body,
+             std::string* error);
+
+  const bool per_thread_;  // libsoup older than 3.2
+  SoupSession* session_;   // nullptr when per_thread_
+};
+
+}  // namespace nm_http
+
+#endif  // NM_HTTP_H_
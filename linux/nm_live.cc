@@ -0,0 +1,96 @@
+#include "nm_live.h"
+
+#include <algorithm>
+
+namespace nm_live {
+
+Registry::~Registry() {
+  for (GObject* object : take_all()) g_object_unref(object);
+}
+
+std::unique_lock<std::mutex> Registry::lock(int64_t id) {
+  return std::unique_lock<std::mutex>(id_locks_[(uint64_t)id % kIdLocks]);
+}
+
+std::vector<std::unique_lock<std::mutex>> Registry::lock_all() {
+  // Always in index order; a show holds at most one of them.
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(kIdLocks);
+  for (std::mutex& m : id_locks_) locks.emplace_back(m);
+  return locks;
+}
+
+GObject* Registry::find(int64_t id) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = entries_.find(id);
+  return it == entries_.end() ? nullptr
+                              : G_OBJECT(g_object_ref(it->second));
+}
+
+void Registry::put(int64_t id, GObject* object) {
+  std::vector<GObject*> dropped;
+  g_object_ref(object);
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = entries_.find(id);
+    if (it != entries_.end()) {
+      // The previous reference; the same object when it is shown again.
+      dropped.push_back(it->second);
+      it->second = object;
+    } else {
+      entries_.emplace(id, object);
+      order_.push_back(id);
+      while (order_.size() > kMaxLive) {
+        auto oldest = entries_.find(order_.front());
+        dropped.push_back(oldest->second);
+        entries_.erase(oldest);
+        order_.pop_front();
+      }
+    }
+  }
+  // Unref outside the lock: finalizers may run.
+  for (GObject* old : dropped) g_object_unref(old);
+}
+
+GObject* Registry::take(int64_t id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) return nullptr;
+  GObject* object = it->second;
+  entries_.erase(it);
+  order_.erase(std::find(order_.begin(), order_.end(), id));
+  return object;
+}
+
+std::vector<GObject*> Registry::take_all() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<GObject*> objects;
+  objects.reserve(entries_.size());
+  for (int64_t id : order_) objects.push_back(entries_[id]);
+  entries_.clear();
+  order_.clear();
+  return objects;
+}
+
+void Registry::remove(GObject* object) {
+  GObject* removed = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto it = order_.begin(); it != order_.end(); ++it) {
+      auto entry = entries_.find(*it);
+      if (entry->second != object) continue;
+      removed = entry->second;
+      entries_.erase(entry);
+      order_.erase(it);
+      break;
+    }
+  }
+  if (removed) g_object_unref(removed);
+}
+
+size_t Registry::size() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return entries_.size();
+}
+
+}  // namespace nm_live
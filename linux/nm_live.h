@@ -0,0 +1,72 @@
+#ifndef NM_LIVE_H_
+#define NM_LIVE_H_
+
+// The notifications still on screen, by app id, so that showNotification
+// with an id that is already showing updates that popup in place and
+// cancelNotification / cancelAllNotifications can close it.
+//
+// Each entry holds a reference to the NotifyNotification. libnotify sends
+// the same server id (replaces_id) when a live NotifyNotification is shown
+// again, so the server swaps the popup instead of stacking a new one.
+// Entries leave when the server reports the notification closed, when it is
+// cancelled, or, past kMaxLive, oldest first.
+//
+// Showing is find(), a D-Bus round trip, then put(); cancelling is take(),
+// then a close. Callers hold lock(id) across each sequence, so a cancel
+// cannot land between a show's find() and put() (undone by the put), and
+// two shows of one id cannot both miss and stack two popups.
+//
+// Stores plain GObjects so it can be tested without libnotify. Thread-safe.
+// Plugin-only.
+
+#include <glib-object.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace nm_live {
+
+class Registry {
+ public:
+  static constexpr size_t kMaxLive = 256;
+  // Ids share this many locks.
+  static constexpr size_t kIdLocks = 16;
+
+  ~Registry();
+
+  // Serialises the show / cancel sequences of |id|.
+  std::unique_lock<std::mutex> lock(int64_t id);
+  // Takes every id lock, for cancelling all.
+  std::vector<std::unique_lock<std::mutex>> lock_all();
+
+  // A new reference to the notification showing as |id|, or null.
+  GObject* find(int64_t id) const;
+
+  // Stores a reference to |object| as |id|, dropping whatever was there.
+  void put(int64_t id, GObject* object);
+
+  // Removes |id| and hands its reference to the caller; null if absent.
+  GObject* take(int64_t id);
+
+  // Removes every entry and hands their references to the caller.
+  std::vector<GObject*> take_all();
+
+  // Drops the entry holding |object|, if any (its closed signal).
+  void remove(GObject* object);
+
+  size_t size() const;
+
+ private:
+  std::mutex id_locks_[kIdLocks];
+  mutable std::mutex mtx_;
+  std::unordered_map<int64_t, GObject*> entries_;
+  std::deque<int64_t> order_;
+};
+
+}  // namespace nm_live
+
+#endif  // NM_LIVE_H_
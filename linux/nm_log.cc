@@ -0,0 +1,233 @@
+#include "nm_log.h"
+
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace nm_log {
+
+static_assert((kRingSlots & (kRingSlots - 1)) == 0,
+              "kRingSlots must be a power of two");
+
+static uint64_t mono_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int64_t wall_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static const char* level_name(Level level) {
+  switch (level) {
+    case kDebug: return "DEBUG";
+    case kInfo:  return "INFO ";
+    case kWarn:  return "WARN ";
+    case kError: return "ERROR";
+  }
+  return "?    ";
+}
+
+bool parse_level(const std::string& name, Level* out) {
+  const char* s = name.c_str();
+  if (strcasecmp(s, "debug") == 0) *out = kDebug;
+  else if (strcasecmp(s, "info") == 0) *out = kInfo;
+  else if (strcasecmp(s, "warn") == 0 || strcasecmp(s, "warning") == 0)
+    *out = kWarn;
+  else if (strcasecmp(s, "error") == 0) *out = kError;
+  else return false;
+  return true;
+}
+
+Logger& Logger::get() {
+  // Leaked on purpose: threads may still log during static destruction.
+  static Logger* instance = new Logger();
+  return *instance;
+}
+
+Logger::Logger() : slots_(new Slot[kRingSlots]) {
+  for (size_t i = 0; i < kRingSlots; i++) {
+    slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+  start_mono_ns_ = mono_now_ns();
+  start_wall_ns_ = wall_now_ns();
+}
+
+bool Logger::log(Level level, const char* msg, size_t len) {
+  // Bounded MPMC queue (Vyukov); each slot's sequence number says whether it
+  // is free for the producer at |pos| or full for the consumer.
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &slots_[pos & (kRingSlots - 1)];
+    size_t seq = slot->seq.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  if (len > kMaxMessage) len = kMaxMessage;
+  slot->mono_ns = mono_now_ns();
+  slot->level = level;
+  slot->len = (uint16_t)len;
+  memcpy(slot->text, msg, len);
+  slot->seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+bool Logger::pop(std::string* batch) {
+  Slot& slot = slots_[dequeue_pos_ & (kRingSlots - 1)];
+  if (slot.seq.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+    return false;
+  }
+  append_line(batch, slot);
+  slot.seq.store(dequeue_pos_ + kRingSlots, std::memory_order_release);
+  dequeue_pos_++;
+  return true;
+}
+
+void Logger::append_line(std::string* out, const Slot& slot) {
+  uint64_t since_start = slot.mono_ns - start_mono_ns_;
+  int64_t wall_ns = start_wall_ns_ + (int64_t)since_start;
+  time_t secs = (time_t)(wall_ns / 1000000000LL);
+  struct tm t;
+  localtime_r(&secs, &t);
+  char head[80];
+  int n = snprintf(head, sizeof(head),
+                   "[NM-POLLER] %02d:%02d:%02d.%03d +%llu.%06llu %s ",
+                   t.tm_hour, t.tm_min, t.tm_sec,
+                   (int)((wall_ns / 1000000LL) % 1000),
+                   (unsigned long long)(since_start / 1000000000ULL),
+                   (unsigned long long)((since_start / 1000ULL) % 1000000ULL),
+                   level_name(slot.level));
+  out->append(head, n > 0 ? (size_t)n : 0);
+  out->append(slot.text, slot.len);
+  out->push_back('\n');
+}
+
+void Logger::start(const Options& options) {
+  if (writer_.joinable()) return;
+  options_ = options;
+  if (!options_.path.empty()) {
+    fd_ = open(options_.path.c_str(),
+               O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd_ >= 0 && fstat(fd_, &st) == 0) file_size_ = (size_t)st.st_size;
+  }
+  {
+    std::lock_guard<std::mutex> lk(wake_mtx_);
+    running_ = true;
+  }
+  writer_ = std::thread(&Logger::writer_main, this);
+}
+
+void Logger::stop() {
+  if (!writer_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lk(wake_mtx_);
+    running_ = false;
+  }
+  wake_cv_.notify_one();
+  writer_.join();
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+}
+
+void Logger::writer_main() {
+  // Keep batches well under max_bytes so rotation stays close to the limit.
+  size_t chunk = 64 * 1024;
+  if (options_.max_bytes > 0 && options_.max_bytes / 4 < chunk) {
+    chunk = options_.max_bytes / 4 + 1;
+  }
+  std::string batch;
+  batch.reserve(chunk + kMaxMessage + 64);
+  for (;;) {
+    bool running;
+    {
+      std::unique_lock<std::mutex> lk(wake_mtx_);
+      wake_cv_.wait_for(lk, std::chrono::milliseconds(kFlushIntervalMs),
+                        [this] { return !running_; });
+      running = running_;
+    }
+
+    batch.clear();
+    while (pop(&batch)) {
+      if (batch.size() >= chunk) {
+        write_batch(batch);
+        batch.clear();
+      }
+    }
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+      char note[96];
+      int n = snprintf(note, sizeof(note),
+                       "[NM-POLLER] log ring full: %llu line(s) dropped\n",
+                       (unsigned long long)(dropped - dropped_reported_));
+      batch.append(note, n > 0 ? (size_t)n : 0);
+      dropped_reported_ = dropped;
+    }
+    if (!batch.empty()) write_batch(batch);
+    if (!running) break;
+  }
+}
+
+static void write_all(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+}
+
+void Logger::write_batch(const std::string& batch) {
+  if (options_.echo_stderr) write_all(STDERR_FILENO, batch.data(), batch.size());
+  if (fd_ < 0) return;
+  if (options_.max_bytes > 0 && file_size_ > 0 &&
+      file_size_ + batch.size() > options_.max_bytes) {
+    rotate();
+    if (fd_ < 0) return;
+  }
+  write_all(fd_, batch.data(), batch.size());
+  file_size_ += batch.size();
+}
+
+void Logger::rotate() {
+  close(fd_);
+  const std::string& base = options_.path;
+  if (options_.keep <= 0) {
+    unlink(base.c_str());
+  } else {
+    unlink((base + "." + std::to_string(options_.keep)).c_str());
+    for (int i = options_.keep - 1; i >= 1; i--) {
+      rename((base + "." + std::to_string(i)).c_str(),
+             (base + "." + std::to_string(i + 1)).c_str());
+    }
+    rename(base.c_str(), (base + ".1").c_str());
+  }
+  fd_ = open(base.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  file_size_ = 0;
+}
+
+}  // namespace nm_log
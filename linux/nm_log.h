@@ -0,0 +1,127 @@
+#ifndef NM_LOG_H_
+#define NM_LOG_H_
+
+// Asynchronous logger for the background poller daemon.
+//
+// Producers (any thread) copy the message into a fixed-size slot of a bounded
+// lock-free MPSC ring — one CAS plus a memcpy, no allocation, no syscall
+// beyond the vDSO clock read. A single writer thread drains the ring every
+// kFlushIntervalMs, formats the batch and issues one write() on a log fd that
+// stays open for the life of the process. When the ring is full new lines are
+// dropped (and counted) rather than blocking the caller.
+//
+// Lines carry the wall-clock time and the CLOCK_MONOTONIC offset since start:
+//   [NM-POLLER] 12:00:01.234 +3.004512 INFO  message
+//
+// The file rotates once it would exceed max_bytes: log -> log.1 -> ... ->
+// log.<keep>, the oldest is deleted.
+//
+// Levels: NM_LOG_COMPILE_LEVEL removes lower levels at compile time (the
+// message expression is not even evaluated); set_level() filters at runtime.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef NM_LOG_COMPILE_LEVEL
+#define NM_LOG_COMPILE_LEVEL 0  // nm_log::kDebug
+#endif
+
+namespace nm_log {
+
+enum Level : int { kDebug = 0, kInfo = 1, kWarn = 2, kError = 3 };
+
+// Accepts "debug", "info", "warn"/"warning", "error" (case-insensitive).
+bool parse_level(const std::string& name, Level* out);
+
+static constexpr size_t kRingSlots = 1024;  // power of two
+static constexpr size_t kMaxMessage = 240;  // longer messages are truncated
+static constexpr int kFlushIntervalMs = 50;
+
+struct Options {
+  std::string path;               // empty: stderr only
+  size_t max_bytes = 1024 * 1024;  // 0 disables rotation
+  int keep = 3;                    // rotated files to retain
+  bool echo_stderr = false;
+};
+
+class Logger {
+ public:
+  static Logger& get();
+
+  // Opens the log file and starts the writer thread. Lines logged before
+  // start() are kept in the ring and written once it runs.
+  void start(const Options& options);
+  // Drains everything still queued, joins the writer and closes the file.
+  void stop();
+
+  void set_level(Level level) { level_.store(level, std::memory_order_relaxed); }
+  Level level() const { return level_.load(std::memory_order_relaxed); }
+  bool enabled(Level level) const {
+    return level >= level_.load(std::memory_order_relaxed);
+  }
+
+  // Hot path. Returns false if the line was dropped because the ring is full.
+  bool log(Level level, const char* msg, size_t len);
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    uint64_t mono_ns;
+    Level level;
+    uint16_t len;
+    char text[kMaxMessage];
+  };
+
+  Logger();
+
+  bool pop(std::string* batch);
+  void writer_main();
+  void write_batch(const std::string& batch);
+  void rotate();
+  void append_line(std::string* out, const Slot& slot);
+
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<size_t> enqueue_pos_{0};
+  size_t dequeue_pos_ = 0;  // writer thread only
+  std::atomic<Level> level_{kInfo};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t dropped_reported_ = 0;
+
+  Options options_;
+  int fd_ = -1;
+  size_t file_size_ = 0;
+  uint64_t start_mono_ns_ = 0;
+  int64_t start_wall_ns_ = 0;
+
+  std::thread writer_;
+  std::mutex wake_mtx_;
+  std::condition_variable wake_cv_;
+  bool running_ = false;
+};
+
+}  // namespace nm_log
+
+#define NM_LOG(level, msg)                                                  \
+  do {                                                                      \
+    if ((level) >= NM_LOG_COMPILE_LEVEL &&                                  \
+        nm_log::Logger::get().enabled(level)) {                             \
+      const std::string& nm_log_msg_ = (msg);                               \
+      nm_log::Logger::get().log(level, nm_log_msg_.data(),                  \
+                                nm_log_msg_.size());                        \
+    }                                                                       \
+  } while (0)
+
+#define NM_LOG_DEBUG(msg) NM_LOG(nm_log::kDebug, msg)
+#define NM_LOG_INFO(msg)  NM_LOG(nm_log::kInfo, msg)
+#define NM_LOG_WARN(msg)  NM_LOG(nm_log::kWarn, msg)
+#define NM_LOG_ERROR(msg) NM_LOG(nm_log::kError, msg)
+
+#endif  // NM_LOG_H_
@@ -0,0 +1,286 @@
+#include "nm_metrics.h"
+
+#include <dirent.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace nm_metrics {
+
+// Escapes a label value as the text format requires: backslash, double quote
+// and newline.
+static std::string escape_label_value(const char* value) {
+  std::string out;
+  for (const char* p = value; *p; p++) {
+    switch (*p) {
+      case '\\': out.append("\\\\"); break;
+      case '"':  out.append("\\\""); break;
+      case '\n': out.append("\\n"); break;
+      default:   out.push_back(*p);
+    }
+  }
+  return out;
+}
+
+static void append_sample(std::string* out, const char* name,
+                          const char* suffix, const std::string& labels,
+                          const char* value) {
+  out->append(name);
+  out->append(suffix);
+  out->push_back('{');
+  out->append(labels);
+  out->append("} ");
+  out->append(value);
+  out->push_back('\n');
+}
+
+static void append_header(std::string* out, const char* name,
+                          const char* help, const char* type) {
+  out->append("# HELP ").append(name).append(" ").append(help).append("\n");
+  out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+static std::string format_u64(uint64_t v) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%" PRIu64, v);
+  return buf;
+}
+
+static std::string format_double(double v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", v);
+  return buf;
+}
+
+static void render_gauge(std::string* out, const char* name, const char* help,
+                         const std::string& labels, int64_t value) {
+  if (value < 0) return;
+  append_header(out, name, help, "gauge");
+  append_sample(out, name, "", labels, format_u64((uint64_t)value).c_str());
+}
+
+static void render_counter(std::string* out, const char* name,
+                           const char* help, const std::string& labels,
+                           const Counter& counter) {
+  append_header(out, name, help, "counter");
+  append_sample(out, name, "", labels, format_u64(counter.value()).c_str());
+}
+
+void StatusCounter::inc(int code) {
+  if (code < 0 || code > kMaxCode) code = 0;
+  codes_[code].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t StatusCounter::value(int code) const {
+  if (code < 0 || code > kMaxCode) return 0;
+  return codes_[code].load(std::memory_order_relaxed);
+}
+
+void StatusCounter::render(std::string* out, const char* name,
+                           const char* help, const std::string& labels) const {
+  append_header(out, name, help, "counter");
+  for (int code = 0; code <= kMaxCode; code++) {
+    uint64_t v = codes_[code].load(std::memory_order_relaxed);
+    if (v == 0) continue;
+    append_sample(out, name, "",
+                  labels + ",code=\"" + std::to_string(code) + "\"",
+                  format_u64(v).c_str());
+  }
+}
+
+Histogram::Histogram(std::initializer_list<double> bounds)
+    : bounds_(bounds), buckets_(new std::atomic<uint64_t>[bounds.size() + 1]) {
+  for (size_t i = 0; i <= bounds_.size(); i++) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::observe(double value) {
+  size_t i = 0;
+  while (i < bounds_.size() && value > bounds_[i]) i++;
+  buckets_[i].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t old_bits = sum_bits_.load(std::memory_order_relaxed);
+  for (;;) {
+    double old_sum;
+    memcpy(&old_sum, &old_bits, sizeof(old_sum));
+    double new_sum = old_sum + value;
+    uint64_t new_bits;
+    memcpy(&new_bits, &new_sum, sizeof(new_bits));
+    if (sum_bits_.compare_exchange_weak(old_bits, new_bits,
+                                        std::memory_order_relaxed)) {
+      break;
+    }
+  }
+}
+
+double Histogram::sum() const {
+  uint64_t bits = sum_bits_.load(std::memory_order_relaxed);
+  double v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+double Histogram::quantile(double q) const {
+  uint64_t total = count();
+  if (total == 0) return 0;
+  double rank = q * (double)total;
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < bounds_.size(); i++) {
+    uint64_t in_bucket = buckets_[i].load(std::memory_order_relaxed);
+    if ((double)(cumulative + in_bucket) >= rank && in_bucket > 0) {
+      double lower = i == 0 ? 0 : bounds_[i - 1];
+      double fraction = (rank - (double)cumulative) / (double)in_bucket;
+      return lower + (bounds_[i] - lower) * fraction;
+    }
+    cumulative += in_bucket;
+  }
+  return bounds_.empty() ? 0 : bounds_.back();
+}
+
+void Histogram::render(std::string* out, const char* name, const char* help,
+                       const std::string& labels) const {
+  append_header(out, name, help, "histogram");
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < bounds_.size(); i++) {
+    cumulative += buckets_[i].load(std::memory_order_relaxed);
+    append_sample(out, name, "_bucket",
+                  labels + ",le=\"" + format_double(bounds_[i]) + "\"",
+                  format_u64(cumulative).c_str());
+  }
+  cumulative += buckets_[bounds_.size()].load(std::memory_order_relaxed);
+  append_sample(out, name, "_bucket", labels + ",le=\"+Inf\"",
+                format_u64(cumulative).c_str());
+  append_sample(out, name, "_sum", labels, format_double(sum()).c_str());
+  append_sample(out, name, "_count", labels, format_u64(cumulative).c_str());
+}
+
+PollMetrics::PollMetrics()
+    : http_duration({0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30}),
+      http_bytes({256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304}),
+      parse_duration({0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                      0.025, 0.05, 0.1}),
+      poll_items({0, 1, 2, 5, 10, 25, 50, 100, 250, 1000}),
+      display_duration({0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                        0.5, 1}),
+      delivery_latency({0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600, 900,
+                        1800, 3600, 7200, 21600, 86400}) {}
+
+void PollMetrics::record_delivery(int64_t sent_at_ms, int64_t displayed_at_ms) {
+  if (sent_at_ms <= 0) return;
+  int64_t latency_ms = displayed_at_ms - sent_at_ms;
+  if (latency_ms < -1000) delivery_clock_skew.inc();
+  if (latency_ms < 0) latency_ms = 0;
+  delivery_latency.observe((double)latency_ms / 1000.0);
+}
+
+std::string PollMetrics::render_prometheus(const char* source) const {
+  const std::string labels =
+      "source=\"" + escape_label_value(source) + "\"";
+  std::string out;
+  out.reserve(8192);
+  render_counter(&out, "nm_polls_total", "Poll cycles started.", labels,
+                 polls);
+  http_responses.render(&out, "nm_http_responses_total",
+                        "HTTP responses by status code (0 = no response).",
+                        labels);
+  http_duration.render(&out, "nm_http_request_duration_seconds",
+                       "Time from request start to full response body.",
+                       labels);
+  http_bytes.render(&out, "nm_http_response_bytes",
+                    "Response body size in bytes.", labels);
+  parse_duration.render(&out, "nm_parse_duration_seconds",
+                        "Time spent parsing a response body.", labels);
+  poll_items.render(&out, "nm_poll_items",
+                    "Items per response before topic filtering.", labels);
+  render_counter(&out, "nm_topic_filtered_items_total",
+                 "Items dropped because their topic is not subscribed.",
+                 labels, topic_filtered);
+  render_counter(&out, "nm_dedupe_hits_total",
+                 "Notifications suppressed as recent duplicates.", labels,
+                 dedupe_hits);
+  render_counter(&out, "nm_near_duplicate_hits_total",
+                 "Notifications suppressed as near-duplicates (SimHash).",
+                 labels, near_duplicate_hits);
+  display_duration.render(&out, "nm_display_duration_seconds",
+                          "Time spent handing a notification to the server.",
+                          labels);
+  render_counter(&out, "nm_display_errors_total",
+                 "Notifications the server (D-Bus) failed to show.", labels,
+                 display_errors);
+  render_counter(&out, "nm_progress_coalesced_total",
+                 "Progress updates replaced by a newer one before display.",
+                 labels, progress_coalesced);
+  render_counter(&out, "nm_rate_limited_total",
+                 "Notifications dropped by their channel's rate limit.",
+                 labels, rate_limited);
+  render_counter(&out, "nm_handoff_lost_total",
+                 "Daemon-fetched items overwritten before the app read them.",
+                 labels, handoff_lost);
+  delivery_latency.render(&out, "nm_delivery_latency_seconds",
+                          "Server emit time (sentAt) to on-screen.", labels);
+  append_header(&out, "nm_delivery_latency_percentile_seconds",
+                "Delivery latency percentiles estimated from the histogram.",
+                "gauge");
+  static const double kQuantiles[] = {0.5, 0.9, 0.99};
+  for (double q : kQuantiles) {
+    append_sample(&out, "nm_delivery_latency_percentile_seconds", "",
+                  labels + ",quantile=\"" + format_double(q) + "\"",
+                  format_double(delivery_latency.quantile(q)).c_str());
+  }
+  render_counter(&out, "nm_delivery_clock_skew_total",
+                 "Items whose sentAt lies more than 1 s in the future.",
+                 labels, delivery_clock_skew);
+  render_counter(&out, "nm_receipts_sent_total",
+                 "Delivery receipts acknowledged by the server.", labels,
+                 receipts_sent);
+  render_counter(&out, "nm_receipts_failed_total",
+                 "Delivery receipts that could not be posted.", labels,
+                 receipts_failed);
+  ProcessStats process = read_process_stats();
+  render_gauge(&out, "nm_process_resident_memory_bytes",
+               "Resident set size of the process.", labels,
+               process.resident_bytes);
+  render_gauge(&out, "nm_process_open_fds", "Open file descriptors.", labels,
+               process.open_fds);
+  render_gauge(&out, "nm_process_threads", "Threads in the process.", labels,
+               process.threads);
+  return out;
+}
+
+ProcessStats read_process_stats() {
+  ProcessStats stats;
+  FILE* status = fopen("/proc/self/status", "r");
+  if (status) {
+    char line[256];
+    long long value = 0;
+    while (fgets(line, sizeof(line), status)) {
+      if (sscanf(line, "VmRSS: %lld kB", &value) == 1) {
+        stats.resident_bytes = value * 1024;
+      } else if (sscanf(line, "Threads: %lld", &value) == 1) {
+        stats.threads = value;
+      }
+    }
+    fclose(status);
+  }
+  DIR* fds = opendir("/proc/self/fd");
+  if (fds) {
+    int64_t count = 0;
+    while (struct dirent* entry = readdir(fds)) {
+      if (entry->d_name[0] != '.') count++;
+    }
+    closedir(fds);
+    stats.open_fds = count - 1;  // the descriptor opendir() itself holds
+  }
+  return stats;
+}
+
+PollMetrics& global() {
+  // Leaked on purpose: the polling thread may still record during shutdown.
+  static PollMetrics* instance = new PollMetrics();
+  return *instance;
+}
+
+}  // namespace nm_metrics
@@ -0,0 +1,131 @@
+#ifndef NM_METRICS_H_
+#define NM_METRICS_H_
+
+// Poll / parse / display metrics kept by BOTH the plugin's polling thread and
+// the background poller daemon, rendered in the Prometheus text exposition
+// format (version 0.0.4).
+//
+// Recording is lock-free (relaxed atomics only) so it can sit on the polling
+// and display paths. Each process owns one PollMetrics (global()); the daemon
+// writes its copy to ~/.config/notification_master/poller.prom after every
+// cycle (node_exporter textfile-collector compatible) and the plugin returns
+// both from getPollingMetrics.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nm_metrics {
+
+class Counter {
+ public:
+  void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Counts responses per HTTP status code; code 0 means the request failed
+// before a status line arrived (DNS, TLS, timeout, ...).
+class StatusCounter {
+ public:
+  static constexpr int kMaxCode = 599;
+  void inc(int code);
+  uint64_t value(int code) const;
+  void render(std::string* out, const char* name, const char* help,
+              const std::string& labels) const;
+
+ private:
+  std::atomic<uint64_t> codes_[kMaxCode + 1] = {};
+};
+
+// Cumulative-bucket histogram with fixed upper bounds.
+class Histogram {
+ public:
+  explicit Histogram(std::initializer_list<double> bounds);
+  void observe(double value);
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  double sum() const;
+  // Estimates the |q| quantile (0..1) by linear interpolation inside the
+  // bucket that contains it, like PromQL histogram_quantile(). Values past
+  // the last bound report that bound. Returns 0 when empty.
+  double quantile(double q) const;
+  void render(std::string* out, const char* name, const char* help,
+              const std::string& labels) const;
+
+ private:
+  std::vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets_;  // non-cumulative
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_bits_{0};  // double, updated with CAS
+};
+
+// Measures elapsed wall time in seconds on the monotonic clock.
+class Stopwatch {
+ public:
+  Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+struct PollMetrics {
+  PollMetrics();
+
+  Counter polls;
+  StatusCounter http_responses;
+  Histogram http_duration;   // seconds
+  Histogram http_bytes;      // response body size
+  Histogram parse_duration;  // seconds
+  Histogram poll_items;      // items per response, before topic filtering
+  Counter topic_filtered;
+  Counter dedupe_hits;
+  Counter near_duplicate_hits;  // suppressed by SimHash distance (daemon)
+  Histogram display_duration;  // seconds spent in notify_notification_show
+  Counter display_errors;      // D-Bus / notification server failures
+  Counter progress_coalesced;  // progress updates replaced before display
+  Counter rate_limited;        // dropped by a channel's rate limit
+  Counter handoff_lost;        // daemon items overwritten before the app read
+                               // them (nm_handoff.h)
+  // Server emit time ("sentAt") to on-screen, seconds. Also rendered as
+  // p50/p90/p99 gauges.
+  Histogram delivery_latency;
+  Counter delivery_clock_skew;  // items stamped in the future (> 1 s)
+  Counter receipts_sent;
+  Counter receipts_failed;
+
+  // Records one displayed item stamped |sent_at_ms| (epoch ms) that reached
+  // the screen at |displayed_at_ms|. No-op when |sent_at_ms| is 0.
+  void record_delivery(int64_t sent_at_ms, int64_t displayed_at_ms);
+
+  // Renders every metric as "nm_<name>{source="<source>"} ...", with
+  // |source| escaped as a label value.
+  std::string render_prometheus(const char* source) const;
+};
+
+// The process-wide instance.
+PollMetrics& global();
+
+// Resource use of the calling process from /proc/self; -1 where unreadable.
+// Rendered as nm_process_* gauges so slow leaks show up as a trend.
+struct ProcessStats {
+  int64_t resident_bytes = -1;  // VmRSS
+  int64_t open_fds = -1;        // entries in /proc/self/fd
+  int64_t threads = -1;         // Threads
+};
+ProcessStats read_process_stats();
+
+}  // namespace nm_metrics
+
+#endif  // NM_METRICS_H_
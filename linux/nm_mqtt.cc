@@ -0,0 +1,156 @@
+#include "nm_mqtt.h"
+
+#include <glib.h>
+#include <mosquitto.h>
+
+#include "nm_topics.h"
+
+namespace nm_mqtt {
+
+static constexpr int kQos = 1;
+
+std::string default_client_id() {
+  std::string id = std::string("nm-") + g_get_user_name();
+  gchar* machine_id = nullptr;
+  if (g_file_get_contents("/etc/machine-id", &machine_id, nullptr, nullptr)) {
+    g_strstrip(machine_id);
+    id += "-" + std::string(machine_id).substr(0, 12);
+    g_free(machine_id);
+  }
+  return id;
+}
+
+Subscriber::Subscriber(const nm_config::MqttConfig& config,
+                       MessageHandler on_message)
+    : config_(config), on_message_(std::move(on_message)) {
+  mosquitto_lib_init();
+  if (config_.client_id.empty()) config_.client_id = default_client_id();
+  // clean_session = false: the broker keeps our subscriptions and queues QoS 1
+  // messages while we are away.
+  mosq_ = mosquitto_new(config_.client_id.c_str(), false, this);
+  if (!mosq_) return;
+  mosquitto_int_option(mosq_, MOSQ_OPT_PROTOCOL_VERSION,
+                       config_.protocol == 311 ? MQTT_PROTOCOL_V311
+                                               : MQTT_PROTOCOL_V5);
+  if (!config_.username.empty()) {
+    mosquitto_username_pw_set(
+        mosq_, config_.username.c_str(),
+        config_.password.empty() ? nullptr : config_.password.c_str());
+  }
+  if (!config_.cafile.empty()) {
+    mosquitto_tls_set(mosq_, config_.cafile.c_str(), nullptr, nullptr, nullptr,
+                      nullptr);
+  }
+  mosquitto_connect_with_flags_callback_set(mosq_, on_connect_cb);
+  mosquitto_disconnect_callback_set(mosq_, on_disconnect_cb);
+  mosquitto_message_callback_set(mosq_, on_message_cb);
+}
+
+Subscriber::~Subscriber() {
+  if (mosq_) {
+    disconnect();
+    mosquitto_destroy(mosq_);
+  }
+  mosquitto_lib_cleanup();
+}
+
+void Subscriber::set_topics(const std::vector<std::string>& topics) {
+  std::vector<std::string> filters =
+      nm_topics::broker_filters(config_.topic_prefix, topics);
+  wanted_ = std::set<std::string>(filters.begin(), filters.end());
+  if (connected_) apply_subscriptions();
+}
+
+bool Subscriber::connect(std::string* error) {
+  if (!mosq_) {
+    if (error) *error = "mosquitto_new failed";
+    return false;
+  }
+  if (config_.host.empty()) {
+    if (error) *error = "no broker host configured";
+    return false;
+  }
+  mosquitto_property* props = nullptr;
+  if (config_.protocol != 311) {
+    mosquitto_property_add_int32(&props, MQTT_PROP_SESSION_EXPIRY_INTERVAL,
+                                 (uint32_t)config_.session_expiry);
+  }
+  int rc = mosquitto_connect_bind_v5(mosq_, config_.host.c_str(), config_.port,
+                                     config_.keepalive, nullptr, props);
+  mosquitto_property_free_all(&props);
+  if (rc != MOSQ_ERR_SUCCESS) {
+    if (error) *error = mosquitto_strerror(rc);
+    return false;
+  }
+  return true;
+}
+
+bool Subscriber::loop(int timeout_ms, std::string* error) {
+  last_error_.clear();
+  int rc = mosquitto_loop(mosq_, timeout_ms, 1);
+  if (rc == MOSQ_ERR_SUCCESS && last_error_.empty()) return true;
+  if (error) {
+    *error = !last_error_.empty() ? last_error_ : mosquitto_strerror(rc);
+  }
+  connected_ = false;
+  return false;
+}
+
+void Subscriber::disconnect() {
+  if (!mosq_) return;
+  mosquitto_disconnect(mosq_);
+  connected_ = false;
+}
+
+void Subscriber::apply_subscriptions() {
+  for (auto it = active_.begin(); it != active_.end();) {
+    if (wanted_.count(*it)) {
+      ++it;
+      continue;
+    }
+    mosquitto_unsubscribe(mosq_, nullptr, it->c_str());
+    it = active_.erase(it);
+  }
+  for (const auto& filter : wanted_) {
+    if (active_.count(filter)) continue;
+    if (mosquitto_subscribe(mosq_, nullptr, filter.c_str(), kQos) ==
+        MOSQ_ERR_SUCCESS) {
+      active_.insert(filter);
+    }
+  }
+}
+
+void Subscriber::on_connect_cb(struct mosquitto*, void* obj, int rc,
+                               int flags) {
+  auto* self = static_cast<Subscriber*>(obj);
+  if (rc != 0) {
+    self->last_error_ = mosquitto_connack_string(rc);
+    return;
+  }
+  self->connected_ = true;
+  // Without a resumed session the broker has forgotten every subscription.
+  // With one it still holds active_, so only the diff against wanted_ (topics
+  // changed while we were offline) is sent. Filters left over from a previous
+  // process are harmless: the daemon filters items by topic again.
+  const bool session_present = (flags & 1) != 0;
+  if (!session_present) self->active_.clear();
+  self->apply_subscriptions();
+}
+
+void Subscriber::on_disconnect_cb(struct mosquitto*, void* obj, int rc) {
+  auto* self = static_cast<Subscriber*>(obj);
+  self->connected_ = false;
+  if (rc != 0 && self->last_error_.empty()) {
+    self->last_error_ = mosquitto_strerror(rc);
+  }
+}
+
+void Subscriber::on_message_cb(struct mosquitto*, void* obj,
+                               const struct mosquitto_message* msg) {
+  auto* self = static_cast<Subscriber*>(obj);
+  if (!msg || !msg->topic || !self->on_message_) return;
+  self->on_message_(msg->topic, static_cast<const char*>(msg->payload),
+                    msg->payloadlen > 0 ? (size_t)msg->payloadlen : 0);
+}
+
+}  // namespace nm_mqtt
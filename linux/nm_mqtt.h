@@ -0,0 +1,79 @@
+#ifndef NM_MQTT_H_
+#define NM_MQTT_H_
+
+// MQTT 3.1.1 / 5 subscriber used by the background poller daemon when
+// poller.conf selects transport = mqtt. Built only when libmosquitto is found
+// (NM_HAVE_MQTT).
+//
+// Subscriptions are QoS 1 and the session is persistent: the client id is
+// stable, clean-start is off and (MQTT 5) a session-expiry interval is sent,
+// so messages published while the desktop was offline are delivered on the
+// next connect. libmosquitto sends the PUBACKs.
+//
+// Not thread-safe: every call, and every callback, happens on the thread that
+// drives loop().
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "nm_poller_config.h"
+
+struct mosquitto;
+struct mosquitto_message;
+
+namespace nm_mqtt {
+
+// Called for every PUBLISH received, with the broker topic name.
+typedef std::function<void(const std::string& topic, const char* payload,
+                           size_t len)>
+    MessageHandler;
+
+// Stable per user and machine: "nm-<user>-<machine id prefix>".
+std::string default_client_id();
+
+class Subscriber {
+ public:
+  Subscriber(const nm_config::MqttConfig& config, MessageHandler on_message);
+  ~Subscriber();
+
+  Subscriber(const Subscriber&) = delete;
+  Subscriber& operator=(const Subscriber&) = delete;
+
+  // Replaces the set of app topics (see nm_topics::broker_filters). Applied
+  // immediately when connected, otherwise on the next CONNACK.
+  void set_topics(const std::vector<std::string>& topics);
+
+  // Opens the connection (blocking TCP/TLS connect). The CONNACK is handled by
+  // a later loop(); connected() turns true once the broker accepted us.
+  bool connect(std::string* error);
+  bool connected() const { return connected_; }
+
+  // Services the socket for up to |timeout_ms|. Returns false once the
+  // connection is gone; call connect() again to resume the session.
+  bool loop(int timeout_ms, std::string* error);
+
+  void disconnect();
+
+ private:
+  static void on_connect_cb(struct mosquitto* mosq, void* obj, int rc,
+                            int flags);
+  static void on_disconnect_cb(struct mosquitto* mosq, void* obj, int rc);
+  static void on_message_cb(struct mosquitto* mosq, void* obj,
+                            const struct mosquitto_message* msg);
+  void apply_subscriptions();
+
+  nm_config::MqttConfig config_;
+  MessageHandler on_message_;
+  struct mosquitto* mosq_ = nullptr;
+  bool connected_ = false;
+  std::string last_error_;
+  // Filters we want vs. filters the broker has for this session.
+  std::set<std::string> wanted_;
+  std::set<std::string> active_;
+};
+
+}  // namespace nm_mqtt
+
+#endif  // NM_MQTT_H_
@@ -0,0 +1,236 @@
+#include "nm_poller_config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace nm_config {
+
+std::string config_dir() {
+  return std::string(g_get_user_config_dir()) + "/" + kConfDir;
+}
+
+std::string config_path() { return config_dir() + "/" + kConfFile; }
+
+std::string state_path() { return config_dir() + "/" + kStateFile; }
+
+std::string prefs_path() { return config_dir() + "/" + kPrefsFile; }
+
+std::string metrics_path() { return config_dir() + "/" + kMetricsFile; }
+
+std::string history_path() {
+  return std::string(g_get_user_data_dir()) + "/" + kConfDir + "/" +
+         kHistoryFile;
+}
+
+std::string handoff_path() {
+  return std::string(g_get_user_runtime_dir()) + "/" + kConfDir + "/" +
+         kHandoffFile;
+}
+
+bool write_key_file(const std::string& path, const char* group,
+                    const KeyValues& values) {
+  gchar* dir = g_path_get_dirname(path.c_str());
+  g_mkdir_with_parents(dir, 0700);
+  g_free(dir);
+
+  GKeyFile* kf = g_key_file_new();
+  g_key_file_load_from_file(kf, path.c_str(), G_KEY_FILE_KEEP_COMMENTS,
+                            nullptr);
+  for (const auto& kv : values) {
+    g_key_file_set_string(kf, group, kv.first.c_str(), kv.second.c_str());
+  }
+
+  gsize len = 0;
+  gchar* data = g_key_file_to_data(kf, &len, nullptr);
+  // g_file_set_contents() writes a temporary file next to |path| and renames
+  // it over the original, so concurrent readers see either the old or the new
+  // file and never a truncated one.
+  gboolean ok = g_file_set_contents(path.c_str(), data, (gssize)len, nullptr);
+  g_free(data);
+  g_key_file_free(kf);
+  return ok;
+}
+
+// Copies |key| from |group| into |out| if present; returns whether it was.
+static bool read_string(GKeyFile* kf, const char* group, const char* key,
+                        std::string* out) {
+  gchar* v = g_key_file_get_string(kf, group, key, nullptr);
+  if (!v) return false;
+  *out = v;
+  g_free(v);
+  return true;
+}
+
+static void read_positive_int(GKeyFile* kf, const char* group, const char* key,
+                              int* out) {
+  std::string v;
+  if (!read_string(kf, group, key, &v)) return;
+  int parsed = std::atoi(v.c_str());
+  if (parsed > 0) *out = parsed;
+}
+
+// near_duplicates must be 1..kMaxNearDuplicates; anything else leaves
+// near-duplicate suppression off and is reported in |next|->warnings.
+static void read_near_duplicates(GKeyFile* kf, PollerConfig* next) {
+  std::string v;
+  if (!read_string(kf, kGroup, kNearDuplicates, &v)) return;
+  char* end = nullptr;
+  long parsed = std::strtol(v.c_str(), &end, 10);
+  if (end != v.c_str() && *end == '\0' && parsed >= 1 &&
+      parsed <= kMaxNearDuplicates) {
+    next->near_duplicates = (int)parsed;
+    return;
+  }
+  next->warnings.push_back(std::string(kNearDuplicates) + " = '" + v +
+                           "' is not in 1.." +
+                           std::to_string(kMaxNearDuplicates) +
+                           " — near-duplicate suppression is off");
+}
+
+PollerConfigStore::PollerConfigStore() : dir_(config_dir()) {}
+
+PollerConfigStore::PollerConfigStore(std::string dir) : dir_(std::move(dir)) {}
+
+PollerConfigStore::~PollerConfigStore() {
+  if (inotify_fd_ >= 0) close(inotify_fd_);
+}
+
+void PollerConfigStore::load() {
+  PollerConfig next;
+  GKeyFile* kf = g_key_file_new();
+  if (g_key_file_load_from_file(kf, (dir_ + "/" + kConfFile).c_str(),
+                                G_KEY_FILE_NONE, nullptr)) {
+    std::string en;
+    read_string(kf, kGroup, kUrl, &next.url);
+    read_positive_int(kf, kGroup, kInterval, &next.interval_minutes);
+    if (read_string(kf, kGroup, kEnabled, &en)) next.enabled = en == "1";
+    read_string(kf, kGroup, kTransport, &next.transport);
+    read_string(kf, kGroup, kLogLevel, &next.log_level);
+    read_string(kf, kGroup, kReceiptsUrl, &next.receipts_url);
+    read_near_duplicates(kf, &next);
+
+    MqttConfig& m = next.mqtt;
+    read_string(kf, kMqttGroup, kMqttHost, &m.host);
+    read_positive_int(kf, kMqttGroup, kMqttPort, &m.port);
+    read_positive_int(kf, kMqttGroup, kMqttProtocol, &m.protocol);
+    read_string(kf, kMqttGroup, kMqttClientId, &m.client_id);
+    read_string(kf, kMqttGroup, kMqttUsername, &m.username);
+    read_string(kf, kMqttGroup, kMqttPassword, &m.password);
+    read_string(kf, kMqttGroup, kMqttTopicPrefix, &m.topic_prefix);
+    read_positive_int(kf, kMqttGroup, kMqttKeepalive, &m.keepalive);
+    read_string(kf, kMqttGroup, kMqttCaFile, &m.cafile);
+    read_positive_int(kf, kMqttGroup, kMqttSessionExpiry, &m.session_expiry);
+  }
+  g_key_file_free(kf);
+
+  kf = g_key_file_new();
+  if (g_key_file_load_from_file(kf, (dir_ + "/" + kPrefsFile).c_str(),
+                                G_KEY_FILE_NONE, nullptr)) {
+    gsize n = 0;
+    gchar** list =
+        g_key_file_get_string_list(kf, kTopicsGroup, kTopicsKey, &n, nullptr);
+    for (gsize i = 0; list && i < n; i++) {
+      if (list[i][0] != '\0') next.topics.emplace_back(list[i]);
+    }
+    g_strfreev(list);
+    next.channels = nm_channels::load_all(kf);
+  }
+  g_key_file_free(kf);
+
+  const char* loadtest_interval = getenv(kLoadtestIntervalEnv);
+  if (loadtest_interval) {
+    int parsed = std::atoi(loadtest_interval);
+    if (parsed > 0) next.interval_seconds = parsed;
+  }
+  config_ = next;
+}
+
+bool PollerConfigStore::watch() {
+  if (inotify_fd_ >= 0) return true;
+  g_mkdir_with_parents(dir_.c_str(), 0700);
+
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) return false;
+  // Watch the directory rather than the file: atomic writers (ours included)
+  // replace the inode via rename, which would silently drop a file watch.
+  // No IN_CREATE: a file is complete only at IN_CLOSE_WRITE or IN_MOVED_TO,
+  // and every atomic write would otherwise wake us for its temp file.
+  watch_wd_ = inotify_add_watch(inotify_fd_, dir_.c_str(),
+                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+  if (watch_wd_ < 0) {
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+bool PollerConfigStore::drain_events() {
+  bool relevant = false;
+  alignas(struct inotify_event) char buf[4096];
+  for (;;) {
+    ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+    if (n <= 0) break;
+    for (char* p = buf; p < buf + n;) {
+      auto* ev = reinterpret_cast<struct inotify_event*>(p);
+      if (ev->len > 0 && (strcmp(ev->name, kConfFile) == 0 ||
+                          strcmp(ev->name, kPrefsFile) == 0)) {
+        relevant = true;
+      }
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+  return relevant;
+}
+
+bool PollerConfigStore::wait_for_change(int timeout_ms) {
+  if (inotify_fd_ < 0) {
+    g_usleep((gulong)timeout_ms * 1000);
+    return false;
+  }
+  // The daemon's own poller.state and poller.prom live next to poller.conf;
+  // their writes are drained here without cutting the wait short.
+  const gint64 deadline = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+  for (;;) {
+    gint64 remaining_ms = (deadline - g_get_monotonic_time()) / 1000;
+    if (remaining_ms < 0) remaining_ms = 0;
+    struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+    int rc = poll(&pfd, 1, (int)remaining_ms);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc <= 0 || !(pfd.revents & POLLIN)) return false;
+    if (drain_events()) break;
+  }
+  load();
+  return true;
+}
+
+void PollerConfigStore::stage(const char* key, const std::string& value) {
+  for (auto& kv : staged_) {
+    if (kv.first == key) {
+      kv.second = value;
+      return;
+    }
+  }
+  staged_.emplace_back(key, value);
+}
+
+bool PollerConfigStore::commit() {
+  if (staged_.empty()) return true;
+  bool ok = write_key_file(dir_ + "/" + kConfFile, kGroup, staged_);
+  staged_.clear();
+  load();
+  // Our own write shows up as an inotify event; swallow it so the polling
+  // loop does not reload the file a second time.
+  if (inotify_fd_ >= 0) drain_events();
+  return ok;
+}
+
+}  // namespace nm_config
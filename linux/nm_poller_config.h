@@ -0,0 +1,233 @@
+#ifndef NM_POLLER_CONFIG_H_
+#define NM_POLLER_CONFIG_H_
+
+// Shared poller.conf layout used by BOTH the Flutter plugin
+// (notification_master_plugin.cc) and the standalone background poller daemon
+// (nm_background_poller_linux.cpp). Mirrors windows/nm_registry_config.h.
+//
+// User configuration — ~/.config/notification_master/poller.conf:
+//   [poller]
+//   url      = https://...
+//   interval = 15         (minutes)
+//   enabled  = 1
+//   transport = poll      (or "mqtt", see [mqtt] below)
+//   log_level = info      (daemon log: debug | info | warn | error)
+//   receipts_url = https://...  (optional, see nm_receipts.h)
+//   near_duplicates = 3   (daemon only, optional: suppress notifications
+//                          within this many SimHash bits of one shown in the
+//                          last hour, 1..7, see nm_simhash.h; unset: off)
+//
+//   [mqtt]                (daemon only, used when transport = mqtt)
+//   host           = broker.example.com
+//   port           = 1883
+//   protocol       = 5    (or 311 for MQTT 3.1.1)
+//   client_id      = ...  (default: derived from user + machine id)
+//   username       = ...
+//   password       = ...
+//   topic_prefix   = notification_master
+//   keepalive      = 60   (seconds)
+//   cafile         = ...  (enables TLS)
+//   session_expiry = 604800 (seconds the broker keeps our session, MQTT 5)
+//
+// Daemon status — ~/.config/notification_master/poller.state (written by the
+// daemon only, never by the plugin, so the two never race on one file):
+//   [status]
+//   last_run   = 1700000000 (epoch seconds of the last successful poll)
+//   last_error = ...
+//
+// Daemon metrics — ~/.config/notification_master/poller.prom (Prometheus text
+// format, see nm_metrics.h; written by the daemon only).
+//
+// Display history — ~/.local/share/notification_master/history.log
+// ($XDG_DATA_HOME; append-only, written by both, read by the plugin; see
+// nm_history.h). Data, not configuration, so it stays out of ~/.config.
+//
+// Live handoff — $XDG_RUNTIME_DIR/notification_master/handoff.ring (shared
+// memory, written by the daemon, read by the plugin; see nm_handoff.h).
+//
+// Topic subscriptions and channels — ~/.config/notification_master/prefs.ini
+// (owned by the plugin's PrefsStore; the daemon only reads it):
+//   [topics]
+//   subscribed = news;alerts.*;
+//   [channel:<id>]        (one group per channel, see nm_channels.h)
+//
+// All writes go through write_key_file(): the key file is serialised once and
+// replaced via write-to-temp + rename, so readers never see a partial file.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nm_channels.h"
+
+namespace nm_config {
+
+static const char* const kConfDir     = "notification_master";
+static const char* const kConfFile    = "poller.conf";
+static const char* const kStateFile   = "poller.state";
+static const char* const kPrefsFile   = "prefs.ini";
+static const char* const kMetricsFile = "poller.prom";
+static const char* const kHistoryFile = "history.log";
+static const char* const kHandoffFile = "handoff.ring";
+
+static const char* const kGroup       = "poller";
+static const char* const kUrl         = "url";
+static const char* const kInterval    = "interval";
+static const char* const kEnabled     = "enabled";
+static const char* const kTransport   = "transport";
+static const char* const kLogLevel    = "log_level";
+static const char* const kReceiptsUrl = "receipts_url";
+static const char* const kNearDuplicates = "near_duplicates";
+// Largest near_duplicates accepted (NearDuplicateIndex::kMaxDistance).
+static constexpr int kMaxNearDuplicates = 7;
+
+// Environment variable the load harness (linux/loadtest) sets to poll every
+// few seconds instead of every |interval| minutes. Not a poller.conf key.
+static const char* const kLoadtestIntervalEnv = "NM_LOADTEST_INTERVAL_SECONDS";
+
+static const char* const kTransportPoll = "poll";
+static const char* const kTransportMqtt = "mqtt";
+
+static const char* const kMqttGroup         = "mqtt";
+static const char* const kMqttHost          = "host";
+static const char* const kMqttPort          = "port";
+static const char* const kMqttProtocol      = "protocol";
+static const char* const kMqttClientId      = "client_id";
+static const char* const kMqttUsername      = "username";
+static const char* const kMqttPassword      = "password";
+static const char* const kMqttTopicPrefix   = "topic_prefix";
+static const char* const kMqttKeepalive     = "keepalive";
+static const char* const kMqttCaFile        = "cafile";
+static const char* const kMqttSessionExpiry = "session_expiry";
+
+static const char* const kStatusGroup = "status";
+static const char* const kLastRun     = "last_run";
+static const char* const kLastError   = "last_error";
+
+static const char* const kTopicsGroup = "topics";
+static const char* const kTopicsKey   = "subscribed";
+
+static constexpr int kDefaultIntervalMinutes = 15;
+
+typedef std::vector<std::pair<std::string, std::string>> KeyValues;
+
+// ~/.config/notification_master
+std::string config_dir();
+// ~/.config/notification_master/poller.conf
+std::string config_path();
+// ~/.config/notification_master/poller.state
+std::string state_path();
+// ~/.config/notification_master/prefs.ini
+std::string prefs_path();
+// ~/.config/notification_master/poller.prom
+std::string metrics_path();
+// ~/.local/share/notification_master/history.log
+std::string history_path();
+// $XDG_RUNTIME_DIR/notification_master/handoff.ring
+std::string handoff_path();
+
+// Applies every (key, value) in |values| to |group| of the key file at |path|
+// and writes it back in ONE atomic replace. Existing keys not in |values| are
+// preserved. Returns false if the file could not be written.
+bool write_key_file(const std::string& path, const char* group,
+                    const KeyValues& values);
+
+// [mqtt] group of poller.conf.
+struct MqttConfig {
+  std::string host;
+  int port = 1883;
+  int protocol = 5;
+  std::string client_id;
+  std::string username;
+  std::string password;
+  std::string topic_prefix = "notification_master";
+  int keepalive = 60;
+  std::string cafile;
+  int session_expiry = 7 * 24 * 60 * 60;
+
+  bool operator==(const MqttConfig& o) const {
+    return host == o.host && port == o.port && protocol == o.protocol &&
+           client_id == o.client_id && username == o.username &&
+           password == o.password && topic_prefix == o.topic_prefix &&
+           keepalive == o.keepalive && cafile == o.cafile &&
+           session_expiry == o.session_expiry;
+  }
+  bool operator!=(const MqttConfig& o) const { return !(*this == o); }
+};
+
+// In-memory snapshot of poller.conf.
+struct PollerConfig {
+  std::string url;
+  int interval_minutes = kDefaultIntervalMinutes;
+  // Sub-minute override from $NM_LOADTEST_INTERVAL_SECONDS; 0 = unset.
+  int interval_seconds = 0;
+  bool enabled = true;
+  std::string transport = kTransportPoll;
+  std::string log_level;
+  std::string receipts_url;
+  // Hamming distance for near-duplicate suppression, 1..kMaxNearDuplicates;
+  // 0 = off.
+  int near_duplicates = 0;
+  MqttConfig mqtt;
+  // Subscribed topics from prefs.ini, used to scope requests and filter items.
+  std::vector<std::string> topics;
+  // Channels from prefs.ini: display policy and rate limit per channel.
+  std::vector<nm_channels::Channel> channels;
+  // Values load() ignored, one message each, for the daemon's log.
+  std::vector<std::string> warnings;
+
+  // Time between polls in seconds.
+  int poll_period_seconds() const {
+    return interval_seconds > 0 ? interval_seconds : interval_minutes * 60;
+  }
+};
+
+// Holds poller.conf in memory and reloads it only when inotify reports that
+// the file changed. Used by the daemon; the polling loop reads current()
+// instead of parsing the file on every cycle.
+class PollerConfigStore {
+ public:
+  // Reads poller.conf and prefs.ini from config_dir().
+  PollerConfigStore();
+  // Reads them from |dir| instead (tests).
+  explicit PollerConfigStore(std::string dir);
+  ~PollerConfigStore();
+
+  PollerConfigStore(const PollerConfigStore&) = delete;
+  PollerConfigStore& operator=(const PollerConfigStore&) = delete;
+
+  // Parses poller.conf (and the topics and channels from prefs.ini) into
+  // current(). A missing file yields the defaults.
+  void load();
+
+  const PollerConfig& current() const { return config_; }
+
+  // Starts watching the config directory. Returns false if inotify is not
+  // available; wait_for_change() then only sleeps, and the caller has to
+  // load() on its own schedule.
+  bool watch();
+
+  // Blocks for up to |timeout_ms| waiting for poller.conf or prefs.ini to
+  // change. Reloads and returns true if either did. Changes to other files
+  // in the directory are drained and the wait goes on.
+  bool wait_for_change(int timeout_ms);
+
+  // Stages a key for the next commit(). Nothing touches the disk until then.
+  void stage(const char* key, const std::string& value);
+
+  // Writes all staged keys in one atomic replace and updates current().
+  bool commit();
+
+ private:
+  bool drain_events();
+
+  const std::string dir_;
+  PollerConfig config_;
+  KeyValues staged_;
+  int inotify_fd_ = -1;
+  int watch_wd_ = -1;
+};
+
+}  // namespace nm_config
+
+#endif  // NM_POLLER_CONFIG_H_
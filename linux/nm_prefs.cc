@@ -0,0 +1,224 @@
+#include "nm_prefs.h"
+
+#include <glib/gstdio.h>
+
+#include "nm_poller_config.h"
+
+namespace nm_prefs {
+
+// The daemon reads the topic list too; keep the layout in one place.
+using nm_config::kTopicsGroup;
+using nm_config::kTopicsKey;
+
+static std::string default_prefs_path() { return nm_config::prefs_path(); }
+
+PrefsStore& PrefsStore::get() {
+  // Intentionally leaked: the write-behind timer may still reference it while
+  // the process tears down.
+  static PrefsStore* instance = new PrefsStore();
+  return *instance;
+}
+
+PrefsStore::PrefsStore() : path_(default_prefs_path()) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  load_locked();
+}
+
+void PrefsStore::load_locked() {
+  if (kf_) g_key_file_free(kf_);
+  kf_ = g_key_file_new();
+  g_key_file_load_from_file(kf_, path_.c_str(), G_KEY_FILE_KEEP_COMMENTS,
+                            nullptr);
+
+  topic_order_.clear();
+  topic_index_.clear();
+  gsize len = 0;
+  gchar** topics = g_key_file_get_string_list(kf_, kTopicsGroup, kTopicsKey,
+                                              &len, nullptr);
+  for (gsize i = 0; i < len; i++) {
+    std::string topic(topics[i]);
+    if (topic_index_.count(topic)) continue;
+    topic_order_.push_back(topic);
+    topic_index_[topic] = std::prev(topic_order_.end());
+  }
+  g_strfreev(topics);
+  dirty_ = false;
+}
+
+std::string PrefsStore::get_string(const char* group, const char* key,
+                                   const std::string& fallback) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  gchar* val = g_key_file_get_string(kf_, group, key, nullptr);
+  std::string result = val ? val : fallback;
+  g_free(val);
+  return result;
+}
+
+void PrefsStore::set_string(const char* group, const char* key,
+                            const std::string& value) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  gchar* current = g_key_file_get_string(kf_, group, key, nullptr);
+  bool changed = g_strcmp0(current, value.c_str()) != 0;
+  g_free(current);
+  if (!changed) return;
+  g_key_file_set_string(kf_, group, key, value.c_str());
+  mark_dirty_locked();
+}
+
+bool PrefsStore::has_topic(const std::string& topic) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return topic_index_.count(topic) != 0;
+}
+
+bool PrefsStore::add_topic_locked(const std::string& topic) {
+  if (topic_index_.count(topic)) return false;
+  topic_order_.push_back(topic);
+  topic_index_[topic] = std::prev(topic_order_.end());
+  return true;
+}
+
+bool PrefsStore::remove_topic_locked(const std::string& topic) {
+  auto it = topic_index_.find(topic);
+  if (it == topic_index_.end()) return false;
+  topic_order_.erase(it->second);
+  topic_index_.erase(it);
+  return true;
+}
+
+bool PrefsStore::add_topic(const std::string& topic) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!add_topic_locked(topic)) return false;
+  mark_dirty_locked();
+  return true;
+}
+
+bool PrefsStore::remove_topic(const std::string& topic) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!remove_topic_locked(topic)) return false;
+  mark_dirty_locked();
+  return true;
+}
+
+void PrefsStore::update_topics(const std::vector<std::string>& add,
+                               const std::vector<std::string>& remove,
+                               std::vector<std::string>* added,
+                               std::vector<std::string>* removed) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  bool changed = false;
+  for (const auto& t : remove) {
+    if (remove_topic_locked(t)) {
+      changed = true;
+      if (removed) removed->push_back(t);
+    }
+  }
+  for (const auto& t : add) {
+    if (add_topic_locked(t)) {
+      changed = true;
+      if (added) added->push_back(t);
+    }
+  }
+  if (changed) mark_dirty_locked();
+}
+
+void PrefsStore::set_topics(const std::vector<std::string>& topics,
+                            std::vector<std::string>* added,
+                            std::vector<std::string>* removed) {
+  std::unordered_set<std::string> wanted(topics.begin(), topics.end());
+  std::lock_guard<std::mutex> lk(mtx_);
+  bool changed = false;
+  for (auto it = topic_order_.begin(); it != topic_order_.end();) {
+    if (wanted.count(*it)) {
+      ++it;
+      continue;
+    }
+    if (removed) removed->push_back(*it);
+    topic_index_.erase(*it);
+    it = topic_order_.erase(it);
+    changed = true;
+  }
+  for (const auto& t : topics) {
+    if (add_topic_locked(t)) {
+      changed = true;
+      if (added) added->push_back(t);
+    }
+  }
+  if (changed) mark_dirty_locked();
+}
+
+std::vector<std::string> PrefsStore::topics() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return std::vector<std::string>(topic_order_.begin(), topic_order_.end());
+}
+
+void PrefsStore::put_channel(const nm_channels::Channel& channel) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  nm_channels::save(kf_, channel);
+  mark_dirty_locked();
+}
+
+std::vector<nm_channels::Channel> PrefsStore::channels() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return nm_channels::load_all(kf_);
+}
+
+void PrefsStore::mark_dirty_locked() {
+  dirty_ = true;
+  // One pending timer at a time: later mutations within the batch window
+  // ride along with the write that is already scheduled. It is deliberately
+  // not re-armed, which bounds how long a change can sit unwritten.
+  if (flush_source_ == 0) {
+    flush_source_ = g_timeout_add(kFlushDelayMs, flush_timeout_cb, this);
+  }
+}
+
+gboolean PrefsStore::flush_timeout_cb(gpointer user_data) {
+  auto* self = static_cast<PrefsStore*>(user_data);
+  std::lock_guard<std::mutex> lk(self->mtx_);
+  self->flush_source_ = 0;
+  self->write_locked();
+  return G_SOURCE_REMOVE;
+}
+
+bool PrefsStore::write_locked() {
+  if (!dirty_) return true;
+
+  std::vector<const gchar*> list;
+  list.reserve(topic_order_.size());
+  for (const auto& t : topic_order_) list.push_back(t.c_str());
+  g_key_file_set_string_list(kf_, kTopicsGroup, kTopicsKey, list.data(),
+                             list.size());
+
+  gchar* dir = g_path_get_dirname(path_.c_str());
+  g_mkdir_with_parents(dir, 0700);
+  g_free(dir);
+
+  gsize len = 0;
+  gchar* data = g_key_file_to_data(kf_, &len, nullptr);
+  // Atomic replace (temp file + rename): a crash mid-write never leaves a
+  // truncated prefs.ini behind.
+  gboolean ok = g_file_set_contents(path_.c_str(), data, (gssize)len, nullptr);
+  g_free(data);
+  if (ok) dirty_ = false;
+  return ok;
+}
+
+void PrefsStore::flush() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (flush_source_ != 0) {
+    g_source_remove(flush_source_);
+    flush_source_ = 0;
+  }
+  write_locked();
+}
+
+void PrefsStore::reset_for_testing(const std::string& path) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (flush_source_ != 0) {
+    g_source_remove(flush_source_);
+    flush_source_ = 0;
+  }
+  path_ = path;
+  load_locked();
+}
+
+}  // namespace nm_prefs
@@ -0,0 +1,97 @@
+#ifndef NM_PREFS_H_
+#define NM_PREFS_H_
+
+// Process-wide cache of ~/.config/notification_master/prefs.ini.
+//
+// The file is parsed once, on first use. Method-channel handlers then read and
+// mutate the in-memory copy only; every mutation marks the store dirty, and
+// the first one after a write arms a write-behind timer on the GLib main
+// context. Mutations made before it fires ride along, so a burst of topic
+// operations costs one disk write. The timer is not pushed back by later
+// mutations, so a steady stream of them still reaches the disk every
+// kFlushDelayMs. flush() writes
+// synchronously via write-to-temp + rename and is called on plugin dispose.
+//
+// Topics are kept in an insertion-ordered hashed set: membership, insert and
+// erase are O(1) and getSubscribedTopics still returns subscription order.
+//
+// Thread-safe: the polling thread and worker threads may read it too.
+
+#include <glib.h>
+
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "nm_channels.h"
+
+namespace nm_prefs {
+
+// Batch window of the write-behind timer, counted from the first mutation.
+static constexpr guint kFlushDelayMs = 500;
+
+class PrefsStore {
+ public:
+  // The process-wide instance. Loads prefs.ini on first call.
+  static PrefsStore& get();
+
+  // Returns |fallback| when the key is missing.
+  std::string get_string(const char* group, const char* key,
+                         const std::string& fallback = "");
+  void set_string(const char* group, const char* key, const std::string& value);
+
+  bool has_topic(const std::string& topic);
+  // Return true if the set actually changed.
+  bool add_topic(const std::string& topic);
+  bool remove_topic(const std::string& topic);
+  std::vector<std::string> topics();
+
+  // Bulk forms: the whole diff is applied under one lock and costs at most one
+  // write-behind. |added| / |removed| (optional) receive the topics that
+  // actually changed, in request order.
+  void update_topics(const std::vector<std::string>& add,
+                     const std::vector<std::string>& remove,
+                     std::vector<std::string>* added,
+                     std::vector<std::string>* removed);
+  // Replaces the subscription set with |topics| (set semantics: duplicates
+  // collapse, existing topics keep their position).
+  void set_topics(const std::vector<std::string>& topics,
+                  std::vector<std::string>* added,
+                  std::vector<std::string>* removed);
+
+  // Notification channels, stored as [channel:<id>] groups (nm_channels.h).
+  void put_channel(const nm_channels::Channel& channel);
+  std::vector<nm_channels::Channel> channels();
+
+  // Writes pending changes now and cancels the write-behind timer.
+  void flush();
+
+  // Drops the cache and re-reads |path| (tests and benchmarks only).
+  void reset_for_testing(const std::string& path);
+
+ private:
+  PrefsStore();
+
+  void load_locked();
+  bool add_topic_locked(const std::string& topic);
+  bool remove_topic_locked(const std::string& topic);
+  void mark_dirty_locked();
+  bool write_locked();
+  static gboolean flush_timeout_cb(gpointer user_data);
+
+  std::mutex mtx_;
+  std::string path_;
+  GKeyFile* kf_ = nullptr;
+  std::list<std::string> topic_order_;
+  std::unordered_map<std::string, std::list<std::string>::iterator> topic_index_;
+  bool dirty_ = false;
+  guint flush_source_ = 0;
+};
+
+}  // namespace nm_prefs
+
+#endif  // NM_PREFS_H_
@@ -0,0 +1,205 @@
+#include "nm_progress.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "nm_metrics.h"
+
+namespace nm_progress {
+
+static constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+
+Coalescer::Coalescer(GMainContext* context, nm_clock::Clock& clock, Sink sink)
+    : context_(context), clock_(clock), sink_(std::move(sink)) {}
+
+Coalescer::~Coalescer() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (timer_) {
+    g_source_destroy(timer_);
+    g_source_unref(timer_);
+    timer_ = nullptr;
+  }
+}
+
+bool Coalescer::start(const Update& update, int updates_per_second) {
+  int rate = updates_per_second < 1 ? 1 : updates_per_second;
+  if (rate > kMaxUpdatesPerSecond) rate = kMaxUpdatesPerSecond;
+  std::vector<Update> due;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = streams_.find(update.id);
+    if (it == streams_.end()) {
+      if (streams_.size() >= kMaxStreams) return false;
+      it = streams_.emplace(update.id, Stream()).first;
+    }
+    Stream& stream = it->second;
+    stream.interval_ms = 1000 / rate;
+    stream.finishing = false;
+    stream.cancelled = false;
+    stream.message.clear();
+    queue_locked(&stream, update);
+    collect_locked(&due);
+  }
+  deliver(due);
+  return true;
+}
+
+bool Coalescer::update(const Update& update) {
+  std::vector<Update> due;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = streams_.find(update.id);
+    if (it == streams_.end() || it->second.finishing ||
+        it->second.cancelled) {
+      return false;
+    }
+    queue_locked(&it->second, update);
+    collect_locked(&due);
+  }
+  deliver(due);
+  return true;
+}
+
+bool Coalescer::sent(int64_t id) {
+  std::vector<Update> due;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = streams_.find(id);
+    if (it == streams_.end()) return true;
+    Stream& stream = it->second;
+    if (stream.cancelled) {
+      streams_.erase(it);
+      return false;
+    }
+    stream.in_flight = false;
+    if (stream.finishing && !stream.has_pending) {
+      streams_.erase(it);
+    }
+    collect_locked(&due);
+  }
+  deliver(due);
+  return true;
+}
+
+bool Coalescer::cancel(int64_t id) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = streams_.find(id);
+  if (it == streams_.end()) return false;
+  cancel_locked(it);
+  return true;
+}
+
+void Coalescer::cancel_all() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  for (auto it = streams_.begin(); it != streams_.end();) cancel_locked(it++);
+}
+
+bool Coalescer::cancelled(int64_t id) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = streams_.find(id);
+  return it != streams_.end() && it->second.cancelled;
+}
+
+void Coalescer::cancel_locked(
+    std::unordered_map<int64_t, Stream>::iterator it) {
+  Stream& stream = it->second;
+  if (!stream.in_flight) {
+    streams_.erase(it);
+    return;
+  }
+  stream.pending = Update();
+  stream.has_pending = false;
+  stream.cancelled = true;
+}
+
+void Coalescer::tick() {
+  std::vector<Update> due;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    collect_locked(&due);
+  }
+  deliver(due);
+}
+
+size_t Coalescer::streams() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return streams_.size();
+}
+
+void Coalescer::queue_locked(Stream* stream, const Update& update) {
+  if (stream->has_pending) nm_metrics::global().progress_coalesced.inc();
+  stream->pending = update;
+  // An update without a title or message keeps the previous one.
+  if (update.title.empty()) {
+    stream->pending.title = stream->title;
+  } else {
+    stream->title = update.title;
+  }
+  if (update.message.empty()) {
+    stream->pending.message = stream->message;
+  } else {
+    stream->message = update.message;
+  }
+  stream->has_pending = true;
+  if (update.final) stream->finishing = true;
+}
+
+// Moves every update that is due to |due| (marking its stream in flight)
+// and arms the timer for the earliest one that is not.
+void Coalescer::collect_locked(std::vector<Update>* due) {
+  int64_t now = clock_.monotonic_ms();
+  int64_t next = kNever;
+  for (auto& entry : streams_) {
+    Stream& stream = entry.second;
+    if (!stream.has_pending || stream.in_flight) continue;
+    int64_t due_ms = stream.sent_before && !stream.pending.final
+                         ? stream.last_sent_ms + stream.interval_ms
+                         : now;
+    if (due_ms > now) {
+      next = std::min(next, due_ms);
+      continue;
+    }
+    due->push_back(std::move(stream.pending));
+    stream.pending = Update();
+    stream.has_pending = false;
+    stream.in_flight = true;
+    stream.sent_before = true;
+    stream.last_sent_ms = now;
+  }
+  if (next != kNever) arm_locked(next, now);
+}
+
+void Coalescer::arm_locked(int64_t due_ms, int64_t now_ms) {
+  if (!context_) return;
+  if (timer_) {
+    if (timer_due_ms_ <= due_ms) return;
+    g_source_destroy(timer_);
+    g_source_unref(timer_);
+  }
+  timer_ = g_timeout_source_new((guint)(due_ms - now_ms));
+  g_source_set_callback(timer_, timer_cb, this, nullptr);
+  g_source_attach(timer_, context_);
+  timer_due_ms_ = due_ms;
+}
+
+gboolean Coalescer::timer_cb(gpointer user_data) {
+  Coalescer* self = static_cast<Coalescer*>(user_data);
+  {
+    std::lock_guard<std::mutex> lk(self->mtx_);
+    // A worker may have swapped in an earlier timer meanwhile.
+    if (self->timer_ == g_main_current_source()) {
+      g_source_unref(self->timer_);
+      self->timer_ = nullptr;
+    }
+  }
+  self->tick();
+  return G_SOURCE_REMOVE;
+}
+
+// Outside the lock: the sink may call sent() right away.
+void Coalescer::deliver(const std::vector<Update>& due) {
+  for (const Update& update : due) sink_(update);
+}
+
+}  // namespace nm_progress
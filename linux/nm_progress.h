@@ -0,0 +1,129 @@
+#ifndef NM_PROGRESS_H_
+#define NM_PROGRESS_H_
+
+// Rate limiting for progress notifications (showProgressNotification /
+// updateProgress).
+//
+// Apps report download or sync progress as fast as it changes, often 60+
+// times a second. Each display is a synchronous D-Bus Notify, so showing
+// every report would flood the notification server and the worker lane.
+// The Coalescer keeps one stream per notification id:
+//
+//   - at most one update per id is handed to the sink per interval
+//     (1 / updates_per_second); reports in between replace the pending one,
+//     so the last value wins;
+//   - a stream never has two displays in flight: the next update waits for
+//     sent() from the previous one, so a slow server slows the stream down
+//     instead of queueing behind it;
+//   - the final update skips the interval, is shown exactly once, and ends
+//     the stream; later reports for the id are refused until it is started
+//     again;
+//   - cancel() ends the stream at once: the pending state is dropped, and a
+//     display still in flight is reported back by sent() so the caller can
+//     close what it showed.
+//
+// The first due time is armed as a timeout on |context|. Without a context
+// nothing is armed and the owner calls tick() (tests).
+//
+// Plugin-only (uses GLib main contexts).
+
+#include <glib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nm_clock.h"
+
+namespace nm_progress {
+
+struct Update {
+  int64_t id = 0;
+  std::string title;
+  std::string message;
+  int value = 0;       // percent, 0–100
+  bool final = false;  // the finished state; ends the stream
+};
+
+// Displays |update|, typically by posting to a worker, and calls
+// Coalescer::sent(update.id) once the display call has returned.
+typedef std::function<void(const Update& update)> Sink;
+
+class Coalescer {
+ public:
+  static constexpr int kDefaultUpdatesPerSecond = 5;
+  static constexpr int kMaxUpdatesPerSecond = 60;
+  static constexpr size_t kMaxStreams = 64;
+
+  Coalescer(GMainContext* context, nm_clock::Clock& clock, Sink sink);
+  ~Coalescer();
+
+  Coalescer(const Coalescer&) = delete;
+  Coalescer& operator=(const Coalescer&) = delete;
+
+  // Starts, or restarts, the stream for |update.id| with |update| as its
+  // first state, limited to |updates_per_second| (clamped to 1..60). False
+  // when kMaxStreams other streams are running.
+  bool start(const Update& update, int updates_per_second);
+
+  // Replaces the pending state of |update.id|; an empty title or message
+  // keeps the previous one. False when the id has no running stream (never
+  // started, or already finished).
+  bool update(const Update& update);
+
+  // The sink's display of |id| has returned. Thread-safe like the rest.
+  // False when the stream was cancelled meanwhile; what was shown should be
+  // closed.
+  bool sent(int64_t id);
+
+  // Ends the stream of |id| (cancelNotification). False when it had none.
+  bool cancel(int64_t id);
+  // Ends every stream (cancelAllNotifications).
+  void cancel_all();
+  // Whether |id|'s stream has been cancelled while a display is in flight;
+  // the sink checks it to skip displays that are no longer wanted.
+  bool cancelled(int64_t id) const;
+
+  // Hands every due update to the sink and re-arms the timer.
+  void tick();
+
+  size_t streams() const;
+
+ private:
+  struct Stream {
+    int64_t interval_ms = 0;
+    int64_t last_sent_ms = 0;
+    bool sent_before = false;
+    bool in_flight = false;
+    bool has_pending = false;
+    bool finishing = false;  // final state queued or in flight
+    bool cancelled = false;  // dropped once the display in flight returns
+    std::string title;
+    std::string message;
+    Update pending;
+  };
+
+  void queue_locked(Stream* stream, const Update& update);
+  // Ends |it|'s stream now, or at sent() when a display is in flight.
+  void cancel_locked(std::unordered_map<int64_t, Stream>::iterator it);
+  void collect_locked(std::vector<Update>* due);
+  void arm_locked(int64_t due_ms, int64_t now_ms);
+  void deliver(const std::vector<Update>& due);
+  static gboolean timer_cb(gpointer data);
+
+  GMainContext* context_;
+  nm_clock::Clock& clock_;
+  Sink sink_;
+  mutable std::mutex mtx_;
+  std::unordered_map<int64_t, Stream> streams_;
+  GSource* timer_ = nullptr;
+  int64_t timer_due_ms_ = 0;
+};
+
+}  // namespace nm_progress
+
+#endif  // NM_PROGRESS_H_
@@ -0,0 +1,123 @@
+#ifndef NM_RECEIPTS_H_
+#define NM_RECEIPTS_H_
+
+// Optional delivery receipts, shared by the plugin's polling thread and the
+// background poller daemon. When receipts_url is set in poller.conf, every
+// displayed item that has an "id" is queued here and the whole batch is
+// POSTed once per poll cycle (every 15 s in MQTT mode):
+//
+//   {"receipts": [{"id": "...", "topic": "...", "sentAt": 1700000000000,
+//                  "displayedAt": 1700000004200, "latencyMs": 4200}, ...]}
+//
+// sentAt is omitted when the item carried none. A failed POST is retried with
+// the next batch; the queue is capped at kMaxPending (oldest dropped).
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace nm_receipts {
+
+static constexpr size_t kMaxPending = 1000;
+
+struct Receipt {
+  std::string id;
+  std::string topic;
+  int64_t sent_at_ms = 0;
+  int64_t displayed_at_ms = 0;
+};
+
+inline void append_json_string(std::string* out, const std::string& s) {
+  out->push_back('"');
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"':  out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        if (c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          out->append(buf);
+        } else {
+          out->push_back((char)c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+class ReceiptQueue {
+ public:
+  void add(const Receipt& receipt) {
+    if (receipt.id.empty()) return;
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (pending_.size() >= kMaxPending) pending_.pop_front();
+    pending_.push_back(receipt);
+  }
+
+  bool empty() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return pending_.empty();
+  }
+
+  // Moves every pending receipt into a JSON body and returns how many were
+  // taken. Follow with commit() after a successful POST or restore() after a
+  // failed one.
+  size_t take_json(std::string* body) {
+    std::deque<Receipt> batch;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      batch.swap(pending_);
+    }
+    body->assign("{\"receipts\":[");
+    bool first = true;
+    for (const auto& r : batch) {
+      if (!first) body->push_back(',');
+      first = false;
+      body->append("{\"id\":");
+      append_json_string(body, r.id);
+      if (!r.topic.empty()) {
+        body->append(",\"topic\":");
+        append_json_string(body, r.topic);
+      }
+      if (r.sent_at_ms > 0) {
+        body->append(",\"sentAt\":" + std::to_string(r.sent_at_ms));
+        int64_t latency = r.displayed_at_ms - r.sent_at_ms;
+        body->append(",\"latencyMs\":" +
+                     std::to_string(latency < 0 ? 0 : latency));
+      }
+      body->append(",\"displayedAt\":" + std::to_string(r.displayed_at_ms));
+      body->push_back('}');
+    }
+    body->append("]}");
+    in_flight_ = std::move(batch);
+    return in_flight_.size();
+  }
+
+  // Puts the batch from the last take_json() back in front of the queue.
+  void restore() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    while (!in_flight_.empty() && pending_.size() < kMaxPending) {
+      pending_.push_front(in_flight_.back());
+      in_flight_.pop_back();
+    }
+    in_flight_.clear();
+  }
+
+  // Forgets the batch from the last take_json() after a successful POST.
+  void commit() { in_flight_.clear(); }
+
+ private:
+  std::mutex mtx_;
+  std::deque<Receipt> pending_;
+  std::deque<Receipt> in_flight_;  // owned by the sending thread
+};
+
+}  // namespace nm_receipts
+
+#endif  // NM_RECEIPTS_H_
@@ -0,0 +1,258 @@
+#include "nm_search.h"
+
+#include <glib.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace nm_search {
+
+namespace {
+
+// Records read from the history per Reader::scan() call.
+constexpr size_t kScanBatch = 512;
+
+// Scripts written without spaces between words.
+bool is_ideographic(gunichar c) {
+  switch (g_unichar_get_script(c)) {
+    case G_UNICODE_SCRIPT_HAN:
+    case G_UNICODE_SCRIPT_HIRAGANA:
+    case G_UNICODE_SCRIPT_KATAKANA:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Plain ASCII needs no normalisation; most notifications take this path.
+bool tokenize_ascii(const std::string& text, std::vector<std::string>* words) {
+  for (unsigned char c : text) {
+    if (c >= 0x80) return false;
+  }
+  std::string word;
+  for (unsigned char c : text) {
+    if (g_ascii_isalnum(c)) {
+      if (word.size() < kMaxWordBytes) word += g_ascii_tolower(c);
+    } else if (!word.empty()) {
+      words->push_back(word);
+      word.clear();
+    }
+  }
+  if (!word.empty()) words->push_back(word);
+  return true;
+}
+
+struct QueryWord {
+  std::string word;
+  bool prefix;
+};
+
+// Splits a query on spaces. The last word of the query, and every word
+// written with a trailing '*', also match as a prefix.
+std::vector<QueryWord> parse_query(const std::string& query) {
+  std::vector<QueryWord> words;
+  size_t start = 0;
+  while (start < query.size()) {
+    size_t end = query.find_first_of(" \t\n", start);
+    if (end == std::string::npos) end = query.size();
+    std::string raw = query.substr(start, end - start);
+    start = end + 1;
+    bool star = !raw.empty() && raw.back() == '*';
+    std::vector<std::string> tokens = tokenize(raw);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      words.push_back(QueryWord{tokens[i], star && i + 1 == tokens.size()});
+    }
+  }
+  if (!words.empty()) words.back().prefix = true;
+  return words;
+}
+
+}  // namespace
+
+std::vector<std::string> tokenize(const std::string& text) {
+  std::vector<std::string> words;
+  if (tokenize_ascii(text, &words)) return words;
+  gchar* valid = g_utf8_make_valid(text.data(), (gssize)text.size());
+  gchar* decomposed = g_utf8_normalize(valid, -1, G_NORMALIZE_NFKD);
+  gchar* folded = decomposed ? g_utf8_casefold(decomposed, -1) : nullptr;
+  std::string word;
+  auto flush = [&words, &word]() {
+    if (word.empty()) return;
+    words.push_back(word);
+    word.clear();
+  };
+  for (const gchar* p = folded; p && *p; p = g_utf8_next_char(p)) {
+    gunichar c = g_utf8_get_char(p);
+    if (g_unichar_ismark(c)) continue;  // accents split off by NFKD
+    if (!g_unichar_isalnum(c)) {
+      flush();
+      continue;
+    }
+    const gchar* next = g_utf8_next_char(p);
+    if (is_ideographic(c)) {
+      flush();
+      word.assign(p, next - p);
+      flush();
+      continue;
+    }
+    if (word.size() + (next - p) <= kMaxWordBytes) word.append(p, next - p);
+  }
+  flush();
+  g_free(folded);
+  g_free(decomposed);
+  g_free(valid);
+  return words;
+}
+
+// ── Index ───────────────────────────────────────────────────────────────────
+
+void Index::add(int64_t seq, const std::string& text) {
+  if (base_ < 0) base_ = seq;
+  uint32_t doc = (uint32_t)(seq - base_);
+  for (const std::string& word : tokenize(text)) {
+    Postings& postings = postings_[word];
+    if (postings.empty() || postings.back() != doc) postings.push_back(doc);
+  }
+  ++documents_;
+}
+
+std::vector<int64_t> Index::search(const std::string& query, size_t limit,
+                                   int64_t min_seq) const {
+  std::vector<int64_t> results;
+  if (base_ < 0 || limit == 0) return results;
+
+  // Each query word becomes the posting lists it matches: one for a whole
+  // word, every word in the range for a prefix.
+  struct Term {
+    std::vector<const Postings*> lists;
+    size_t total = 0;
+  };
+  std::vector<Term> terms;
+  for (const QueryWord& q : parse_query(query)) {
+    Term term;
+    if (q.prefix) {
+      for (auto it = postings_.lower_bound(q.word);
+           it != postings_.end() &&
+           it->first.compare(0, q.word.size(), q.word) == 0;
+           ++it) {
+        term.lists.push_back(&it->second);
+        term.total += it->second.size();
+      }
+    } else {
+      auto it = postings_.find(q.word);
+      if (it != postings_.end()) {
+        term.lists.push_back(&it->second);
+        term.total = it->second.size();
+      }
+    }
+    if (term.lists.empty()) return results;
+    terms.push_back(std::move(term));
+  }
+  if (terms.empty()) return results;
+  // Rarest first: it moves the candidate furthest per seek.
+  std::sort(terms.begin(), terms.end(), [](const Term& a, const Term& b) {
+    return a.total < b.total;
+  });
+
+  // The newest document at or below |bound| in any of |term|'s lists.
+  auto seek = [](const Term& term, int64_t bound) {
+    int64_t best = -1;
+    for (const Postings* list : term.lists) {
+      auto it = std::upper_bound(list->begin(), list->end(), (uint32_t)bound);
+      if (it != list->begin()) best = std::max(best, (int64_t)*(it - 1));
+    }
+    return best;
+  };
+
+  const int64_t min_doc = std::max<int64_t>(0, min_seq - base_);
+  int64_t candidate = std::numeric_limits<uint32_t>::max();
+  while (results.size() < limit && candidate >= min_doc) {
+    bool agreed = true;
+    for (const Term& term : terms) {
+      int64_t doc = seek(term, candidate);
+      if (doc < 0) return results;
+      if (doc < candidate) {
+        candidate = doc;
+        agreed = false;
+        break;
+      }
+    }
+    if (!agreed) continue;
+    if (candidate < min_doc) break;
+    results.push_back(base_ + candidate);
+    --candidate;
+  }
+  return results;
+}
+
+// ── Searcher ────────────────────────────────────────────────────────────────
+
+Searcher::Searcher(nm_history::Reader* reader) : reader_(reader) {}
+
+Searcher::~Searcher() {
+  std::lock_guard<std::mutex> lk(thread_mtx_);
+  if (indexer_.joinable()) indexer_.join();
+}
+
+void Searcher::update() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  reader_->refresh();
+  const int64_t first = reader_->first_seq();
+  const int64_t end = reader_->end_seq();
+  bool rebuild = !index_ || end < next_seq_ ||
+                 (index_->documents() > 0 &&
+                  first - index_->first_seq() >
+                      (int64_t)index_->documents() / 2);
+  if (rebuild) {
+    index_.reset(new Index());
+    next_seq_ = first;
+  }
+  // Only decoding happens under the Reader's lock; tokenising does not.
+  std::vector<std::pair<int64_t, std::string>> batch;
+  for (;;) {
+    batch.clear();
+    next_seq_ = reader_->scan(
+        next_seq_, kScanBatch, [&batch](const nm_history::Record& r) {
+          batch.emplace_back(r.seq,
+                             r.title + '\n' + r.message + '\n' + r.big_text);
+        });
+    if (batch.empty()) break;
+    for (const auto& document : batch) {
+      index_->add(document.first, document.second);
+    }
+  }
+}
+
+void Searcher::update_in_background() {
+  std::lock_guard<std::mutex> lk(thread_mtx_);
+  if (indexer_.joinable()) {
+    if (indexing_.load()) return;
+    indexer_.join();
+  }
+  indexing_ = true;
+  indexer_ = std::thread([this] {
+    pthread_setname_np(pthread_self(), "nm-search");
+    update();
+    indexing_ = false;
+  });
+}
+
+std::vector<nm_history::Record> Searcher::search(const std::string& query,
+                                                 size_t limit) {
+  update();
+  std::vector<nm_history::Record> records;
+  std::vector<int64_t> seqs;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    seqs = index_->search(query, limit, reader_->first_seq());
+  }
+  for (int64_t seq : seqs) {
+    nm_history::Record record;
+    if (reader_->get(seq, &record)) records.push_back(std::move(record));
+  }
+  return records;
+}
+
+}  // namespace nm_search
@@ -0,0 +1,108 @@
+#ifndef NM_SEARCH_H_
+#define NM_SEARCH_H_
+
+// Full-text search over the display history (nm_history.h), for
+// searchNotifications.
+//
+// Text is split into words with Unicode rules. It is NFKD-normalised with
+// combining marks dropped, then case-folded, so "Café" and "CAFE" match.
+// Words are runs of letters and digits in any script. Han, Hiragana and
+// Katakana characters are words of their own, since those scripts do not
+// separate words with spaces.
+//
+// A query matches records holding all of its words. The last word, and any
+// word ending in '*', also matches as a prefix ("deploy fail" finds
+// "Deploy failed"). Results are ranked by recency: each word's posting list
+// is ordered by seq, and a leapfrog intersection walks them from the newest
+// end, so a query only touches the lists around its first |limit| hits.
+//
+// Searcher keeps an Index of each record's title, message and big_text in
+// step with a history Reader. update_in_background() indexes the existing
+// history on a thread of its own (the plugin starts it at registration), so
+// a search only adds the records appended since. Records are read in
+// batches and tokenised outside the Reader's lock, so history queries keep
+// running meanwhile. The display path only appends to the log.
+//
+// Plugin-only. Thread-safe.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nm_history.h"
+
+namespace nm_search {
+
+// Longer words are cut to this many bytes.
+static constexpr size_t kMaxWordBytes = 64;
+
+// The folded words of |text|, in order.
+std::vector<std::string> tokenize(const std::string& text);
+
+class Index {
+ public:
+  // Adds the words of |text| as document |seq|. Seqs must increase.
+  void add(int64_t seq, const std::string& text);
+
+  // Seqs (at least |min_seq|) of the newest |limit| documents matching
+  // |query|, newest first.
+  std::vector<int64_t> search(const std::string& query, size_t limit,
+                              int64_t min_seq = 0) const;
+
+  size_t documents() const { return documents_; }
+  size_t words() const { return postings_.size(); }
+  int64_t first_seq() const { return base_; }
+
+ private:
+  // Documents are stored relative to the first seq added.
+  typedef std::vector<uint32_t> Postings;
+
+  int64_t base_ = -1;
+  size_t documents_ = 0;
+  // Sorted, so a prefix is one contiguous range.
+  std::map<std::string, Postings> postings_;
+};
+
+class Searcher {
+ public:
+  // |reader| is not owned and must outlive the Searcher.
+  explicit Searcher(nm_history::Reader* reader);
+  // Waits for a background update.
+  ~Searcher();
+
+  Searcher(const Searcher&) = delete;
+  Searcher& operator=(const Searcher&) = delete;
+
+  // Indexes the records appended since the last call. Rebuilds the index
+  // when compaction has dropped more than half of it, or when the log was
+  // replaced by a shorter one.
+  void update();
+
+  // Runs update() on a thread of its own; does nothing while one is still
+  // running. A search meanwhile waits for it rather than indexing again.
+  void update_in_background();
+
+  // The newest |limit| records matching |query|, after update().
+  std::vector<nm_history::Record> search(const std::string& query,
+                                         size_t limit);
+
+ private:
+  nm_history::Reader* const reader_;
+  std::mutex mtx_;
+  std::unique_ptr<Index> index_;
+  int64_t next_seq_ = 0;
+
+  std::mutex thread_mtx_;
+  std::thread indexer_;
+  std::atomic<bool> indexing_{false};
+};
+
+}  // namespace nm_search
+
+#endif  // NM_SEARCH_H_
@@ -0,0 +1,235 @@
+#ifndef NM_SIMHASH_H_
+#define NM_SIMHASH_H_
+
+// Near-duplicate suppression for the background poller daemon, the optional
+// stage after DedupeCache (nm_dedupe.h). Feeds often repeat one event with a
+// changing counter or timestamp ("Build 1841 failed at 10:02", "Build 1842
+// failed at 10:07"), which exact dedupe lets through every time.
+//
+// Each notification gets a 64-bit SimHash over its words and word pairs,
+// with ASCII case folded and every digit run read as one placeholder, so
+// counters and times do not move the fingerprint at all and a changed word
+// moves only a few bits. A new fingerprint within max_distance bits
+// (Hamming) of one shown inside the window is suppressed.
+//
+// The index splits fingerprints into kBands 8-bit bands and buckets every
+// entry under each band. Two fingerprints at most kMaxDistance bits apart
+// agree on at least one whole band, so a lookup only compares the entries in
+// its own kBands buckets instead of the whole window. Memory is bounded like
+// DedupeCache: max_entries fingerprints at most, the oldest (or expired) go
+// first.
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nm_clock.h"
+#include "nm_dedupe.h"
+
+namespace nm_dedupe {
+
+// Hamming distance between two fingerprints.
+inline int hamming_distance(uint64_t a, uint64_t b) {
+  return __builtin_popcountll(a ^ b);
+}
+
+namespace simhash_internal {
+
+// FNV-1a, then the splitmix64 finaliser so that short features still set
+// about half of the 64 bits.
+inline uint64_t feature_hash(const std::string& feature) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (unsigned char c : feature) {
+    h ^= c;
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+inline void add_feature(const std::string& feature, int weights[64]) {
+  uint64_t h = feature_hash(feature);
+  for (int bit = 0; bit < 64; ++bit) {
+    weights[bit] += (h >> bit) & 1 ? 1 : -1;
+  }
+}
+
+}  // namespace simhash_internal
+
+// SimHash of |text| (the daemon passes title + '\n' + body). Words are runs
+// of letters, digits and non-ASCII bytes; everything else separates them.
+inline uint64_t simhash(const std::string& text) {
+  int weights[64] = {0};
+  std::string previous;
+  std::string word;
+  bool in_digits = false;
+  auto flush = [&]() {
+    if (word.empty()) return;
+    simhash_internal::add_feature(word, weights);
+    if (!previous.empty()) {
+      simhash_internal::add_feature(previous + ' ' + word, weights);
+    }
+    previous.swap(word);
+    word.clear();
+  };
+  for (unsigned char c : text) {
+    if (c >= '0' && c <= '9') {
+      if (!in_digits) word += '0';
+      in_digits = true;
+      continue;
+    }
+    in_digits = false;
+    if (c >= 'A' && c <= 'Z') {
+      word += (char)(c - 'A' + 'a');
+    } else if ((c >= 'a' && c <= 'z') || c >= 0x80) {
+      word += (char)c;
+    } else {
+      flush();
+    }
+  }
+  flush();
+  uint64_t fingerprint = 0;
+  for (int bit = 0; bit < 64; ++bit) {
+    if (weights[bit] > 0) fingerprint |= 1ULL << bit;
+  }
+  return fingerprint;
+}
+
+class NearDuplicateIndex {
+ public:
+  static constexpr int kBands = 8;
+  static constexpr int kMaxDistance = kBands - 1;
+
+  // |clock| (not owned) defaults to nm_clock::get() at each call.
+  explicit NearDuplicateIndex(long long window_ms,
+                              size_t max_entries = kDefaultMaxEntries,
+                              nm_clock::Clock* clock = nullptr)
+      : window_ms_(window_ms),
+        capacity_(max_entries ? max_entries : 1),
+        clock_(clock) {}
+
+  // True (and |fingerprint| is remembered as shown now) unless one within
+  // |max_distance| bits (larger values count as kMaxDistance; the daemon's
+  // config loader rejects them) was shown less than window_ms ago. Suppressed
+  // fingerprints are not remembered, so a slowly drifting message is
+  // compared against what the user actually saw.
+  bool should_show(uint64_t fingerprint, int max_distance) {
+    long long now = (clock_ ? *clock_ : nm_clock::get()).monotonic_ms();
+    std::lock_guard<std::mutex> lk(mtx_);
+    prune_locked(now);
+    if (seen_locked(fingerprint, max_distance)) return false;
+    remember_locked(fingerprint, now);
+    return true;
+  }
+
+  bool should_show(const std::string& text, int max_distance) {
+    return should_show(simhash(text), max_distance);
+  }
+
+  // Whether one within |max_distance| bits of |fingerprint| was shown less
+  // than window_ms ago. Nothing is remembered; the daemon calls remember()
+  // only once the notification is on screen, so rate-limited and failed
+  // ones never suppress a later copy.
+  bool seen(uint64_t fingerprint, int max_distance) {
+    long long now = (clock_ ? *clock_ : nm_clock::get()).monotonic_ms();
+    std::lock_guard<std::mutex> lk(mtx_);
+    prune_locked(now);
+    return seen_locked(fingerprint, max_distance);
+  }
+
+  // Remembers |fingerprint| as shown now.
+  void remember(uint64_t fingerprint) {
+    long long now = (clock_ ? *clock_ : nm_clock::get()).monotonic_ms();
+    std::lock_guard<std::mutex> lk(mtx_);
+    prune_locked(now);
+    remember_locked(fingerprint, now);
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return count_;
+  }
+
+ private:
+  struct Entry {
+    uint64_t fingerprint;
+    long long shown_at;
+  };
+
+  static uint32_t bucket_key(uint64_t fingerprint, int band) {
+    return (uint32_t)band << 8 |
+           (uint32_t)(fingerprint >> (band * 8) & 0xff);
+  }
+
+  bool seen_locked(uint64_t fingerprint, int max_distance) {
+    if (max_distance > kMaxDistance) max_distance = kMaxDistance;
+    if (max_distance < 0) return false;
+    for (int band = 0; band < kBands; ++band) {
+      auto it = buckets_.find(bucket_key(fingerprint, band));
+      if (it == buckets_.end()) continue;
+      for (uint32_t slot : it->second) {
+        if (hamming_distance(ring_[slot].fingerprint, fingerprint) <=
+            max_distance) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  void remember_locked(uint64_t fingerprint, long long now) {
+    if (count_ == capacity_) evict_oldest_locked();
+    if (ring_.size() < capacity_) ring_.resize(ring_.size() + 1);
+    uint32_t slot = (uint32_t)((head_ + count_) % capacity_);
+    ring_[slot] = Entry{fingerprint, now};
+    ++count_;
+    for (int band = 0; band < kBands; ++band) {
+      buckets_[bucket_key(fingerprint, band)].push_back(slot);
+    }
+  }
+
+  // |ring_| is in show order from |head_|, so expired entries come first.
+  void prune_locked(long long now) {
+    while (count_ && now - ring_[head_].shown_at >= window_ms_) {
+      evict_oldest_locked();
+    }
+  }
+
+  void evict_oldest_locked() {
+    uint32_t slot = (uint32_t)head_;
+    for (int band = 0; band < kBands; ++band) {
+      auto it = buckets_.find(bucket_key(ring_[slot].fingerprint, band));
+      std::vector<uint32_t>& slots = it->second;
+      for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i] != slot) continue;
+        slots[i] = slots.back();
+        slots.pop_back();
+        break;
+      }
+      if (slots.empty()) buckets_.erase(it);
+    }
+    head_ = (head_ + 1) % capacity_;
+    --count_;
+  }
+
+  const long long window_ms_;
+  const size_t capacity_;
+  nm_clock::Clock* const clock_;
+  std::mutex mtx_;
+  std::vector<Entry> ring_;  // grows up to capacity_, then wraps
+  size_t head_ = 0;
+  size_t count_ = 0;
+  // (band << 8 | band value) -> ring slots holding that band value.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> buckets_;
+};
+
+}  // namespace nm_dedupe
+
+#endif  // NM_SIMHASH_H_
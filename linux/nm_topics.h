@@ -0,0 +1,184 @@
+#ifndef NM_TOPICS_H_
+#define NM_TOPICS_H_
+
+// Topic scoping shared by the plugin's polling thread and the background
+// poller daemon.
+//
+// Request side: the subscribed set is sent as a `topics=a,b,c` query
+// parameter (sorted, percent-encoded) while it stays under
+// kMaxTopicsQueryLength, and always as an X-NM-Topics-Hash header carrying a
+// stable 64-bit FNV-1a hash of the sorted set, so servers can cache per set
+// or look up large sets registered out of band.
+//
+// Response side: TopicMatcher drops items whose "topic" is not subscribed.
+// Patterns are exact ("alerts.build") or end in a ".*" wildcard segment
+// ("alerts.*" matches "alerts.build" and "alerts.build.linux"); a lone "*"
+// matches everything. Items without a topic are broadcasts and always pass,
+// as does everything when nothing is subscribed.
+//
+// Broker side (MQTT transport): app topics map onto a topic tree under a
+// prefix, one level per dot — "alerts.build" is "<prefix>/alerts/build",
+// "alerts.*" subscribes "<prefix>/alerts/#" and "*" (or an empty set)
+// "<prefix>/#". Broadcasts are published to "<prefix>" itself.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace nm_topics {
+
+static const char* const kTopicsQueryParam = "topics";
+static const char* const kTopicsHashHeader = "X-NM-Topics-Hash";
+static constexpr size_t kMaxTopicsQueryLength = 1024;
+
+class TopicMatcher {
+ public:
+  TopicMatcher() = default;
+  explicit TopicMatcher(const std::vector<std::string>& patterns) {
+    assign(patterns);
+  }
+
+  void assign(const std::vector<std::string>& patterns) {
+    exact_.clear();
+    prefixes_.clear();
+    match_all_ = false;
+    for (const auto& p : patterns) {
+      if (p == "*") {
+        match_all_ = true;
+      } else if (p.size() > 2 && p.compare(p.size() - 2, 2, ".*") == 0) {
+        prefixes_.insert(p.substr(0, p.size() - 2));
+      } else if (!p.empty()) {
+        exact_.insert(p);
+      }
+    }
+  }
+
+  // True when no topic filter applies (nothing subscribed).
+  bool empty() const {
+    return !match_all_ && exact_.empty() && prefixes_.empty();
+  }
+
+  // One hash lookup per dot-separated level of |topic|, independent of how
+  // many patterns are subscribed.
+  bool matches(const std::string& topic) const {
+    if (topic.empty() || empty() || match_all_) return true;
+    if (exact_.count(topic)) return true;
+    if (prefixes_.empty()) return false;
+    for (size_t dot = topic.find('.'); dot != std::string::npos;
+         dot = topic.find('.', dot + 1)) {
+      if (prefixes_.count(topic.substr(0, dot))) return true;
+    }
+    return false;
+  }
+
+ private:
+  std::unordered_set<std::string> exact_;
+  std::unordered_set<std::string> prefixes_;
+  bool match_all_ = false;
+};
+
+inline std::vector<std::string> sorted_unique(std::vector<std::string> topics) {
+  std::sort(topics.begin(), topics.end());
+  topics.erase(std::unique(topics.begin(), topics.end()), topics.end());
+  return topics;
+}
+
+// Stable across processes and platforms: FNV-1a 64 over the sorted topics,
+// each terminated by '\n'. Returned as 16 lowercase hex digits.
+inline std::string topic_set_hash(const std::vector<std::string>& topics) {
+  uint64_t h = 1469598103934665603ULL;
+  for (const auto& t : sorted_unique(topics)) {
+    for (unsigned char c : t) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    h ^= '\n';
+    h *= 1099511628211ULL;
+  }
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+  return buf;
+}
+
+inline std::string percent_encode(const std::string& s) {
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string out;
+  out.reserve(s.size());
+  for (unsigned char c : s) {
+    bool unreserved = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+                      (c >= '0' && c <= '9') || c == '-' || c == '_' ||
+                      c == '.' || c == '~' || c == '*';
+    if (unreserved) {
+      out += (char)c;
+    } else {
+      out += '%';
+      out += kHex[c >> 4];
+      out += kHex[c & 0xF];
+    }
+  }
+  return out;
+}
+
+// Returns |url| with `topics=` appended, or |url| unchanged when there are no
+// topics or the encoded list would exceed kMaxTopicsQueryLength (the hash
+// header still identifies the set in that case).
+inline std::string scoped_url(const std::string& url,
+                              const std::vector<std::string>& topics) {
+  if (topics.empty()) return url;
+  std::string value;
+  for (const auto& t : sorted_unique(topics)) {
+    if (!value.empty()) value += ",";
+    value += percent_encode(t);
+  }
+  if (value.size() > kMaxTopicsQueryLength) return url;
+  size_t hash_pos = url.find('#');
+  std::string base = url.substr(0, hash_pos);
+  std::string fragment = hash_pos == std::string::npos ? "" : url.substr(hash_pos);
+  base += base.find('?') == std::string::npos ? '?' : '&';
+  return base + kTopicsQueryParam + "=" + value + fragment;
+}
+
+// Maps one subscription pattern to an MQTT topic filter under |prefix|.
+// Returns "" for names that cannot be expressed (containing '/', '+', '#').
+inline std::string broker_filter(const std::string& prefix,
+                                 const std::string& pattern) {
+  if (pattern == "*") return prefix + "/#";
+  std::string name = pattern;
+  bool wildcard = name.size() > 2 && name.compare(name.size() - 2, 2, ".*") == 0;
+  if (wildcard) name.resize(name.size() - 2);
+  if (name.empty() || name.find_first_of("/+#") != std::string::npos) return "";
+  std::replace(name.begin(), name.end(), '.', '/');
+  return prefix + "/" + name + (wildcard ? "/#" : "");
+}
+
+// The full filter set for |topics|: the broadcast topic plus one filter per
+// pattern, or everything under |prefix| when nothing is subscribed.
+inline std::vector<std::string> broker_filters(
+    const std::string& prefix, const std::vector<std::string>& topics) {
+  if (topics.empty()) return {prefix + "/#"};
+  std::vector<std::string> filters = {prefix};
+  for (const auto& t : sorted_unique(topics)) {
+    std::string f = broker_filter(prefix, t);
+    if (!f.empty()) filters.push_back(f);
+  }
+  return sorted_unique(filters);
+}
+
+// Inverse of broker_filter() for a concrete topic name: "<prefix>/a/b" is
+// "a.b" and "<prefix>" itself is "" (a broadcast).
+inline std::string topic_from_broker(const std::string& prefix,
+                                     const std::string& broker_topic) {
+  if (broker_topic.compare(0, prefix.size(), prefix) != 0) return broker_topic;
+  std::string rest = broker_topic.substr(prefix.size());
+  if (!rest.empty() && rest[0] != '/') return broker_topic;
+  if (!rest.empty()) rest.erase(0, 1);
+  std::replace(rest.begin(), rest.end(), '/', '.');
+  return rest;
+}
+
+}  // namespace nm_topics
+
+#endif  // NM_TOPICS_H_
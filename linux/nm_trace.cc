@@ -0,0 +1,251 @@
+#include "nm_trace.h"
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nm_trace {
+
+static_assert((kEventsPerThread & (kEventsPerThread - 1)) == 0,
+              "kEventsPerThread must be a power of two");
+
+namespace internal {
+std::atomic<bool> g_enabled{false};
+}  // namespace internal
+
+namespace {
+
+struct Event {
+  const char* name;
+  const char* category;
+  const char* arg_name;
+  uint64_t start_ns;
+  uint64_t duration_ns;
+  int64_t arg;
+};
+
+// Single writer (the owning thread); dump() reads it concurrently and uses
+// |head| to discard slots that may have been overwritten while copying.
+struct ThreadBuffer {
+  long tid = 0;
+  char name[32] = {};
+  std::atomic<uint64_t> head{0};
+  Event events[kEventsPerThread];
+};
+
+std::mutex g_registry_mtx;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+// Buffers of exited threads, handed to the next new thread. Their events
+// stay in dumps until then.
+std::vector<ThreadBuffer*> g_free_buffers;
+// Threads that traced while all kMaxThreads buffers were taken.
+uint64_t g_dropped_threads = 0;
+std::string g_output_dir;
+std::string g_process = "process";
+
+// Plain thread_locals stay readable during thread exit, so spans recorded by
+// other thread_local destructors see a null buffer rather than a freed one.
+thread_local ThreadBuffer* t_buffer = nullptr;
+thread_local bool t_registered = false;
+
+// Returns the thread's buffer to g_free_buffers when the thread exits.
+struct BufferRelease {
+  ~BufferRelease() {
+    if (!t_buffer) return;
+    std::lock_guard<std::mutex> lk(g_registry_mtx);
+    g_free_buffers.push_back(t_buffer);
+    t_buffer = nullptr;
+  }
+};
+
+ThreadBuffer* this_thread_buffer() {
+  if (!t_registered) {
+    t_registered = true;
+    std::lock_guard<std::mutex> lk(g_registry_mtx);
+    ThreadBuffer* buffer = nullptr;
+    if (!g_free_buffers.empty()) {
+      buffer = g_free_buffers.back();
+      g_free_buffers.pop_back();
+      buffer->name[0] = '\0';
+      buffer->head.store(0, std::memory_order_relaxed);
+    } else if (g_buffers.size() < kMaxThreads) {
+      g_buffers.emplace_back(new ThreadBuffer());
+      buffer = g_buffers.back().get();
+    } else {
+      g_dropped_threads++;
+      return nullptr;
+    }
+    buffer->tid = (long)syscall(SYS_gettid);
+    t_buffer = buffer;
+    thread_local BufferRelease release;
+    (void)release;
+  }
+  return t_buffer;
+}
+
+void append_escaped(std::string* out, const char* s) {
+  for (; s && *s; ++s) {
+    if (*s == '"' || *s == '\\') out->push_back('\\');
+    if ((unsigned char)*s >= 0x20) out->push_back(*s);
+  }
+}
+
+}  // namespace
+
+bool init_from_env(const char* process) {
+  const char* value = getenv("NM_TRACE");
+  if (!value || !*value || strcmp(value, "0") == 0) return false;
+  {
+    std::lock_guard<std::mutex> lk(g_registry_mtx);
+    g_process = process;
+    if (strcmp(value, "1") == 0) {
+      const char* tmp = getenv("TMPDIR");
+      g_output_dir = tmp && *tmp ? tmp : "/tmp";
+    } else {
+      g_output_dir = value;
+    }
+  }
+  set_enabled(true);
+  return true;
+}
+
+void set_enabled(bool on) {
+  internal::g_enabled.store(on, std::memory_order_relaxed);
+}
+
+void set_thread_name(const char* name) {
+  ThreadBuffer* buffer = this_thread_buffer();
+  if (!buffer) return;
+  std::lock_guard<std::mutex> lk(g_registry_mtx);
+  snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void record(const char* name, const char* category, uint64_t start_ns,
+            uint64_t duration_ns, const char* arg_name, int64_t arg) {
+  if (!enabled()) return;
+  ThreadBuffer* buffer = this_thread_buffer();
+  if (!buffer) return;
+  uint64_t h = buffer->head.load(std::memory_order_relaxed);
+  Event& e = buffer->events[h & (kEventsPerThread - 1)];
+  e.name = name;
+  e.category = category;
+  e.arg_name = arg_name;
+  e.start_ns = start_ns;
+  e.duration_ns = duration_ns;
+  e.arg = arg;
+  buffer->head.store(h + 1, std::memory_order_release);
+}
+
+bool dump_to(const std::string& path) {
+  std::string out;
+  out.reserve(256 * 1024);
+  out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const long pid = (long)getpid();
+  bool first = true;
+  char buf[160];
+
+  std::lock_guard<std::mutex> lk(g_registry_mtx);
+  snprintf(buf, sizeof(buf),
+           "{\"ph\":\"M\",\"pid\":%ld,\"name\":\"process_name\","
+           "\"args\":{\"name\":\"",
+           pid);
+  out.append(buf);
+  append_escaped(&out, ("notification_master " + g_process).c_str());
+  out.append("\"}}");
+  first = false;
+
+  std::vector<Event> copy;
+  for (const auto& buffer : g_buffers) {
+    if (buffer->name[0]) {
+      snprintf(buf, sizeof(buf),
+               ",{\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"name\":\"thread_name\","
+               "\"args\":{\"name\":\"",
+               pid, buffer->tid);
+      out.append(buf);
+      append_escaped(&out, buffer->name);
+      out.append("\"}}");
+    }
+
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    uint64_t begin = head > kEventsPerThread ? head - kEventsPerThread : 0;
+    copy.assign(kEventsPerThread, Event());
+    for (uint64_t i = begin; i < head; i++) {
+      copy[i & (kEventsPerThread - 1)] =
+          buffer->events[i & (kEventsPerThread - 1)];
+    }
+    // Slots the writer reused while we copied are no longer trustworthy.
+    uint64_t head_after = buffer->head.load(std::memory_order_acquire);
+    if (head_after > kEventsPerThread &&
+        head_after - kEventsPerThread > begin) {
+      begin = head_after - kEventsPerThread;
+    }
+
+    for (uint64_t i = begin; i < head; i++) {
+      const Event& e = copy[i & (kEventsPerThread - 1)];
+      if (!e.name) continue;
+      if (!first) out.push_back(',');
+      first = false;
+      snprintf(buf, sizeof(buf),
+               "{\"ph\":\"X\",\"pid\":%ld,\"tid\":%ld,\"ts\":%.3f,"
+               "\"dur\":%.3f,\"name\":\"",
+               pid, buffer->tid, (double)e.start_ns / 1000.0,
+               (double)e.duration_ns / 1000.0);
+      out.append(buf);
+      append_escaped(&out, e.name);
+      out.append("\",\"cat\":\"");
+      append_escaped(&out, e.category);
+      out.push_back('"');
+      if (e.arg_name) {
+        out.append(",\"args\":{\"");
+        append_escaped(&out, e.arg_name);
+        snprintf(buf, sizeof(buf), "\":%lld}", (long long)e.arg);
+        out.append(buf);
+      }
+      out.push_back('}');
+    }
+  }
+  out.append("]");
+  if (g_dropped_threads > 0) {
+    snprintf(buf, sizeof(buf), ",\"otherData\":{\"dropped_threads\":%llu}",
+             (unsigned long long)g_dropped_threads);
+    out.append(buf);
+  }
+  out.append("}\n");
+
+  std::string tmp = path + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "w");
+  if (!f) return false;
+  bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+  ok = fclose(f) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string dump() {
+  if (!enabled()) return "";
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lk(g_registry_mtx);
+    path = g_output_dir + "/notification_master-" + g_process + "-" +
+           std::to_string((long)getpid()) + ".json";
+  }
+  return dump_to(path) ? path : "";
+}
+
+}  // namespace nm_trace
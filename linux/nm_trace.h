@@ -0,0 +1,97 @@
+#ifndef NM_TRACE_H_
+#define NM_TRACE_H_
+
+// Opt-in span tracing for the notification pipeline, exported as Chrome trace
+// JSON (chrome://tracing, https://ui.perfetto.dev). Used by BOTH the plugin and
+// the background poller daemon.
+//
+// Enable by setting NM_TRACE in the environment (the daemon inherits it from
+// the app): NM_TRACE=1 writes to $TMPDIR (or /tmp), any other value names the
+// output directory. Files are notification_master-<process>-<pid>.json and are
+// written by dump() — on exit, on SIGUSR1 (daemon) or via dumpTrace (plugin).
+//
+// Recording is lock-free: each thread appends to its own fixed-size ring
+// (kEventsPerThread, oldest overwritten), registered once per thread. At most
+// kMaxThreads rings exist; an exited thread's ring is reused by the next new
+// thread, and threads beyond the limit are not traced but counted as
+// otherData.dropped_threads in the dump. With tracing off a span costs one
+// relaxed atomic load; with it on, two CLOCK_MONOTONIC reads and a 40-byte
+// store, so it can stay on in canaries.
+//
+// Span names and categories must be string literals (only the pointer is
+// stored).
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace nm_trace {
+
+static constexpr size_t kEventsPerThread = 8192;  // power of two
+static constexpr size_t kMaxThreads = 64;
+
+namespace internal {
+extern std::atomic<bool> g_enabled;
+}  // namespace internal
+
+inline bool enabled() {
+  return internal::g_enabled.load(std::memory_order_relaxed);
+}
+
+// Enables tracing when NM_TRACE is set. |process| names the output file.
+bool init_from_env(const char* process);
+void set_enabled(bool on);
+
+// Names the calling thread in the trace viewer.
+void set_thread_name(const char* name);
+
+// CLOCK_MONOTONIC in nanoseconds (same base as g_get_monotonic_time()).
+uint64_t now_ns();
+
+// Records a finished span. |arg_name| (a literal) with |arg| is shown in the
+// viewer's detail pane when non-null.
+void record(const char* name, const char* category, uint64_t start_ns,
+            uint64_t duration_ns, const char* arg_name = nullptr,
+            int64_t arg = 0);
+
+// Writes every thread's events to the file named in the header comment and
+// returns its path ("" when tracing is off or the write failed). Events are
+// kept, so later dumps are supersets within each ring's window.
+std::string dump();
+bool dump_to(const std::string& path);
+
+// RAII span: begins on construction, recorded on destruction.
+class Span {
+ public:
+  Span(const char* name, const char* category)
+      : name_(name), category_(category), start_(enabled() ? now_ns() : 0) {}
+  ~Span() {
+    if (start_ != 0) {
+      record(name_, category_, start_, now_ns() - start_, arg_name_, arg_);
+    }
+  }
+  void set_arg(const char* name, int64_t value) {
+    arg_name_ = name;
+    arg_ = value;
+  }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+ private:
+  const char* name_;
+  const char* category_;
+  uint64_t start_;
+  const char* arg_name_ = nullptr;
+  int64_t arg_ = 0;
+};
+
+}  // namespace nm_trace
+
+#define NM_TRACE_CONCAT_INNER(a, b) a##b
+#define NM_TRACE_CONCAT(a, b) NM_TRACE_CONCAT_INNER(a, b)
+// Traces the rest of the enclosing scope.
+#define NM_TRACE_SCOPE(name, category) \
+  nm_trace::Span NM_TRACE_CONCAT(nm_trace_span_, __LINE__)(name, category)
+
+#endif  // NM_TRACE_H_
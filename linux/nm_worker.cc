@@ -0,0 +1,118 @@
+#include "nm_worker.h"
+
+#include <pthread.h>
+
+#include <utility>
+
+namespace nm_worker {
+
+WorkerPool::WorkerPool(size_t threads)
+    : thread_count_(threads ? threads : 1) {}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::unique_lock<std::mutex> lk(mtx_);
+    idle_cv_.wait(lk, [this] {
+      return queue_.empty() && serial_.empty() && !serial_scheduled_ &&
+             busy_ == 0;
+    });
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& t : threads_) t.join();
+}
+
+void WorkerPool::start_locked() {
+  if (!threads_.empty()) return;
+  for (size_t i = 0; i < thread_count_; i++) {
+    threads_.emplace_back([this] {
+      pthread_setname_np(pthread_self(), "nm-worker");
+      run();
+    });
+  }
+}
+
+void WorkerPool::post(Task task) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    start_locked();
+    queue_.push_back(std::move(task));
+  }
+  work_cv_.notify_one();
+}
+
+void WorkerPool::post_serial(Task task) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    start_locked();
+    serial_.push_back(std::move(task));
+    if (serial_scheduled_) return;
+    // At most one runner for the serial lane is queued or running.
+    serial_scheduled_ = true;
+    queue_.push_back([this] { run_serial(); });
+  }
+  work_cv_.notify_one();
+}
+
+void WorkerPool::run_serial() {
+  Task task;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    task = std::move(serial_.front());
+    serial_.pop_front();
+  }
+  task();
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (serial_.empty()) {
+      serial_scheduled_ = false;
+      return;
+    }
+    queue_.push_back([this] { run_serial(); });
+  }
+  work_cv_.notify_one();
+}
+
+void WorkerPool::drain() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  idle_cv_.wait(lk, [this] {
+    return queue_.empty() && serial_.empty() && !serial_scheduled_ &&
+           busy_ == 0;
+  });
+}
+
+void WorkerPool::run() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  for (;;) {
+    work_cv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) return;  // stopping
+    Task task = std::move(queue_.front());
+    queue_.pop_front();
+    busy_++;
+    lk.unlock();
+    task();
+    lk.lock();
+    busy_--;
+    if (busy_ == 0 && queue_.empty()) idle_cv_.notify_all();
+  }
+}
+
+static gboolean run_task_cb(gpointer user_data) {
+  (*static_cast<Task*>(user_data))();
+  return G_SOURCE_REMOVE;
+}
+
+static void delete_task(gpointer user_data) {
+  delete static_cast<Task*>(user_data);
+}
+
+void run_on_context(GMainContext* context, Task task) {
+  GSource* source = g_idle_source_new();
+  g_source_set_priority(source, G_PRIORITY_DEFAULT);
+  g_source_set_callback(source, run_task_cb, new Task(std::move(task)),
+                        delete_task);
+  g_source_attach(source, context);
+  g_source_unref(source);
+}
+
+}  // namespace nm_worker
@@ -0,0 +1,70 @@
+#ifndef NM_WORKER_H_
+#define NM_WORKER_H_
+
+// Small thread pool that keeps blocking method-call handlers (D-Bus calls to
+// the notification server, prefs and poller.conf I/O, joining the polling
+// thread, spawning the daemon) off the GTK main thread.
+//
+// Two lanes share the threads:
+//   post()        — any free worker, concurrently (notification display);
+//   post_serial() — one task at a time in submission order (everything that
+//                   reads or writes plugin state, so a stop that follows a
+//                   start still runs after it).
+//
+// Results go back with run_on_context(), which queues an idle source on the
+// main context; the plugin responds to the FlMethodCall from there.
+//
+// Workers are started on first use and joined by the destructor after the
+// queue drains. Plugin-only (uses GLib main contexts).
+
+#include <glib.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nm_worker {
+
+typedef std::function<void()> Task;
+
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void post(Task task);
+  void post_serial(Task task);
+
+  // Blocks until every task posted so far has finished.
+  void drain();
+
+ private:
+  void start_locked();
+  void run();
+  void run_serial();
+
+  const size_t thread_count_;
+  std::mutex mtx_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<Task> queue_;
+  std::deque<Task> serial_;
+  bool serial_scheduled_ = false;
+  size_t busy_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Runs |task| on the thread that iterates |context|, from an idle source.
+void run_on_context(GMainContext* context, Task task);
+
+}  // namespace nm_worker
+
+#endif  // NM_WORKER_H_
@@ -2,6 +2,7 @@
 
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
+#include <gio/gio.h>
 #include <sys/utsname.h>
 #include <json-glib/json-glib.h>
 #include <libsoup/soup.h>
@@ -9,16 +10,38 @@
 
 #include <cstring>
 #include <thread>
-#include <chrono>
+#include <algorithm>
 #include <atomic>
 #include <iostream>
 #include <map>
+#include <string>
+#include <vector>
 #include <mutex>
+#include <pthread.h>
 #include <signal.h>
 #include <ctime>
 #include <unistd.h>
 
 #include "notification_master_plugin_private.h"
+#include "nm_args.h"
+#include "nm_channels.h"
+#include "nm_clock.h"
+#include "nm_dispatch.h"
+#include "nm_events.h"
+#include "nm_feed.h"
+#include "nm_handoff.h"
+#include "nm_history.h"
+#include "nm_http.h"
+#include "nm_live.h"
+#include "nm_metrics.h"
+#include "nm_poller_config.h"
+#include "nm_prefs.h"
+#include "nm_progress.h"
+#include "nm_receipts.h"
+#include "nm_search.h"
+#include "nm_topics.h"
+#include "nm_trace.h"
+#include "nm_worker.h"
 
 #define NOTIFICATION_MASTER_PLUGIN(obj) \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), notification_master_plugin_get_type(), \
@@ -31,19 +54,60 @@ struct _NotificationMasterPlugin {
   gboolean is_foreground_active;
   std::thread* polling_thread;
   std::atomic<bool> stop_polling;
+  // Cancels the polling thread's in-flight HTTP request on stop.
+  GCancellable* poll_cancellable;
   // Background daemon process (startBackgroundPollingService)
   GPid daemon_pid;
   gboolean daemon_active;
+  // Blocking handlers run here and respond on |main_context|.
+  nm_worker::WorkerPool* workers;
+  // fetchNotifications runs here, so slow feeds cannot occupy |workers|.
+  nm_worker::WorkerPool* fetch_workers;
+  GMainContext* main_context;
+  // Lifecycle events for Dart ("notification_master/events", nm_events.h).
+  FlEventChannel* event_channel;
+  nm_events::Batcher* events;
+  GDBusConnection* bus;
+  guint action_signal_id;
+  guint closed_signal_id;
+  // Items fetched by the background daemon, while Dart listens (nm_handoff.h).
+  nm_handoff::Listener* handoff;
+  // Rate-limited progress notifications (nm_progress.h).
+  nm_progress::Coalescer* progress;
 };
 
 G_DEFINE_TYPE(NotificationMasterPlugin, notification_master_plugin, g_object_get_type())
 
+// Worker threads for blocking method calls: one runs the serial lane while
+// another shows notifications.
+static constexpr size_t kWorkerThreads = 2;
+
+// Concurrent fetchNotifications calls. Each may wait out the HTTP timeout;
+// further calls queue behind them instead of taking a display worker.
+static constexpr size_t kFetchThreads = 2;
+
 // Forward declarations
 static void start_polling_service(NotificationMasterPlugin* self, const gchar* polling_url, gint interval_minutes);
 static void stop_polling_service(NotificationMasterPlugin* self);
 static gboolean start_background_daemon(NotificationMasterPlugin* self, const gchar* url, gint interval_minutes);
 static void     stop_background_daemon(NotificationMasterPlugin* self);
 static gboolean is_background_daemon_running(NotificationMasterPlugin* self);
+static gchar*   get_device_token();
+static void     subscribe_to_topic(const gchar* topic, gboolean show_confirmation);
+static void     unsubscribe_from_topic(const gchar* topic, gboolean show_confirmation);
+static void     apply_topic_change(const gchar* method,
+                                   const std::vector<std::string>& topics,
+                                   gboolean show_confirmation);
+static FlValue* get_subscribed_topics();
+static FlValue* get_polling_metrics();
+static bool     fetch_feed(const std::string& url,
+                           const std::vector<std::string>& topics,
+                           nm_http::Headers headers,
+                           nm_http::ValidatorCache* validators,
+                           GCancellable* cancellable,
+                           nm_http::Response* response);
+static void     show_feed_items(const std::vector<nm_feed::Item>& items,
+                                const nm_topics::TopicMatcher& matcher);
 
 // Scheduled (background) notification tracking for Linux. A detached child
 // process (see scheduleNotification) survives the app closing; we keep its pid
@@ -51,6 +115,76 @@ static gboolean is_background_daemon_running(NotificationMasterPlugin* self);
 static std::mutex g_scheduled_mutex;
 static std::map<int, GPid> g_scheduled_pids;
 
+// Delivery receipts queued by the polling thread (see nm_receipts.h).
+static nm_receipts::ReceiptQueue g_receipts;
+
+// Replace libnotify when set (tests and benchmarks).
+static NotificationSink g_notification_sink = nullptr;
+static NotificationCloseSink g_close_sink = nullptr;
+
+void set_notification_sink(NotificationSink sink,
+                           NotificationCloseSink close_sink) {
+  g_notification_sink = sink;
+  g_close_sink = close_sink;
+}
+
+// The live plugin's event batcher. Display and polling code have no plugin
+// pointer; the batcher itself is thread-safe.
+static std::atomic<nm_events::Batcher*> g_events{nullptr};
+
+// Server ids of the notifications shown here (see on_notification_signal).
+static nm_events::ServerIds g_server_ids;
+
+static void emit_event(nm_events::Event event) {
+  nm_events::Batcher* events = g_events.load();
+  if (events) events->push(std::move(event));
+}
+
+// Notifications shown with an app id, kept so the id can update or close
+// them (see nm_live.h). Never destroyed: workers may still be showing at exit.
+static nm_live::Registry* const g_live = new nm_live::Registry();
+
+// Ids handed out to showNotification calls without one, as Android does.
+// They start well above the ids apps pick for themselves.
+static std::atomic<gint64> g_next_auto_id{0x40000000};
+
+static void on_live_notification_closed(NotifyNotification* notification,
+                                        gpointer user_data) {
+  g_live->remove(G_OBJECT(notification));
+}
+
+// show_notification id for the plugin's own popups (topic confirmations,
+// device token), which are not reported as events.
+static constexpr gint64 kUntracked = -1;
+
+// Clicks reach Dart through the ActionInvoked signal instead; libnotify only
+// calls this while the NotifyNotification is alive.
+static void ignore_action_cb(NotifyNotification* notification, char* action,
+                             gpointer user_data) {}
+
+// show_notification through g_notification_sink. A live |id| keeps a plain
+// GObject in g_live, found and stored under the id lock as a
+// NotifyNotification would be.
+static gboolean show_through_sink(const gchar* title, const gchar* message,
+                                  gint64 id, const nm_events::Event& delivered) {
+  bool live = id > 0;
+  std::unique_lock<std::mutex> id_lock;
+  GObject* notification = nullptr;
+  if (live) {
+    id_lock = g_live->lock(id);
+    notification = g_live->find(id);
+    if (!notification) {
+      notification = G_OBJECT(g_object_new(G_TYPE_OBJECT, nullptr));
+    }
+  }
+  gboolean shown = g_notification_sink(title, message, notification);
+  if (shown && live) g_live->put(id, notification);
+  if (id_lock) id_lock.unlock();
+  if (notification) g_object_unref(notification);
+  if (shown && id != kUntracked) emit_event(delivered);
+  return shown;
+}
+
 // Shell-escape a string for use inside single quotes (sh -c command).
 static gchar* sh_quote_string(const gchar* s) {
   if (!s) return g_strdup("''");
@@ -66,22 +200,184 @@ static gchar* sh_quote_string(const gchar* s) {
   return g_string_free(out, FALSE);
 }
 
-// Show a simple notification using libnotify
-static gboolean show_notification(const gchar* title, const gchar* message, const gchar* channel_id) {
-  if (!notify_is_initted()) {
-    notify_init("NotificationMaster");
+// Channel policies and rate limits (nm_channels.h), loaded from prefs.ini on
+// first display and kept in step by createCustomChannel.
+static nm_channels::Registry& channel_registry() {
+  static nm_channels::Registry* registry = new nm_channels::Registry();
+  static std::once_flag loaded;
+  std::call_once(loaded, [] {
+    registry->set(nm_prefs::PrefsStore::get().channels());
+  });
+  return *registry;
+}
+
+// Local display history (nm_history.h), shared with the background daemon.
+static nm_history::Writer& history_writer() {
+  static nm_history::Writer* writer =
+      new nm_history::Writer(nm_config::history_path());
+  return *writer;
+}
+
+static nm_history::Reader& history_reader() {
+  static nm_history::Reader* reader =
+      new nm_history::Reader(nm_config::history_path());
+  return *reader;
+}
+
+// Conditional-GET validators (nm_http.h), one set per consumer of a feed:
+// the polling thread shows only what changed since its own last 200, and a
+// 304 to fetchNotifications means unchanged since Dart last fetched it.
+static nm_http::ValidatorCache& poll_validators() {
+  static nm_http::ValidatorCache* validators = new nm_http::ValidatorCache();
+  return *validators;
+}
+
+static nm_http::ValidatorCache& fetch_validators() {
+  static nm_http::ValidatorCache* validators = new nm_http::ValidatorCache();
+  return *validators;
+}
+
+// Full-text index over history_reader() (nm_search.h). Built in the
+// background at registration and brought up to date by each
+// searchNotifications call, never on the display path.
+static nm_search::Searcher& search_index() {
+  static nm_search::Searcher* searcher =
+      new nm_search::Searcher(&history_reader());
+  return *searcher;
+}
+
+// show_notification |progress| for notifications without a progress bar.
+static constexpr gint kNoProgress = -1;
+
+// Whether the notification server draws the "value" hint as a progress bar.
+// The spec has no capability for it, so known servers are listed; others
+// get the percentage in the body instead.
+static bool server_draws_progress() {
+  static std::once_flag once;
+  static bool draws = false;
+  std::call_once(once, [] {
+    static const char* const kServers[] = {
+        "dunst", "mako", "Plasma", "notify-osd", "swaync", "xfce4-notifyd",
+    };
+    char* name = nullptr;
+    if (notify_get_server_info(&name, nullptr, nullptr, nullptr) && name) {
+      for (const char* server : kServers) {
+        if (g_strcmp0(name, server) == 0) draws = true;
+      }
+    }
+    g_free(name);
+  });
+  return draws;
+}
+
+// Show a simple notification using libnotify. Unless |id| is kUntracked, a
+// delivered event carries |id| (0 when the caller has none) and the feed
+// |item_id| of polled items, and later clicks and closes are reported too.
+// A positive |id| that is still on screen is updated in place. With a
+// |progress| percentage the notification carries a progress bar, and an
+// |ongoing| one stays up until the next update replaces it.
+// |channel_id| picks the display policy. App notifications over the
+// channel's rate limit are dropped (FALSE); the plugin's own popups and
+// progress updates, which nm_progress already paces, are exempt. Shown app
+// notifications go to the history; feed items are recorded by
+// show_feed_items.
+static gboolean show_notification(const gchar* title, const gchar* message,
+                                  const gchar* channel_id,
+                                  gint64 id = kUntracked,
+                                  const gchar* item_id = nullptr,
+                                  gint progress = kNoProgress,
+                                  bool ongoing = false) {
+  nm_events::Event delivered;
+  delivered.type = nm_events::kDelivered;
+  delivered.id = id;
+  if (item_id) delivered.item_id = item_id;
+  nm_channels::Channel channel;
+  std::string channel_key = channel_id ? channel_id : "";
+  if (id == kUntracked || progress != kNoProgress) {
+    channel_registry().policy(channel_key, &channel);
+  } else if (!channel_registry().admit(channel_key,
+                                       nm_clock::get().monotonic_ms(),
+                                       &channel)) {
+    nm_metrics::global().rate_limited.inc();
+    return FALSE;
   }
+  if (g_notification_sink) {
+    return show_through_sink(title, message, id, delivered);
+  }
+  // Display runs on worker threads and the polling thread.
+  static std::once_flag notify_once;
+  std::call_once(notify_once, [] {
+    if (!notify_is_initted()) notify_init("NotificationMaster");
+  });
   
-  NotifyNotification* notification = notify_notification_new(title, message, NULL);
+  std::string body = message ? message : "";
+  bool progress_hint = progress != kNoProgress && server_draws_progress();
+  if (progress != kNoProgress && !progress_hint) {
+    body += (body.empty() ? "" : " — ") + std::to_string(progress) + "%";
+  }
+  bool live = id > 0;
+  // Held until the notification is stored: see nm_live.h.
+  std::unique_lock<std::mutex> id_lock;
+  if (live) id_lock = g_live->lock(id);
+  NotifyNotification* notification =
+      live ? (NotifyNotification*)g_live->find(id) : nullptr;
+  if (notification) {
+    // Shown again under the same server id, which replaces the popup.
+    notify_notification_update(notification, title, body.c_str(), NULL);
+    notify_notification_clear_actions(notification);
+    notify_notification_clear_hints(notification);
+  } else {
+    notification = notify_notification_new(title, body.c_str(), NULL);
+    if (live) {
+      g_signal_connect(notification, "closed",
+                       G_CALLBACK(on_live_notification_closed), nullptr);
+    }
+  }
+  if (progress_hint) {
+    notify_notification_set_hint_int32(notification, "value", progress);
+  }
   notify_notification_set_timeout(notification, 5000); // 5 seconds
+  nm_channels::apply(channel, notification);
+  if (ongoing) {
+    notify_notification_set_timeout(notification, NOTIFY_EXPIRES_NEVER);
+  }
+  nm_events::Batcher* events = g_events.load();
+  bool tracked = id != kUntracked && events && events->enabled();
+  if (tracked) {
+    // A default action makes a click emit ActionInvoked("default").
+    notify_notification_add_action(notification, "default", "Open",
+                                   NOTIFY_ACTION_CALLBACK(ignore_action_cb),
+                                   nullptr, nullptr);
+  }
   
   GError* error = NULL;
+  NM_TRACE_SCOPE("notify_show", "display");
+  nm_metrics::Stopwatch timer;
   gboolean success = notify_notification_show(notification, &error);
+  nm_metrics::global().display_duration.observe(timer.seconds());
   
   if (error) {
+    nm_metrics::global().display_errors.inc();
     g_print("Error showing notification: %s\n", error->message);
     g_error_free(error);
   }
+  if (success && tracked) {
+    gint server_id = 0;
+    g_object_get(notification, "id", &server_id, NULL);
+    g_server_ids.remember((uint32_t)server_id, delivered.id,
+                          delivered.item_id);
+    events->push(std::move(delivered));
+  }
+  if (success && live) g_live->put(id, G_OBJECT(notification));
+  if (id_lock) id_lock.unlock();
+  if (success && id != kUntracked && progress == kNoProgress && !item_id) {
+    nm_history::Record record;
+    record.notification_id = id;
+    record.title = title ? title : "";
+    record.message = body;
+    record.channel = channel_key;
+    history_writer().append(record);
+  }
   
   g_object_unref(G_OBJECT(notification));
   return success;
@@ -91,505 +387,1100 @@ static gboolean show_notification(const gchar* title, const gchar* message, cons
 static gboolean show_big_text_notification(const gchar* title, const gchar* message, const gchar* big_text, const gchar* channel_id) {
   // For simplicity, we'll concatenate the big text to the message
   gchar* full_message = g_strdup_printf("%s\n%s", message, big_text);
-  gboolean result = show_notification(title, full_message, channel_id);
+  gboolean result = show_notification(title, full_message, channel_id, 0);
   g_free(full_message);
   return result;
 }
 
-// Create a notification channel (stub for Linux)
-static void create_notification_channel(const gchar* channel_id, const gchar* channel_name, const gchar* channel_description) {
-  // Linux doesn't have notification channels like Android, so we'll just log this
-  g_print("Created notification channel: %s (%s)\n", channel_name, channel_id);
+// Create (or replace) a notification channel: persisted in prefs.ini, where
+// the background daemon picks it up too, and applied from the next display.
+static void create_notification_channel(const nm_channels::Channel& channel) {
+  nm_prefs::PrefsStore::get().put_channel(channel);
+  channel_registry().put(channel);
 }
 
-// Called when a method call is received from Flutter.
-static void notification_master_plugin_handle_method_call(
-    NotificationMasterPlugin* self,
-    FlMethodCall* method_call) {
-  g_autoptr(FlMethodResponse) response = nullptr;
-
-  const gchar* method = fl_method_call_get_name(method_call);
-  FlValue* args = fl_method_call_get_args(method_call);
-
-  if (strcmp(method, "getPlatformVersion") == 0) {
-    response = get_platform_version();
-  } else if (strcmp(method, "requestNotificationPermission") == 0) {
-    // Linux notifications don't typically require explicit permission
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "checkNotificationPermission") == 0) {
-    // Linux notifications are generally allowed by default
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "showNotification") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* title_value = fl_value_lookup_string(args, "title");
-      FlValue* message_value = fl_value_lookup_string(args, "message");
-      FlValue* id_value = fl_value_lookup_string(args, "id");
-      
-      if (title_value && message_value) {
-        const gchar* title = fl_value_get_string(title_value);
-        const gchar* message = fl_value_get_string(message_value);
-        const gchar* channel_id = "default";
-        int notification_id = 1; // Default ID
-        
-        FlValue* channel_id_value = fl_value_lookup_string(args, "channelId");
-        if (channel_id_value) {
-          channel_id = fl_value_get_string(channel_id_value);
-        }
-        
-        // Extract custom ID if provided
-        if (id_value && fl_value_get_type(id_value) == FL_VALUE_TYPE_INT) {
-          notification_id = fl_value_get_int(id_value);
-        }
-        
-        gboolean success = show_notification(title, message, channel_id);
-        g_autoptr(FlValue) result = fl_value_new_int(success ? notification_id : -1);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for showNotification", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for showNotification", nullptr));
-    }
-  } else if (strcmp(method, "showBigTextNotification") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* title_value = fl_value_lookup_string(args, "title");
-      FlValue* message_value = fl_value_lookup_string(args, "message");
-      FlValue* big_text_value = fl_value_lookup_string(args, "bigText");
-      
-      if (title_value && message_value && big_text_value) {
-        const gchar* title = fl_value_get_string(title_value);
-        const gchar* message = fl_value_get_string(message_value);
-        const gchar* big_text = fl_value_get_string(big_text_value);
-        const gchar* channel_id = "default";
-        
-        FlValue* channel_id_value = fl_value_lookup_string(args, "channelId");
-        if (channel_id_value) {
-          channel_id = fl_value_get_string(channel_id_value);
-        }
-        
-        gboolean success = show_big_text_notification(title, message, big_text, channel_id);
-        g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for showBigTextNotification", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for showBigTextNotification", nullptr));
-    }
-  } else if (strcmp(method, "showImageNotification") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* title_value = fl_value_lookup_string(args, "title");
-      FlValue* message_value = fl_value_lookup_string(args, "message");
-      FlValue* image_url_value = fl_value_lookup_string(args, "imageUrl");
-      
-      if (title_value && message_value && image_url_value) {
-        const gchar* title = fl_value_get_string(title_value);
-        const gchar* message = fl_value_get_string(message_value);
-        const gchar* image_url = fl_value_get_string(image_url_value);
-        const gchar* channel_id = "default";
-        
-        FlValue* channel_id_value = fl_value_lookup_string(args, "channelId");
-        if (channel_id_value) {
-          channel_id = fl_value_get_string(channel_id_value);
-        }
-        
-        // For simplicity, we'll just include the image URL in the message
-        gchar* full_message = g_strdup_printf("%s\nImage: %s", message, image_url);
-        gboolean success = show_notification(title, full_message, channel_id);
-        g_free(full_message);
-        
-        g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for showImageNotification", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for showImageNotification", nullptr));
-    }
-  } else if (strcmp(method, "showNotificationWithActions") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* title_value = fl_value_lookup_string(args, "title");
-      FlValue* message_value = fl_value_lookup_string(args, "message");
-      
-      if (title_value && message_value) {
-        const gchar* title = fl_value_get_string(title_value);
-        const gchar* message = fl_value_get_string(message_value);
-        const gchar* channel_id = "default";
-        
-        FlValue* channel_id_value = fl_value_lookup_string(args, "channelId");
-        if (channel_id_value) {
-          channel_id = fl_value_get_string(channel_id_value);
-        }
-        
-        // For simplicity, we'll just show a regular notification
-        gboolean success = show_notification(title, message, channel_id);
-        g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for showNotificationWithActions", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for showNotificationWithActions", nullptr));
-    }
-  } else if (strcmp(method, "createCustomChannel") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* channel_id_value = fl_value_lookup_string(args, "channelId");
-      FlValue* channel_name_value = fl_value_lookup_string(args, "channelName");
-      
-      if (channel_id_value && channel_name_value) {
-        const gchar* channel_id = fl_value_get_string(channel_id_value);
-        const gchar* channel_name = fl_value_get_string(channel_name_value);
-        const gchar* channel_description = "";
-        
-        FlValue* channel_description_value = fl_value_lookup_string(args, "channelDescription");
-        if (channel_description_value) {
-          channel_description = fl_value_get_string(channel_description_value);
-        }
-        
-        create_notification_channel(channel_id, channel_name, channel_description);
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for createCustomChannel", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for createCustomChannel", nullptr));
-    }
-  } else if (strcmp(method, "startNotificationPolling") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* polling_url_value = fl_value_lookup_string(args, "pollingUrl");
-      
-      if (polling_url_value) {
-        const gchar* polling_url = fl_value_get_string(polling_url_value);
-        gint interval_minutes = 15; // Default value
-        
-        FlValue* interval_minutes_value = fl_value_lookup_string(args, "intervalMinutes");
-        if (interval_minutes_value) {
-          interval_minutes = fl_value_get_int(interval_minutes_value);
-        }
-        
-        // Stop any running service first (mutual exclusivity).
-        stop_polling_service(self);
-        self->is_foreground_active = FALSE;
-
-        // Persist so getActiveNotificationService returns the right value.
-        GKeyFile* kf = load_prefs();
-        g_key_file_set_string(kf, "service", "active", "polling");
-        save_prefs(kf);
-        g_key_file_free(kf);
-
-        start_polling_service(self, polling_url, interval_minutes);
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for startNotificationPolling", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for startNotificationPolling", nullptr));
-    }
-  } else if (strcmp(method, "stopNotificationPolling") == 0) {
-    stop_polling_service(self);
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "startForegroundService") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* polling_url_value = fl_value_lookup_string(args, "pollingUrl");
-      
-      if (polling_url_value) {
-        const gchar* polling_url = fl_value_get_string(polling_url_value);
-        gint interval_minutes = 15; // Default value
-        
-        FlValue* interval_minutes_value = fl_value_lookup_string(args, "intervalMinutes");
-        if (interval_minutes_value) {
-          interval_minutes = fl_value_get_int(interval_minutes_value);
-        }
-        
-        // Stop any running service first (mutual exclusivity).
-        stop_polling_service(self);
-
-        // Persist service type.
-        GKeyFile* kf = load_prefs();
-        g_key_file_set_string(kf, "service", "active", "foreground");
-        save_prefs(kf);
-        g_key_file_free(kf);
-
-        // Linux has no foreground service concept; treat as polling.
-        self->is_foreground_active = TRUE;
-        start_polling_service(self, polling_url, interval_minutes);
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "Invalid arguments for startForegroundService", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for startForegroundService", nullptr));
-    }
-  } else if (strcmp(method, "stopForegroundService") == 0) {
-    stop_polling_service(self);
-    self->is_foreground_active = FALSE;
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "setFirebaseAsActiveService") == 0) {
-  } else if (strcmp(method, "getActiveNotificationService") == 0) {
-    const gchar* service = "none";
-    if (self->is_foreground_active) {
-      service = "foreground";
-    } else if (self->is_polling_active) {
-      service = "polling";
-    } else {
-      // Check if firebase was set persistently.
-      GKeyFile* kf = load_prefs();
-      gchar* stored = g_key_file_get_string(kf, "service", "active", nullptr);
-      g_key_file_free(kf);
-      if (g_strcmp0(stored, "firebase") == 0) {
-        service = "firebase";
-      }
-      g_free(stored);
-    }
-    g_autoptr(FlValue) result = fl_value_new_string(service);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "showHeadsUpNotification") == 0 ||
-             strcmp(method, "showFullScreenNotification") == 0 ||
-             strcmp(method, "showStyledNotification") == 0) {
-    // Treat as regular notification on Linux
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* title_value = fl_value_lookup_string(args, "title");
-      FlValue* message_value = fl_value_lookup_string(args, "message");
-      const gchar* title = title_value ? fl_value_get_string(title_value) : "Notification";
-      const gchar* message = message_value ? fl_value_get_string(message_value) : "";
-      gboolean success = show_notification(title, message, "default");
-      g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
-      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments", nullptr));
+static FlMethodResponse* handle_get_platform_version(
+    NotificationMasterPlugin* self, FlValue* args) {
+  return get_platform_version();
+}
+
+static FlMethodResponse* handle_request_notification_permission(
+    NotificationMasterPlugin* self, FlValue* args) {
+  // Linux notifications don't typically require explicit permission
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_check_notification_permission(
+    NotificationMasterPlugin* self, FlValue* args) {
+  // Linux notifications are generally allowed by default
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+struct ShowNotificationArgs {
+  const gchar* title = nullptr;
+  const gchar* message = nullptr;
+  gint64 id = 0;  // none: one is assigned
+  const gchar* channel_id = "default";
+  const gchar* big_text = nullptr;
+  const gchar* image_url = nullptr;
+};
+
+static const nm_args::Field<ShowNotificationArgs> kShowNotificationArgs[] = {
+    nm_args::field("title", &ShowNotificationArgs::title, nm_args::kRequired),
+    nm_args::field("message", &ShowNotificationArgs::message,
+                   nm_args::kRequired),
+    nm_args::field("id", &ShowNotificationArgs::id),
+    nm_args::field("channelId", &ShowNotificationArgs::channel_id),
+};
+
+static FlMethodResponse* handle_show_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  ShowNotificationArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kShowNotificationArgs, &a, &error)) {
+    return nm_args::invalid_arguments("showNotification", error);
+  }
+  if (a.id <= 0) a.id = g_next_auto_id++;
+  gboolean success =
+      show_notification(a.title, a.message, a.channel_id, a.id);
+  g_autoptr(FlValue) result = fl_value_new_int(success ? a.id : -1);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static const nm_args::Field<ShowNotificationArgs> kShowBigTextArgs[] = {
+    nm_args::field("title", &ShowNotificationArgs::title, nm_args::kRequired),
+    nm_args::field("message", &ShowNotificationArgs::message,
+                   nm_args::kRequired),
+    nm_args::field("bigText", &ShowNotificationArgs::big_text,
+                   nm_args::kRequired),
+    nm_args::field("channelId", &ShowNotificationArgs::channel_id),
+};
+
+static FlMethodResponse* handle_show_big_text_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  ShowNotificationArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kShowBigTextArgs, &a, &error)) {
+    return nm_args::invalid_arguments("showBigTextNotification", error);
+  }
+  gboolean success =
+      show_big_text_notification(a.title, a.message, a.big_text, a.channel_id);
+  g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static const nm_args::Field<ShowNotificationArgs> kShowImageArgs[] = {
+    nm_args::field("title", &ShowNotificationArgs::title, nm_args::kRequired),
+    nm_args::field("message", &ShowNotificationArgs::message,
+                   nm_args::kRequired),
+    nm_args::field("imageUrl", &ShowNotificationArgs::image_url,
+                   nm_args::kRequired),
+    nm_args::field("channelId", &ShowNotificationArgs::channel_id),
+};
+
+static FlMethodResponse* handle_show_image_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  ShowNotificationArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kShowImageArgs, &a, &error)) {
+    return nm_args::invalid_arguments("showImageNotification", error);
+  }
+  // For simplicity, we'll just include the image URL in the message
+  gchar* full_message = g_strdup_printf("%s\nImage: %s", a.message, a.image_url);
+  gboolean success = show_notification(a.title, full_message, a.channel_id, 0);
+  g_free(full_message);
+
+  g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static const nm_args::Field<ShowNotificationArgs> kShowWithActionsArgs[] = {
+    nm_args::field("title", &ShowNotificationArgs::title, nm_args::kRequired),
+    nm_args::field("message", &ShowNotificationArgs::message,
+                   nm_args::kRequired),
+    nm_args::field("channelId", &ShowNotificationArgs::channel_id),
+};
+
+static FlMethodResponse* handle_show_notification_with_actions(
+    NotificationMasterPlugin* self, FlValue* args) {
+  ShowNotificationArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kShowWithActionsArgs, &a, &error)) {
+    return nm_args::invalid_arguments("showNotificationWithActions", error);
+  }
+  // For simplicity, we'll just show a regular notification
+  gboolean success = show_notification(a.title, a.message, a.channel_id, 0);
+  g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+struct CreateChannelArgs {
+  const gchar* channel_id = nullptr;
+  const gchar* channel_name = nullptr;
+  const gchar* channel_description = "";
+  gint64 importance = 2;  // NotificationImportance.defaultImportance
+  bool enable_sound = true;
+  const gchar* sound = "";
+  const gchar* category = "";
+  gint64 timeout_ms = nm_channels::kCallerTimeout;
+  gint64 max_per_minute = 0;
+  gint64 burst = 0;
+};
+
+static const nm_args::Field<CreateChannelArgs> kCreateChannelArgs[] = {
+    nm_args::field("channelId", &CreateChannelArgs::channel_id,
+                   nm_args::kRequired),
+    nm_args::field("channelName", &CreateChannelArgs::channel_name,
+                   nm_args::kRequired),
+    nm_args::field("channelDescription",
+                   &CreateChannelArgs::channel_description),
+    nm_args::field("importance", &CreateChannelArgs::importance),
+    nm_args::field("enableSound", &CreateChannelArgs::enable_sound),
+    nm_args::field("sound", &CreateChannelArgs::sound),
+    nm_args::field("category", &CreateChannelArgs::category),
+    nm_args::field("timeoutMs", &CreateChannelArgs::timeout_ms),
+    nm_args::field("maxPerMinute", &CreateChannelArgs::max_per_minute),
+    nm_args::field("burst", &CreateChannelArgs::burst),
+};
+
+static FlMethodResponse* handle_create_custom_channel(
+    NotificationMasterPlugin* self, FlValue* args) {
+  CreateChannelArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kCreateChannelArgs, &a, &error)) {
+    return nm_args::invalid_arguments("createCustomChannel", error);
+  }
+  nm_channels::Channel channel;
+  channel.id = a.channel_id;
+  channel.name = a.channel_name;
+  channel.description = a.channel_description;
+  channel.urgency = nm_channels::urgency_for_importance((int)a.importance);
+  channel.timeout_ms =
+      (int)std::max<gint64>(a.timeout_ms, nm_channels::kCallerTimeout);
+  channel.silent = !a.enable_sound;
+  channel.sound = a.sound;
+  channel.category = a.category;
+  channel.rate_per_minute = (int)std::max<gint64>(a.max_per_minute, 0);
+  channel.burst = (int)std::max<gint64>(a.burst, 0);
+  create_notification_channel(channel);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// startNotificationPolling, startForegroundService and
+// startBackgroundPollingService.
+struct PollingArgs {
+  const gchar* polling_url = nullptr;
+  gint64 interval_minutes = 15;
+};
+
+static const nm_args::Field<PollingArgs> kPollingArgs[] = {
+    nm_args::field("pollingUrl", &PollingArgs::polling_url, nm_args::kRequired),
+    nm_args::field("intervalMinutes", &PollingArgs::interval_minutes),
+};
+
+static FlMethodResponse* handle_start_notification_polling(
+    NotificationMasterPlugin* self, FlValue* args) {
+  PollingArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kPollingArgs, &a, &error)) {
+    return nm_args::invalid_arguments("startNotificationPolling", error);
+  }
+  // Stop any running service first (mutual exclusivity).
+  stop_polling_service(self);
+  self->is_foreground_active = FALSE;
+
+  // Persist so getActiveNotificationService returns the right value.
+  nm_prefs::PrefsStore::get().set_string("service", "active", "polling");
+
+  start_polling_service(self, a.polling_url, (gint)a.interval_minutes);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_stop_notification_polling(
+    NotificationMasterPlugin* self, FlValue* args) {
+  stop_polling_service(self);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+struct FetchArgs {
+  const gchar* url = nullptr;
+  std::vector<std::string> headers;  // "Name: Value"
+  bool conditional = true;
+  bool filter_topics = true;
+  bool show = false;
+};
+
+static const nm_args::Field<FetchArgs> kFetchArgs[] = {
+    nm_args::field("url", &FetchArgs::url, nm_args::kRequired),
+    nm_args::field("headers", &FetchArgs::headers),
+    nm_args::field("conditional", &FetchArgs::conditional),
+    nm_args::field("filterTopics", &FetchArgs::filter_topics),
+    nm_args::field("show", &FetchArgs::show),
+};
+
+// Per-item values of the reply's flat "items" list, in this order.
+static const char* const kFetchFields[] = {
+    "id", "title", "message", "bigText", "imageUrl", "topic", "sentAt"};
+
+// fetchNotifications: one GET through the client the polling thread uses
+// (shared connections, conditional GET, decompression), parsed by nm_feed.
+// The reply is {"status", "notModified", "fields", "items"}, where "items"
+// holds kFetchFields values for each item back to back (strings, "" when
+// absent; sentAt is epoch ms, 0 when absent). With "show", the items are
+// also displayed here, so Dart makes no per-item calls.
+static FlMethodResponse* handle_fetch_notifications(
+    NotificationMasterPlugin* self, FlValue* args) {
+  FetchArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kFetchArgs, &a, &error)) {
+    return nm_args::invalid_arguments("fetchNotifications", error);
+  }
+  nm_http::Headers headers;
+  for (const auto& line : a.headers) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos || colon == 0) {
+      return nm_args::invalid_arguments(
+          "fetchNotifications", "headers must be \"Name: Value\" strings");
     }
-  } else if (strcmp(method, "getDeviceToken") == 0) {
-    gchar* token = get_device_token();
-    g_autoptr(FlValue) result = fl_value_new_string(token ? token : "");
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-    g_free(token);
-  } else if (strcmp(method, "subscribeToTopic") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* topic_value = fl_value_lookup_string(args, "topic");
-      if (topic_value && fl_value_get_type(topic_value) == FL_VALUE_TYPE_STRING) {
-        const gchar* topic = fl_value_get_string(topic_value);
-        subscribe_to_topic(topic);
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_TOPIC", "topic is required", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments", nullptr));
+    size_t value = line.find_first_not_of(' ', colon + 1);
+    headers.emplace_back(line.substr(0, colon),
+                         value == std::string::npos ? "" : line.substr(value));
+  }
+  std::vector<std::string> topics;
+  std::string url = a.url;
+  if (a.filter_topics) {
+    topics = nm_prefs::PrefsStore::get().topics();
+    url = nm_topics::scoped_url(a.url, topics);
+  }
+
+  nm_http::Response response;
+  fetch_feed(url, topics, headers,
+             a.conditional ? &fetch_validators() : nullptr, nullptr,
+             &response);
+  if (response.status == 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "FETCH_FAILED", response.error.c_str(), nullptr));
+  }
+  std::vector<nm_feed::Item> items;
+  if (SOUP_STATUS_IS_SUCCESSFUL(response.status)) {
+    nm_metrics::PollMetrics& metrics = nm_metrics::global();
+    nm_metrics::Stopwatch timer;
+    bool parsed;
+    {
+      NM_TRACE_SCOPE("parse", "parse");
+      parsed = nm_feed::parse(response.body.data(), response.body.size(),
+                              &items, &error);
     }
-  } else if (strcmp(method, "unsubscribeFromTopic") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* topic_value = fl_value_lookup_string(args, "topic");
-      if (topic_value && fl_value_get_type(topic_value) == FL_VALUE_TYPE_STRING) {
-        const gchar* topic = fl_value_get_string(topic_value);
-        unsubscribe_from_topic(topic);
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_TOPIC", "topic is required", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments", nullptr));
+    metrics.parse_duration.observe(timer.seconds());
+    if (!parsed) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_RESPONSE", error.c_str(), nullptr));
     }
-  } else if (strcmp(method, "getSubscribedTopics") == 0) {
-    g_autoptr(FlValue) list = get_subscribed_topics();
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(list));
-  } else if (strcmp(method, "scheduleNotification") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* id_value = fl_value_lookup_string(args, "id");
-      FlValue* title_value = fl_value_lookup_string(args, "title");
-      FlValue* message_value = fl_value_lookup_string(args, "message");
-      FlValue* epoch_value = fl_value_lookup_string(args, "scheduledEpochMillis");
-      FlValue* alarm_value = fl_value_lookup_string(args, "alarmSound");
-
-      if (title_value && message_value && id_value && epoch_value) {
-        gint id = fl_value_get_int(id_value);
-        gint64 epoch_millis = fl_value_get_int(epoch_value);
-        gboolean alarm_sound = alarm_value && fl_value_get_type(alarm_value) == FL_VALUE_TYPE_BOOL
-            ? fl_value_get_bool(alarm_value) : FALSE;
-        const gchar* title = fl_value_get_string(title_value);
-        const gchar* message = fl_value_get_string(message_value);
-
-        gint64 now_secs = (gint64)time(nullptr);
-        gint64 target_secs = epoch_millis / 1000;
-        gint64 delay = target_secs - now_secs;
-        if (delay < 0) delay = 0;
-
-        gboolean ok = FALSE;
-        if (delay == 0) {
-          show_notification(title, message, "default");
-          ok = TRUE;
-        } else {
-          // Spawn a fully detached process (setsid) that sleeps then fires
-          // notify-send. This survives the app being fully closed.
-          gchar* escaped_title = sh_quote_string(title);
-          gchar* escaped_message = sh_quote_string(message);
-          gchar* command = g_strdup_printf(
-              "sleep %lld && notify-send %s %s",
-              (long long)delay, escaped_title, escaped_message);
-          gchar* argv[] = { const_cast<gchar*>("setsid"),
-                            const_cast<gchar*>("sh"),
-                            const_cast<gchar*>("-c"),
-                            command, nullptr };
-          GPid pid = 0;
-          GError* spawn_error = nullptr;
-          gboolean spawned = g_spawn_async(
-              nullptr, argv, nullptr,
-              (GSpawnFlags)(G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL |
-                            G_SPAWN_STDERR_TO_DEV_NULL | G_SPAWN_DO_NOT_REAP_CHILD),
-              nullptr, nullptr, &pid, &spawn_error);
-          if (spawned) {
-            std::lock_guard<std::mutex> lock(g_scheduled_mutex);
-            g_scheduled_pids[id] = pid;
-            ok = TRUE;
-          } else {
-            g_print("Failed to schedule notification: %s\n",
-                    spawn_error ? spawn_error->message : "unknown");
-            if (spawn_error) g_error_free(spawn_error);
-            // Fall back to showing immediately.
-            show_notification(title, message, "default");
-            ok = TRUE;
-          }
-          g_free(escaped_title);
-          g_free(escaped_message);
-          g_free(command);
-        }
-        (void)alarm_sound;
-        g_autoptr(FlValue) result = fl_value_new_bool(ok);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "id, title, message and scheduledEpochMillis are required", nullptr));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for scheduleNotification", nullptr));
+    metrics.poll_items.observe((double)items.size());
+    nm_topics::TopicMatcher matcher(topics);
+    auto filtered = std::remove_if(
+        items.begin(), items.end(),
+        [&matcher](const nm_feed::Item& item) {
+          return !matcher.matches(item.topic);
+        });
+    metrics.topic_filtered.inc(items.end() - filtered);
+    items.erase(filtered, items.end());
+    if (a.show) show_feed_items(items, nm_topics::TopicMatcher());
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "status",
+                           fl_value_new_int(response.status));
+  fl_value_set_string_take(result, "notModified",
+                           fl_value_new_bool(response.not_modified));
+  FlValue* fields = fl_value_new_list();
+  for (const char* field : kFetchFields) {
+    fl_value_append_take(fields, fl_value_new_string(field));
+  }
+  fl_value_set_string_take(result, "fields", fields);
+  FlValue* flat = fl_value_new_list();
+  for (const auto& item : items) {
+    fl_value_append_take(flat, fl_value_new_string(item.id.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(item.title.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(item.message.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(item.big_text.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(item.image_url.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(item.topic.c_str()));
+    fl_value_append_take(flat, fl_value_new_int(item.sent_at_ms));
+  }
+  fl_value_set_string_take(result, "items", flat);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_start_foreground_service(
+    NotificationMasterPlugin* self, FlValue* args) {
+  PollingArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kPollingArgs, &a, &error)) {
+    return nm_args::invalid_arguments("startForegroundService", error);
+  }
+  // Stop any running service first (mutual exclusivity).
+  stop_polling_service(self);
+
+  // Persist service type.
+  nm_prefs::PrefsStore::get().set_string("service", "active", "foreground");
+
+  // Linux has no foreground service concept; treat as polling.
+  self->is_foreground_active = TRUE;
+  start_polling_service(self, a.polling_url, (gint)a.interval_minutes);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_stop_foreground_service(
+    NotificationMasterPlugin* self, FlValue* args) {
+  stop_polling_service(self);
+  self->is_foreground_active = FALSE;
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_get_active_notification_service(
+    NotificationMasterPlugin* self, FlValue* args) {
+  const gchar* service = "none";
+  if (self->is_foreground_active) {
+    service = "foreground";
+  } else if (self->is_polling_active) {
+    service = "polling";
+  } else {
+    // Check if firebase was set persistently.
+    if (nm_prefs::PrefsStore::get().get_string("service", "active") == "firebase") {
+      service = "firebase";
     }
-  } else if (strcmp(method, "cancelScheduledNotification") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* id_value = fl_value_lookup_string(args, "id");
-      if (id_value) {
-        gint id = fl_value_get_int(id_value);
-        std::lock_guard<std::mutex> lock(g_scheduled_mutex);
-        auto it = g_scheduled_pids.find(id);
-        if (it != g_scheduled_pids.end()) {
-          kill(it->second, SIGKILL);
-          g_spawn_close_pid(it->second);
-          g_scheduled_pids.erase(it);
-        }
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      } else {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENTS", "id is required", nullptr));
-      }
+  }
+  g_autoptr(FlValue) result = fl_value_new_string(service);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static const nm_args::Field<ShowNotificationArgs> kShowPlainArgs[] = {
+    nm_args::field("title", &ShowNotificationArgs::title),
+    nm_args::field("message", &ShowNotificationArgs::message),
+};
+
+// showHeadsUpNotification, showFullScreenNotification and
+// showStyledNotification: treated as regular notifications on Linux.
+static FlMethodResponse* show_plain_notification_response(const gchar* method,
+                                                          FlValue* args) {
+  ShowNotificationArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kShowPlainArgs, &a, &error)) {
+    return nm_args::invalid_arguments(method, error);
+  }
+  gboolean success = show_notification(a.title ? a.title : "Notification",
+                                       a.message ? a.message : "", "default",
+                                       0);
+  g_autoptr(FlValue) result = fl_value_new_int(success ? 1 : -1);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_show_heads_up_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  return show_plain_notification_response("showHeadsUpNotification", args);
+}
+
+static FlMethodResponse* handle_show_full_screen_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  return show_plain_notification_response("showFullScreenNotification", args);
+}
+
+static FlMethodResponse* handle_show_styled_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  return show_plain_notification_response("showStyledNotification", args);
+}
+
+static FlMethodResponse* handle_get_device_token(NotificationMasterPlugin* self,
+                                                 FlValue* args) {
+  FlMethodResponse* response = nullptr;
+  gchar* token = get_device_token();
+  g_autoptr(FlValue) result = fl_value_new_string(token ? token : "");
+  response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  g_free(token);
+  return response;
+}
+
+// subscribeToTopic / unsubscribeFromTopic confirm by default; the bulk
+// methods only when asked (see apply_topic_change).
+struct TopicArgs {
+  const gchar* topic = nullptr;
+  std::vector<std::string> topics;
+  bool show_confirmation = true;
+};
+
+static const nm_args::Field<TopicArgs> kTopicArgs[] = {
+    nm_args::field("topic", &TopicArgs::topic, nm_args::kRequired),
+    nm_args::field("showConfirmation", &TopicArgs::show_confirmation),
+};
+
+static FlMethodResponse* handle_subscribe_to_topic(
+    NotificationMasterPlugin* self, FlValue* args) {
+  TopicArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kTopicArgs, &a, &error)) {
+    return nm_args::invalid_arguments("subscribeToTopic", error);
+  }
+  subscribe_to_topic(a.topic, a.show_confirmation);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_unsubscribe_from_topic(
+    NotificationMasterPlugin* self, FlValue* args) {
+  TopicArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kTopicArgs, &a, &error)) {
+    return nm_args::invalid_arguments("unsubscribeFromTopic", error);
+  }
+  unsubscribe_from_topic(a.topic, a.show_confirmation);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static const nm_args::Field<TopicArgs> kTopicListArgs[] = {
+    nm_args::field("topics", &TopicArgs::topics, nm_args::kRequired),
+    nm_args::field("showConfirmation", &TopicArgs::show_confirmation),
+};
+
+// subscribeToTopics, unsubscribeFromTopics and setTopics.
+static FlMethodResponse* topic_change_response(const gchar* method,
+                                               FlValue* args) {
+  TopicArgs a;
+  a.show_confirmation = false;
+  std::string error;
+  if (!nm_args::decode(args, kTopicListArgs, &a, &error)) {
+    return nm_args::invalid_arguments(method, error);
+  }
+  apply_topic_change(method, a.topics, a.show_confirmation);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_subscribe_to_topics(
+    NotificationMasterPlugin* self, FlValue* args) {
+  return topic_change_response("subscribeToTopics", args);
+}
+
+static FlMethodResponse* handle_unsubscribe_from_topics(
+    NotificationMasterPlugin* self, FlValue* args) {
+  return topic_change_response("unsubscribeFromTopics", args);
+}
+
+static FlMethodResponse* handle_set_topics(NotificationMasterPlugin* self,
+                                           FlValue* args) {
+  return topic_change_response("setTopics", args);
+}
+
+static FlMethodResponse* handle_get_subscribed_topics(
+    NotificationMasterPlugin* self, FlValue* args) {
+  g_autoptr(FlValue) list = get_subscribed_topics();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(list));
+}
+
+struct ScheduleArgs {
+  gint64 id = 0;
+  const gchar* title = nullptr;
+  const gchar* message = nullptr;
+  gint64 scheduled_epoch_millis = 0;
+  bool alarm_sound = false;
+};
+
+static const nm_args::Field<ScheduleArgs> kScheduleArgs[] = {
+    nm_args::field("id", &ScheduleArgs::id, nm_args::kRequired),
+    nm_args::field("title", &ScheduleArgs::title, nm_args::kRequired),
+    nm_args::field("message", &ScheduleArgs::message, nm_args::kRequired),
+    nm_args::field("scheduledEpochMillis",
+                   &ScheduleArgs::scheduled_epoch_millis, nm_args::kRequired),
+    nm_args::field("alarmSound", &ScheduleArgs::alarm_sound),
+};
+
+static FlMethodResponse* handle_schedule_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  NM_TRACE_SCOPE("schedule_notification", "scheduler");
+  ScheduleArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kScheduleArgs, &a, &error)) {
+    return nm_args::invalid_arguments("scheduleNotification", error);
+  }
+
+  gint64 delay =
+      nm_clock::seconds_until(a.scheduled_epoch_millis, nm_clock::get());
+
+  gboolean ok = FALSE;
+  if (delay == 0) {
+    show_notification(a.title, a.message, "default", a.id);
+    ok = TRUE;
+  } else {
+    // Spawn a fully detached process (setsid) that sleeps then fires
+    // notify-send. This survives the app being fully closed.
+    gchar* escaped_title = sh_quote_string(a.title);
+    gchar* escaped_message = sh_quote_string(a.message);
+    gchar* command = g_strdup_printf(
+        "sleep %lld && notify-send %s %s",
+        (long long)delay, escaped_title, escaped_message);
+    gchar* argv[] = { const_cast<gchar*>("setsid"),
+                      const_cast<gchar*>("sh"),
+                      const_cast<gchar*>("-c"),
+                      command, nullptr };
+    GPid pid = 0;
+    GError* spawn_error = nullptr;
+    gboolean spawned = g_spawn_async(
+        nullptr, argv, nullptr,
+        (GSpawnFlags)(G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL |
+                      G_SPAWN_STDERR_TO_DEV_NULL | G_SPAWN_DO_NOT_REAP_CHILD),
+        nullptr, nullptr, &pid, &spawn_error);
+    if (spawned) {
+      std::lock_guard<std::mutex> lock(g_scheduled_mutex);
+      g_scheduled_pids[(int)a.id] = pid;
+      ok = TRUE;
     } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENTS", "Invalid arguments for cancelScheduledNotification", nullptr));
-    }
-  } else if (strcmp(method, "cancelAllScheduledNotifications") == 0) {
-    std::lock_guard<std::mutex> lock(g_scheduled_mutex);
-    for (auto& kv : g_scheduled_pids) {
-      kill(kv.second, SIGKILL);
-      g_spawn_close_pid(kv.second);
+      g_print("Failed to schedule notification: %s\n",
+              spawn_error ? spawn_error->message : "unknown");
+      if (spawn_error) g_error_free(spawn_error);
+      // Fall back to showing immediately.
+      show_notification(a.title, a.message, "default", a.id);
+      ok = TRUE;
     }
-    g_scheduled_pids.clear();
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "getPendingScheduledNotifications") == 0) {
-    g_autoptr(FlValue) list = fl_value_new_list();
-    std::lock_guard<std::mutex> lock(g_scheduled_mutex);
-    for (auto& kv : g_scheduled_pids) {
-      fl_value_append_take(list, fl_value_new_int(kv.first));
-    }
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(list));
-
-  // ── Android-only permission gates — always true / no-op on Linux ─────────
-  } else if (strcmp(method, "canScheduleExactAlarms") == 0) {
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "openExactAlarmSettings") == 0) {
-    g_autoptr(FlValue) result = fl_value_new_bool(FALSE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "openAppNotificationSettings") == 0) {
-    // Open GNOME notification settings if available; ignore errors.
-    g_spawn_command_line_async("gnome-control-center notifications", nullptr);
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-
-  // ── Firebase — not applicable on Linux (returns true, no-op) ────────────
-  } else if (strcmp(method, "setFirebaseAsActiveService") == 0) {
-    // Mark firebase as active so getActiveNotificationService() reports it.
-    GKeyFile* kf = load_prefs();
-    g_key_file_set_string(kf, "service", "active", "firebase");
-    save_prefs(kf);
-    g_key_file_free(kf);
-    stop_polling_service(self);
-    self->is_foreground_active = FALSE;
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-
-  // ── Background daemon (notification_master_poller) ─────────────────────
-  } else if (strcmp(method, "startBackgroundPollingService") == 0) {
-    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-      FlValue* url_val = fl_value_lookup_string(args, "pollingUrl");
-      FlValue* iv_val  = fl_value_lookup_string(args, "intervalMinutes");
-      const gchar* url = (url_val && fl_value_get_type(url_val) == FL_VALUE_TYPE_STRING)
-                         ? fl_value_get_string(url_val) : nullptr;
-      gint interval    = (iv_val  && fl_value_get_type(iv_val)  == FL_VALUE_TYPE_INT)
-                         ? (gint)fl_value_get_int(iv_val) : 15;
-      if (!url || strlen(url) == 0) {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-            "INVALID_ARGUMENT", "pollingUrl is required", nullptr));
-      } else {
-        gboolean ok = start_background_daemon(self, url, interval);
-        g_autoptr(FlValue) result = fl_value_new_bool(ok);
-        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-      }
-    } else {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-          "INVALID_ARGUMENT", "Invalid arguments", nullptr));
+    g_free(escaped_title);
+    g_free(escaped_message);
+    g_free(command);
+  }
+  g_autoptr(FlValue) result = fl_value_new_bool(ok);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static const nm_args::Field<ScheduleArgs> kCancelScheduledArgs[] = {
+    nm_args::field("id", &ScheduleArgs::id, nm_args::kRequired),
+};
+
+static FlMethodResponse* handle_cancel_scheduled_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  NM_TRACE_SCOPE("cancel_scheduled", "scheduler");
+  ScheduleArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kCancelScheduledArgs, &a, &error)) {
+    return nm_args::invalid_arguments("cancelScheduledNotification", error);
+  }
+  std::lock_guard<std::mutex> lock(g_scheduled_mutex);
+  auto it = g_scheduled_pids.find((int)a.id);
+  if (it != g_scheduled_pids.end()) {
+    kill(it->second, SIGKILL);
+    g_spawn_close_pid(it->second);
+    g_scheduled_pids.erase(it);
+  }
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_cancel_all_scheduled_notifications(
+    NotificationMasterPlugin* self, FlValue* args) {
+  NM_TRACE_SCOPE("cancel_all_scheduled", "scheduler");
+  std::lock_guard<std::mutex> lock(g_scheduled_mutex);
+  for (auto& kv : g_scheduled_pids) {
+    kill(kv.second, SIGKILL);
+    g_spawn_close_pid(kv.second);
+  }
+  g_scheduled_pids.clear();
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_get_pending_scheduled_notifications(
+    NotificationMasterPlugin* self, FlValue* args) {
+  g_autoptr(FlValue) list = fl_value_new_list();
+  std::lock_guard<std::mutex> lock(g_scheduled_mutex);
+  for (auto& kv : g_scheduled_pids) {
+    fl_value_append_take(list, fl_value_new_int(kv.first));
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(list));
+}
+
+struct CancelArgs {
+  gint64 id = 0;
+};
+
+static const nm_args::Field<CancelArgs> kCancelArgs[] = {
+    nm_args::field("id", &CancelArgs::id, nm_args::kRequired),
+};
+
+// Closes a notification taken out of g_live and drops its reference.
+static void close_live_notification(GObject* object) {
+  GError* error = nullptr;
+  if (g_notification_sink) {
+    if (g_close_sink) g_close_sink(object);
+  } else if (!notify_notification_close((NotifyNotification*)object,
+                                        &error)) {
+    g_print("Error closing notification: %s\n",
+            error ? error->message : "unknown");
+    if (error) g_error_free(error);
+  }
+  g_object_unref(object);
+}
+
+// Closes the notification showing as |id|, if any; returns whether one was.
+static bool close_live_id(gint64 id) {
+  std::unique_lock<std::mutex> id_lock = g_live->lock(id);
+  GObject* notification = g_live->take(id);
+  if (notification) close_live_notification(notification);
+  return notification != nullptr;
+}
+
+// Both also end the progress streams (nm_progress.h) of what they cancel, so
+// a pending or in-flight update does not bring the popup back.
+static FlMethodResponse* handle_cancel_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  CancelArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kCancelArgs, &a, &error)) {
+    return nm_args::invalid_arguments("cancelNotification", error);
+  }
+  self->progress->cancel(a.id);
+  bool closed = close_live_id(a.id);
+  g_autoptr(FlValue) result = fl_value_new_bool(closed);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_cancel_all_notifications(
+    NotificationMasterPlugin* self, FlValue* args) {
+  self->progress->cancel_all();
+  std::vector<std::unique_lock<std::mutex>> id_locks = g_live->lock_all();
+  std::vector<GObject*> notifications = g_live->take_all();
+  for (GObject* notification : notifications) {
+    close_live_notification(notification);
+  }
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+struct ProgressArgs {
+  gint64 id = 0;
+  const gchar* title = nullptr;
+  const gchar* message = nullptr;
+  gint64 progress = 0;
+  gint64 max_updates_per_second =
+      nm_progress::Coalescer::kDefaultUpdatesPerSecond;
+  bool done = false;
+};
+
+static const nm_args::Field<ProgressArgs> kShowProgressArgs[] = {
+    nm_args::field("id", &ProgressArgs::id, nm_args::kRequired),
+    nm_args::field("title", &ProgressArgs::title, nm_args::kRequired),
+    nm_args::field("message", &ProgressArgs::message),
+    nm_args::field("progress", &ProgressArgs::progress),
+    nm_args::field("maxUpdatesPerSecond",
+                   &ProgressArgs::max_updates_per_second),
+};
+
+static const nm_args::Field<ProgressArgs> kUpdateProgressArgs[] = {
+    nm_args::field("id", &ProgressArgs::id, nm_args::kRequired),
+    nm_args::field("progress", &ProgressArgs::progress, nm_args::kRequired),
+    nm_args::field("title", &ProgressArgs::title),
+    nm_args::field("message", &ProgressArgs::message),
+    nm_args::field("done", &ProgressArgs::done),
+};
+
+static nm_progress::Update progress_update(const ProgressArgs& a) {
+  nm_progress::Update update;
+  update.id = a.id;
+  if (a.title) update.title = a.title;
+  if (a.message) update.message = a.message;
+  update.value = (int)std::min<gint64>(std::max<gint64>(a.progress, 0), 100);
+  update.final = a.done;
+  return update;
+}
+
+// Both run inline: they only hand the state to the coalescer, which shows
+// it from a worker at the stream's rate.
+static FlMethodResponse* handle_show_progress_notification(
+    NotificationMasterPlugin* self, FlValue* args) {
+  ProgressArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kShowProgressArgs, &a, &error) || a.id <= 0) {
+    return nm_args::invalid_arguments(
+        "showProgressNotification",
+        error.empty() ? "id must be positive" : error);
+  }
+  bool started = self->progress->start(progress_update(a),
+                                       (int)a.max_updates_per_second);
+  g_autoptr(FlValue) result = fl_value_new_bool(started);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_update_progress(
+    NotificationMasterPlugin* self, FlValue* args) {
+  ProgressArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kUpdateProgressArgs, &a, &error)) {
+    return nm_args::invalid_arguments("updateProgress", error);
+  }
+  bool queued = self->progress->update(progress_update(a));
+  g_autoptr(FlValue) result = fl_value_new_bool(queued);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Displays one coalesced progress state on a worker (the coalescer's sink).
+// The task holds a plugin reference like method calls do. A stream cancelled
+// before the display skips it; one cancelled during it closes the popup
+// again, since the cancel may have run before it was stored.
+static void post_progress_display(NotificationMasterPlugin* self,
+                                  const nm_progress::Update& update) {
+  g_object_ref(self);
+  self->workers->post([self, update]() {
+    if (!self->progress->cancelled(update.id)) {
+      show_notification(update.title.c_str(), update.message.c_str(),
+                        "default", update.id, nullptr, update.value,
+                        !update.final);
     }
-  } else if (strcmp(method, "stopBackgroundPollingService") == 0) {
-    stop_background_daemon(self);
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else if (strcmp(method, "isBackgroundPollingRunning") == 0) {
-    gboolean running = is_background_daemon_running(self);
-    g_autoptr(FlValue) result = fl_value_new_bool(running);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    if (!self->progress->sent(update.id)) close_live_id(update.id);
+    nm_worker::run_on_context(self->main_context,
+                              [self]() { g_object_unref(self); });
+  });
+}
+
+// searchNotifications limit when the call gives none.
+static constexpr gint64 kDefaultSearchLimit = 20;
+
+struct HistoryArgs {
+  gint64 cursor = -1;
+  gint64 limit = nm_history::kDefaultPageSize;
+  const gchar* channel_id = nullptr;
+  const gchar* topic = nullptr;
+  gint64 since = 0;
+  gint64 until = 0;
+};
+
+static const nm_args::Field<HistoryArgs> kHistoryArgs[] = {
+    nm_args::field("cursor", &HistoryArgs::cursor),
+    nm_args::field("limit", &HistoryArgs::limit),
+    nm_args::field("channelId", &HistoryArgs::channel_id),
+    nm_args::field("topic", &HistoryArgs::topic),
+    nm_args::field("since", &HistoryArgs::since),
+    nm_args::field("until", &HistoryArgs::until),
+};
 
+// Per-entry values of the reply's flat "items" list, in this order.
+static const char* const kHistoryFields[] = {
+    "seq", "shownAt", "source", "id", "itemId",
+    "title", "message", "channelId", "topic", "bigText"};
+
+// {"fields", "items"} for |records|, laid out like fetchNotifications.
+static FlValue* history_reply(const std::vector<nm_history::Record>& records) {
+  FlValue* result = fl_value_new_map();
+  FlValue* fields = fl_value_new_list();
+  for (const char* field : kHistoryFields) {
+    fl_value_append_take(fields, fl_value_new_string(field));
+  }
+  fl_value_set_string_take(result, "fields", fields);
+  FlValue* flat = fl_value_new_list();
+  for (const auto& record : records) {
+    fl_value_append_take(flat, fl_value_new_int(record.seq));
+    fl_value_append_take(flat, fl_value_new_int(record.shown_at_ms));
+    fl_value_append_take(
+        flat, fl_value_new_string(nm_history::source_name(record.source)));
+    fl_value_append_take(flat, fl_value_new_int(record.notification_id));
+    fl_value_append_take(flat, fl_value_new_string(record.item_id.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(record.title.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(record.message.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(record.channel.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(record.topic.c_str()));
+    fl_value_append_take(flat, fl_value_new_string(record.big_text.c_str()));
+  }
+  fl_value_set_string_take(result, "items", flat);
+  return result;
+}
+
+// getNotificationHistory: one page of history.log, newest first, through
+// the mmap()ed index. The reply is history_reply() plus "nextCursor", which
+// is null on the last page.
+static FlMethodResponse* handle_get_notification_history(
+    NotificationMasterPlugin* self, FlValue* args) {
+  HistoryArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kHistoryArgs, &a, &error)) {
+    return nm_args::invalid_arguments("getNotificationHistory", error);
+  }
+  nm_history::Query query;
+  query.cursor = a.cursor;
+  query.limit = a.limit < 1 ? 1 : (size_t)a.limit;
+  if (a.channel_id) query.channel = a.channel_id;
+  if (a.topic) query.topic = a.topic;
+  query.since_ms = a.since;
+  query.until_ms = a.until;
+  nm_history::Page page = history_reader().query(query);
+
+  g_autoptr(FlValue) result = history_reply(page.records);
+  fl_value_set_string_take(result, "nextCursor",
+                           page.next_cursor < 0
+                               ? fl_value_new_null()
+                               : fl_value_new_int(page.next_cursor));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+struct SearchArgs {
+  const gchar* query = nullptr;
+  gint64 limit = kDefaultSearchLimit;
+};
+
+static const nm_args::Field<SearchArgs> kSearchArgs[] = {
+    nm_args::field("query", &SearchArgs::query, nm_args::kRequired),
+    nm_args::field("limit", &SearchArgs::limit),
+};
+
+// searchNotifications: the newest history records holding every word of
+// the query, the last word matching as a prefix. Indexes what was recorded
+// since the previous search first. The reply is history_reply().
+static FlMethodResponse* handle_search_notifications(
+    NotificationMasterPlugin* self, FlValue* args) {
+  SearchArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kSearchArgs, &a, &error)) {
+    return nm_args::invalid_arguments("searchNotifications", error);
+  }
+  size_t limit = a.limit < 1 ? 1 : (size_t)a.limit;
+  if (limit > nm_history::kMaxPageSize) limit = nm_history::kMaxPageSize;
+  g_autoptr(FlValue) result =
+      history_reply(search_index().search(a.query, limit));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// ── Android-only permission gates — always true / no-op on Linux ─────────
+
+static FlMethodResponse* handle_can_schedule_exact_alarms(
+    NotificationMasterPlugin* self, FlValue* args) {
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_open_exact_alarm_settings(
+    NotificationMasterPlugin* self, FlValue* args) {
+  g_autoptr(FlValue) result = fl_value_new_bool(FALSE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_open_app_notification_settings(
+    NotificationMasterPlugin* self, FlValue* args) {
+  // Open GNOME notification settings if available; ignore errors.
+  g_spawn_command_line_async("gnome-control-center notifications", nullptr);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// ── Firebase — not applicable on Linux (returns true, no-op) ────────────
+
+static FlMethodResponse* handle_set_firebase_as_active_service(
+    NotificationMasterPlugin* self, FlValue* args) {
+  // Mark firebase as active so getActiveNotificationService() reports it.
+  nm_prefs::PrefsStore::get().set_string("service", "active", "firebase");
+  stop_polling_service(self);
+  self->is_foreground_active = FALSE;
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// ── Background daemon (notification_master_poller) ─────────────────────
+
+static FlMethodResponse* handle_start_background_polling_service(
+    NotificationMasterPlugin* self, FlValue* args) {
+  PollingArgs a;
+  std::string error;
+  if (!nm_args::decode(args, kPollingArgs, &a, &error)) {
+    return nm_args::invalid_arguments("startBackgroundPollingService", error);
+  }
+  if (a.polling_url[0] == '\0') {
+    return nm_args::invalid_arguments("startBackgroundPollingService",
+                                      "pollingUrl must not be empty");
+  }
+  gboolean ok = start_background_daemon(self, a.polling_url,
+                                        (gint)a.interval_minutes);
+  g_autoptr(FlValue) result = fl_value_new_bool(ok);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_stop_background_polling_service(
+    NotificationMasterPlugin* self, FlValue* args) {
+  stop_background_daemon(self);
+  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_is_background_polling_running(
+    NotificationMasterPlugin* self, FlValue* args) {
+  gboolean running = is_background_daemon_running(self);
+  g_autoptr(FlValue) result = fl_value_new_bool(running);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_get_polling_metrics(
+    NotificationMasterPlugin* self, FlValue* args) {
+  g_autoptr(FlValue) result = get_polling_metrics();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* handle_dump_trace(NotificationMasterPlugin* self,
+                                           FlValue* args) {
+  // Path of the written Chrome trace, or null when NM_TRACE is not set.
+  std::string path = nm_trace::dump();
+  g_autoptr(FlValue) result = path.empty() ? fl_value_new_null()
+                                           : fl_value_new_string(path.c_str());
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+typedef FlMethodResponse* (*MethodHandler)(NotificationMasterPlugin* self,
+                                           FlValue* args);
+
+// Where a handler runs (see notification_master_plugin_call()).
+enum Lane {
+  kInline,    // cheap and never blocks: on the calling (main) thread
+  kSerial,    // touches plugin state, prefs or files: worker pool, in order
+  kParallel,  // independent blocking work (D-Bus display): worker pool
+  kNetwork,   // waits on a remote server: fetch pool, at most kFetchThreads
+};
+
+struct MethodEntry {
+  const char* name;
+  MethodHandler handler;
+  Lane lane;
+};
+
+// Every method the channel answers. Lookup goes through a perfect hash built
+// from this table at compile time (see nm_dispatch.h), so the order here
+// does not affect dispatch cost.
+static constexpr MethodEntry kMethods[] = {
+    {"getPlatformVersion", handle_get_platform_version, kInline},
+    {"requestNotificationPermission", handle_request_notification_permission,
+     kInline},
+    {"checkNotificationPermission", handle_check_notification_permission,
+     kInline},
+    {"showNotification", handle_show_notification, kParallel},
+    {"showBigTextNotification", handle_show_big_text_notification, kParallel},
+    {"showImageNotification", handle_show_image_notification, kParallel},
+    {"showNotificationWithActions", handle_show_notification_with_actions,
+     kParallel},
+    {"createCustomChannel", handle_create_custom_channel, kSerial},
+    {"startNotificationPolling", handle_start_notification_polling, kSerial},
+    {"stopNotificationPolling", handle_stop_notification_polling, kSerial},
+    {"startForegroundService", handle_start_foreground_service, kSerial},
+    {"stopForegroundService", handle_stop_foreground_service, kSerial},
+    {"getActiveNotificationService", handle_get_active_notification_service,
+     kSerial},
+    {"showHeadsUpNotification", handle_show_heads_up_notification, kParallel},
+    {"showFullScreenNotification", handle_show_full_screen_notification,
+     kParallel},
+    {"showStyledNotification", handle_show_styled_notification, kParallel},
+    {"getDeviceToken", handle_get_device_token, kSerial},
+    {"subscribeToTopic", handle_subscribe_to_topic, kSerial},
+    {"unsubscribeFromTopic", handle_unsubscribe_from_topic, kSerial},
+    {"subscribeToTopics", handle_subscribe_to_topics, kSerial},
+    {"unsubscribeFromTopics", handle_unsubscribe_from_topics, kSerial},
+    {"setTopics", handle_set_topics, kSerial},
+    {"getSubscribedTopics", handle_get_subscribed_topics, kSerial},
+    {"scheduleNotification", handle_schedule_notification, kSerial},
+    {"cancelScheduledNotification", handle_cancel_scheduled_notification,
+     kSerial},
+    {"cancelAllScheduledNotifications",
+     handle_cancel_all_scheduled_notifications, kSerial},
+    {"getPendingScheduledNotifications",
+     handle_get_pending_scheduled_notifications, kSerial},
+    {"canScheduleExactAlarms", handle_can_schedule_exact_alarms, kInline},
+    {"openExactAlarmSettings", handle_open_exact_alarm_settings, kInline},
+    {"openAppNotificationSettings", handle_open_app_notification_settings,
+     kParallel},
+    {"setFirebaseAsActiveService", handle_set_firebase_as_active_service,
+     kSerial},
+    {"startBackgroundPollingService", handle_start_background_polling_service,
+     kSerial},
+    {"stopBackgroundPollingService", handle_stop_background_polling_service,
+     kSerial},
+    {"isBackgroundPollingRunning", handle_is_background_polling_running,
+     kSerial},
+    {"getPollingMetrics", handle_get_polling_metrics, kParallel},
+    {"dumpTrace", handle_dump_trace, kParallel},
+    {"fetchNotifications", handle_fetch_notifications, kNetwork},
+    {"cancelNotification", handle_cancel_notification, kParallel},
+    {"cancelAllNotifications", handle_cancel_all_notifications, kParallel},
+    {"showProgressNotification", handle_show_progress_notification, kInline},
+    {"updateProgress", handle_update_progress, kInline},
+    {"getNotificationHistory", handle_get_notification_history, kParallel},
+    {"searchNotifications", handle_search_notifications, kParallel},
+};
+
+static constexpr auto kMethodIndex =
+    nm_dispatch::build_index<nm_dispatch::slots_for(
+        sizeof(kMethods) / sizeof(kMethods[0]))>(kMethods);
+static_assert(kMethodIndex.ok, "kMethods has a duplicate method name");
+
+// Runs one method call and returns its response (transfer full).
+FlMethodResponse* notification_master_plugin_dispatch(
+    NotificationMasterPlugin* self, const gchar* method, FlValue* args) {
+  int i = kMethodIndex.find(kMethods, method);
+  if (i < 0) return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  return kMethods[i].handler(self, args);
+}
+
+void notification_master_plugin_call(NotificationMasterPlugin* self,
+                                     const gchar* method, FlValue* args,
+                                     ResponseCallback callback,
+                                     gpointer user_data) {
+  int i = kMethodIndex.find(kMethods, method);
+  if (i < 0 || kMethods[i].lane == kInline) {
+    FlMethodResponse* response =
+        i < 0 ? FL_METHOD_RESPONSE(fl_method_not_implemented_response_new())
+              : kMethods[i].handler(self, args);
+    callback(response, user_data);
+    g_object_unref(response);
+    return;
+  }
+
+  // The task keeps the plugin and |args| alive; both are released on the
+  // main context after the callback, so the plugin is never disposed on a
+  // worker thread.
+  MethodHandler handler = kMethods[i].handler;
+  g_object_ref(self);
+  if (args) fl_value_ref(args);
+  nm_worker::Task task = [self, handler, args, callback, user_data]() {
+    FlMethodResponse* response = handler(self, args);
+    nm_worker::run_on_context(
+        self->main_context, [self, args, response, callback, user_data]() {
+          callback(response, user_data);
+          g_object_unref(response);
+          if (args) fl_value_unref(args);
+          g_object_unref(self);
+        });
+  };
+  if (kMethods[i].lane == kSerial) {
+    self->workers->post_serial(task);
+  } else if (kMethods[i].lane == kNetwork) {
+    self->fetch_workers->post(task);
   } else {
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    self->workers->post(task);
   }
+}
 
+static void respond_to_method_call(FlMethodResponse* response,
+                                   gpointer user_data) {
+  FlMethodCall* method_call = FL_METHOD_CALL(user_data);
   fl_method_call_respond(method_call, response, nullptr);
+  g_object_unref(method_call);
+}
+
+// Called when a method call is received from Flutter. Blocking handlers run
+// on the worker pool and respond later from the main context, so the UI
+// thread only pays for the lookup and the hand-off.
+static void notification_master_plugin_handle_method_call(
+    NotificationMasterPlugin* self,
+    FlMethodCall* method_call) {
+  notification_master_plugin_call(self, fl_method_call_get_name(method_call),
+                                  fl_method_call_get_args(method_call),
+                                  respond_to_method_call,
+                                  g_object_ref(method_call));
 }
 
 FlMethodResponse* get_platform_version() {
@@ -600,39 +1491,17 @@ FlMethodResponse* get_platform_version() {
   return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
 }
 
-// ── GKeyFile-based persistent storage ────────────────────────────────────────
-// File: ~/.config/notification_master/prefs.ini
-
-static gchar* get_prefs_path() {
-  return g_build_filename(g_get_user_config_dir(),
-                          "notification_master", "prefs.ini", nullptr);
-}
-
-static GKeyFile* load_prefs() {
-  GKeyFile* kf = g_key_file_new();
-  gchar* path = get_prefs_path();
-  g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, nullptr);
-  g_free(path);
-  return kf;
-}
-
-static void save_prefs(GKeyFile* kf) {
-  gchar* path = get_prefs_path();
-  // Ensure directory exists
-  gchar* dir = g_path_get_dirname(path);
-  g_mkdir_with_parents(dir, 0700);
-  g_free(dir);
-  g_key_file_save_to_file(kf, path, nullptr);
-  g_free(path);
-}
+// ── Persistent storage ───────────────────────────────────────────────────────
+// File: ~/.config/notification_master/prefs.ini, cached in memory by
+// nm_prefs::PrefsStore and written back by its debounced write-behind.
 
 // Returns a heap-allocated string (caller must g_free)
 static gchar* get_device_token() {
-  GKeyFile* kf = load_prefs();
-  gchar* token = g_key_file_get_string(kf, "device", "token", nullptr);
-  g_key_file_free(kf);
+  nm_prefs::PrefsStore& prefs = nm_prefs::PrefsStore::get();
+  std::string cached = prefs.get_string("device", "token");
 
-  if (token && strlen(token) > 0) {
+  if (!cached.empty()) {
+    gchar* token = g_strdup(cached.c_str());
     // Local confirmation notification
     gchar* preview = g_strndup(token, 24);
     gchar* msg = g_strdup_printf("Token (cached): %s…", preview);
@@ -641,16 +1510,12 @@ static gchar* get_device_token() {
     g_free(msg);
     return token;
   }
-  g_free(token);
 
   // Generate a stable ID from /etc/machine-id (standard on systemd distros)
   gchar* machine_id = nullptr;
   if (g_file_get_contents("/etc/machine-id", &machine_id, nullptr, nullptr)) {
     g_strstrip(machine_id);
-    GKeyFile* kf2 = load_prefs();
-    g_key_file_set_string(kf2, "device", "token", machine_id);
-    save_prefs(kf2);
-    g_key_file_free(kf2);
+    prefs.set_string("device", "token", machine_id);
     gchar* preview = g_strndup(machine_id, 24);
     gchar* msg = g_strdup_printf("Token (machine-id): %s…", preview);
     show_notification("Device Token (Linux)", msg, "default");
@@ -662,40 +1527,16 @@ static gchar* get_device_token() {
   // Fallback: hostname
   const gchar* host = g_get_host_name();
   gchar* id = g_strdup(host ? host : "linux-device");
-  GKeyFile* kf3 = load_prefs();
-  g_key_file_set_string(kf3, "device", "token", id);
-  save_prefs(kf3);
-  g_key_file_free(kf3);
+  prefs.set_string("device", "token", id);
   gchar* msg = g_strdup_printf("Token (hostname): %s", id);
   show_notification("Device Token (Linux)", msg, "default");
   g_free(msg);
   return id;
 }
 
-static void subscribe_to_topic(const gchar* topic) {
-  GKeyFile* kf = load_prefs();
-  gsize len = 0;
-  gchar** topics = g_key_file_get_string_list(kf, "topics", "subscribed", &len, nullptr);
-
-  gboolean found = FALSE;
-  for (gsize i = 0; i < len; i++) {
-    if (g_strcmp0(topics[i], topic) == 0) { found = TRUE; break; }
-  }
-
-  if (!found) {
-    gchar** new_topics = g_new(gchar*, len + 2);
-    for (gsize i = 0; i < len; i++) new_topics[i] = topics[i];
-    new_topics[len] = g_strdup(topic);
-    new_topics[len + 1] = nullptr;
-    g_key_file_set_string_list(kf, "topics", "subscribed",
-                               (const gchar* const*)new_topics, len + 1);
-    g_free(new_topics[len]);
-    g_free(new_topics);
-    save_prefs(kf);
-  }
-
-  g_strfreev(topics);
-  g_key_file_free(kf);
+static void subscribe_to_topic(const gchar* topic, gboolean show_confirmation) {
+  nm_prefs::PrefsStore::get().add_topic(topic);
+  if (!show_confirmation) return;
 
   // Local confirmation notification
   gchar* msg = g_strdup_printf("You are now subscribed to topic: %s", topic);
@@ -703,26 +1544,9 @@ static void subscribe_to_topic(const gchar* topic) {
   g_free(msg);
 }
 
-static void unsubscribe_from_topic(const gchar* topic) {
-  GKeyFile* kf = load_prefs();
-  gsize len = 0;
-  gchar** topics = g_key_file_get_string_list(kf, "topics", "subscribed", &len, nullptr);
-
-  GPtrArray* remaining = g_ptr_array_new();
-  for (gsize i = 0; i < len; i++) {
-    if (g_strcmp0(topics[i], topic) != 0) {
-      g_ptr_array_add(remaining, topics[i]);
-    }
-  }
-
-  g_key_file_set_string_list(kf, "topics", "subscribed",
-                             (const gchar* const*)remaining->pdata,
-                             remaining->len);
-  save_prefs(kf);
-
-  g_ptr_array_free(remaining, FALSE);
-  g_strfreev(topics);
-  g_key_file_free(kf);
+static void unsubscribe_from_topic(const gchar* topic, gboolean show_confirmation) {
+  nm_prefs::PrefsStore::get().remove_topic(topic);
+  if (!show_confirmation) return;
 
   // Local confirmation notification
   gchar* msg = g_strdup_printf("You have unsubscribed from topic: %s", topic);
@@ -730,148 +1554,264 @@ static void unsubscribe_from_topic(const gchar* topic) {
   g_free(msg);
 }
 
+// subscribeToTopics / unsubscribeFromTopics / setTopics: applies the whole
+// diff in one prefs transaction. At most ONE summary popup is shown, and only
+// when the caller asks for it with showConfirmation: true.
+static void apply_topic_change(const gchar* method,
+                               const std::vector<std::string>& topics,
+                               gboolean confirm) {
+
+  std::vector<std::string> added, removed;
+  nm_prefs::PrefsStore& prefs = nm_prefs::PrefsStore::get();
+  if (strcmp(method, "subscribeToTopics") == 0) {
+    prefs.update_topics(topics, {}, &added, nullptr);
+  } else if (strcmp(method, "unsubscribeFromTopics") == 0) {
+    prefs.update_topics({}, topics, nullptr, &removed);
+  } else {
+    prefs.set_topics(topics, &added, &removed);
+  }
+
+  if (confirm && (!added.empty() || !removed.empty())) {
+    gchar* msg = g_strdup_printf("Subscribed to %zu topic(s), unsubscribed from %zu",
+                                 added.size(), removed.size());
+    show_notification("Topics updated", msg, "default");
+    g_free(msg);
+  }
+}
+
 // Returns a new FlValue list — caller owns it (use g_autoptr)
 static FlValue* get_subscribed_topics() {
-  GKeyFile* kf = load_prefs();
-  gsize len = 0;
-  gchar** topics = g_key_file_get_string_list(kf, "topics", "subscribed", &len, nullptr);
-  g_key_file_free(kf);
-
   FlValue* list = fl_value_new_list();
-  for (gsize i = 0; i < len; i++) {
-    fl_value_append_take(list, fl_value_new_string(topics[i]));
+  for (const auto& topic : nm_prefs::PrefsStore::get().topics()) {
+    fl_value_append_take(list, fl_value_new_string(topic.c_str()));
   }
-  g_strfreev(topics);
   return list;
 }
 
 // ── HTTP polling helpers ──────────────────────────────────────────────────────
-// Parse and display a JSON polling response.
-// Expected shape: { "notifications": [ { "title": "...", "message": "...",
-//                                        "bigText": "..." }, ... ] }
+// Parse and display a JSON polling response (shapes: see nm_feed.h).
+// Items whose "topic" is not among |topics| are dropped (see nm_topics.h).
 // Non-conforming responses fall back to a single generic notification.
-static void process_poll_response(const gchar* body, gsize len) {
-  if (!body || len == 0) {
-    show_notification("Notification", "New notification received", "default");
-    return;
+void process_poll_response(const gchar* body, gsize len,
+                           const std::vector<std::string>& topics) {
+  nm_metrics::PollMetrics& metrics = nm_metrics::global();
+  std::vector<nm_feed::Item> items;
+  std::string error;
+  nm_metrics::Stopwatch timer;
+  bool parsed;
+  {
+    NM_TRACE_SCOPE("parse", "parse");
+    parsed = nm_feed::parse(body, len, &items, &error);
   }
-
-  GError* err = nullptr;
-  JsonParser* parser = json_parser_new();
-  gboolean ok = json_parser_load_from_data(parser, body, (gssize)len, &err);
-
-  if (!ok || err) {
-    g_print("[NotificationMaster] JSON parse error: %s\n",
-            err ? err->message : "unknown");
-    if (err) g_error_free(err);
-    g_object_unref(parser);
-    show_notification("Notification", "New notification received", "default");
+  metrics.parse_duration.observe(timer.seconds());
+  if (!parsed) {
+    if (body && len > 0) {
+      g_print("[NotificationMaster] JSON parse error: %s\n", error.c_str());
+    }
+    show_notification("Notification", "New notification received", "default",
+                      0);
     return;
   }
 
-  JsonNode* root = json_parser_get_root(parser);
-  if (!root || !JSON_NODE_HOLDS_OBJECT(root)) {
-    g_object_unref(parser);
-    show_notification("Notification", "New notification received", "default");
-    return;
+  metrics.poll_items.observe((double)items.size());
+  show_feed_items(items, nm_topics::TopicMatcher(topics));
+}
+
+// Displays the |items| that pass |matcher|, each preceded by a fetched event
+// for Dart, and queues a delivery receipt for every one shown.
+static void show_feed_items(const std::vector<nm_feed::Item>& items,
+                            const nm_topics::TopicMatcher& matcher) {
+  nm_metrics::PollMetrics& metrics = nm_metrics::global();
+  NM_TRACE_SCOPE("show_items", "display");
+  for (const auto& item : items) {
+    if (!matcher.matches(item.topic)) {
+      metrics.topic_filtered.inc();
+      continue;
+    }
+    nm_events::Event fetched;
+    fetched.type = nm_events::kFetched;
+    fetched.item_id = item.id;
+    fetched.item = item;
+    emit_event(std::move(fetched));
+    const gchar* title =
+        item.title.empty() ? "Notification" : item.title.c_str();
+    const std::string& body_text =
+        item.big_text.empty() ? item.message : item.big_text;
+    if (show_notification(title, body_text.c_str(), item.channel.c_str(), 0,
+                          item.id.c_str())) {
+      nm_receipts::Receipt receipt;
+      receipt.id = item.id;
+      receipt.topic = item.topic;
+      receipt.sent_at_ms = item.sent_at_ms;
+      receipt.displayed_at_ms = nm_feed::now_epoch_ms();
+      metrics.record_delivery(receipt.sent_at_ms, receipt.displayed_at_ms);
+      g_receipts.add(receipt);
+      nm_history::Record record;
+      record.source = nm_history::kFeed;
+      record.shown_at_ms = receipt.displayed_at_ms;
+      record.item_id = item.id;
+      record.title = title;
+      record.message = item.message;
+      record.big_text = item.big_text;
+      record.channel = item.channel;
+      record.topic = item.topic;
+      // Like show_notification, a sink keeps stub displays out of the
+      // user's history.
+      if (!g_notification_sink) history_writer().append(record);
+    }
   }
+}
 
-  JsonObject* obj = json_node_get_object(root);
-  if (!json_object_has_member(obj, "notifications")) {
-    g_object_unref(parser);
-    show_notification("Notification", "New notification received", "default");
+// POSTs every queued delivery receipt to |receipts_url| in one request
+// through the shared client. Failed batches are retried next cycle.
+static void post_receipts(const std::string& receipts_url,
+                          GCancellable* cancellable) {
+  if (receipts_url.empty() || g_receipts.empty()) return;
+  NM_TRACE_SCOPE("post_receipts", "http");
+  std::string body;
+  size_t count = g_receipts.take_json(&body);
+  guint status = 0;
+  if (!nm_http::Client::get().post_json(receipts_url, body, cancellable,
+                                        &status)) {
+    g_receipts.commit();  // unusable URL: drop rather than grow forever
     return;
   }
-
-  JsonArray* arr = json_object_get_array_member(obj, "notifications");
-  guint count = json_array_get_length(arr);
-  for (guint i = 0; i < count; i++) {
-    JsonObject* n = json_array_get_object_element(arr, i);
-    const gchar* title   = json_object_has_member(n, "title")   ?
-                           json_object_get_string_member(n, "title")   : "Notification";
-    const gchar* big_text = json_object_has_member(n, "bigText") ?
-                            json_object_get_string_member(n, "bigText") : nullptr;
-    const gchar* message = json_object_has_member(n, "message") ?
-                           json_object_get_string_member(n, "message") : "";
-    const gchar* body_text = (big_text && big_text[0]) ? big_text : message;
-    show_notification(title, body_text, "default");
+  if (SOUP_STATUS_IS_SUCCESSFUL(status)) {
+    g_receipts.commit();
+    nm_metrics::global().receipts_sent.inc(count);
+  } else {
+    g_receipts.restore();
+    nm_metrics::global().receipts_failed.inc(count);
   }
-
-  g_object_unref(parser);
 }
 
-// Perform one synchronous HTTP GET using libsoup and process the response.
-// Called from the background polling thread — must not touch GTK/GLib main loop.
-static void perform_poll(const gchar* polling_url) {
 #if SOUP_VERSION == 3
-  SoupSession* session = soup_session_new();
-  SoupMessage* msg = soup_message_new(SOUP_METHOD_GET, polling_url);
-  if (!msg) { g_object_unref(session); return; }
-
-  GError* err = nullptr;
-  GBytes* bytes = soup_session_send_and_read(session, msg, nullptr, &err);
-  if (err) {
-    g_print("[NotificationMaster] HTTP error: %s\n", err->message);
-    g_error_free(err);
-  } else if (bytes) {
-    gsize len = 0;
-    const gchar* data = (const gchar*)g_bytes_get_data(bytes, &len);
-    process_poll_response(data, len);
-    g_bytes_unref(bytes);
-  }
-  g_object_unref(msg);
-  g_object_unref(session);
-#else
-  // libsoup 2.4 synchronous API
-  SoupSession* session = soup_session_new();
-  SoupMessage* msg = soup_message_new(SOUP_METHOD_GET, polling_url);
-  if (!msg) { g_object_unref(session); return; }
-
-  guint status = soup_session_send_message(session, msg);
-  if (SOUP_STATUS_IS_SUCCESSFUL(status)) {
-    SoupMessageBody* body = msg->response_body;
-    if (body && body->data) {
-      process_poll_response(body->data, (gsize)body->length);
+// Splits a finished request into dns / connect / tls / wait / transfer trace
+// spans from libsoup's message metrics (microseconds, monotonic clock).
+static void trace_soup_phases(SoupMessage* msg) {
+  SoupMessageMetrics* m = soup_message_get_metrics(msg);
+  if (!m) return;
+  auto span = [](const char* name, guint64 from_us, guint64 to_us) {
+    if (from_us != 0 && to_us > from_us) {
+      nm_trace::record(name, "http", from_us * 1000, (to_us - from_us) * 1000);
     }
-  } else {
-    g_print("[NotificationMaster] HTTP status %u for %s\n", status, polling_url);
+  };
+  span("dns", soup_message_metrics_get_dns_start(m),
+       soup_message_metrics_get_dns_end(m));
+  span("connect", soup_message_metrics_get_connect_start(m),
+       soup_message_metrics_get_tls_start(m)
+           ? soup_message_metrics_get_tls_start(m)
+           : soup_message_metrics_get_connect_end(m));
+  span("tls", soup_message_metrics_get_tls_start(m),
+       soup_message_metrics_get_connect_end(m));
+  span("wait", soup_message_metrics_get_request_start(m),
+       soup_message_metrics_get_response_start(m));
+  span("transfer", soup_message_metrics_get_response_start(m),
+       soup_message_metrics_get_response_end(m));
+}
+#endif
+
+// GETs |url| through the shared client (nm_http.h), adding the
+// X-NM-Topics-Hash header for |topics| to |headers|, and records HTTP
+// metrics and trace spans. The request is conditional on |validators| when
+// given. Returns false when |cancellable| fired, in which case nothing is
+// recorded.
+static bool fetch_feed(const std::string& url,
+                       const std::vector<std::string>& topics,
+                       nm_http::Headers headers,
+                       nm_http::ValidatorCache* validators,
+                       GCancellable* cancellable,
+                       nm_http::Response* response) {
+  if (!topics.empty()) {
+    headers.emplace_back(nm_topics::kTopicsHashHeader,
+                         nm_topics::topic_set_hash(topics));
   }
-  g_object_unref(msg);
-  g_object_unref(session);
+  nm_http::Inspector inspect;
+#if SOUP_VERSION == 3
+  if (nm_trace::enabled()) inspect = trace_soup_phases;
 #endif
+  nm_metrics::PollMetrics& metrics = nm_metrics::global();
+  nm_metrics::Stopwatch timer;
+  {
+    NM_TRACE_SCOPE("http_get", "http");
+    nm_http::Client::get().get(url, headers, validators, cancellable,
+                               response, inspect);
+  }
+  if (response->cancelled) return false;
+  metrics.http_duration.observe(timer.seconds());
+  metrics.http_responses.inc((int)response->status);
+  if (response->status == 0) {
+    g_print("[NotificationMaster] HTTP error: %s\n", response->error.c_str());
+  } else if (SOUP_STATUS_IS_SUCCESSFUL(response->status)) {
+    metrics.http_bytes.observe((double)response->body.size());
+  } else if (!response->not_modified) {
+    g_print("[NotificationMaster] HTTP status %u for %s\n", response->status,
+            url.c_str());
+  }
+  return true;
+}
+
+// Perform one synchronous HTTP GET and process the response.
+// Called from the background polling thread — must not touch GTK/GLib main loop.
+// The request is scoped to the subscribed topics via a `topics=` query
+// parameter and the X-NM-Topics-Hash header, and is conditional: a 304 means
+// the feed has not changed since the last poll, so nothing is shown.
+// Receipts for the items shown are then posted to |receipts_url| (if set) as
+// one batch. Cancelling |cancellable| (stopNotificationPolling) ends an
+// in-flight request at once.
+static void perform_poll(const gchar* polling_url,
+                         const std::string& receipts_url,
+                         GCancellable* cancellable) {
+  NM_TRACE_SCOPE("poll_cycle", "poll");
+  std::vector<std::string> topics = nm_prefs::PrefsStore::get().topics();
+  std::string url = nm_topics::scoped_url(polling_url, topics);
+  nm_metrics::global().polls.inc();
+  nm_http::Response response;
+  if (!fetch_feed(url, topics, nm_http::Headers(), &poll_validators(),
+                  cancellable, &response)) {
+    return;
+  }
+  if (SOUP_STATUS_IS_SUCCESSFUL(response.status)) {
+    process_poll_response(response.body.data(), response.body.size(), topics);
+  }
+  post_receipts(receipts_url, cancellable);
+}
+
+// Prometheus text for this process ("plugin") and the daemon's last snapshot
+// ("daemon", from poller.prom; omitted if the daemon never ran).
+static FlValue* get_polling_metrics() {
+  FlValue* result = fl_value_new_map();
+  std::string plugin = nm_metrics::global().render_prometheus("plugin");
+  fl_value_set_string_take(result, "plugin",
+                           fl_value_new_string(plugin.c_str()));
+  gchar* daemon = nullptr;
+  if (g_file_get_contents(nm_config::metrics_path().c_str(), &daemon, nullptr,
+                          nullptr)) {
+    fl_value_set_string_take(result, "daemon", fl_value_new_string(daemon));
+    g_free(daemon);
+  }
+  return result;
 }
 
 // ---------------------------------------------------------------------------
 // Background daemon helpers
 // ---------------------------------------------------------------------------
 
-// Write a value to ~/.config/notification_master/poller.conf
-static void daemon_write_conf(const gchar* key, const gchar* value) {
-  gchar* path = g_build_filename(g_get_user_config_dir(),
-                                 "notification_master", "poller.conf", nullptr);
-  gchar* dir  = g_build_filename(g_get_user_config_dir(),
-                                 "notification_master", nullptr);
-  g_mkdir_with_parents(dir, 0700);
-
-  GKeyFile* kf = g_key_file_new();
-  g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, nullptr);
-  g_key_file_set_string(kf, "poller", key, value);
-  g_key_file_save_to_file(kf, path, nullptr);
-
-  g_key_file_free(kf);
-  g_free(dir);
-  g_free(path);
+// Write values to ~/.config/notification_master/poller.conf in one atomic
+// replace. The daemon reloads the file when inotify reports the rename.
+static void daemon_write_conf(const nm_config::KeyValues& values) {
+  nm_config::write_key_file(nm_config::config_path(), nm_config::kGroup, values);
 }
 
 static gboolean start_background_daemon(NotificationMasterPlugin* self,
                                         const gchar* url,
                                         gint interval_minutes) {
   // If already running, update URL/interval and return success.
+  gchar iv_str[32];
+  snprintf(iv_str, sizeof(iv_str), "%d", interval_minutes > 0 ? interval_minutes : 15);
+
   if (is_background_daemon_running(self)) {
-    daemon_write_conf("url", url);
-    gchar* iv = g_strdup_printf("%d", interval_minutes > 0 ? interval_minutes : 15);
-    daemon_write_conf("interval", iv);
-    g_free(iv);
+    daemon_write_conf({{nm_config::kUrl, url}, {nm_config::kInterval, iv_str}});
     return TRUE;
   }
 
@@ -891,8 +1831,11 @@ static gboolean start_background_daemon(NotificationMasterPlugin* self,
     return FALSE;
   }
 
-  gchar iv_str[32];
-  snprintf(iv_str, sizeof(iv_str), "%d", interval_minutes > 0 ? interval_minutes : 15);
+  // Persist the full config before launching so the daemon finds it on its
+  // first read and has nothing to write back.
+  daemon_write_conf({{nm_config::kUrl, url},
+                     {nm_config::kInterval, iv_str},
+                     {nm_config::kEnabled, "1"}});
 
   gchar* argv[] = {
     daemon,
@@ -921,12 +1864,11 @@ static gboolean start_background_daemon(NotificationMasterPlugin* self,
 
   self->daemon_pid    = pid;
   self->daemon_active = TRUE;
-  daemon_write_conf("enabled", "1");
   return TRUE;
 }
 
 static void stop_background_daemon(NotificationMasterPlugin* self) {
-  daemon_write_conf("enabled", "0");
+  daemon_write_conf({{nm_config::kEnabled, "0"}});
 
   if (self->daemon_active && self->daemon_pid > 0) {
     kill(self->daemon_pid, SIGTERM);
@@ -962,21 +1904,39 @@ static void start_polling_service(NotificationMasterPlugin* self,
   std::string url_copy(polling_url ? polling_url : "");
   gint interval = (interval_minutes > 0) ? interval_minutes : 15;
 
-  self->polling_thread = new std::thread([self, url_copy, interval]() {
+  // Optional receipts endpoint, shared with the daemon via poller.conf, and
+  // the load harness's sub-minute period from the environment.
+  nm_config::PollerConfigStore conf;
+  conf.load();
+  std::string receipts_url = conf.current().receipts_url;
+  gint period_s = conf.current().interval_seconds > 0
+                      ? conf.current().interval_seconds
+                      : interval * 60;
+
+  self->poll_cancellable = g_cancellable_new();
+  GCancellable* cancellable = self->poll_cancellable;
+  self->polling_thread = new std::thread([self, url_copy, period_s,
+                                          receipts_url, cancellable]() {
+    nm_trace::set_thread_name("polling_thread");
+    // Visible in top -H and /proc (the load harness samples its CPU time).
+    pthread_setname_np(pthread_self(), "nm-polling");
     // Fire one poll immediately on start.
     if (!self->stop_polling && !url_copy.empty()) {
-      perform_poll(url_copy.c_str());
+      perform_poll(url_copy.c_str(), receipts_url, cancellable);
     }
 
-    // Then repeat every `interval` minutes, checking stop_polling every second
-    // so shutdown is responsive without sleeping the full interval.
-    for (gint elapsed = 0; !self->stop_polling; elapsed++) {
-      std::this_thread::sleep_for(std::chrono::seconds(1));
+    // Then repeat every `period_s` seconds, checking stop_polling every second
+    // so shutdown is responsive without sleeping the full interval. Time comes
+    // from nm_clock so tests can run this loop on a SimulatedClock.
+    nm_clock::Clock& clock = nm_clock::get();
+    int64_t next_poll = clock.monotonic_ms() + (int64_t)period_s * 1000;
+    while (!self->stop_polling) {
+      clock.sleep_ms(std::min<int64_t>(next_poll - clock.monotonic_ms(), 1000));
       if (self->stop_polling) break;
-      if (elapsed >= interval * 60) {
-        elapsed = 0;
+      if (clock.monotonic_ms() >= next_poll) {
+        next_poll = clock.monotonic_ms() + (int64_t)period_s * 1000;
         if (!url_copy.empty()) {
-          perform_poll(url_copy.c_str());
+          perform_poll(url_copy.c_str(), receipts_url, cancellable);
         }
       }
     }
@@ -987,31 +1947,231 @@ static void start_polling_service(NotificationMasterPlugin* self,
 static void stop_polling_service(NotificationMasterPlugin* self) {
   if (!self->is_polling_active) return;
 
+  // Runs on a worker (or in dispose): the join waits for the current poll to
+  // notice the cancellation, never for a full HTTP timeout.
   self->stop_polling = true;
+  g_cancellable_cancel(self->poll_cancellable);
   if (self->polling_thread && self->polling_thread->joinable()) {
     self->polling_thread->join();
     delete self->polling_thread;
     self->polling_thread = nullptr;
   }
+  g_clear_object(&self->poll_cancellable);
   self->is_polling_active = FALSE;
 
   // Clear the persisted active service if it was polling/foreground.
-  GKeyFile* kf = load_prefs();
-  gchar* stored = g_key_file_get_string(kf, "service", "active", nullptr);
-  if (g_strcmp0(stored, "polling") == 0 || g_strcmp0(stored, "foreground") == 0) {
-    g_key_file_set_string(kf, "service", "active", "none");
-    save_prefs(kf);
+  nm_prefs::PrefsStore& prefs = nm_prefs::PrefsStore::get();
+  std::string stored = prefs.get_string("service", "active");
+  if (stored == "polling" || stored == "foreground") {
+    prefs.set_string("service", "active", "none");
+  }
+}
+
+// ── Event channel ─────────────────────────────────────────────────────────────
+
+static void set_string_if_any(FlValue* map, const gchar* key,
+                              const std::string& value) {
+  if (!value.empty()) {
+    fl_value_set_string_take(map, key, fl_value_new_string(value.c_str()));
+  }
+}
+
+FlValue* encode_event_batch(const std::vector<nm_events::Event>& batch) {
+  FlValue* list = fl_value_new_list();
+  for (const auto& event : batch) {
+    FlValue* map = fl_value_new_map();
+    fl_value_set_string_take(map, "type", fl_value_new_int(event.type));
+    if (event.id != 0) {
+      fl_value_set_string_take(map, "id", fl_value_new_int(event.id));
+    }
+    set_string_if_any(map, "itemId", event.item_id);
+    set_string_if_any(map, "action", event.action);
+    if (event.type == nm_events::kClosed) {
+      fl_value_set_string_take(map, "reason", fl_value_new_int(event.reason));
+    }
+    if (event.type == nm_events::kFetched) {
+      const nm_feed::Item& item = event.item;
+      FlValue* payload = fl_value_new_map();
+      set_string_if_any(payload, "id", item.id);
+      set_string_if_any(payload, "title", item.title);
+      set_string_if_any(payload, "message", item.message);
+      set_string_if_any(payload, "bigText", item.big_text);
+      set_string_if_any(payload, "imageUrl", item.image_url);
+      set_string_if_any(payload, "topic", item.topic);
+      if (item.sent_at_ms != 0) {
+        fl_value_set_string_take(payload, "sentAt",
+                                 fl_value_new_int(item.sent_at_ms));
+      }
+      fl_value_set_string_take(map, "payload", payload);
+    }
+    fl_value_append_take(list, map);
+  }
+  return list;
+}
+
+// Batcher sink: one channel message per frame.
+static void send_event_batch(NotificationMasterPlugin* self,
+                             const std::vector<nm_events::Event>& batch) {
+  if (!self->event_channel) return;
+  FlValue* list = encode_event_batch(batch);
+  GError* error = nullptr;
+  if (!fl_event_channel_send(self->event_channel, list, nullptr, &error)) {
+    g_print("[NotificationMaster] Failed to send events: %s\n",
+            error ? error->message : "unknown");
+    if (error) g_error_free(error);
+  }
+  fl_value_unref(list);
+}
+
+// ActionInvoked (u id, s action_key) and NotificationClosed (u id, u reason)
+// are broadcast for every application's notifications; only ids recorded by
+// show_notification are reported.
+static void on_notification_signal(GDBusConnection* connection,
+                                   const gchar* sender,
+                                   const gchar* object_path,
+                                   const gchar* interface_name,
+                                   const gchar* signal_name,
+                                   GVariant* parameters, gpointer user_data) {
+  NotificationMasterPlugin* self = NOTIFICATION_MASTER_PLUGIN(user_data);
+  nm_events::Event event;
+  guint32 server_id = 0;
+  if (g_strcmp0(signal_name, "ActionInvoked") == 0) {
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(us)"))) return;
+    const gchar* action = nullptr;
+    g_variant_get(parameters, "(u&s)", &server_id, &action);
+    event.type = nm_events::kActionInvoked;
+    event.action = action;
+  } else {
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(uu)"))) return;
+    guint32 reason = 0;
+    g_variant_get(parameters, "(uu)", &server_id, &reason);
+    event.type = nm_events::kClosed;
+    event.reason = (int32_t)reason;
   }
-  g_free(stored);
-  g_key_file_free(kf);
+  if (!g_server_ids.lookup(server_id, &event)) return;
+  if (event.type == nm_events::kClosed) g_server_ids.forget(server_id);
+  self->events->push(std::move(event));
+}
+
+static void subscribe_notification_signals(NotificationMasterPlugin* self) {
+  if (!self->bus || self->action_signal_id != 0) return;
+  self->action_signal_id = g_dbus_connection_signal_subscribe(
+      self->bus, nullptr, "org.freedesktop.Notifications", "ActionInvoked",
+      "/org/freedesktop/Notifications", nullptr, G_DBUS_SIGNAL_FLAGS_NONE,
+      on_notification_signal, self, nullptr);
+  self->closed_signal_id = g_dbus_connection_signal_subscribe(
+      self->bus, nullptr, "org.freedesktop.Notifications",
+      "NotificationClosed", "/org/freedesktop/Notifications", nullptr,
+      G_DBUS_SIGNAL_FLAGS_NONE, on_notification_signal, self, nullptr);
+}
+
+static void unsubscribe_notification_signals(NotificationMasterPlugin* self) {
+  if (self->action_signal_id == 0) return;
+  g_dbus_connection_signal_unsubscribe(self->bus, self->action_signal_id);
+  g_dbus_connection_signal_unsubscribe(self->bus, self->closed_signal_id);
+  self->action_signal_id = 0;
+  self->closed_signal_id = 0;
+}
+
+static void bus_ready_cb(GObject* source, GAsyncResult* result,
+                         gpointer user_data) {
+  NotificationMasterPlugin* self = NOTIFICATION_MASTER_PLUGIN(user_data);
+  GError* error = nullptr;
+  GDBusConnection* bus = g_bus_get_finish(result, &error);
+  if (!bus) {
+    g_print("[NotificationMaster] No session bus for events: %s\n",
+            error ? error->message : "unknown");
+    if (error) g_error_free(error);
+  } else if (self->bus) {
+    g_object_unref(bus);  // a second listen raced the first
+  } else {
+    self->bus = bus;
+    if (self->events->enabled()) subscribe_notification_signals(self);
+  }
+  g_object_unref(self);
+}
+
+// Forwards the daemon's fetched items as fetched events, like the polling
+// thread's. The Batcher sends them with the next frame.
+static void start_handoff_listener(NotificationMasterPlugin* self) {
+  if (self->handoff) return;
+  self->handoff = new nm_handoff::Listener(
+      nm_config::handoff_path(),
+      [](std::vector<nm_feed::Item> items, size_t lost) {
+        nm_metrics::global().handoff_lost.inc(lost);
+        for (auto& item : items) {
+          nm_events::Event fetched;
+          fetched.type = nm_events::kFetched;
+          fetched.item_id = item.id;
+          fetched.item = std::move(item);
+          emit_event(std::move(fetched));
+        }
+      });
+  if (!self->handoff->is_listening()) {
+    g_print("[NotificationMaster] Cannot open %s\n",
+            nm_config::handoff_path().c_str());
+  }
+}
+
+static FlMethodErrorResponse* events_listen_cb(FlEventChannel* channel,
+                                               FlValue* args,
+                                               gpointer user_data) {
+  NotificationMasterPlugin* self = NOTIFICATION_MASTER_PLUGIN(user_data);
+  self->events->set_enabled(true);
+  start_handoff_listener(self);
+  if (self->bus) {
+    subscribe_notification_signals(self);
+  } else {
+    g_bus_get(G_BUS_TYPE_SESSION, nullptr, bus_ready_cb, g_object_ref(self));
+  }
+  return nullptr;
+}
+
+static FlMethodErrorResponse* events_cancel_cb(FlEventChannel* channel,
+                                               FlValue* args,
+                                               gpointer user_data) {
+  NotificationMasterPlugin* self = NOTIFICATION_MASTER_PLUGIN(user_data);
+  self->events->set_enabled(false);
+  unsubscribe_notification_signals(self);
+  delete self->handoff;
+  self->handoff = nullptr;
+  return nullptr;
 }
 
 static void notification_master_plugin_dispose(GObject* object) {
   NotificationMasterPlugin* self = NOTIFICATION_MASTER_PLUGIN(object);
   
+  // Every worker task holds a reference, so none is pending here. Dropping
+  // the coalescer first removes its timer.
+  delete self->progress;
+  self->progress = nullptr;
+  delete self->workers;
+  self->workers = nullptr;
+  delete self->fetch_workers;
+  self->fetch_workers = nullptr;
+
   // Stop any active services
   stop_polling_service(self);
-  
+
+  // Write back anything still waiting in the prefs write-behind.
+  nm_prefs::PrefsStore::get().flush();
+
+  nm_trace::dump();
+
+  delete self->handoff;
+  self->handoff = nullptr;
+
+  // Display, polling and the handoff have stopped, so nothing else pushes
+  // events.
+  unsubscribe_notification_signals(self);
+  g_clear_object(&self->bus);
+  nm_events::Batcher* events = self->events;
+  g_events.compare_exchange_strong(events, nullptr);
+  delete self->events;
+  self->events = nullptr;
+
+  g_clear_pointer(&self->main_context, g_main_context_unref);
+
   G_OBJECT_CLASS(notification_master_plugin_parent_class)->dispose(object);
 }
 
@@ -1026,6 +2186,26 @@ static void notification_master_plugin_init(NotificationMasterPlugin* self) {
   self->stop_polling         = false;
   self->daemon_pid           = 0;
   self->daemon_active        = FALSE;
+  self->poll_cancellable     = nullptr;
+  self->workers              = new nm_worker::WorkerPool(kWorkerThreads);
+  self->fetch_workers        = new nm_worker::WorkerPool(kFetchThreads);
+  self->main_context         = g_main_context_ref_thread_default();
+  self->event_channel        = nullptr;
+  self->bus                  = nullptr;
+  self->action_signal_id     = 0;
+  self->closed_signal_id     = 0;
+  self->handoff              = nullptr;
+  self->events               = new nm_events::Batcher(
+      self->main_context,
+      [self](const std::vector<nm_events::Event>& batch) {
+        send_event_batch(self, batch);
+      });
+  g_events.store(self->events);
+  self->progress = new nm_progress::Coalescer(
+      self->main_context, nm_clock::get(),
+      [self](const nm_progress::Update& update) {
+        post_progress_display(self, update);
+      });
 }
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
@@ -1035,6 +2215,10 @@ static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
 }
 
 void notification_master_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  if (nm_trace::init_from_env("plugin")) {
+    nm_trace::set_thread_name("platform");
+  }
+
   NotificationMasterPlugin* plugin = NOTIFICATION_MASTER_PLUGIN(
       g_object_new(notification_master_plugin_get_type(), nullptr));
 
@@ -1047,5 +2231,16 @@ void notification_master_plugin_register_with_registrar(FlPluginRegistrar* regis
                                             g_object_ref(plugin),
                                             g_object_unref);
 
+  plugin->event_channel =
+      fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                           "notification_master/events",
+                           FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(plugin->event_channel, events_listen_cb,
+                                       events_cancel_cb, g_object_ref(plugin),
+                                       g_object_unref);
+
+  // The first searchNotifications then finds the history already indexed.
+  search_index().update_in_background();
+
   g_object_unref(plugin);
 }
\ No newline at end of file
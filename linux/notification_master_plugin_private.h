@@ -1,6 +1,10 @@
 #include <flutter_linux/flutter_linux.h>
 
+#include <string>
+#include <vector>
+
 #include "include/notification_master/notification_master_plugin.h"
+#include "nm_events.h"
 
 // This file exposes some plugin internals for unit testing. See
 // https://github.com/flutter/flutter/issues/88724 for current limitations
@@ -8,3 +12,50 @@
 
 // Handles the getPlatformVersion method call.
 FlMethodResponse *get_platform_version();
+
+// Runs the handler for |method| with |args| (as decoded by the standard codec)
+// and returns its response (transfer full). The method channel callback is a
+// thin wrapper around this.
+FlMethodResponse *notification_master_plugin_dispatch(
+    NotificationMasterPlugin *self, const gchar *method, FlValue *args);
+
+// Receives the response to a call started with notification_master_plugin_call
+// (transfer none).
+typedef void (*ResponseCallback)(FlMethodResponse *response,
+                                 gpointer user_data);
+
+// Runs |method| the way the method channel does: cheap methods answer before
+// this returns, the rest run on the plugin's worker threads and |callback| is
+// invoked from an idle source on the main context that created the plugin.
+void notification_master_plugin_call(NotificationMasterPlugin *self,
+                                     const gchar *method, FlValue *args,
+                                     ResponseCallback callback,
+                                     gpointer user_data);
+
+// Parses one polling response body and displays its items, as the polling
+// thread does after each successful GET.
+void process_poll_response(const gchar *body, gsize len,
+                           const std::vector<std::string> &topics);
+
+// Encodes one batch of lifecycle events as sent on the
+// "notification_master/events" channel: a list of maps with "type" and, when
+// set, "id", "itemId", "action", "reason" and "payload" (transfer full).
+FlValue *encode_event_batch(const std::vector<nm_events::Event> &batch);
+
+// Receives every notification the plugin would show through libnotify.
+// |notification| stands in for the NotifyNotification of an app
+// notification with an id: a new object the first time, the same one while
+// it is live. It is null for the others. Returns whether it was "shown".
+typedef gboolean (*NotificationSink)(const gchar *title, const gchar *message,
+                                     GObject *notification);
+
+// Told when cancelNotification or cancelAllNotifications closes a live
+// notification that went to a sink.
+typedef void (*NotificationCloseSink)(GObject *notification);
+
+// Routes notifications to |sink| instead of libnotify, and their closes to
+// |close_sink|; nullptr restores libnotify. Live ids, updates and cancels
+// take the same locks as with libnotify. Notifications that go to a sink
+// are not added to the display history.
+void set_notification_sink(NotificationSink sink,
+                           NotificationCloseSink close_sink = nullptr);
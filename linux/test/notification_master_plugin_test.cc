@@ -1,9 +1,43 @@
 #include <flutter_linux/flutter_linux.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <json-glib/json-glib.h>
+#include <netinet/in.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "include/notification_master/notification_master_plugin.h"
 #include "notification_master_plugin_private.h"
+#include "nm_args.h"
+#include "nm_channels.h"
+#include "nm_clock.h"
+#include "nm_dedupe.h"
+#include "nm_dispatch.h"
+#include "nm_events.h"
+#include "nm_handoff.h"
+#include "nm_history.h"
+#include "nm_live.h"
+#include "nm_log.h"
+#include "nm_metrics.h"
+#include "nm_poller_config.h"
+#include "nm_prefs.h"
+#include "nm_progress.h"
+#include "nm_search.h"
+#include "nm_simhash.h"
+#include "nm_topics.h"
+#include "nm_trace.h"
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -27,5 +61,1397 @@ TEST(NotificationMasterPlugin, GetPlatformVersion) {
   EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 }
 
+TEST(NotificationMasterPlugin, PrefsTopicsAreASetAndSurviveFlush) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_prefs_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  std::string path = std::string(dir) + "/prefs.ini";
+
+  nm_prefs::PrefsStore& prefs = nm_prefs::PrefsStore::get();
+  prefs.reset_for_testing(path);
+  EXPECT_TRUE(prefs.add_topic("news"));
+  EXPECT_FALSE(prefs.add_topic("news"));
+  EXPECT_TRUE(prefs.add_topic("offers"));
+  EXPECT_TRUE(prefs.remove_topic("news"));
+  EXPECT_FALSE(prefs.remove_topic("ghost"));
+  prefs.flush();
+
+  // Re-reading the file must give back exactly what was flushed.
+  prefs.reset_for_testing(path);
+  EXPECT_EQ(prefs.topics(), std::vector<std::string>({"offers"}));
+}
+
+TEST(NotificationMasterPlugin, TopicMatcherSupportsWildcards) {
+  nm_topics::TopicMatcher matcher({"news", "alerts.*"});
+  EXPECT_TRUE(matcher.matches("news"));
+  EXPECT_TRUE(matcher.matches("alerts.build"));
+  EXPECT_TRUE(matcher.matches("alerts.build.linux"));
+  EXPECT_TRUE(matcher.matches(""));  // untagged items are broadcasts
+  EXPECT_FALSE(matcher.matches("alerts"));
+  EXPECT_FALSE(matcher.matches("newsletter"));
+
+  // The query parameter is sorted, so the same set always maps to one URL.
+  EXPECT_EQ(nm_topics::scoped_url("https://h/feed?v=1", {"news", "alerts.*"}),
+            "https://h/feed?v=1&topics=alerts.*,news");
+  EXPECT_EQ(nm_topics::topic_set_hash({"b", "a"}),
+            nm_topics::topic_set_hash({"a", "b", "a"}));
+}
+
+TEST(NotificationMasterPlugin, TopicsMapOntoBrokerTopicTree) {
+  EXPECT_EQ(nm_topics::broker_filters("nm", {"news", "alerts.*"}),
+            std::vector<std::string>({"nm", "nm/alerts/#", "nm/news"}));
+  EXPECT_EQ(nm_topics::broker_filters("nm", {}),
+            std::vector<std::string>({"nm/#"}));
+  EXPECT_EQ(nm_topics::broker_filter("nm", "bad/name"), "");
+  EXPECT_EQ(nm_topics::topic_from_broker("nm", "nm/alerts/build"),
+            "alerts.build");
+  EXPECT_EQ(nm_topics::topic_from_broker("nm", "nm"), "");
+}
+
+TEST(NotificationMasterPlugin, DeliveryLatencyPercentiles) {
+  nm_metrics::PollMetrics metrics;
+  for (int i = 0; i < 100; i++) {
+    // 90 items take 2 s from sentAt to screen, 10 take 100 s.
+    metrics.record_delivery(1000000, 1000000 + (i < 90 ? 2000 : 100000));
+  }
+  metrics.record_delivery(0, 5000);  // unstamped items are not recorded
+  EXPECT_EQ(metrics.delivery_latency.count(), 100u);
+  EXPECT_LE(metrics.delivery_latency.quantile(0.5), 2.5);
+  EXPECT_GT(metrics.delivery_latency.quantile(0.99), 60.0);
+}
+
+TEST(NotificationMasterPlugin, DedupeCacheIsBounded) {
+  nm_dedupe::DedupeCache cache(60 * 60 * 1000, 3);
+  EXPECT_TRUE(cache.should_show("a"));
+  EXPECT_FALSE(cache.should_show("a"));
+  EXPECT_TRUE(cache.should_show("b"));
+  EXPECT_TRUE(cache.should_show("c"));
+  EXPECT_TRUE(cache.should_show("d"));  // evicts "a", the oldest
+  EXPECT_EQ(cache.size(), 3u);
+  EXPECT_FALSE(cache.should_show("d"));
+  EXPECT_TRUE(cache.should_show("a"));
+
+  // Nothing outlives a zero window.
+  nm_dedupe::DedupeCache expired(0);
+  EXPECT_TRUE(expired.should_show("a"));
+  EXPECT_TRUE(expired.should_show("a"));
+  EXPECT_EQ(expired.size(), 1u);
+}
+
+TEST(NotificationMasterPlugin, NearDuplicatesAreSuppressed) {
+  using nm_dedupe::hamming_distance;
+  using nm_dedupe::simhash;
+  // Counters, times and case do not move the fingerprint.
+  EXPECT_EQ(simhash("Build 1841 failed\nmain failed at 10:02"),
+            simhash("BUILD 1842 failed\nmain failed at 9:07"));
+  // One added word moves a few bits; unrelated text about half of them.
+  EXPECT_LE(hamming_distance(simhash("New message from Alice\nAre we still "
+                                     "on for lunch?"),
+                             simhash("New message from Alice\nAre we still "
+                                     "on for lunch today?")),
+            7);
+  EXPECT_GT(hamming_distance(simhash("Disk almost full\n/var is at 93%"),
+                             simhash("Payment received\nThank you!")),
+            7);
+
+  nm_clock::SimulatedClock clock;
+  nm_dedupe::NearDuplicateIndex index(60 * 60 * 1000, 2, &clock);
+  const uint64_t a = 0x0123456789abcdefULL;
+  EXPECT_TRUE(index.should_show(a, 3));
+  EXPECT_FALSE(index.should_show(a ^ 0x7, 3));         // 3 bits: suppressed
+  EXPECT_TRUE(index.should_show(a ^ 0xf, 3));          // 4 bits: shown
+  EXPECT_FALSE(index.should_show(a ^ 0x10000001, 3));  // near the first
+  // At capacity the oldest goes first.
+  EXPECT_TRUE(index.should_show(~a, 3));
+  EXPECT_EQ(index.size(), 2u);
+  EXPECT_TRUE(index.should_show(a, 0));
+  // Distances are clamped to what the bands can find.
+  EXPECT_FALSE(index.should_show(a ^ 0x7f, 64));
+  EXPECT_TRUE(index.should_show(a ^ 0xff, 64));
+  // Nothing outlives the window.
+  clock.advance(60 * 60 * 1000);
+  EXPECT_TRUE(index.should_show(a, 3));
+  EXPECT_EQ(index.size(), 1u);
+}
+
+TEST(NotificationMasterPlugin, SimulatedClockDrivesDedupeAndSchedules) {
+  nm_clock::SimulatedClock clock(1700000000000);
+  nm_dedupe::DedupeCache cache(60 * 60 * 1000, 16, &clock);
+  EXPECT_TRUE(cache.should_show("a"));
+  clock.advance(59 * 60 * 1000);
+  EXPECT_FALSE(cache.should_show("a"));
+  // Wall-clock steps do not move the window; monotonic time does.
+  clock.jump_wall(24 * 60 * 60 * 1000);
+  EXPECT_FALSE(cache.should_show("a"));
+  clock.advance(60 * 1000);
+  EXPECT_TRUE(cache.should_show("a"));
+  // A week of simulated time drains the cache.
+  clock.advance(7LL * 24 * 60 * 60 * 1000);
+  EXPECT_TRUE(cache.should_show("b"));
+  EXPECT_EQ(cache.size(), 1u);
+
+  // Schedules are wall-clock targets, rounded up to whole seconds.
+  const int64_t target = clock.wall_ms() + 90500;
+  EXPECT_EQ(nm_clock::seconds_until(target, clock), 91);
+  clock.sleep_ms(90000);
+  EXPECT_EQ(nm_clock::seconds_until(target, clock), 1);
+  clock.jump_wall(-60 * 60 * 1000);  // clock set back an hour
+  EXPECT_EQ(nm_clock::seconds_until(target, clock), 3601);
+  clock.jump_wall(2 * 60 * 60 * 1000);
+  EXPECT_EQ(nm_clock::seconds_until(target, clock), 0);
+}
+
+struct NamedEntry {
+  const char* name;
+};
+
+TEST(NotificationMasterPlugin, MethodDispatchUsesPerfectHash) {
+  static constexpr NamedEntry kNames[] = {
+      {"show"}, {"showNotification"}, {"showNotificationWithActions"},
+      {"setTopics"}, {"getTopics"}, {""}};
+  static constexpr auto kIndex =
+      nm_dispatch::build_index<nm_dispatch::slots_for(6)>(kNames);
+  static_assert(kIndex.ok, "no perfect seed for six names");
+  for (int i = 0; i < 6; i++) EXPECT_EQ(kIndex.find(kNames, kNames[i].name), i);
+  EXPECT_EQ(kIndex.find(kNames, "showNotificationX"), -1);
+  EXPECT_EQ(kIndex.find(kNames, "settopics"), -1);
+
+  g_autofree gchar* dir = g_dir_make_tmp("nm_dispatch_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  nm_prefs::PrefsStore::get().reset_for_testing(std::string(dir) +
+                                                "/prefs.ini");
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) args = fl_value_new_map();
+
+  g_autoptr(FlMethodResponse) unknown =
+      notification_master_plugin_dispatch(plugin, "noSuchMethod", args);
+  EXPECT_TRUE(FL_IS_METHOD_NOT_IMPLEMENTED_RESPONSE(unknown));
+
+  g_autoptr(FlMethodResponse) firebase = notification_master_plugin_dispatch(
+      plugin, "setFirebaseAsActiveService", args);
+  ASSERT_NE(firebase, nullptr);
+  EXPECT_TRUE(FL_IS_METHOD_SUCCESS_RESPONSE(firebase));
+
+  g_autoptr(FlMethodResponse) active = notification_master_plugin_dispatch(
+      plugin, "getActiveNotificationService", args);
+  ASSERT_TRUE(FL_IS_METHOD_SUCCESS_RESPONSE(active));
+  EXPECT_STREQ(fl_value_get_string(fl_method_success_response_get_result(
+                   FL_METHOD_SUCCESS_RESPONSE(active))),
+               "firebase");
+  g_object_unref(plugin);
+}
+
+struct SampleArgs {
+  const gchar* title = nullptr;
+  const gchar* channel_id = "default";
+  gint64 id = 1;
+  bool loud = false;
+  std::vector<std::string> topics;
+};
+
+TEST(NotificationMasterPlugin, ArgumentSchemaDecodesInOnePass) {
+  static const nm_args::Field<SampleArgs> kSchema[] = {
+      nm_args::field("title", &SampleArgs::title, nm_args::kRequired),
+      nm_args::field("channelId", &SampleArgs::channel_id),
+      nm_args::field("id", &SampleArgs::id),
+      nm_args::field("loud", &SampleArgs::loud),
+      nm_args::field("topics", &SampleArgs::topics),
+  };
+  std::string error;
+
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "title", fl_value_new_string("Hello"));
+  fl_value_set_string_take(args, "channelId", fl_value_new_null());
+  fl_value_set_string_take(args, "id", fl_value_new_int(42));
+  fl_value_set_string_take(args, "unknown", fl_value_new_bool(TRUE));
+  FlValue* topics = fl_value_new_list();
+  fl_value_append_take(topics, fl_value_new_string("news"));
+  fl_value_set_string_take(args, "topics", topics);
+  SampleArgs decoded;
+  ASSERT_TRUE(nm_args::decode(args, kSchema, &decoded, &error)) << error;
+  EXPECT_STREQ(decoded.title, "Hello");
+  EXPECT_STREQ(decoded.channel_id, "default");  // null keeps the default
+  EXPECT_EQ(decoded.id, 42);
+  EXPECT_FALSE(decoded.loud);
+  EXPECT_EQ(decoded.topics, std::vector<std::string>({"news"}));
+
+  fl_value_append_take(topics, fl_value_new_int(7));
+  SampleArgs bad_list;
+  EXPECT_FALSE(nm_args::decode(args, kSchema, &bad_list, &error));
+  EXPECT_EQ(error, "topics must be a list of strings");
+
+  g_autoptr(FlValue) wrong_type = fl_value_new_map();
+  fl_value_set_string_take(wrong_type, "title", fl_value_new_string("Hi"));
+  fl_value_set_string_take(wrong_type, "id", fl_value_new_string("42"));
+  SampleArgs unused;
+  EXPECT_FALSE(nm_args::decode(wrong_type, kSchema, &unused, &error));
+  EXPECT_EQ(error, "id must be an int");
+
+  g_autoptr(FlValue) missing = fl_value_new_map();
+  EXPECT_FALSE(nm_args::decode(missing, kSchema, &unused, &error));
+  EXPECT_EQ(error, "title is required");
+
+  g_autoptr(FlValue) not_a_map = fl_value_new_string("title");
+  EXPECT_FALSE(nm_args::decode(not_a_map, kSchema, &unused, &error));
+  EXPECT_EQ(error, "arguments must be a map");
+
+  // Handlers answer malformed calls with INVALID_ARGUMENTS instead of
+  // reading a string as an int.
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlMethodResponse) response = notification_master_plugin_dispatch(
+      plugin, "cancelScheduledNotification", wrong_type);
+  ASSERT_TRUE(FL_IS_METHOD_ERROR_RESPONSE(response));
+  EXPECT_STREQ(fl_method_error_response_get_code(
+                   FL_METHOD_ERROR_RESPONSE(response)),
+               "INVALID_ARGUMENTS");
+  g_object_unref(plugin);
+}
+
+struct CallResult {
+  int calls = 0;
+  bool success = false;
+};
+
+static void record_response(FlMethodResponse* response, gpointer user_data) {
+  CallResult* result = static_cast<CallResult*>(user_data);
+  result->calls++;
+  result->success = FL_IS_METHOD_SUCCESS_RESPONSE(response);
+}
+
+TEST(NotificationMasterPlugin, BlockingCallsRespondFromMainContext) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_worker_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  nm_prefs::PrefsStore::get().reset_for_testing(std::string(dir) +
+                                                "/prefs.ini");
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) args = fl_value_new_map();
+
+  // Cheap methods answer before the call returns.
+  CallResult inline_result;
+  notification_master_plugin_call(plugin, "getPlatformVersion", args,
+                                  record_response, &inline_result);
+  EXPECT_EQ(inline_result.calls, 1);
+  EXPECT_TRUE(inline_result.success);
+
+  // Prefs-backed methods run on a worker; the answer arrives only once the
+  // main context is iterated.
+  CallResult worker_result;
+  notification_master_plugin_call(plugin, "getSubscribedTopics", args,
+                                  record_response, &worker_result);
+  EXPECT_EQ(worker_result.calls, 0);
+  while (worker_result.calls == 0) g_main_context_iteration(nullptr, TRUE);
+  EXPECT_EQ(worker_result.calls, 1);
+  EXPECT_TRUE(worker_result.success);
+  g_object_unref(plugin);
+}
+
+TEST(NotificationMasterPlugin, EventsAreCoalescedPerBatch) {
+  std::vector<std::vector<nm_events::Event>> batches;
+  nm_events::Batcher batcher(
+      nullptr, [&batches](const std::vector<nm_events::Event>& batch) {
+        batches.push_back(batch);
+      });
+  nm_events::Event delivered;
+  delivered.type = nm_events::kDelivered;
+  delivered.id = 7;
+  batcher.push(delivered);  // no listener yet: dropped
+  batcher.flush();
+  EXPECT_TRUE(batches.empty());
+
+  batcher.set_enabled(true);
+  batcher.push(delivered);
+  nm_events::Event action;
+  action.type = nm_events::kActionInvoked;
+  action.id = 7;
+  action.action = "default";
+  batcher.push(action);
+  action.action = "reply";
+  batcher.push(action);  // replaces the first click
+  nm_events::Event fetched;
+  fetched.type = nm_events::kFetched;
+  fetched.item.title = "no id";
+  batcher.push(fetched);
+  batcher.push(fetched);  // items without an id are all kept
+  fetched.item_id = fetched.item.id = "a1";
+  batcher.push(fetched);
+  fetched.item.title = "a1 again";
+  batcher.push(fetched);
+  batcher.flush();
+
+  ASSERT_EQ(batches.size(), 1u);
+  const std::vector<nm_events::Event>& batch = batches[0];
+  ASSERT_EQ(batch.size(), 5u);
+  EXPECT_EQ(batch[0].type, nm_events::kDelivered);
+  EXPECT_EQ(batch[1].action, "reply");
+  EXPECT_EQ(batch[4].item.title, "a1 again");
+
+  g_autoptr(FlValue) encoded = encode_event_batch(batch);
+  ASSERT_EQ(fl_value_get_length(encoded), 5u);
+  FlValue* first = fl_value_get_list_value(encoded, 0);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(first, "type")),
+            nm_events::kDelivered);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(first, "id")), 7);
+  EXPECT_EQ(fl_value_lookup_string(first, "itemId"), nullptr);
+  FlValue* payload =
+      fl_value_lookup_string(fl_value_get_list_value(encoded, 4), "payload");
+  ASSERT_NE(payload, nullptr);
+  EXPECT_STREQ(fl_value_get_string(fl_value_lookup_string(payload, "id")),
+               "a1");
+
+  // Signals for notifications this process did not show are ignored.
+  nm_events::ServerIds ids;
+  ids.remember(41, 7, "");
+  nm_events::Event closed;
+  EXPECT_TRUE(ids.lookup(41, &closed));
+  EXPECT_EQ(closed.id, 7);
+  ids.forget(41);
+  EXPECT_FALSE(ids.lookup(41, &closed));
+  EXPECT_FALSE(ids.lookup(42, &closed));
+}
+
+TEST(NotificationMasterPlugin, FetchNotificationsReportsBadRequests) {
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+
+  g_autoptr(FlValue) bad_header = fl_value_new_map();
+  fl_value_set_string_take(bad_header, "url",
+                           fl_value_new_string("http://127.0.0.1:9/feed"));
+  FlValue* headers = fl_value_new_list();
+  fl_value_append_take(headers, fl_value_new_string("no colon"));
+  fl_value_set_string_take(bad_header, "headers", headers);
+  g_autoptr(FlMethodResponse) invalid = notification_master_plugin_dispatch(
+      plugin, "fetchNotifications", bad_header);
+  ASSERT_TRUE(FL_IS_METHOD_ERROR_RESPONSE(invalid));
+  EXPECT_STREQ(
+      fl_method_error_response_get_code(FL_METHOD_ERROR_RESPONSE(invalid)),
+      "INVALID_ARGUMENTS");
+
+  g_autoptr(FlValue) bad_url = fl_value_new_map();
+  fl_value_set_string_take(bad_url, "url", fl_value_new_string("not a url"));
+  fl_value_set_string_take(bad_url, "filterTopics", fl_value_new_bool(FALSE));
+  g_autoptr(FlMethodResponse) failed = notification_master_plugin_dispatch(
+      plugin, "fetchNotifications", bad_url);
+  ASSERT_TRUE(FL_IS_METHOD_ERROR_RESPONSE(failed));
+  EXPECT_STREQ(
+      fl_method_error_response_get_code(FL_METHOD_ERROR_RESPONSE(failed)),
+      "FETCH_FAILED");
+  g_object_unref(plugin);
+}
+
+TEST(NotificationMasterPlugin, LiveNotificationsAreKeptById) {
+  nm_live::Registry live;
+  GObject* first = G_OBJECT(g_object_new(G_TYPE_OBJECT, nullptr));
+  GObject* second = G_OBJECT(g_object_new(G_TYPE_OBJECT, nullptr));
+  live.put(1, first);
+  live.put(1, first);  // shown again: still one reference
+  live.put(2, second);
+  EXPECT_EQ(live.size(), 2u);
+
+  GObject* found = live.find(1);
+  EXPECT_EQ(found, first);
+  g_object_unref(found);
+  EXPECT_EQ(live.find(3), nullptr);
+
+  // The closed signal drops the entry.
+  live.remove(second);
+  EXPECT_EQ(live.find(2), nullptr);
+
+  GObject* taken = live.take(1);
+  EXPECT_EQ(taken, first);
+  g_object_unref(taken);
+  EXPECT_EQ(live.take(1), nullptr);
+  EXPECT_EQ(live.size(), 0u);
+
+  // The oldest entries go once the registry is full.
+  for (int64_t id = 0; id <= (int64_t)nm_live::Registry::kMaxLive; ++id) {
+    live.put(id, first);
+  }
+  EXPECT_EQ(live.size(), nm_live::Registry::kMaxLive);
+  EXPECT_EQ(live.find(0), nullptr);
+  std::vector<GObject*> all = live.take_all();
+  EXPECT_EQ(all.size(), nm_live::Registry::kMaxLive);
+  for (GObject* object : all) g_object_unref(object);
+
+  g_object_unref(first);
+  g_object_unref(second);
+}
+
+TEST(NotificationMasterPlugin, ProgressUpdatesAreCoalesced) {
+  nm_clock::SimulatedClock clock;
+  std::vector<nm_progress::Update> shown;
+  nm_progress::Coalescer progress(
+      nullptr, clock,
+      [&shown](const nm_progress::Update& update) { shown.push_back(update); });
+  nm_progress::Update update;
+  update.id = 3;
+  update.value = 50;
+  EXPECT_FALSE(progress.update(update));  // not started
+
+  update.title = "Download";
+  update.value = 0;
+  ASSERT_TRUE(progress.start(update, 10));  // one update per 100 ms
+  ASSERT_EQ(shown.size(), 1u);
+
+  // 60 reports a second while the first display is still in flight.
+  update.title.clear();
+  for (int value = 1; value <= 6; ++value) {
+    update.value = value;
+    EXPECT_TRUE(progress.update(update));
+    clock.advance(16);
+  }
+  EXPECT_EQ(shown.size(), 1u);
+  progress.sent(3);  // 96 ms after the first: not due yet
+  EXPECT_EQ(shown.size(), 1u);
+  clock.advance(4);
+  progress.tick();
+  ASSERT_EQ(shown.size(), 2u);
+  EXPECT_EQ(shown[1].value, 6);  // last value wins
+  EXPECT_EQ(shown[1].title, "Download");
+  progress.sent(3);
+
+  // The final state skips the interval and is shown once.
+  update.value = 100;
+  update.message = "Done";
+  update.final = true;
+  EXPECT_TRUE(progress.update(update));
+  ASSERT_EQ(shown.size(), 3u);
+  EXPECT_TRUE(shown[2].final);
+  EXPECT_FALSE(progress.update(update));
+  progress.sent(3);
+  EXPECT_EQ(progress.streams(), 0u);
+  clock.advance(1000);
+  progress.tick();
+  EXPECT_EQ(shown.size(), 3u);
+}
+
+TEST(NotificationMasterPlugin, ChannelsAreRateLimitedIndependently) {
+  nm_channels::Channel noisy;
+  noisy.id = "ci";
+  noisy.name = "CI builds";
+  noisy.urgency = nm_channels::urgency_for_importance(0);
+  noisy.category = "transfer.complete";
+  noisy.rate_per_minute = 6;  // one every 10 s
+  noisy.burst = 2;
+  nm_channels::Channel fallback;
+  fallback.id = nm_channels::kDefaultChannel;
+  fallback.name = "Default";
+
+  // Channels round-trip through prefs.ini groups.
+  GKeyFile* kf = g_key_file_new();
+  nm_channels::save(kf, noisy);
+  nm_channels::save(kf, fallback);
+  std::vector<nm_channels::Channel> loaded = nm_channels::load_all(kf);
+  g_key_file_free(kf);
+  ASSERT_EQ(loaded.size(), 2u);
+
+  nm_channels::Registry registry;
+  registry.set(loaded);
+  nm_channels::Channel policy;
+  int64_t now = 1000;
+  EXPECT_TRUE(registry.admit("ci", now, &policy));
+  EXPECT_EQ(policy.category, "transfer.complete");
+  EXPECT_EQ(policy.urgency, NOTIFY_URGENCY_LOW);
+  EXPECT_TRUE(registry.admit("ci", now, &policy));
+  EXPECT_FALSE(registry.admit("ci", now, &policy));  // burst used up
+  // Other channels keep their own budget; ids without a channel get the
+  // default channel's policy.
+  EXPECT_TRUE(registry.admit("chat", now, &policy));
+  EXPECT_EQ(policy.name, "Default");
+
+  // Reloading the same set keeps the empty bucket.
+  registry.set(loaded);
+  EXPECT_FALSE(registry.admit("ci", now + 5000, &policy));
+  EXPECT_TRUE(registry.admit("ci", now + 10000, &policy));
+}
+
+TEST(NotificationMasterPlugin, HistoryIsPagedFilteredAndCompacted) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_history_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  std::string path = std::string(dir) + "/history.log";
+
+  nm_history::Writer writer(path, 16 * 1024, nm_history::kRetentionMs);
+  nm_history::Reader reader(path);
+  EXPECT_TRUE(reader.query(nm_history::Query()).records.empty());
+  const int64_t now = nm_clock::get().wall_ms();
+  for (int i = 0; i < 100; ++i) {
+    nm_history::Record record;
+    record.shown_at_ms = now + i;
+    record.source = nm_history::kFeed;
+    record.title = "Item " + std::to_string(i);
+    record.channel = i % 2 ? "odd" : "even";
+    record.topic = i % 10 == 0 ? "tens" : "";
+    ASSERT_TRUE(writer.append(record));
+  }
+
+  nm_history::Query query;
+  query.limit = 10;
+  nm_history::Page page = reader.query(query);
+  ASSERT_EQ(page.records.size(), 10u);
+  EXPECT_EQ(page.records[0].title, "Item 99");
+  EXPECT_EQ(page.records[0].seq, 99);
+  EXPECT_EQ(page.next_cursor, 90);
+  query.cursor = page.next_cursor;
+  EXPECT_EQ(reader.query(query).records[0].seq, 89);
+
+  nm_history::Query filtered;
+  filtered.channel = "even";
+  filtered.topic = "tens";
+  page = reader.query(filtered);
+  EXPECT_EQ(page.records.size(), 10u);
+  EXPECT_EQ(page.next_cursor, -1);
+  nm_history::Query range;
+  range.since_ms = now + 10;
+  range.until_ms = now + 20;
+  page = reader.query(range);
+  ASSERT_EQ(page.records.size(), 10u);
+  EXPECT_EQ(page.records.back().shown_at_ms, now + 10);
+  nm_history::Query unknown;
+  unknown.channel = "ghost";
+  EXPECT_TRUE(reader.query(unknown).records.empty());
+
+  // Past 16 KiB the log is rewritten without its oldest records; seqs (and
+  // so cursors) stay the same.
+  for (int i = 100; i < 1000; ++i) {
+    nm_history::Record record;
+    record.shown_at_ms = now + i;
+    record.title = "Item " + std::to_string(i);
+    ASSERT_TRUE(writer.append(record));
+  }
+  page = reader.query(nm_history::Query());
+  EXPECT_EQ(page.records[0].seq, 999);
+  EXPECT_EQ(page.records[0].title, "Item 999");
+  EXPECT_LT(reader.size(), 1000u);
+  query.cursor = 950;
+  query.limit = 1;
+  EXPECT_EQ(reader.query(query).records[0].title, "Item 949");
+}
+
+TEST(NotificationMasterPlugin, SearchFindsWordsAndPrefixes) {
+  typedef std::vector<std::string> Words;
+  EXPECT_EQ(nm_search::tokenize("Deploy FAILED: web-1"),
+            (Words{"deploy", "failed", "web", "1"}));
+  EXPECT_EQ(nm_search::tokenize("Caf\xc3\xa9 Stra\xc3\x9f" "e"),
+            (Words{"cafe", "strasse"}));
+  // 東京 (Tokyo) is two words.
+  EXPECT_EQ(nm_search::tokenize("\xe6\x9d\xb1\xe4\xba\xac!"),
+            (Words{"\xe6\x9d\xb1", "\xe4\xba\xac"}));
+
+  nm_search::Index index;
+  index.add(10, "Deploy started");
+  index.add(11, "Deploy failed on web-1");
+  index.add(12, "Lunch is ready");
+  index.add(13, "Deploy finished");
+  EXPECT_EQ(index.search("deploy", 10), (std::vector<int64_t>{13, 11, 10}));
+  EXPECT_EQ(index.search("deploy", 2), (std::vector<int64_t>{13, 11}));
+  EXPECT_EQ(index.search("DEPLOY fail", 10), (std::vector<int64_t>{11}));
+  EXPECT_EQ(index.search("dep* web", 10), (std::vector<int64_t>{11}));
+  EXPECT_EQ(index.search("f", 10), (std::vector<int64_t>{13, 11}));
+  EXPECT_EQ(index.search("deploy", 10, 11), (std::vector<int64_t>{13, 11}));
+  EXPECT_TRUE(index.search("deploy lunch", 10).empty());
+  EXPECT_TRUE(index.search("", 10).empty());
+
+  g_autofree gchar* dir = g_dir_make_tmp("nm_search_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  std::string path = std::string(dir) + "/history.log";
+  nm_history::Writer writer(path);
+  nm_history::Reader reader(path);
+  nm_search::Searcher searcher(&reader);
+  EXPECT_TRUE(searcher.search("build", 10).empty());
+  for (int i = 0; i < 20; ++i) {
+    nm_history::Record record;
+    record.title = i % 2 ? "Build passed" : "Build failed";
+    record.message = "Pipeline " + std::to_string(i);
+    ASSERT_TRUE(writer.append(record));
+  }
+  std::vector<nm_history::Record> found = searcher.search("build fail", 3);
+  ASSERT_EQ(found.size(), 3u);
+  EXPECT_EQ(found[0].seq, 18);
+  EXPECT_EQ(found[0].message, "Pipeline 18");
+  // Records appended after a search are indexed by the next one.
+  nm_history::Record record;
+  record.title = "Build failed again";
+  ASSERT_TRUE(writer.append(record));
+  found = searcher.search("again", 10);
+  ASSERT_EQ(found.size(), 1u);
+  EXPECT_EQ(found[0].seq, 20);
+}
+
+TEST(NotificationMasterPlugin, HandoffDeliversDaemonItems) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_handoff_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  std::string path = std::string(dir) + "/handoff.ring";
+  auto item = [](int i) {
+    nm_feed::Item item;
+    item.id = "item-" + std::to_string(i);
+    item.title = "Title " + std::to_string(i);
+    item.topic = "news";
+    item.sent_at_ms = 1700000000000 + i;
+    return item;
+  };
+
+  nm_handoff::Publisher publisher(path, 4096);
+  nm_handoff::Subscriber subscriber(path, 4096);
+  ASSERT_TRUE(subscriber.is_open());
+  std::vector<nm_feed::Item> items;
+  EXPECT_FALSE(subscriber.wait(1));
+  ASSERT_TRUE(publisher.publish({item(1), item(2)}));
+  EXPECT_TRUE(subscriber.wait(1000));
+  EXPECT_EQ(subscriber.read(&items), 0u);
+  ASSERT_EQ(items.size(), 2u);
+  EXPECT_EQ(items[1].id, "item-2");
+  EXPECT_EQ(items[1].topic, "news");
+  EXPECT_EQ(items[1].sent_at_ms, 1700000000002);
+
+  // Falling a whole 4 KiB ring behind skips to the newest batch and counts
+  // what was overwritten.
+  std::vector<nm_feed::Item> burst;
+  for (int i = 0; i < 100; ++i) burst.push_back(item(100 + i));
+  ASSERT_TRUE(publisher.publish(burst));
+  ASSERT_TRUE(publisher.publish({item(999)}));
+  items.clear();
+  EXPECT_EQ(subscriber.read(&items), 100u);
+  ASSERT_EQ(items.size(), 1u);
+  EXPECT_EQ(items[0].id, "item-999");
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<std::string> received;
+  {
+    nm_handoff::Listener listener(
+        path, [&](std::vector<nm_feed::Item> batch, size_t lost) {
+          std::lock_guard<std::mutex> lk(mtx);
+          for (const auto& b : batch) received.push_back(b.id);
+          cv.notify_all();
+        });
+    ASSERT_TRUE(listener.is_listening());
+    ASSERT_TRUE(publisher.publish({item(7)}));
+    std::unique_lock<std::mutex> lk(mtx);
+    EXPECT_TRUE(cv.wait_for(lk, std::chrono::seconds(5),
+                            [&] { return !received.empty(); }));
+  }
+  EXPECT_EQ(received, std::vector<std::string>{"item-7"});
+}
+
+// Renames of |name| among the events queued on inotify |fd|.
+static int count_renames(int fd, const char* name) {
+  int renames = 0;
+  alignas(struct inotify_event) char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    for (char* p = buf; p < buf + n;) {
+      auto* ev = reinterpret_cast<struct inotify_event*>(p);
+      if ((ev->mask & IN_MOVED_TO) && ev->len > 0 &&
+          strcmp(ev->name, name) == 0) {
+        ++renames;
+      }
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+  return renames;
+}
+
+TEST(NotificationMasterPlugin, PollerConfigLoadsCommitsAndReloads) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_config_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  const std::string conf_path = std::string(dir) + "/" + nm_config::kConfFile;
+
+  nm_config::PollerConfigStore store(dir);
+  store.load();
+  EXPECT_EQ(store.current().url, "");
+  EXPECT_EQ(store.current().interval_minutes,
+            nm_config::kDefaultIntervalMinutes);
+  EXPECT_TRUE(store.current().enabled);
+  EXPECT_EQ(store.current().transport, nm_config::kTransportPoll);
+  EXPECT_EQ(store.current().near_duplicates, 0);
+  EXPECT_EQ(store.current().mqtt.port, 1883);
+
+  ASSERT_TRUE(g_file_set_contents(conf_path.c_str(),
+                                  "[poller]\n"
+                                  "url=https://example.com/feed\n"
+                                  "interval=5\n"
+                                  "enabled=0\n"
+                                  "near_duplicates=3\n"
+                                  "[mqtt]\n"
+                                  "host=broker\n"
+                                  "port=8883\n"
+                                  "keepalive=-4\n",
+                                  -1, nullptr));
+  store.load();
+  EXPECT_EQ(store.current().url, "https://example.com/feed");
+  EXPECT_EQ(store.current().interval_minutes, 5);
+  EXPECT_FALSE(store.current().enabled);
+  EXPECT_EQ(store.current().near_duplicates, 3);
+  EXPECT_EQ(store.current().mqtt.host, "broker");
+  EXPECT_EQ(store.current().mqtt.port, 8883);
+  EXPECT_EQ(store.current().mqtt.keepalive, 60);  // not positive: default
+
+  // Staged keys reach the disk together, in one atomic rename.
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  ASSERT_GE(fd, 0);
+  ASSERT_GE(inotify_add_watch(fd, dir, IN_MOVED_TO), 0);
+  store.stage(nm_config::kUrl, "https://example.com/other");
+  store.stage(nm_config::kInterval, "7");
+  store.stage(nm_config::kInterval, "9");  // the last value wins
+  store.stage(nm_config::kEnabled, "1");
+  EXPECT_EQ(count_renames(fd, nm_config::kConfFile), 0);
+  EXPECT_EQ(store.current().interval_minutes, 5);
+  ASSERT_TRUE(store.commit());
+  EXPECT_EQ(count_renames(fd, nm_config::kConfFile), 1);
+  close(fd);
+  EXPECT_EQ(store.current().url, "https://example.com/other");
+  EXPECT_EQ(store.current().interval_minutes, 9);
+  EXPECT_TRUE(store.current().enabled);
+  EXPECT_EQ(store.current().mqtt.host, "broker");  // untouched keys stay
+
+  // A file renamed over poller.conf is picked up. Writes to other files in
+  // the directory neither reload nor end the wait early.
+  ASSERT_TRUE(store.watch());
+  const std::string state_path = std::string(dir) + "/" + nm_config::kStateFile;
+  ASSERT_TRUE(g_file_set_contents(state_path.c_str(), "[status]\nlast_run=1\n",
+                                  -1, nullptr));
+  const gint64 start = g_get_monotonic_time();
+  EXPECT_FALSE(store.wait_for_change(100));
+  EXPECT_GE(g_get_monotonic_time() - start, 90 * 1000);
+  const std::string tmp = conf_path + ".new";
+  ASSERT_TRUE(g_file_set_contents(
+      tmp.c_str(), "[poller]\nurl=https://example.com/renamed\n", -1,
+      nullptr));
+  ASSERT_EQ(rename(tmp.c_str(), conf_path.c_str()), 0);
+  EXPECT_TRUE(store.wait_for_change(2000));
+  EXPECT_EQ(store.current().url, "https://example.com/renamed");
+  EXPECT_EQ(store.current().interval_minutes,
+            nm_config::kDefaultIntervalMinutes);
+}
+
+TEST(NotificationMasterPlugin, LoggerFiltersDropsAndFlushesOnStop) {
+  nm_log::Level parsed = nm_log::kDebug;
+  EXPECT_TRUE(nm_log::parse_level("Warning", &parsed));
+  EXPECT_EQ(parsed, nm_log::kWarn);
+  EXPECT_FALSE(nm_log::parse_level("loud", &parsed));
+
+  // Below the runtime level a line is neither queued nor even built.
+  nm_log::Logger& logger = nm_log::Logger::get();
+  logger.set_level(nm_log::kWarn);
+  int built = 0;
+  auto message = [&built](const char* text) {
+    built++;
+    return std::string(text);
+  };
+  NM_LOG_INFO(message("filtered info"));
+  NM_LOG_WARN(message("kept warn"));
+  NM_LOG_ERROR(message("kept error"));
+  EXPECT_EQ(built, 2);
+
+  // No writer runs before start(), so the ring fills up; once full, lines
+  // are dropped and counted instead of blocking.
+  for (size_t i = 2; i < nm_log::kRingSlots; i++) {
+    std::string line = "fill " + std::to_string(i);
+    ASSERT_TRUE(logger.log(nm_log::kError, line.data(), line.size()));
+  }
+  EXPECT_FALSE(logger.log(nm_log::kError, "overflow", 8));
+  EXPECT_EQ(logger.dropped(), 1u);
+
+  // stop() writes everything still queued before it returns.
+  g_autofree gchar* dir = g_dir_make_tmp("nm_log_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  nm_log::Options options;
+  options.path = std::string(dir) + "/poller.log";
+  logger.start(options);
+  logger.stop();
+  logger.set_level(nm_log::kInfo);
+
+  g_autofree gchar* contents = nullptr;
+  ASSERT_TRUE(g_file_get_contents(options.path.c_str(), &contents, nullptr,
+                                  nullptr));
+  std::vector<std::string> lines;
+  gchar** split = g_strsplit(contents, "\n", -1);
+  for (gchar** p = split; *p; ++p) {
+    if (**p != '\0') lines.emplace_back(*p);
+  }
+  g_strfreev(split);
+  ASSERT_EQ(lines.size(), nm_log::kRingSlots + 1);
+  EXPECT_NE(lines[0].find("WARN  kept warn"), std::string::npos);
+  EXPECT_NE(lines[1].find("ERROR kept error"), std::string::npos);
+  EXPECT_NE(lines[nm_log::kRingSlots - 1].find(
+                "ERROR fill " + std::to_string(nm_log::kRingSlots - 1)),
+            std::string::npos);
+  EXPECT_EQ(lines.back(), "[NM-POLLER] log ring full: 1 line(s) dropped");
+  EXPECT_EQ(std::string(contents).find("filtered info"), std::string::npos);
+  EXPECT_EQ(std::string(contents).find("overflow"), std::string::npos);
+}
+
+TEST(NotificationMasterPlugin, MetricsRenderPrometheusText) {
+  const std::string labels = "source=\"test\"";
+
+  nm_metrics::Histogram histogram({0.5, 1, 2.5});
+  histogram.observe(0.25);
+  histogram.observe(1);
+  histogram.observe(3);
+  std::string out;
+  histogram.render(&out, "nm_test_seconds", "A test histogram.", labels);
+  EXPECT_EQ(out,
+            "# HELP nm_test_seconds A test histogram.\n"
+            "# TYPE nm_test_seconds histogram\n"
+            "nm_test_seconds_bucket{source=\"test\",le=\"0.5\"} 1\n"
+            "nm_test_seconds_bucket{source=\"test\",le=\"1\"} 2\n"
+            "nm_test_seconds_bucket{source=\"test\",le=\"2.5\"} 2\n"
+            "nm_test_seconds_bucket{source=\"test\",le=\"+Inf\"} 3\n"
+            "nm_test_seconds_sum{source=\"test\"} 4.25\n"
+            "nm_test_seconds_count{source=\"test\"} 3\n");
+
+  nm_metrics::StatusCounter statuses;
+  statuses.inc(200);
+  statuses.inc(200);
+  statuses.inc(0);
+  statuses.inc(1000);  // out of range: counted as no response
+  out.clear();
+  statuses.render(&out, "nm_test_responses_total", "Responses.", labels);
+  EXPECT_EQ(out,
+            "# HELP nm_test_responses_total Responses.\n"
+            "# TYPE nm_test_responses_total counter\n"
+            "nm_test_responses_total{source=\"test\",code=\"0\"} 2\n"
+            "nm_test_responses_total{source=\"test\",code=\"200\"} 2\n");
+
+  // The source label is escaped, so no sample line can be broken up.
+  nm_metrics::PollMetrics metrics;
+  metrics.polls.inc(3);
+  out = metrics.render_prometheus("a\"b\\c\nd");
+  const std::string escaped = "{source=\"a\\\"b\\\\c\\nd\"";
+  const std::string head =
+      "# HELP nm_polls_total Poll cycles started.\n"
+      "# TYPE nm_polls_total counter\n"
+      "nm_polls_total" + escaped + "} 3\n";
+  EXPECT_EQ(out.substr(0, head.size()), head);
+  EXPECT_NE(out.find("nm_http_request_duration_seconds_bucket" + escaped +
+                     ",le=\"+Inf\"} 0\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("nm_delivery_latency_percentile_seconds" + escaped +
+                     ",quantile=\"0.99\"} 0\n"),
+            std::string::npos);
+  gchar** lines = g_strsplit(out.c_str(), "\n", -1);
+  for (gchar** line = lines; *line && **line; ++line) {
+    if (g_str_has_prefix(*line, "#")) {
+      EXPECT_TRUE(g_str_has_prefix(*line, "# HELP nm_") ||
+                  g_str_has_prefix(*line, "# TYPE nm_"))
+          << *line;
+    } else {
+      EXPECT_TRUE(g_str_has_prefix(*line, "nm_")) << *line;
+      EXPECT_NE(strstr(*line, escaped.c_str()), nullptr) << *line;
+    }
+  }
+  g_strfreev(lines);
+}
+
+TEST(NotificationMasterPlugin, TraceExportsChromeJsonWhenOptedIn) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_trace_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  const std::string path = std::string(dir) + "/trace.json";
+
+  // Off unless NM_TRACE is set: spans are not recorded and dump() writes
+  // nothing.
+  g_unsetenv("NM_TRACE");
+  EXPECT_FALSE(nm_trace::init_from_env("test"));
+  EXPECT_FALSE(nm_trace::enabled());
+  { NM_TRACE_SCOPE("test.disabled", "test"); }
+  EXPECT_EQ(nm_trace::dump(), "");
+
+  nm_trace::set_enabled(true);
+  nm_trace::set_thread_name("trace \"test\"");
+  {
+    nm_trace::Span outer("test.outer", "test");
+    outer.set_arg("items", 3);
+    {
+      NM_TRACE_SCOPE("test.inner", "test");
+      g_usleep(1000);
+    }
+  }
+  nm_trace::set_enabled(false);
+  ASSERT_TRUE(nm_trace::dump_to(path));
+
+  g_autofree gchar* contents = nullptr;
+  ASSERT_TRUE(g_file_get_contents(path.c_str(), &contents, nullptr, nullptr));
+  JsonParser* parser = json_parser_new();
+  ASSERT_TRUE(json_parser_load_from_data(parser, contents, -1, nullptr))
+      << contents;
+  JsonNode* root = json_parser_get_root(parser);
+  ASSERT_TRUE(root && JSON_NODE_HOLDS_OBJECT(root));
+  JsonArray* events =
+      json_object_get_array_member(json_node_get_object(root), "traceEvents");
+  ASSERT_NE(events, nullptr);
+
+  bool thread_named = false;
+  JsonObject* outer = nullptr;
+  JsonObject* inner = nullptr;
+  for (guint i = 0; i < json_array_get_length(events); i++) {
+    JsonObject* e = json_array_get_object_element(events, i);
+    ASSERT_NE(e, nullptr);
+    const gchar* ph = json_object_get_string_member(e, "ph");
+    const gchar* name = json_object_get_string_member(e, "name");
+    if (g_strcmp0(ph, "M") == 0) {
+      JsonObject* args = json_object_get_object_member(e, "args");
+      if (g_strcmp0(name, "thread_name") == 0 &&
+          g_strcmp0(json_object_get_string_member(args, "name"),
+                    "trace \"test\"") == 0) {
+        thread_named = true;
+      }
+      continue;
+    }
+    // Every span is one complete ("X") event carrying its own duration.
+    EXPECT_STREQ(ph, "X");
+    EXPECT_TRUE(json_object_has_member(e, "ts"));
+    EXPECT_GE(json_object_get_double_member(e, "dur"), 0);
+    EXPECT_STRNE(name, "test.disabled");
+    if (g_strcmp0(name, "test.outer") == 0) outer = e;
+    if (g_strcmp0(name, "test.inner") == 0) inner = e;
+  }
+  EXPECT_TRUE(thread_named);
+  ASSERT_NE(outer, nullptr);
+  ASSERT_NE(inner, nullptr);
+  EXPECT_EQ(json_object_get_int_member(
+                json_object_get_object_member(outer, "args"), "items"),
+            3);
+  const double outer_ts = json_object_get_double_member(outer, "ts");
+  const double inner_ts = json_object_get_double_member(inner, "ts");
+  const double inner_dur = json_object_get_double_member(inner, "dur");
+  EXPECT_GE(inner_dur, 1000.0);  // microseconds
+  EXPECT_GE(inner_ts, outer_ts);
+  EXPECT_LE(inner_ts + inner_dur,
+            outer_ts + json_object_get_double_member(outer, "dur") + 0.001);
+  g_object_unref(parser);
+}
+
+static std::atomic<int> g_live_created{0};
+static std::atomic<int> g_live_closed{0};
+static std::atomic<int> g_live_reclosed{0};
+
+// Counts the popups created and yields where the D-Bus round trip sits.
+static gboolean slow_live_sink(const gchar* title, const gchar* message,
+                               GObject* notification) {
+  if (notification && !g_object_get_data(notification, "created")) {
+    g_object_set_data(notification, "created", GINT_TO_POINTER(1));
+    g_live_created++;
+  }
+  std::this_thread::yield();
+  return TRUE;
+}
+
+static void count_live_close(GObject* notification) {
+  // Closed twice: a show put it back after a cancel had closed it.
+  if (g_object_get_data(notification, "closed")) g_live_reclosed++;
+  g_object_set_data(notification, "closed", GINT_TO_POINTER(1));
+  g_live_closed++;
+}
+
+TEST(NotificationMasterPlugin, LiveShowAndCancelOfOneIdDoNotInterleave) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_live_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  nm_prefs::PrefsStore::get().reset_for_testing(std::string(dir) +
+                                                "/prefs.ini");
+  set_notification_sink(slow_live_sink, count_live_close);
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  g_autoptr(FlValue) show_args = fl_value_new_map();
+  fl_value_set_string_take(show_args, "title", fl_value_new_string("Build"));
+  fl_value_set_string_take(show_args, "message",
+                           fl_value_new_string("Running"));
+  fl_value_set_string_take(show_args, "id", fl_value_new_int(7));
+  g_autoptr(FlValue) cancel_args = fl_value_new_map();
+  fl_value_set_string_take(cancel_args, "id", fl_value_new_int(7));
+
+  // The real handlers, as the worker pool runs them in parallel.
+  const int kRounds = 2000;
+  auto show = [&]() {
+    for (int i = 0; i < kRounds; i++) {
+      g_autoptr(FlMethodResponse) response =
+          notification_master_plugin_dispatch(plugin, "showNotification",
+                                              show_args);
+      EXPECT_TRUE(FL_IS_METHOD_SUCCESS_RESPONSE(response));
+    }
+  };
+  auto cancel = [&]() {
+    for (int i = 0; i < kRounds; i++) {
+      g_autoptr(FlMethodResponse) response =
+          notification_master_plugin_dispatch(
+              plugin,
+              i % 16 == 0 ? "cancelAllNotifications" : "cancelNotification",
+              cancel_args);
+      EXPECT_TRUE(FL_IS_METHOD_SUCCESS_RESPONSE(response));
+    }
+  };
+  std::thread shower_a(show);
+  std::thread shower_b(show);
+  std::thread canceller(cancel);
+  shower_a.join();
+  shower_b.join();
+  canceller.join();
+  // Closes the one still live, so every popup is accounted for.
+  g_autoptr(FlMethodResponse) last =
+      notification_master_plugin_dispatch(plugin, "cancelAllNotifications",
+                                          cancel_args);
+  EXPECT_TRUE(FL_IS_METHOD_SUCCESS_RESPONSE(last));
+
+  EXPECT_EQ(g_live_reclosed.load(), 0);
+  // No two shows both missed and stacked a second popup.
+  EXPECT_EQ(g_live_created.load(), g_live_closed.load());
+  EXPECT_GT(g_live_closed.load(), 0);
+  g_object_unref(plugin);
+  set_notification_sink(nullptr);
+}
+
+TEST(NotificationMasterPlugin, CancelledProgressStreamsEnd) {
+  nm_clock::SimulatedClock clock;
+  std::vector<nm_progress::Update> shown;
+  nm_progress::Coalescer progress(
+      nullptr, clock,
+      [&shown](const nm_progress::Update& update) { shown.push_back(update); });
+  nm_progress::Update update;
+  update.title = "Download";
+
+  // Cancelled with a display in flight and an update pending: the pending
+  // state is dropped, and sent() reports the cancel so the caller closes
+  // what it just showed.
+  update.id = 1;
+  ASSERT_TRUE(progress.start(update, 10));
+  ASSERT_EQ(shown.size(), 1u);
+  update.value = 40;
+  EXPECT_TRUE(progress.update(update));
+  EXPECT_TRUE(progress.cancel(1));
+  EXPECT_TRUE(progress.cancelled(1));
+  EXPECT_FALSE(progress.update(update));
+  clock.advance(1000);
+  progress.tick();
+  EXPECT_EQ(shown.size(), 1u);
+  EXPECT_FALSE(progress.sent(1));
+  EXPECT_EQ(progress.streams(), 0u);
+  EXPECT_FALSE(progress.cancel(1));
+
+  // Cancelled while idle: gone at once.
+  update.id = 2;
+  ASSERT_TRUE(progress.start(update, 10));
+  EXPECT_TRUE(progress.sent(2));
+  update.value = 60;
+  EXPECT_TRUE(progress.update(update));  // waits for the interval
+  EXPECT_TRUE(progress.cancel(2));
+  EXPECT_EQ(progress.streams(), 0u);
+  clock.advance(1000);
+  progress.tick();
+  EXPECT_EQ(shown.size(), 2u);
+
+  // Cancelled streams do not use up kMaxStreams.
+  for (int64_t id = 10; id < 10 + (int64_t)nm_progress::Coalescer::kMaxStreams;
+       ++id) {
+    update.id = id;
+    ASSERT_TRUE(progress.start(update, 10));
+  }
+  update.id = 1000;
+  EXPECT_FALSE(progress.start(update, 10));
+  progress.cancel_all();
+  for (int64_t id = 10; id < 10 + (int64_t)nm_progress::Coalescer::kMaxStreams;
+       ++id) {
+    EXPECT_FALSE(progress.sent(id));
+  }
+  EXPECT_EQ(progress.streams(), 0u);
+  EXPECT_TRUE(progress.start(update, 10));
+}
+
+TEST(NotificationMasterPlugin, HandoffPublishesOnlyShownItems) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_handoff_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  std::string path = std::string(dir) + "/handoff.ring";
+  auto item = [](int i) {
+    nm_feed::Item item;
+    item.id = "item-" + std::to_string(i);
+    item.title = "Title " + std::to_string(i);
+    item.message = "Body " + std::to_string(i);
+    return item;
+  };
+  // Stands in for show_notification(): a repeat within the window is not
+  // shown again, so the app must not hear about it again either.
+  nm_dedupe::DedupeCache dedupe(60 * 60 * 1000);
+  auto show = [&](const nm_feed::Item& item) {
+    return dedupe.should_show(item.title + '\0' + item.message);
+  };
+
+  nm_handoff::Publisher publisher(path, 4096);
+  nm_handoff::Subscriber subscriber(path, 4096);
+  ASSERT_TRUE(subscriber.is_open());
+  std::vector<nm_feed::Item> items;
+  ASSERT_TRUE(publisher.publish_shown({item(1), item(2)}, show));
+  EXPECT_TRUE(subscriber.wait(1000));
+  EXPECT_EQ(subscriber.read(&items), 0u);
+  EXPECT_EQ(items.size(), 2u);
+
+  items.clear();
+  ASSERT_TRUE(publisher.publish_shown({item(2), item(3)}, show));
+  EXPECT_TRUE(subscriber.wait(1000));
+  EXPECT_EQ(subscriber.read(&items), 0u);
+  ASSERT_EQ(items.size(), 1u);
+  EXPECT_EQ(items[0].id, "item-3");
+
+  // Nothing new on the next poll: nothing reaches the ring.
+  ASSERT_TRUE(publisher.publish_shown({item(2)}, show));
+  EXPECT_FALSE(subscriber.wait(1));
+  items.clear();
+  EXPECT_EQ(subscriber.read(&items), 0u);
+  EXPECT_TRUE(items.empty());
+}
+
+static gboolean accept_shown(const gchar* title, const gchar* message,
+                             GObject* notification) {
+  return TRUE;
+}
+
+TEST(NotificationMasterPlugin, PendingFetchesDoNotDelayDisplay) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_fetch_lane_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  nm_prefs::PrefsStore::get().reset_for_testing(std::string(dir) +
+                                                "/prefs.ini");
+  // Takes connections into its backlog but never answers them.
+  int server = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(server, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(bind(server, (sockaddr*)&addr, sizeof(addr)), 0);
+  ASSERT_EQ(listen(server, 8), 0);
+  ASSERT_EQ(getsockname(server, (sockaddr*)&addr, &addr_len), 0);
+  std::string url =
+      "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/feed";
+
+  set_notification_sink(accept_shown);
+  NotificationMasterPlugin* plugin = (NotificationMasterPlugin*)g_object_new(
+      notification_master_plugin_get_type(), nullptr);
+  // More hanging fetches than there are display workers.
+  CallResult fetches[3];
+  for (CallResult& fetch : fetches) {
+    g_autoptr(FlValue) args = fl_value_new_map();
+    fl_value_set_string_take(args, "url", fl_value_new_string(url.c_str()));
+    fl_value_set_string_take(args, "filterTopics", fl_value_new_bool(FALSE));
+    notification_master_plugin_call(plugin, "fetchNotifications", args,
+                                    record_response, &fetch);
+  }
+  g_autoptr(FlValue) show_args = fl_value_new_map();
+  fl_value_set_string_take(show_args, "title", fl_value_new_string("Hello"));
+  fl_value_set_string_take(show_args, "message", fl_value_new_string("World"));
+  CallResult shown;
+  notification_master_plugin_call(plugin, "showNotification", show_args,
+                                  record_response, &shown);
+  gint64 deadline = g_get_monotonic_time() + 5 * G_TIME_SPAN_SECOND;
+  while (shown.calls == 0 && g_get_monotonic_time() < deadline) {
+    if (!g_main_context_iteration(nullptr, FALSE)) g_usleep(1000);
+  }
+  EXPECT_EQ(shown.calls, 1);
+  EXPECT_TRUE(shown.success);
+  for (const CallResult& fetch : fetches) EXPECT_EQ(fetch.calls, 0);
+
+  // Closing the listener resets the waiting connections; every fetch fails.
+  close(server);
+  for (const CallResult& fetch : fetches) {
+    while (fetch.calls == 0) g_main_context_iteration(nullptr, TRUE);
+    EXPECT_FALSE(fetch.success);
+  }
+  g_object_unref(plugin);
+  set_notification_sink(nullptr);
+}
+
+TEST(NotificationMasterPlugin, DedupeRemembersOnlyWhatWasShown) {
+  // The daemon checks with seen() and calls remember() after a successful
+  // show, so a rate-limited or failed item is shown when it comes back.
+  nm_dedupe::DedupeCache cache(60 * 60 * 1000);
+  EXPECT_FALSE(cache.seen("a"));
+  EXPECT_FALSE(cache.seen("a"));
+  EXPECT_EQ(cache.size(), 0u);
+  cache.remember("a");
+  EXPECT_TRUE(cache.seen("a"));
+  EXPECT_FALSE(cache.should_show("a"));
+
+  nm_dedupe::NearDuplicateIndex index(60 * 60 * 1000);
+  const uint64_t a = 0x0123456789abcdefULL;
+  EXPECT_FALSE(index.seen(a, 3));
+  EXPECT_FALSE(index.seen(a ^ 0x7, 3));
+  EXPECT_EQ(index.size(), 0u);
+  index.remember(a);
+  EXPECT_TRUE(index.seen(a ^ 0x7, 3));
+  EXPECT_FALSE(index.seen(a ^ 0xf, 3));
+}
+
+TEST(NotificationMasterPlugin, NearDuplicateDistanceIsValidated) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_config_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  const std::string conf_path = std::string(dir) + "/" + nm_config::kConfFile;
+  nm_config::PollerConfigStore store(dir);
+  for (const char* value : {"0", "8", "64", "-3", "3x"}) {
+    std::string conf =
+        std::string("[poller]\nnear_duplicates=") + value + "\n";
+    ASSERT_TRUE(
+        g_file_set_contents(conf_path.c_str(), conf.c_str(), -1, nullptr));
+    store.load();
+    EXPECT_EQ(store.current().near_duplicates, 0) << value;
+    ASSERT_EQ(store.current().warnings.size(), 1u) << value;
+    EXPECT_NE(store.current().warnings[0].find("near_duplicates"),
+              std::string::npos);
+  }
+  ASSERT_TRUE(g_file_set_contents(
+      conf_path.c_str(), "[poller]\nnear_duplicates=7\n", -1, nullptr));
+  store.load();
+  EXPECT_EQ(store.current().near_duplicates, 7);
+  EXPECT_TRUE(store.current().warnings.empty());
+}
+
+TEST(NotificationMasterPlugin, UnregisteredChannelsAreLimitedSeparately) {
+  nm_channels::Channel fallback;
+  fallback.id = nm_channels::kDefaultChannel;
+  fallback.name = "Default";
+  fallback.rate_per_minute = 6;  // one every 10 s
+  fallback.burst = 1;
+  nm_channels::Registry registry;
+  registry.set({fallback});
+
+  nm_channels::Channel policy;
+  const int64_t now = 1000;
+  EXPECT_TRUE(registry.admit("noisy", now, &policy));
+  EXPECT_EQ(policy.name, "Default");
+  EXPECT_FALSE(registry.admit("noisy", now, &policy));
+  EXPECT_FALSE(registry.admit("noisy", now + 5000, &policy));
+  // Another unregistered id still has its whole burst.
+  EXPECT_TRUE(registry.admit("quiet", now + 5000, &policy));
+  EXPECT_FALSE(registry.admit("quiet", now + 5000, &policy));
+  EXPECT_TRUE(registry.admit("noisy", now + 10000, &policy));
+  // Unregistered ids are not listed as channels.
+  EXPECT_EQ(registry.channels().size(), 1u);
+
+  // A new default policy starts every unregistered id from a full bucket.
+  fallback.burst = 2;
+  registry.put(fallback);
+  EXPECT_TRUE(registry.admit("noisy", now + 10000, &policy));
+  EXPECT_TRUE(registry.admit("noisy", now + 10000, &policy));
+  EXPECT_FALSE(registry.admit("noisy", now + 10000, &policy));
+}
+
+TEST(NotificationMasterPlugin, SearchIndexesBigTextInTheBackground) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_search_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  std::string path = std::string(dir) + "/history.log";
+  {
+    nm_history::Writer writer(path);
+    for (int i = 0; i < 2000; ++i) {
+      nm_history::Record record;
+      record.title = "Item " + std::to_string(i);
+      record.message = "Nothing to see";
+      if (i == 1500) record.big_text = "Rollback finished on web-3";
+      ASSERT_TRUE(writer.append(record));
+    }
+  }
+  nm_history::Reader reader(path);
+  reader.refresh();
+  // Secondary indexes read the log in bounded batches.
+  int visited = 0;
+  EXPECT_EQ(reader.scan(1995, 100,
+                        [&visited](const nm_history::Record&) { ++visited; }),
+            2000);
+  EXPECT_EQ(visited, 5);
+  visited = 0;
+  EXPECT_EQ(reader.scan(0, 10,
+                        [&visited](const nm_history::Record&) { ++visited; }),
+            10);
+  EXPECT_EQ(visited, 10);
+
+  nm_search::Searcher searcher(&reader);
+  searcher.update_in_background();
+  // History pages are served while the index is built.
+  nm_history::Query query;
+  query.limit = 1;
+  nm_history::Page page = reader.query(query);
+  ASSERT_EQ(page.records.size(), 1u);
+  EXPECT_EQ(page.records[0].seq, 1999);
+  std::vector<nm_history::Record> found = searcher.search("rollback web", 10);
+  ASSERT_EQ(found.size(), 1u);
+  EXPECT_EQ(found[0].seq, 1500);
+  EXPECT_EQ(found[0].message, "Nothing to see");
+  EXPECT_EQ(found[0].big_text, "Rollback finished on web-3");
+  // A second background run only picks up what is new.
+  searcher.update_in_background();
+  EXPECT_EQ(searcher.search("item 1999", 10).size(), 1u);
+}
+
+// Dumps the trace and returns otherData.dropped_threads (0 when absent);
+// |spans| receives the number of spans called |name|.
+static int64_t dump_dropped_threads(const std::string& path, const char* name,
+                                    int* spans) {
+  *spans = 0;
+  if (!nm_trace::dump_to(path)) return -1;
+  g_autofree gchar* contents = nullptr;
+  if (!g_file_get_contents(path.c_str(), &contents, nullptr, nullptr)) {
+    return -1;
+  }
+  JsonParser* parser = json_parser_new();
+  int64_t dropped = -1;
+  if (json_parser_load_from_data(parser, contents, -1, nullptr)) {
+    JsonObject* root = json_node_get_object(json_parser_get_root(parser));
+    JsonArray* events = json_object_get_array_member(root, "traceEvents");
+    for (guint i = 0; events && i < json_array_get_length(events); i++) {
+      JsonObject* e = json_array_get_object_element(events, i);
+      if (g_strcmp0(json_object_get_string_member(e, "name"), name) == 0) {
+        (*spans)++;
+      }
+    }
+    JsonObject* other = json_object_has_member(root, "otherData")
+                            ? json_object_get_object_member(root, "otherData")
+                            : nullptr;
+    dropped = other ? json_object_get_int_member(other, "dropped_threads") : 0;
+  }
+  g_object_unref(parser);
+  return dropped;
+}
+
+TEST(NotificationMasterPlugin, TraceReusesBuffersOfExitedThreads) {
+  g_autofree gchar* dir = g_dir_make_tmp("nm_trace_test_XXXXXX", nullptr);
+  ASSERT_NE(dir, nullptr);
+  const std::string path = std::string(dir) + "/trace.json";
+  nm_trace::set_enabled(true);
+  int spans = 0;
+  const int64_t dropped_before =
+      dump_dropped_threads(path, "test.short_lived", &spans);
+  ASSERT_GE(dropped_before, 0);
+
+  // Far more threads than kMaxThreads over the process lifetime, one at a
+  // time: every one gets the ring the previous one left behind.
+  const size_t kShortLived = 4 * nm_trace::kMaxThreads;
+  for (size_t i = 0; i < kShortLived; i++) {
+    std::thread([] { NM_TRACE_SCOPE("test.short_lived", "test"); }).join();
+  }
+  EXPECT_EQ(dump_dropped_threads(path, "test.short_lived", &spans),
+            dropped_before);
+  EXPECT_GE(spans, 1);
+
+  // More live threads than rings: the extra ones are counted, not traced.
+  const size_t kLive = nm_trace::kMaxThreads + 4;
+  std::atomic<size_t> recorded{0};
+  std::atomic<bool> release{false};
+  std::vector<std::thread> live;
+  for (size_t i = 0; i < kLive; i++) {
+    live.emplace_back([&] {
+      { NM_TRACE_SCOPE("test.live", "test"); }
+      recorded++;
+      while (!release) std::this_thread::yield();
+    });
+  }
+  while (recorded < kLive) std::this_thread::yield();
+  EXPECT_GE(dump_dropped_threads(path, "test.live", &spans),
+            dropped_before + 4);
+  EXPECT_LE((size_t)spans, nm_trace::kMaxThreads);
+  release = true;
+  for (auto& t : live) t.join();
+
+  // Their rings are free again once they exit.
+  std::thread([] { NM_TRACE_SCOPE("test.after_exit", "test"); }).join();
+  dump_dropped_threads(path, "test.after_exit", &spans);
+  EXPECT_EQ(spans, 1);
+  nm_trace::set_enabled(false);
+}
+
 }  // namespace test
 }  // namespace notification_master
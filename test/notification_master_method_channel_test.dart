@@ -1,6 +1,8 @@
 import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:notification_master/notification_master_method_channel.dart';
+import 'package:notification_master/src/tools/notification_event.dart';
+import 'package:notification_master/src/tools/notification_history.dart';
 
 void main() {
   TestWidgetsFlutterBinding.ensureInitialized();
@@ -23,4 +25,164 @@ void main() {
   test('getPlatformVersion', () async {
     expect(await platform.getPlatformVersion(), '42');
   });
+
+  test('fetchNotifications decodes the flat item list', () async {
+    MethodCall? sent;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+          sent = methodCall;
+          return {
+            'status': 200,
+            'notModified': false,
+            'fields': ['id', 'title', 'message', 'sentAt'],
+            'items': [
+              'a1', 'Build failed', '', 1700000000000, //
+              'a2', 'Hi', 'x', 0,
+            ],
+          };
+        });
+
+    final fetched = await platform.fetchNotifications(
+      'https://example.com/feed',
+      headers: {'Authorization': 'Bearer t'},
+    );
+    expect(sent?.arguments['headers'], ['Authorization: Bearer t']);
+    expect(fetched?.status, 200);
+    expect(fetched?.items, [
+      {'id': 'a1', 'title': 'Build failed', 'sentAt': 1700000000000},
+      {'id': 'a2', 'title': 'Hi', 'message': 'x'},
+    ]);
+  });
+
+  test('getNotificationHistory sends the filter and decodes the page',
+      () async {
+    MethodCall? sent;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+          sent = methodCall;
+          return {
+            'fields': ['seq', 'id', 'title', 'message', 'source', 'shownAt'],
+            'items': [
+              41, 7, 'Build failed', '', 'app', 1700000000000, //
+              40, 0, 'Hi', 'x', 'daemon', 1690000000000,
+            ],
+            'nextCursor': 40,
+          };
+        });
+
+    final page = await platform.getNotificationHistory(
+      cursor: 42,
+      limit: 2,
+      filter: NotificationHistoryFilter(
+        channelId: 'alerts',
+        since: DateTime.fromMillisecondsSinceEpoch(1600000000000),
+      ),
+    );
+    expect(sent?.method, 'getNotificationHistory');
+    expect(sent?.arguments, {
+      'cursor': 42,
+      'limit': 2,
+      'channelId': 'alerts',
+      'topic': null,
+      'since': 1600000000000,
+      'until': null,
+    });
+    expect(page?.nextCursor, 40);
+    expect(page?.entries.map((e) => e.seq), [41, 40]);
+    expect(page?.entries.first.id, 7);
+    expect(page?.entries.first.message, isNull);
+    expect(page?.entries.last.source, 'daemon');
+    expect(
+      page?.entries.last.shownAt,
+      DateTime.fromMillisecondsSinceEpoch(1690000000000),
+    );
+  });
+
+  test('searchNotifications sends the query and decodes the entries',
+      () async {
+    MethodCall? sent;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+          sent = methodCall;
+          return {
+            'fields': ['seq', 'title', 'message', 'source'],
+            'items': [
+              12, 'Deploy failed', 'web-1', 'feed', //
+              3, 'Deploy started', '', 'app',
+            ],
+          };
+        });
+
+    final entries = await platform.searchNotifications('deploy', limit: 5);
+    expect(sent?.method, 'searchNotifications');
+    expect(sent?.arguments, {'query': 'deploy', 'limit': 5});
+    expect(entries?.map((e) => e.seq), [12, 3]);
+    expect(entries?.first.message, 'web-1');
+    expect(entries?.last.message, isNull);
+    expect(entries?.last.source, 'app');
+  });
+
+  test('cancelNotification sends the id', () async {
+    MethodCall? sent;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+          sent = methodCall;
+          return true;
+        });
+
+    expect(await platform.cancelNotification(7), isTrue);
+    expect(sent?.method, 'cancelNotification');
+    expect(sent?.arguments, {'id': 7});
+  });
+
+  test('updateProgress sends the progress state', () async {
+    MethodCall? sent;
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+          sent = methodCall;
+          return true;
+        });
+
+    expect(await platform.updateProgress(3, progress: 100, done: true), isTrue);
+    expect(sent?.method, 'updateProgress');
+    expect(sent?.arguments, {
+      'id': 3,
+      'progress': 100,
+      'title': null,
+      'message': null,
+      'done': true,
+    });
+  });
+
+  test('notificationEvents decodes batches and skips unknown types', () async {
+    const events = EventChannel('notification_master/events');
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockStreamHandler(
+          events,
+          MockStreamHandler.inline(
+            onListen: (arguments, sink) {
+              sink.success([
+                {'type': 0, 'id': 7},
+                {'type': 99},
+                {
+                  'type': 3,
+                  'itemId': 'a1',
+                  'payload': {'id': 'a1', 'title': 'Build failed'},
+                },
+              ]);
+            },
+          ),
+        );
+
+    final batch = await platform.notificationEvents.first;
+    expect(batch.map((e) => e.type), [
+      NotificationEventType.delivered,
+      NotificationEventType.fetched,
+    ]);
+    expect(batch[0].id, 7);
+    expect(batch[1].payload?['title'], 'Build failed');
+
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockStreamHandler(events, null);
+  });
 }
@@ -1,6 +1,9 @@
 import 'package:flutter_test/flutter_test.dart';
 import 'package:notification_master/notification_master_method_channel.dart';
 import 'package:notification_master/notification_master_platform_interface.dart';
+import 'package:notification_master/src/tools/fetched_notifications.dart';
+import 'package:notification_master/src/tools/notification_event.dart';
+import 'package:notification_master/src/tools/notification_history.dart';
 import 'package:notification_master/src/tools/notification_importance.dart';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
@@ -33,6 +36,11 @@ class MockNotificationMasterPlatform
     int? lightColor,
     bool? enableVibration,
     bool? enableSound,
+    String? sound,
+    String? category,
+    int? timeoutMs,
+    int? maxPerMinute,
+    int? burst,
   }) => Future.value(true);
   @override
   Future<bool> startNotificationPolling({
@@ -136,6 +144,36 @@ class MockNotificationMasterPlatform
   Future<List<String>> getSubscribedTopics() =>
       Future.value(List.unmodifiable(_topics));
 
+  @override
+  Future<bool> subscribeToTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) {
+    for (final topic in topics) {
+      if (!_topics.contains(topic)) _topics.add(topic);
+    }
+    return Future.value(true);
+  }
+
+  @override
+  Future<bool> unsubscribeFromTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) {
+    _topics.removeWhere(topics.contains);
+    return Future.value(true);
+  }
+
+  @override
+  Future<bool> setTopics(
+    List<String> topics, {
+    bool showConfirmation = false,
+  }) {
+    final wanted = topics.toSet();
+    _topics.removeWhere((t) => !wanted.contains(t));
+    return subscribeToTopics(topics);
+  }
+
   @override
   Future<bool> scheduleNotification({
     required int id,
@@ -168,6 +206,62 @@ class MockNotificationMasterPlatform
     throw UnimplementedError();
   }
 
+  @override
+  Future<Map<String, String>> getPollingMetrics() => Future.value(const {});
+
+  @override
+  Future<String?> dumpTrace() => Future.value(null);
+
+  @override
+  Future<FetchedNotifications?> fetchNotifications(
+    String url, {
+    Map<String, String>? headers,
+    bool conditional = true,
+    bool filterTopics = true,
+    bool show = false,
+  }) => Future.value(null);
+
+  @override
+  Stream<List<NotificationEvent>> get notificationEvents =>
+      const Stream.empty();
+
+  @override
+  Future<bool> cancelNotification(int id) => Future.value(true);
+
+  @override
+  Future<bool> cancelAllNotifications() => Future.value(true);
+
+  @override
+  Future<NotificationHistoryPage?> getNotificationHistory({
+    int? cursor,
+    int limit = 50,
+    NotificationHistoryFilter? filter,
+  }) => Future.value(const NotificationHistoryPage(entries: []));
+
+  @override
+  Future<List<NotificationHistoryEntry>?> searchNotifications(
+    String query, {
+    int limit = 20,
+  }) => Future.value(const []);
+
+  @override
+  Future<bool> showProgressNotification({
+    required int id,
+    required String title,
+    String? message,
+    int progress = 0,
+    int maxUpdatesPerSecond = 5,
+  }) => Future.value(true);
+
+  @override
+  Future<bool> updateProgress(
+    int id, {
+    required int progress,
+    String? title,
+    String? message,
+    bool done = false,
+  }) => Future.value(true);
+
   @override
   Future<bool> startBackgroundPollingService({
     required String pollingUrl,
@@ -357,6 +451,48 @@ void main() {
     });
   });
 
+  // ── Bulk topic operations ───────────────────────────────────────────────
+  group('bulk topics', () {
+    setUp(() => mock.clearTopics());
+
+    test('subscribeToTopics adds every topic once', () async {
+      await NotificationMasterPlatform.instance.subscribeToTopics([
+        'news',
+        'offers',
+        'news',
+      ]);
+      final topics = await NotificationMasterPlatform.instance
+          .getSubscribedTopics();
+      expect(topics, equals(['news', 'offers']));
+    });
+
+    test('unsubscribeFromTopics removes only the listed topics', () async {
+      await NotificationMasterPlatform.instance.subscribeToTopics([
+        'news',
+        'offers',
+        'alerts',
+      ]);
+      await NotificationMasterPlatform.instance.unsubscribeFromTopics([
+        'news',
+        'ghost',
+      ]);
+      final topics = await NotificationMasterPlatform.instance
+          .getSubscribedTopics();
+      expect(topics, equals(['offers', 'alerts']));
+    });
+
+    test('setTopics replaces the subscription set', () async {
+      await NotificationMasterPlatform.instance.subscribeToTopics([
+        'news',
+        'offers',
+      ]);
+      await NotificationMasterPlatform.instance.setTopics(['offers', 'sport']);
+      final topics = await NotificationMasterPlatform.instance
+          .getSubscribedTopics();
+      expect(topics, equals(['offers', 'sport']));
+    });
+  });
+
   // ── Full server-side workflow ───────────────────────────────────────────
   group('token + topic server-side workflow', () {
     setUp(() => mock.clearTopics());